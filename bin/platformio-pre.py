@@ -1,6 +1,8 @@
 #!/usr/bin/env python3
 # trunk-ignore-all(ruff/F821)
 # trunk-ignore-all(flake8/F821): For SConstruct imports
+import sys
+
 Import("env")
 platform = env.PioPlatform()
 
@@ -17,3 +19,8 @@ else:
 print(f"PROGNAME: {env.get('PROGNAME')}")
 if platform.name == "espressif32":
     print(f"ESP32_FS_IMAGE_NAME: {env.get('ESP32_FS_IMAGE_NAME')}")
+
+# Native unit tests get a millis() they can drive from a virtual clock (testSetMillis() in test/TestUtil.h), so simulations
+# run the firmware's timers on simulated time. Apple's ld has no --wrap, there millis() stays the wall clock.
+if platform.name == "native" and "test" in env.GetBuildType() and sys.platform.startswith("linux"):
+    env.Append(LINKFLAGS=["-Wl,--wrap=millis"], CPPDEFINES=["TEST_VIRTUAL_MILLIS"])
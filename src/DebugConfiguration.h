@@ -51,6 +51,7 @@ extern MemGet memGet;
 #define LOG_ERROR(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #define LOG_CRIT(...) SEGGER_RTT_printf(0, __VA_ARGS__)
 #define LOG_TRACE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
+#define LOG_LEVEL_ENABLED(level) (true)
 #else
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
 #define LOG_DEBUG(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
@@ -59,6 +60,8 @@ extern MemGet memGet;
 #define LOG_ERROR(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
 #define LOG_CRIT(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
 #define LOG_TRACE(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
+// Guard for log lines that are expensive to build, e.g. if (LOG_LEVEL_ENABLED(MESHTASTIC_LOG_LEVEL_DEBUG)) { ... }
+#define LOG_LEVEL_ENABLED(level) DEBUG_PORT.isLevelEnabled(level)
 #else
 #define LOG_DEBUG(...)
 #define LOG_INFO(...)
@@ -66,6 +69,7 @@ extern MemGet memGet;
 #define LOG_ERROR(...)
 #define LOG_CRIT(...)
 #define LOG_TRACE(...)
+#define LOG_LEVEL_ENABLED(level) (false)
 #endif
 #endif
 
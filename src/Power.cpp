@@ -890,7 +890,7 @@ void Power::readPowerStatus()
         char threadlist[256] = "Threads running:";
         int threadlistLen = strlen(threadlist);
         int running = 0;
-        for (int i = 0; i < MAX_THREADS; i++) {
+        for (size_t i = 0; i < concurrency::mainController.size(); i++) {
             auto thread = concurrency::mainController.get(i);
             if ((thread != nullptr) && (thread->enabled)) {
                 // Use snprintf to safely append to stack buffer without heap allocation
@@ -906,7 +906,13 @@ void Power::readPowerStatus()
         }
         LOG_HEAP(threadlist);
         LOG_HEAP("Heap status: %d/%d bytes free (%d), running %d/%d threads", memGet.getFreeHeap(), memGet.getHeapSize(),
-                 memGet.getFreeHeap() - lastheap, running, concurrency::mainController.size(false));
+                 memGet.getFreeHeap() - lastheap, running, concurrency::mainController.size());
+        char busiest[256];
+        concurrency::mainController.describeBusiest(busiest, sizeof(busiest), 8);
+        LOG_HEAP("Busiest threads: %s", busiest);
+        const AllocatorStats pool = packetPool.getStats();
+        LOG_HEAP("Packet pool: %u in use, %u high water, %u capacity, %u alloc failures", pool.inUse, pool.highWater,
+                 pool.capacity, pool.allocFailures);
         lastheap = memGet.getFreeHeap();
     }
 #ifdef DEBUG_HEAP_MQTT
@@ -0,0 +1,170 @@
+#include "Profiler.h"
+
+#if !MESHTASTIC_EXCLUDE_PROFILER
+#include "concurrency/OSThread.h"
+#include "serialization/JsonWriter.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+Profiler profiler;
+
+/**
+ * Writes the busiest points to the log every PROFILER_LOG_INTERVAL_MS
+ */
+class ProfilerThread : public concurrency::OSThread
+{
+  public:
+    ProfilerThread() : OSThread("Profiler", PROFILER_LOG_INTERVAL_MS) {}
+
+  protected:
+    int32_t runOnce() override
+    {
+        char text[256];
+        if (profiler.describe(text, sizeof(text), 8) > 0)
+            LOG_INFO("Profile: %s", text);
+        return RUN_SAME;
+    }
+};
+
+static ProfilerThread *profilerThread;
+
+/// The places PROFILE_SCOPE and Router::runOnce() record to, besides the modules
+static const char *const fixedPoints[PROFILER_FIXED_POINTS][2] = {
+    {"router", "rx_wait"}, {"router", "decode"}, {"router", "filter"},
+    {"router", "modules"}, {"router", "rebroadcast"}, {"mqtt", "publish"},
+};
+
+Profiler::Profiler()
+{
+    for (const auto &point : fixedPoints)
+        pointFor(point[0], point[1]);
+}
+
+void LatencyHistogram::record(uint32_t us)
+{
+    uint8_t bucket = 0;
+    if (us >= 8)
+        bucket = std::min(31 - __builtin_clz(us) - 2, PROFILER_BUCKETS - 1);
+    buckets[bucket]++;
+    count++;
+    totalUs += us;
+    if (us > maxUs)
+        maxUs = us;
+}
+
+uint32_t LatencyHistogram::percentileUs(uint8_t percent) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t wanted = ((uint64_t)count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < PROFILER_BUCKETS - 1; i++) {
+        seen += buckets[i];
+        if (seen >= wanted)
+            return std::min<uint32_t>(8u << i, maxUs);
+    }
+    return maxUs;
+}
+
+int16_t Profiler::pointFor(const char *kind, const char *name)
+{
+    return findOrAdd(kind, name, false);
+}
+
+int16_t Profiler::findOrAdd(const char *kind, const char *name, bool thread)
+{
+    char fullName[PROFILER_NAME_LEN];
+    snprintf(fullName, sizeof(fullName), "%s/%s", kind, name);
+
+    for (uint8_t i = 0; i < numPoints; i++)
+        if (strcmp(points[i].name, fullName) == 0)
+            return i;
+
+    if (thread ? numThreadPoints == PROFILER_MAX_THREAD_POINTS : numPoints - numThreadPoints == PROFILER_MAX_POINTS)
+        return PROFILER_NO_POINT;
+
+    Point &point = points[numPoints];
+    strcpy(point.name, fullName);
+    memset(&point.histogram, 0, sizeof(point.histogram));
+    if (thread)
+        numThreadPoints++;
+    return numPoints++;
+}
+
+void Profiler::reset()
+{
+    for (uint8_t i = 0; i < numPoints; i++)
+        memset(&points[i].histogram, 0, sizeof(points[i].histogram));
+}
+
+void Profiler::startLogging()
+{
+    if (!profilerThread)
+        profilerThread = new ProfilerThread();
+}
+
+size_t Profiler::busiest(uint8_t *order, size_t maxPoints) const
+{
+    for (uint8_t i = 0; i < numPoints; i++)
+        order[i] = i;
+    std::sort(order, order + numPoints,
+              [this](uint8_t a, uint8_t b) { return points[a].histogram.totalUs > points[b].histogram.totalUs; });
+    return std::min(maxPoints, (size_t)numPoints);
+}
+
+size_t Profiler::describe(char *buf, size_t bufSize, size_t maxPoints) const
+{
+    uint8_t order[TABLE_SIZE];
+    size_t n = busiest(order, maxPoints);
+
+    size_t len = 0;
+    buf[0] = 0;
+    for (size_t i = 0; i < n && len < bufSize; i++) {
+        const Point &point = points[order[i]];
+        if (point.histogram.count == 0)
+            break;
+        int written = snprintf(buf + len, bufSize - len, "%s%s n=%u p50=%u p99=%u max=%uus", len ? ", " : "", point.name,
+                               (unsigned)point.histogram.count, (unsigned)point.histogram.percentileUs(50),
+                               (unsigned)point.histogram.percentileUs(99), (unsigned)point.histogram.maxUs);
+        if (written < 0)
+            break;
+        len += written;
+    }
+    return len < bufSize ? len : bufSize - 1;
+}
+
+size_t Profiler::toJson(char *buf, size_t bufSize) const
+{
+    JsonWriter json(buf, bufSize);
+    json.beginObject();
+    json.key("uptime_ms").number((unsigned int)millis());
+    // Bucket n counts the runs shorter than bucket_limits_us[n] (and not shorter than the one before), the last one the rest
+    json.key("bucket_limits_us").beginArray();
+    for (uint8_t i = 0; i < PROFILER_BUCKETS - 1; i++)
+        json.number(8u << i);
+    json.endArray();
+
+    json.key("points").beginArray();
+    for (uint8_t i = 0; i < numPoints; i++) {
+        const LatencyHistogram &histogram = points[i].histogram;
+        json.beginObject();
+        json.key("name").string(points[i].name);
+        json.key("count").number((unsigned int)histogram.count);
+        json.key("total_us").number((double)histogram.totalUs);
+        json.key("p50_us").number((unsigned int)histogram.percentileUs(50));
+        json.key("p99_us").number((unsigned int)histogram.percentileUs(99));
+        json.key("max_us").number((unsigned int)histogram.maxUs);
+        json.key("buckets").beginArray();
+        for (uint8_t b = 0; b < PROFILER_BUCKETS; b++)
+            json.number((unsigned int)histogram.buckets[b]);
+        json.endArray();
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    return json.finish();
+}
+
+#endif
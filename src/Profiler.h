@@ -0,0 +1,181 @@
+#pragma once
+
+#include "configuration.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/// Histogram buckets: bucket 0 counts runs under 8 usecs, bucket n runs of [2^(n+2), 2^(n+3)) usecs, the last one anything longer
+#define PROFILER_BUCKETS 16
+
+/// The router stages and MQTT, which get their points up front
+#define PROFILER_FIXED_POINTS 6
+
+/// Enough for the fixed points and one per module, there are about 40 modules on ESP32 and Linux and fewer elsewhere
+#ifndef PROFILER_MAX_POINTS
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#define PROFILER_MAX_POINTS (PROFILER_FIXED_POINTS + 48)
+#else
+#define PROFILER_MAX_POINTS (PROFILER_FIXED_POINTS + 32)
+#endif
+#endif
+
+/// Threads have points of their own, so they can't take the ones of the router and modules. Threads beyond these aren't profiled.
+#ifndef PROFILER_MAX_THREAD_POINTS
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#define PROFILER_MAX_THREAD_POINTS 48
+#else
+#define PROFILER_MAX_THREAD_POINTS 32
+#endif
+#endif
+
+/// How often the profile is written to the log
+#ifndef PROFILER_LOG_INTERVAL_MS
+#define PROFILER_LOG_INTERVAL_MS (15 * 60 * 1000)
+#endif
+
+#define PROFILER_NAME_LEN 32
+
+/// Not a profile point, recording to it does nothing
+#define PROFILER_NO_POINT -1
+/// A cached point that wasn't looked up yet
+#define PROFILER_UNKNOWN_POINT -2
+
+/**
+ * Run times of one place in the code, in a fixed amount of memory
+ */
+struct LatencyHistogram {
+    uint32_t buckets[PROFILER_BUCKETS];
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t totalUs;
+
+    void record(uint32_t us);
+
+    /// Upper bound of the run time that percent of the runs stayed under, no more than maxUs
+    uint32_t percentileUs(uint8_t percent) const;
+};
+
+/**
+ * @brief Collects how long threads, modules and the stages of the router take
+ *
+ * Every profiled place in the code gets a point, named like "router/decode" or "module/routing", with a histogram of its run
+ * times. The points are kept in a fixed size table, places beyond PROFILER_MAX_POINTS are not profiled. The router stages
+ * are added first, so they are always there. Spans include the time of the spans nested in them.
+ *
+ * Every run of a thread is recorded as "thread/<name>", in a block of PROFILER_MAX_THREAD_POINTS points of their own, so
+ * however many threads start before the first packet comes in, the router and modules keep their points.
+ *
+ * Recording happens on the main loop. Readers on other threads, like the portduino web server, may see a run half recorded.
+ */
+class Profiler
+{
+  public:
+    Profiler();
+
+    /**
+     * Find the point called kind/name, adding it if there is none yet
+     *
+     * @return the point, or PROFILER_NO_POINT if the table is full
+     */
+    int16_t pointFor(const char *kind, const char *name);
+
+    /// pointFor(), looked up only the first time, for callers that keep the point around starting as PROFILER_UNKNOWN_POINT
+    int16_t pointFor(const char *kind, const char *name, int16_t &cached)
+    {
+        if (cached == PROFILER_UNKNOWN_POINT)
+            cached = pointFor(kind, name);
+        return cached;
+    }
+
+    /// Like pointFor(), but for thread/name in the block of thread points
+    int16_t threadPointFor(const char *name, int16_t &cached)
+    {
+        if (cached == PROFILER_UNKNOWN_POINT)
+            cached = findOrAdd("thread", name, true);
+        return cached;
+    }
+
+    void record(int16_t point, uint32_t us)
+    {
+        if (point >= 0 && point < numPoints)
+            points[point].histogram.record(us);
+    }
+
+    size_t size() const { return numPoints; }
+    const char *name(size_t point) const { return points[point].name; }
+    const LatencyHistogram &histogram(size_t point) const { return points[point].histogram; }
+
+    /// Forget all run times, but keep the points
+    void reset();
+
+    /// Start writing the busiest points to the log every PROFILER_LOG_INTERVAL_MS
+    void startLogging();
+
+    /**
+     * Describe the maxPoints points that took the most time in total, like "thread/Router n=12 p50=64 p99=512 max=900us, ..."
+     *
+     * @return the length of the text, cut off to fit buf
+     */
+    size_t describe(char *buf, size_t bufSize, size_t maxPoints) const;
+
+    /**
+     * Write every point as JSON. Like snprintf, the output is cut off if it doesn't fit.
+     *
+     * @return the length of the complete JSON, it didn't fit if >= bufSize
+     */
+    size_t toJson(char *buf, size_t bufSize) const;
+
+  private:
+    struct Point {
+        char name[PROFILER_NAME_LEN];
+        LatencyHistogram histogram;
+    };
+
+    static const size_t TABLE_SIZE = PROFILER_MAX_POINTS + PROFILER_MAX_THREAD_POINTS;
+
+    Point points[TABLE_SIZE];
+    uint8_t numPoints = 0;
+    uint8_t numThreadPoints = 0;
+
+    int16_t findOrAdd(const char *kind, const char *name, bool thread);
+
+    /// The points sorted by the time they took in total, longest first
+    size_t busiest(uint8_t *order, size_t maxPoints) const;
+};
+
+extern Profiler profiler;
+
+/**
+ * Records the time from its construction to its destruction to a profile point
+ */
+class ProfileSpan
+{
+  public:
+    explicit ProfileSpan(int16_t point) : point(point), start(micros()) {}
+    ~ProfileSpan() { profiler.record(point, micros() - start); }
+
+  private:
+    int16_t point;
+    uint32_t start;
+};
+
+#if !MESHTASTIC_EXCLUDE_PROFILER
+
+#define PROFILER_CONCAT2(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT2(a, b)
+
+/// Profile the rest of the enclosing block as kind/name, both must be string literals
+#define PROFILE_SCOPE(kind, name)                                                                                                \
+    static const int16_t PROFILER_CONCAT(profilePoint, __LINE__) = profiler.pointFor(kind, name);                                \
+    ProfileSpan PROFILER_CONCAT(profileSpan, __LINE__)(PROFILER_CONCAT(profilePoint, __LINE__))
+
+/// Profile the rest of the enclosing block as kind/name, looking the point up once and keeping it in cached
+#define PROFILE_SCOPE_CACHED(kind, name, cached)                                                                                 \
+    ProfileSpan PROFILER_CONCAT(profileSpan, __LINE__)(profiler.pointFor(kind, name, cached))
+
+#else
+
+#define PROFILE_SCOPE(kind, name)
+#define PROFILE_SCOPE_CACHED(kind, name, cached)
+
+#endif
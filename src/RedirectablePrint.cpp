@@ -274,16 +274,28 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
     return ll;
 }
 
-void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+bool RedirectablePrint::isLevelEnabled(const char *logLevel)
 {
+#if ARCH_PORTDUINO
+    // level trace is special, it can also go to the trace file
+    if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0)
+        return portduino_config.traceFilename != "" || portduino_config.logoutputlevel >= level_trace;
+    if (portduino_config.logoutputlevel < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
+        return false;
+    } else if (portduino_config.logoutputlevel < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
+        return false;
+    } else if (portduino_config.logoutputlevel < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
+        return false;
+    }
+#endif
+    if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
+        return false;
+    }
+    return true;
+}
 
-    // append \n to format
-    size_t len = strlen(format);
-    auto newFormat = std::unique_ptr<char[]>(new char[len + 2]);
-    strcpy(newFormat.get(), format);
-    newFormat[len] = '\n';
-    newFormat[len + 1] = '\0';
-
+void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+{
 #if ARCH_PORTDUINO
     // level trace is special, two possible ways to handle it.
     if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
@@ -296,22 +308,28 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
             }
             va_end(arg);
         }
-        if (portduino_config.logoutputlevel < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
+        if (portduino_config.logoutputlevel < level_trace) {
             return;
         }
     }
-    if (portduino_config.logoutputlevel < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        return;
-    } else if (portduino_config.logoutputlevel < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
-        return;
-    } else if (portduino_config.logoutputlevel < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
-        return;
-    }
 #endif
-    if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
+    if (!isLevelEnabled(logLevel)) {
         return;
     }
 
+    // append \n to format, on the stack unless the format is unusually long
+    char stackFormat[160];
+    std::unique_ptr<char[]> heapFormat;
+    char *newFormat = stackFormat;
+    size_t len = strlen(format);
+    if (len + 2 > sizeof(stackFormat)) {
+        heapFormat.reset(new char[len + 2]);
+        newFormat = heapFormat.get();
+    }
+    memcpy(newFormat, format, len);
+    newFormat[len] = '\n';
+    newFormat[len + 1] = '\0';
+
 #ifdef HAS_FREE_RTOS
     if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
 #else
@@ -325,14 +343,14 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
         va_start(arg, format);
 
         va_copy(arg_copy, arg);
-        log_to_serial(logLevel, newFormat.get(), arg_copy);
+        log_to_serial(logLevel, newFormat, arg_copy);
         va_end(arg_copy);
 
         va_copy(arg_copy, arg);
-        log_to_syslog(logLevel, newFormat.get(), arg_copy);
+        log_to_syslog(logLevel, newFormat, arg_copy);
         va_end(arg_copy);
 
-        log_to_ble(logLevel, newFormat.get(), arg);
+        log_to_ble(logLevel, newFormat, arg);
 
         va_end(arg);
 #ifdef HAS_FREE_RTOS
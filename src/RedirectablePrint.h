@@ -41,6 +41,11 @@ class RedirectablePrint : public Print
      */
     void log(const char *logLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
 
+    /**
+     * Would log() output anything at this level? Lets callers skip formatting expensive log lines nobody will see.
+     */
+    bool isLevelEnabled(const char *logLevel);
+
     /** like printf but va_list based */
     size_t vprintf(const char *logLevel, const char *format, va_list arg);
 
@@ -17,26 +17,19 @@ bool OSThread::showWaiting = false;
 
 const OSThread *OSThread::currentThread;
 
-ThreadController mainController, timerController;
+Scheduler mainController("mainController"), timerController("timerController");
 InterruptableDelay mainDelay;
 
-void OSThread::setup()
-{
-    mainController.ThreadName = "mainController";
-    timerController.ThreadName = "timerController";
-}
+void OSThread::setup() {}
 
-OSThread::OSThread(const char *_name, uint32_t period, ThreadController *_controller)
-    : Thread(NULL, period), controller(_controller)
+OSThread::OSThread(const char *_name, uint32_t period, Scheduler *_controller) : Thread(NULL, period), controller(_controller)
 {
     assertIsSetup();
 
     ThreadName = _name;
 
-    if (controller) {
-        bool added = controller->add(this);
-        assert(added);
-    }
+    if (controller)
+        controller->add(this);
 }
 
 OSThread::~OSThread()
@@ -45,16 +38,30 @@ OSThread::~OSThread()
         controller->remove(this);
 }
 
+/**
+ * Wait a specified number msecs starting from the last time we were run. Safe to call from an ISR.
+ */
+IRAM_ATTR void OSThread::setInterval(unsigned long _interval)
+{
+    Thread::setInterval(_interval);
+
+    if (controller)
+        controller->reschedule(this);
+}
+
 /**
  * Wait a specified number msecs starting from the current time (rather than the last time we were run)
  */
-void OSThread::setIntervalFromNow(unsigned long _interval)
+IRAM_ATTR void OSThread::setIntervalFromNow(unsigned long _interval)
 {
     // Save interval
     interval = _interval;
 
     // Cache the next run based on the last_run
     _cached_next_run = millis() + interval;
+
+    if (controller)
+        controller->reschedule(this);
 }
 
 bool OSThread::shouldRun(unsigned long time)
@@ -82,7 +89,14 @@ void OSThread::run()
     auto heap = memGet.getFreeHeap();
 #endif
     currentThread = this;
+    uint32_t start = micros();
     auto newDelay = runOnce();
+    uint32_t elapsed = micros() - start;
+    runTimeUs += elapsed;
+    runCount++;
+#if !MESHTASTIC_EXCLUDE_PROFILER
+    profiler.record(profiler.threadPointFor(ThreadName.c_str(), profilePoint), elapsed);
+#endif
 #ifdef DEBUG_HEAP
     auto newHeap = memGet.getFreeHeap();
     if (newHeap < heap)
@@ -109,6 +123,14 @@ int32_t OSThread::disable()
     return INT32_MAX;
 }
 
+IRAM_ATTR void OSThread::enable()
+{
+    enabled = true;
+
+    if (controller)
+        controller->reschedule(this);
+}
+
 /**
  * This flag is set **only** when setup() starts, to provide a way for us to check for sloppy static constructor calls.
  * Call assertIsSetup() to force a crash if someone tries to create an instance too early.
@@ -1,16 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <stdint.h>
 
+#include "Profiler.h"
 #include "Thread.h"
-#include "ThreadController.h"
 #include "concurrency/InterruptableDelay.h"
+#include "concurrency/Scheduler.h"
 
 namespace concurrency
 {
 
-extern ThreadController mainController, timerController;
+extern Scheduler mainController, timerController;
 extern InterruptableDelay mainDelay;
 
 #define RUN_SAME -1
@@ -30,7 +32,23 @@ extern InterruptableDelay mainDelay;
  */
 class OSThread : public Thread
 {
-    ThreadController *controller;
+    friend class Scheduler;
+
+    Scheduler *controller;
+
+    /// Where the scheduler keeps us
+    enum SchedState : uint8_t { SCHED_NONE, SCHED_WAITING, SCHED_PARKED, SCHED_DUE };
+    SchedState schedState = SCHED_NONE;
+    size_t heapIndex = 0; // Or in the list of parked threads
+    uint64_t deadline = 0;
+
+    /// Set while we are on the scheduler's list of rescheduled threads
+    std::atomic<bool> wakePending{false};
+    OSThread *nextWake = nullptr;
+
+    uint32_t runCount = 0;
+    uint64_t runTimeUs = 0;
+    int16_t profilePoint = PROFILER_UNKNOWN_POINT;
 
     /// Show debugging info for disabled threads
     static bool showDisabled;
@@ -45,7 +63,7 @@ class OSThread : public Thread
     /// For debug printing only (might be null)
     static const OSThread *currentThread;
 
-    OSThread(const char *name, uint32_t period = 0, ThreadController *controller = &mainController);
+    OSThread(const char *name, uint32_t period = 0, Scheduler *controller = &mainController);
 
     virtual ~OSThread();
 
@@ -55,11 +73,29 @@ class OSThread : public Thread
 
     virtual int32_t disable();
 
+    /**
+     * Set enabled and let the scheduler know, so we run again when our interval is up. Safe to call from an ISR.
+     *
+     * Setting enabled directly is only noticed once setInterval() is called too. After disable(), call that instead.
+     */
+    void enable();
+
+    /**
+     * Wait a specified number msecs starting from the last time we were run. Safe to call from an ISR.
+     */
+    virtual void setInterval(unsigned long _interval);
+
     /**
      * Wait a specified number msecs starting from the current time (rather than the last time we were run)
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    /// How often runOnce() was called
+    uint32_t getRunCount() const { return runCount; }
+
+    /// Total time spent in runOnce(), in usecs
+    uint64_t getRunTimeUs() const { return runTimeUs; }
+
   protected:
     /**
      * The method that will be called each time our thread gets a chance to run
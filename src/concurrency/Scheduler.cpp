@@ -0,0 +1,261 @@
+#include "Scheduler.h"
+#include "OSThread.h"
+#include "configuration.h"
+#include <algorithm>
+#include <stdio.h>
+
+namespace concurrency
+{
+
+void Scheduler::add(OSThread *thread)
+{
+    threads.push_back(thread);
+    place(thread);
+}
+
+void Scheduler::remove(OSThread *thread)
+{
+    auto found = std::find(threads.begin(), threads.end(), thread);
+    if (found == threads.end())
+        return;
+    threads.erase(found);
+
+    // Make sure it isn't left on the list of rescheduled threads
+    absorbChanges();
+
+    switch (thread->schedState) {
+    case OSThread::SCHED_WAITING:
+        heapErase(thread->heapIndex);
+        break;
+    case OSThread::SCHED_PARKED:
+        unpark(thread);
+        break;
+    case OSThread::SCHED_DUE:
+        std::replace(due.begin(), due.end(), thread, (OSThread *)nullptr);
+        break;
+    default:
+        break;
+    }
+    thread->schedState = OSThread::SCHED_NONE;
+}
+
+IRAM_ATTR void Scheduler::reschedule(OSThread *thread)
+{
+    if (thread->wakePending.exchange(true))
+        return; // Already on the list
+
+    OSThread *head = wakeHead.load();
+    do {
+        thread->nextWake = head;
+    } while (!wakeHead.compare_exchange_weak(head, thread));
+}
+
+long Scheduler::runOrDelay()
+{
+    absorbChanges();
+
+    uint64_t now64 = now();
+    uint32_t time = lastMillis;
+    while (!heap.empty() && heap[0]->deadline <= now64) {
+        OSThread *thread = heap[0];
+        heapErase(0);
+        thread->schedState = OSThread::SCHED_DUE;
+        due.push_back(thread);
+    }
+
+    for (size_t i = 0; i < due.size(); i++) {
+        OSThread *thread = due[i];
+        // It might have been disabled or pushed back by a thread that ran before it
+        if (thread && thread->shouldRun(time))
+            thread->run();
+
+        // Unless running it (or anything before it) removed it
+        if (due[i]) {
+            due[i] = nullptr;
+            thread->schedState = OSThread::SCHED_NONE;
+            place(thread);
+        }
+    }
+    due.clear();
+
+    // Running threads may have woken others
+    absorbChanges();
+    if (heap.empty())
+        return INT32_MAX;
+
+    now64 = now();
+    uint64_t next = heap[0]->deadline;
+    if (next <= now64)
+        return 0;
+    return next - now64 < INT32_MAX ? (long)(next - now64) : INT32_MAX;
+}
+
+OSThread *Scheduler::busiest() const
+{
+    OSThread *busiest = nullptr;
+    for (OSThread *thread : threads)
+        if (thread->getRunTimeUs() > 0 && (!busiest || thread->getRunTimeUs() > busiest->getRunTimeUs()))
+            busiest = thread;
+    return busiest;
+}
+
+size_t Scheduler::describeBusiest(char *buf, size_t bufSize, size_t maxThreads) const
+{
+    std::vector<OSThread *> sorted(threads);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const OSThread *a, const OSThread *b) { return a->getRunTimeUs() > b->getRunTimeUs(); });
+    if (sorted.size() > maxThreads)
+        sorted.resize(maxThreads);
+
+    size_t len = 0;
+    buf[0] = 0;
+    for (const OSThread *thread : sorted) {
+        if (len >= bufSize)
+            break;
+        int n = snprintf(buf + len, bufSize - len, "%s%s %ux %ums", len ? ", " : "", thread->ThreadName.c_str(),
+                         (unsigned)thread->getRunCount(), (unsigned)(thread->getRunTimeUs() / 1000));
+        if (n < 0)
+            break;
+        len += n;
+    }
+    return len < bufSize ? len : bufSize - 1;
+}
+
+uint64_t Scheduler::now()
+{
+    uint32_t millis32 = millis();
+    clock64 += (uint32_t)(millis32 - lastMillis);
+    lastMillis = millis32;
+    return clock64;
+}
+
+uint64_t Scheduler::deadlineOf(const OSThread *thread) const
+{
+    // Thread::shouldRun() looks at the sign of the 32 bit difference too, so a deadline is never more than 2^31 msecs away
+    int32_t remaining = (int32_t)((uint32_t)thread->_cached_next_run - lastMillis);
+    if (remaining < 0 && (uint64_t)-(int64_t)remaining > clock64)
+        return 0;
+    return clock64 + remaining;
+}
+
+void Scheduler::absorbChanges()
+{
+    OSThread *thread = wakeHead.exchange(nullptr);
+    if (!thread)
+        return;
+
+    now();
+    while (thread) {
+        OSThread *next = thread->nextWake;
+        // Clear it before looking at the thread, so a reschedule from an ISR while we do is not lost
+        thread->wakePending = false;
+
+        if (thread->schedState == OSThread::SCHED_WAITING) {
+            if (!thread->enabled) {
+                heapErase(thread->heapIndex);
+                park(thread);
+            } else {
+                uint64_t old = thread->deadline;
+                thread->deadline = deadlineOf(thread);
+                if (thread->deadline < old)
+                    siftUp(thread->heapIndex);
+                else
+                    siftDown(thread->heapIndex);
+            }
+        } else if (thread->schedState == OSThread::SCHED_PARKED && thread->enabled) {
+            unpark(thread);
+            thread->deadline = deadlineOf(thread);
+            heapPush(thread);
+        }
+        // Due ones find their place once they ran
+
+        thread = next;
+    }
+}
+
+void Scheduler::place(OSThread *thread)
+{
+    if (thread->enabled) {
+        now();
+        thread->deadline = deadlineOf(thread);
+        heapPush(thread);
+    } else {
+        park(thread);
+    }
+}
+
+void Scheduler::park(OSThread *thread)
+{
+    thread->schedState = OSThread::SCHED_PARKED;
+    thread->heapIndex = parked.size();
+    parked.push_back(thread);
+}
+
+void Scheduler::unpark(OSThread *thread)
+{
+    OSThread *last = parked.back();
+    parked.pop_back();
+    if (last != thread) {
+        parked[thread->heapIndex] = last;
+        last->heapIndex = thread->heapIndex;
+    }
+    thread->schedState = OSThread::SCHED_NONE;
+}
+
+void Scheduler::heapPush(OSThread *thread)
+{
+    thread->schedState = OSThread::SCHED_WAITING;
+    heap.push_back(thread);
+    thread->heapIndex = heap.size() - 1;
+    siftUp(thread->heapIndex);
+}
+
+void Scheduler::heapErase(size_t i)
+{
+    OSThread *last = heap.back();
+    heap.pop_back();
+    if (i < heap.size()) {
+        heapSet(i, last);
+        siftUp(i);
+        siftDown(last->heapIndex);
+    }
+}
+
+void Scheduler::siftUp(size_t i)
+{
+    OSThread *thread = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent]->deadline <= thread->deadline)
+            break;
+        heapSet(i, heap[parent]);
+        i = parent;
+    }
+    heapSet(i, thread);
+}
+
+void Scheduler::siftDown(size_t i)
+{
+    OSThread *thread = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && heap[child + 1]->deadline < heap[child]->deadline)
+            child++;
+        if (thread->deadline <= heap[child]->deadline)
+            break;
+        heapSet(i, heap[child]);
+        i = child;
+    }
+    heapSet(i, thread);
+}
+
+void Scheduler::heapSet(size_t i, OSThread *thread)
+{
+    heap[i] = thread;
+    thread->heapIndex = i;
+}
+
+} // namespace concurrency
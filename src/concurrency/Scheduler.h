@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace concurrency
+{
+
+class OSThread;
+
+/**
+ * @brief Runs OSThreads when they are due
+ *
+ * Threads wait in a min-heap ordered by their next run time, so the next deadline is always at the top and moving a thread
+ * after setInterval() costs O(log n), instead of asking every thread whether it should run on every pass.
+ *
+ * setInterval() may be called from ISRs and other tasks, so it only pushes the thread on a lock free list, which runOrDelay()
+ * works off before it looks at the heap. Disabled threads are parked outside the heap and cost nothing until OSThread::enable()
+or a setInterval() puts them on that list again.
+ *
+ * Like ThreadController before it, add(), remove() and runOrDelay() must only be called from the main loop.
+ */
+class Scheduler
+{
+  public:
+    explicit Scheduler(const char *name) : name(name) {}
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    void add(OSThread *thread);
+    void remove(OSThread *thread);
+
+    /**
+     * Run every thread that is due, each at most once
+     *
+     * @return msecs until the next thread is due
+     */
+    long runOrDelay();
+
+    /// Note that the next run time of thread changed. Safe to call from an ISR.
+    void reschedule(OSThread *thread);
+
+    /// Number of threads, get(0) to get(size() - 1) are all of them
+    size_t size() const { return threads.size(); }
+    OSThread *get(size_t i) const { return i < threads.size() ? threads[i] : nullptr; }
+
+    /// The thread that has spent the most time running, or nullptr if none has run yet
+    OSThread *busiest() const;
+
+    /**
+     * Describe the maxThreads threads that spent the most time running, busiest first, like "Router 120x 35ms, ..."
+     *
+     * @return the length of the text, cut off to fit buf
+     */
+    size_t describeBusiest(char *buf, size_t bufSize, size_t maxThreads) const;
+
+    const char *const name;
+
+  private:
+    std::vector<OSThread *> threads;
+
+    /// Enabled threads that are waiting for their deadline, soonest first
+    std::vector<OSThread *> heap;
+
+    /// Disabled threads, each at its OSThread::heapIndex
+    std::vector<OSThread *> parked;
+
+    /// Threads popped off the heap by the current pass, remove() clears their slot
+    std::vector<OSThread *> due;
+
+    /// Threads whose next run time changed, linked through OSThread::nextWake
+    std::atomic<OSThread *> wakeHead{nullptr};
+
+    /// millis() extended to 64 bits, so deadlines keep their order across the 49 day wrap
+    uint64_t clock64 = 0;
+    uint32_t lastMillis = 0;
+
+    /// Advance the 64 bit clock to millis()
+    uint64_t now();
+
+    /// Deadline of thread on the 64 bit clock, as of the last now()
+    uint64_t deadlineOf(const OSThread *thread) const;
+
+    /// Move threads that were rescheduled or enabled since the last pass to where they belong
+    void absorbChanges();
+
+    /// Put a thread that is in none of the lists in the heap, or park it if it is disabled
+    void place(OSThread *thread);
+
+    void park(OSThread *thread);
+    void unpark(OSThread *thread);
+
+    void heapPush(OSThread *thread);
+    void heapErase(size_t i);
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+    void heapSet(size_t i, OSThread *thread);
+};
+
+} // namespace concurrency
@@ -663,7 +663,7 @@ class Screen : public concurrency::OSThread
             return false; // not enqueued if our display is not in use
         else {
             bool success = cmdQueue.enqueue(cmd, 0);
-            enabled = true; // handle ASAP (we are the registered reader for cmdQueue, but might have been disabled)
+            enable(); // handle ASAP (we are the registered reader for cmdQueue, but might have been disabled)
             return success;
         }
     }
@@ -706,6 +706,18 @@ void drawSystemScreen(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x
         }
     }
 
+    if (SCREEN_HEIGHT > 64 && line <= 6) { // Only show the thread using the most CPU time if there is room for it
+        const concurrency::OSThread *busiest = concurrency::mainController.busiest();
+        if (busiest && millis() > 0) {
+            char busyStr[40];
+            uint32_t permille = busiest->getRunTimeUs() / millis();
+            snprintf(busyStr, sizeof(busyStr), "Busy: %.16s %u.%u%%", busiest->ThreadName.c_str(), (unsigned)(permille / 10),
+                     (unsigned)(permille % 10));
+            display->drawString((SCREEN_WIDTH - display->getStringWidth(busyStr)) / 2, getTextPositions(display)[line++],
+                                busyStr);
+        }
+    }
+
     graphics::drawCommonFooter(display, x, y);
 }
 
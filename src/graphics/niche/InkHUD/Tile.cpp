@@ -239,7 +239,7 @@ void InkHUD::Tile::requestHighlight()
 void InkHUD::Tile::startHighlightTimeout()
 {
     taskHighlight->setIntervalFromNow(5 * 1000UL);
-    taskHighlight->enabled = true;
+    taskHighlight->enable();
 }
 
 // Stop the timer which would automatically dismiss the highlighting
@@ -7,6 +7,7 @@
 #include "NodeDB.h"
 #include "PowerFSM.h"
 #include "PowerMon.h"
+#include "Profiler.h"
 #include "RadioLibInterface.h"
 #include "ReliableRouter.h"
 #include "TransmitHistory.h"
@@ -997,6 +998,10 @@ void setup()
     // Start airtime logger thread.
     airTime = new AirTime();
 
+#if !MESHTASTIC_EXCLUDE_PROFILER
+    profiler.startLogging();
+#endif
+
     if (!rIf)
         RECORD_CRITICALERROR(meshtastic_CriticalErrorCode_NO_RADIO);
     else {
@@ -3,6 +3,7 @@
 #include "CryptoEngine.h"
 #include "Default.h"
 #include "DisplayFormatters.h"
+#include "MeshModule.h"
 #include "NodeDB.h"
 #include "RadioInterface.h"
 #include "configuration.h"
@@ -39,6 +40,7 @@ uint8_t xorHash(const uint8_t *p, size_t len)
 int16_t Channels::generateHash(ChannelIndex channelNum)
 {
     auto k = getKey(channelNum);
+    keys[channelNum] = k;
     if (k.length < 0)
         return -1; // invalid
     else {
@@ -295,6 +297,7 @@ void Channels::onConfigChanged()
         if (ch.role == meshtastic_Channel_Role_PRIMARY)
             primaryIndex = i;
     }
+    MeshModule::onChannelsChanged();
 #if !MESHTASTIC_EXCLUDE_MQTT
     if (channels.anyMqttEnabled() && mqtt && !mqtt->isEnabled()) {
         LOG_DEBUG("MQTT is enabled on at least one channel, so set MQTT thread to run immediately");
@@ -337,6 +340,7 @@ void Channels::setChannel(const meshtastic_Channel &c)
                 channelFile.channels[i].role = meshtastic_Channel_Role_SECONDARY;
 
     old = c; // slam in the new settings/role
+    MeshModule::onChannelsChanged();
 }
 
 bool Channels::anyMqttEnabled()
@@ -408,17 +412,27 @@ bool Channels::hasDefaultChannel()
  */
 bool Channels::decryptForHash(ChannelIndex chIndex, ChannelHash channelHash)
 {
-    if (chIndex > getNumChannels() || getHash(chIndex) != channelHash) {
+    if (chIndex >= getNumChannels() || getHash(chIndex) != channelHash) {
         // LOG_DEBUG("Skip channel %d (hash %x) due to invalid hash/index, want=%x", chIndex, getHash(chIndex),
         // channelHash);
         return false;
     } else {
         LOG_DEBUG("Use channel %d (hash 0x%x)", chIndex, channelHash);
-        setCrypto(chIndex);
+        // Use the key the hash was generated from, a valid hash implies a valid key
+        crypto->setKey(keys[chIndex]);
         return true;
     }
 }
 
+uint32_t Channels::getCandidatesForHash(ChannelHash channelHash)
+{
+    uint32_t candidates = 0;
+    for (ChannelIndex i = 0; i < getNumChannels(); i++)
+        if (hashes[i] == channelHash)
+            candidates |= (1UL << i);
+    return candidates;
+}
+
 bool Channels::setDefaultPresetCryptoForHash(ChannelHash channelHash)
 {
     // Iterate all known presets
@@ -28,6 +28,9 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// the keys the hashes above were generated from, so decoding does not have to expand PSKs per packet
+    CryptoKey keys[MAX_NUM_CHANNELS] = {};
+
   public:
     Channels() {}
 
@@ -75,6 +78,11 @@ class Channels
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
+    /** Return a bitmask of the channel indexes whose precomputed hash matches channelHash, i.e. the only channels worth
+     * trying to decrypt an inbound packet with (bit n set means channel n is a candidate)
+     */
+    uint32_t getCandidatesForHash(ChannelHash channelHash);
+
     /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
      *
      * This method is called before encoding outbound packets
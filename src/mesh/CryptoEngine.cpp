@@ -44,6 +44,7 @@ void CryptoEngine::generateKeyPair(uint8_t *pubKey, uint8_t *privKey)
 
     LOG_DEBUG("Generate Curve25519 keypair");
     Curve25519::dh1(public_key, private_key);
+    clearSharedKeyCache();
     memcpy(pubKey, public_key, sizeof(public_key));
     memcpy(privKey, private_key, sizeof(private_key));
 }
@@ -65,6 +66,7 @@ bool CryptoEngine::regeneratePublicKey(uint8_t *pubKey, uint8_t *privKey)
         }
         memcpy(private_key, privKey, sizeof(private_key));
         memcpy(public_key, pubKey, sizeof(public_key));
+        clearSharedKeyCache();
     } else {
         LOG_WARN("X25519 key generation failed due to blank private key");
         return false;
@@ -98,10 +100,9 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
         LOG_DEBUG("Node %d or their public_key not found", toNode);
         return false;
     }
-    if (!setDHPublicKey(remotePublic.bytes)) {
+    if (!deriveSharedKey(remotePublic.bytes)) {
         return false;
     }
-    hash(shared_key, 32);
     initNonce(fromNode, packetNum, extraNonceTmp);
 
     // Calculate the shared secret with the destination node and encrypt
@@ -140,10 +141,9 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     }
 
     // Calculate the shared secret with the sending node and decrypt
-    if (!setDHPublicKey(remotePublic.bytes)) {
+    if (!deriveSharedKey(remotePublic.bytes)) {
         return false;
     }
-    hash(shared_key, 32);
 
     initNonce(fromNode, packetNum, extraNonce);
     printBytes("Attempt decrypt with nonce: ", nonce, 13);
@@ -153,9 +153,56 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
 
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
 {
+    if (memcmp(private_key, _private_key, 32) != 0)
+        clearSharedKeyCache();
     memcpy(private_key, _private_key, 32);
 }
 
+bool CryptoEngine::deriveSharedKey(const uint8_t *remotePublic)
+{
+    SharedKeyCacheEntry *victim = &sharedKeyCache[0];
+    for (auto &entry : sharedKeyCache) {
+        if (entry.lastUsed && memcmp(entry.remotePublic, remotePublic, 32) == 0) {
+            entry.lastUsed = ++sharedKeyCacheClock;
+            memcpy(shared_key, entry.key, 32);
+            sharedKeyCacheHits++;
+            return true;
+        }
+        if (entry.lastUsed < victim->lastUsed)
+            victim = &entry;
+    }
+    sharedKeyCacheMisses++;
+
+    uint8_t pubKey[32];
+    memcpy(pubKey, remotePublic, 32);
+    if (!setDHPublicKey(pubKey)) {
+        return false;
+    }
+    hash(shared_key, 32);
+
+    if (sharedKeyCacheClock == UINT32_MAX) // Keep LRU ordering sane if the clock would ever wrap
+        clearSharedKeyCache();
+    memcpy(victim->remotePublic, remotePublic, 32);
+    memcpy(victim->key, shared_key, 32);
+    victim->lastUsed = ++sharedKeyCacheClock;
+    return true;
+}
+
+void CryptoEngine::invalidateSharedKey(const uint8_t *remotePublic)
+{
+    for (auto &entry : sharedKeyCache) {
+        if (entry.lastUsed && memcmp(entry.remotePublic, remotePublic, 32) == 0) {
+            memset(&entry, 0, sizeof(entry));
+        }
+    }
+}
+
+void CryptoEngine::clearSharedKeyCache()
+{
+    memset(sharedKeyCache, 0, sizeof(sharedKeyCache));
+    sharedKeyCacheClock = 0;
+}
+
 /**
  * Hash arbitrary data using SHA256.
  *
@@ -238,15 +285,40 @@ void CryptoEngine::decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes
     encryptPacket(fromNode, packetId, numBytes, bytes);
 }
 
+CTRCommon *CryptoEngine::getCtrForKey(const CryptoKey &k)
+{
+    CtrCacheEntry *victim = &ctrCache[0];
+    for (auto &entry : ctrCache) {
+        if (entry.lastUsed && entry.key.length == k.length && memcmp(entry.key.bytes, k.bytes, k.length) == 0) {
+            entry.lastUsed = ++ctrCacheClock;
+            return entry.ctr.get();
+        }
+        if (entry.lastUsed < victim->lastUsed)
+            victim = &entry;
+    }
+
+    if (ctrCacheClock == UINT32_MAX) { // Keep LRU ordering sane if the clock would ever wrap
+        for (auto &entry : ctrCache)
+            entry.lastUsed = 0;
+        ctrCacheClock = 0;
+    }
+    // Reuse the victim's cipher object if it has the right key size, the key schedule is rebuilt by setKey()
+    if (!victim->ctr || victim->key.length != k.length) {
+        if (k.length == 16)
+            victim->ctr = std::unique_ptr<CTRCommon>(new CTR<AES128>());
+        else
+            victim->ctr = std::unique_ptr<CTRCommon>(new CTR<AES256>());
+    }
+    victim->ctr->setKey(k.bytes, k.length);
+    victim->key = k;
+    victim->lastUsed = ++ctrCacheClock;
+    return victim->ctr.get();
+}
+
 // Generic implementation of AES-CTR encryption.
 void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes)
 {
-    std::unique_ptr<CTRCommon> ctr;
-    if (_key.length == 16)
-        ctr = std::unique_ptr<CTRCommon>(new CTR<AES128>());
-    else
-        ctr = std::unique_ptr<CTRCommon>(new CTR<AES256>());
-    ctr->setKey(_key.bytes, _key.length);
+    CTRCommon *ctr = getCtrForKey(_key);
     static uint8_t scratch[MAX_BLOCKSIZE];
     memcpy(scratch, bytes, numBytes);
     memset(scratch + numBytes, 0,
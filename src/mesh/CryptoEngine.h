@@ -22,6 +22,20 @@ struct CryptoKey {
  */
 
 #define MAX_BLOCKSIZE 256
+
+/// Number of expanded AES-CTR key schedules kept by the generic engine, enough for the channels a node typically decodes
+#ifndef AES_KEY_SCHEDULE_CACHE_SIZE
+#define AES_KEY_SCHEDULE_CACHE_SIZE 4
+#endif
+
+/// Number of remote public keys whose derived PKI AES key we keep, so repeat DM partners skip the X25519 + SHA256 step
+#ifndef PKI_SHARED_KEY_CACHE_SIZE
+#ifdef ARCH_PORTDUINO
+#define PKI_SHARED_KEY_CACHE_SIZE 64
+#else
+#define PKI_SHARED_KEY_CACHE_SIZE 8
+#endif
+#endif
 #define TEST_CURVE25519_FIELD_OPS // Exposes Curve25519::isWeakPoint() for testing keys
 
 class CryptoEngine
@@ -32,6 +46,9 @@ class CryptoEngine
 #endif
 
     virtual ~CryptoEngine() {}
+
+    /// Which implementation this is, for the startup log
+    virtual const char *getName() const { return "generic"; }
 #if !(MESHTASTIC_EXCLUDE_PKI)
 #if !(MESHTASTIC_EXCLUDE_PKI_KEYGEN)
     virtual void generateKeyPair(uint8_t *pubKey, uint8_t *privKey);
@@ -46,6 +63,13 @@ class CryptoEngine
     virtual bool setDHPublicKey(uint8_t *publicKey);
     virtual void hash(uint8_t *bytes, size_t numBytes);
 
+    /// Forget the AES key derived for this remote public key, e.g. because a node's key was replaced
+    void invalidateSharedKey(const uint8_t *remotePublic);
+    /// Forget all derived AES keys, required whenever our private key changes
+    void clearSharedKeyCache();
+    uint32_t getSharedKeyCacheHits() const { return sharedKeyCacheHits; }
+    uint32_t getSharedKeyCacheMisses() const { return sharedKeyCacheMisses; }
+
     virtual void aesSetKey(const uint8_t *key, size_t key_len);
 
     virtual void aesEncrypt(uint8_t *in, uint8_t *out);
@@ -78,9 +102,38 @@ class CryptoEngine
     /** Our per packet nonce */
     uint8_t nonce[16] = {0};
     CryptoKey key = {};
+
+    struct CtrCacheEntry {
+        CryptoKey key;
+        std::unique_ptr<CTRCommon> ctr; // Cipher with the key schedule for key already expanded
+        uint32_t lastUsed;              // Value of ctrCacheClock at last use, 0 means empty
+    };
+    CtrCacheEntry ctrCache[AES_KEY_SCHEDULE_CACHE_SIZE] = {};
+    uint32_t ctrCacheClock = 0;
+
+    /** Return an AES-CTR cipher keyed with k, expanding the key schedule only if it is not cached yet */
+    CTRCommon *getCtrForKey(const CryptoKey &k);
 #if !(MESHTASTIC_EXCLUDE_PKI)
     uint8_t shared_key[32] = {0};
     uint8_t private_key[32] = {0};
+
+    struct SharedKeyCacheEntry {
+        uint8_t remotePublic[32];
+        uint8_t key[32];   // SHA256 of the X25519 shared secret, as used for AES-CCM
+        uint32_t lastUsed; // Value of sharedKeyCacheClock at last use, 0 means empty
+    };
+    SharedKeyCacheEntry sharedKeyCache[PKI_SHARED_KEY_CACHE_SIZE] = {};
+    uint32_t sharedKeyCacheClock = 0;
+    uint32_t sharedKeyCacheHits = 0;
+    uint32_t sharedKeyCacheMisses = 0;
+
+    /**
+     * Load shared_key with the AES key for a remote public key, from the cache if possible, else by running
+     * setDHPublicKey() and hash() and caching the result in the least recently used entry.
+     *
+     * @return false if the key exchange failed (e.g. weak public key)
+     */
+    bool deriveSharedKey(const uint8_t *remotePublic);
 #endif
     /**
      * Init our 128 bit nonce for a new packet
@@ -2,12 +2,22 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "PointerQueue.h"
 #include "configuration.h" // For LOG_WARN, LOG_DEBUG, LOG_HEAP
 
+/// Usage counters of an Allocator
+struct AllocatorStats {
+    uint32_t inUse;         // Objects currently handed out
+    uint32_t highWater;     // Most objects handed out at once
+    uint32_t allocFailures; // Allocations that returned nullptr
+    uint32_t capacity;      // Objects available without touching the heap again, 0 for plain malloc
+};
+
 template <class T> class Allocator
 {
 
@@ -69,13 +79,38 @@ template <class T> class Allocator
     /// Return a buffer for use by others
     virtual void release(T *p) = 0;
 
+    /// Snapshot of the usage counters
+    AllocatorStats getStats() const
+    {
+        return AllocatorStats{inUse.load(), highWater.load(), allocFailures.load(), getCapacity()};
+    }
+
   protected:
     // Alloc some storage
     virtual T *alloc(TickType_t maxWait) = 0;
 
+    virtual uint32_t getCapacity() const { return 0; }
+
+    /// Update the counters after an allocation attempt, safe from ISRs
+    void countAlloc(const T *p)
+    {
+        if (!p) {
+            allocFailures++;
+            return;
+        }
+        uint32_t now = ++inUse;
+        uint32_t high = highWater.load();
+        while (now > high && !highWater.compare_exchange_weak(high, now)) {
+        }
+    }
+
+    void countRelease() { inUse--; }
+
   private:
     // std::unique_ptr Deleter function; calls release().
     const std::function<void(T *)> deleter;
+
+    std::atomic<uint32_t> inUse{0}, highWater{0}, allocFailures{0};
 };
 
 /**
@@ -93,6 +128,7 @@ template <class T> class MemoryDynamic : public Allocator<T>
         LOG_HEAP("Freeing 0x%x", p);
 
         free(p);
+        this->countRelease();
     }
 
   protected:
@@ -101,18 +137,111 @@ template <class T> class MemoryDynamic : public Allocator<T>
     {
         T *p = (T *)malloc(sizeof(T));
         assert(p);
+        this->countAlloc(p);
         return p;
     }
 };
 
+/**
+ * A heap backed slab allocator for targets without a fixed pool size (native). Objects are carved out of chunks of
+ * ChunkSize that are allocated once and never freed, and recycled through an intrusive free list. Unlike malloc per
+ * object, months of packet churn can't fragment the heap.
+ * Not for use from an ISR: the free list is guarded by a spinlock.
+ */
+template <class T, int ChunkSize = 32> class MemorySlab : public Allocator<T>
+{
+  private:
+    // A free slot holds the free list link where the object would be
+    union Slot {
+        T obj;
+        Slot *nextFree;
+    };
+
+    std::vector<Slot *> chunks;
+    Slot *freeList = nullptr;
+    std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+    void lock()
+    {
+        while (busy.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+    void unlock() { busy.clear(std::memory_order_release); }
+
+  public:
+    ~MemorySlab()
+    {
+        for (Slot *chunk : chunks)
+            free(chunk);
+    }
+
+    /// Return a buffer for use by others
+    virtual void release(T *p) override
+    {
+        if (!p) {
+            LOG_DEBUG("Failed to release memory, pointer is null");
+            return;
+        }
+
+        Slot *slot = reinterpret_cast<Slot *>(p);
+        lock();
+        slot->nextFree = freeList;
+        freeList = slot;
+        unlock();
+        this->countRelease();
+        LOG_HEAP("Released slab item at 0x%x", p);
+    }
+
+  protected:
+    // Pop the free list, adding a chunk if it is empty
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        lock();
+        if (!freeList) {
+            Slot *chunk = (Slot *)malloc(sizeof(Slot) * ChunkSize);
+            if (chunk) {
+                chunks.push_back(chunk);
+                for (int i = ChunkSize - 1; i >= 0; i--) {
+                    chunk[i].nextFree = freeList;
+                    freeList = &chunk[i];
+                }
+            }
+        }
+        Slot *slot = freeList;
+        if (slot)
+            freeList = slot->nextFree;
+        unlock();
+
+        this->countAlloc(slot ? &slot->obj : nullptr);
+        if (!slot) {
+            LOG_WARN("Failed to grow memory slab!");
+            return nullptr;
+        }
+        LOG_HEAP("Allocated slab item at 0x%x", slot);
+        return &slot->obj;
+    }
+
+    virtual uint32_t getCapacity() const override { return chunks.size() * ChunkSize; }
+};
+
 /**
  * A static memory pool that uses a fixed buffer instead of heap allocation
+ *
+ * Free slots form a lock-free stack of indexes, so alloc and release are O(1) and safe from ISRs.
  */
 template <class T, int MaxSize> class MemoryPool : public Allocator<T>
 {
   private:
+    static_assert(MaxSize < 0xFFFF, "Pool slots are indexed with 16 bits");
+    static const uint16_t NO_SLOT = 0xFFFF;
+
     T pool[MaxSize];
     bool used[MaxSize];
+    std::atomic<uint16_t> nextFree[MaxSize]; // Next slot on the free stack, only meaningful for free slots
+
+    // Top of the free stack in the low 16 bits and a pop counter in the high 16 bits. A pop interrupted by other pops and
+    // pushes then fails its compare-exchange even if the same slot is on top again (ABA).
+    std::atomic<uint32_t> freeHead;
 
   public:
     MemoryPool() : pool{}, used{}
@@ -120,6 +249,9 @@ template <class T, int MaxSize> class MemoryPool : public Allocator<T>
         // Arrays are now zero-initialized by member initializer list
         // pool array: all elements are default-constructed (zero for POD types)
         // used array: all elements are false (zero-initialized)
+        for (int i = 0; i < MaxSize; i++)
+            nextFree[i].store(i + 1 < MaxSize ? i + 1 : (int)NO_SLOT, std::memory_order_relaxed);
+        freeHead.store(0);
     }
 
     /// Return a buffer for use by others
@@ -135,6 +267,12 @@ template <class T, int MaxSize> class MemoryPool : public Allocator<T>
         if (index >= 0 && index < MaxSize) {
             assert(used[index]); // Should be marked as used
             used[index] = false;
+
+            uint32_t head = freeHead.load();
+            do {
+                nextFree[index].store(head & 0xFFFF, std::memory_order_relaxed);
+            } while (!freeHead.compare_exchange_weak(head, (head & 0xFFFF0000) | index));
+            this->countRelease();
             LOG_HEAP("Released static pool item %d at 0x%x", index, p);
         } else {
             LOG_WARN("Pointer 0x%x not from our pool!", p);
@@ -145,17 +283,23 @@ template <class T, int MaxSize> class MemoryPool : public Allocator<T>
     // Alloc some storage from our static pool
     virtual T *alloc(TickType_t maxWait) override
     {
-        // Find first free slot
-        for (int i = 0; i < MaxSize; i++) {
-            if (!used[i]) {
-                used[i] = true;
-                LOG_HEAP("Allocated static pool item %d at 0x%x", i, &pool[i]);
-                return &pool[i];
+        uint32_t head = freeHead.load();
+        while ((head & 0xFFFF) != NO_SLOT) {
+            uint16_t slot = head & 0xFFFF;
+            uint32_t popped = ((head + 0x10000) & 0xFFFF0000) | nextFree[slot].load(std::memory_order_relaxed);
+            if (freeHead.compare_exchange_weak(head, popped)) {
+                used[slot] = true;
+                this->countAlloc(&pool[slot]);
+                LOG_HEAP("Allocated static pool item %d at 0x%x", slot, &pool[slot]);
+                return &pool[slot];
             }
         }
 
         // No free slots available - return nullptr instead of asserting
+        this->countAlloc(nullptr);
         LOG_WARN("No free slots available in static memory pool!");
         return nullptr;
     }
+
+    virtual uint32_t getCapacity() const override { return MaxSize; }
 };
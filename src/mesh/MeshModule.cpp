@@ -2,12 +2,40 @@
 #include "Channels.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "Profiler.h"
 #include "configuration.h"
 #include "modules/RoutingModule.h"
 #include <algorithm>
 #include <assert.h>
 
 std::vector<MeshModule *> *MeshModule::modules;
+bool MeshModule::dispatchDirty = true;
+
+/// The modules callModules() asks about packets on one portnum, in the order they registered
+struct PortnumModules {
+    meshtastic_PortNum portnum;
+    std::vector<MeshModule *> modules;
+};
+
+static std::vector<PortnumModules> portnumModules; // Sorted by portnum, only the portnums some module declared
+static std::vector<MeshModule *> anyPortnumModules; // Modules for packets on any other portnum
+static std::vector<MeshModule *> encryptedModules;  // Modules for packets we couldn't decode
+static uint8_t callDepth;                           // callModules() can be reentered while a module handles a packet
+
+static_assert(MAX_NUM_CHANNELS <= 8, "bound channels are kept in a uint8_t bitmask");
+
+static std::vector<PortnumModules>::iterator findPortnum(meshtastic_PortNum portnum)
+{
+    return std::lower_bound(portnumModules.begin(), portnumModules.end(), portnum,
+                            [](const PortnumModules &entry, meshtastic_PortNum p) { return entry.portnum < p; });
+}
+
+/// @return the modules that might want a decoded packet on this portnum
+static const std::vector<MeshModule *> &modulesForPortnum(meshtastic_PortNum portnum)
+{
+    auto it = findPortnum(portnum);
+    return (it != portnumModules.end() && it->portnum == portnum) ? it->modules : anyPortnumModules;
+}
 
 const meshtastic_MeshPacket *MeshModule::currentRequest;
 uint8_t MeshModule::numPeriodicModules = 0;
@@ -25,6 +53,7 @@ MeshModule::MeshModule(const char *_name) : name(_name)
         modules = new std::vector<MeshModule *>();
 
     modules->push_back(this);
+    dispatchDirty = true;
 }
 
 void MeshModule::setup() {}
@@ -34,6 +63,61 @@ MeshModule::~MeshModule()
     auto it = std::find(modules->begin(), modules->end(), this);
     assert(it != modules->end());
     modules->erase(it);
+    dispatchDirty = true;
+}
+
+void MeshModule::wantPortnum(meshtastic_PortNum portnum)
+{
+    if (std::find(portnums, portnums + numPortnums, portnum) != portnums + numPortnums)
+        return;
+    assert(numPortnums < MAX_PORTNUMS);
+    portnums[numPortnums++] = portnum;
+    dispatchDirty = true;
+}
+
+void MeshModule::wantAllPortnums()
+{
+    numPortnums = 0;
+    dispatchDirty = true;
+}
+
+void MeshModule::buildDispatch()
+{
+    portnumModules.clear();
+    anyPortnumModules.clear();
+    encryptedModules.clear();
+    dispatchDirty = false;
+    if (!modules)
+        return;
+
+    for (MeshModule *pi : *modules) {
+        for (uint8_t i = 0; i < pi->numPortnums; i++) {
+            auto it = findPortnum(pi->portnums[i]);
+            if (it == portnumModules.end() || it->portnum != pi->portnums[i])
+                portnumModules.insert(it, PortnumModules{pi->portnums[i], {}});
+        }
+    }
+
+    // Modules that want every portnum go in every list, so each list keeps the order the modules registered in
+    for (MeshModule *pi : *modules) {
+        if (pi->numPortnums == 0) {
+            anyPortnumModules.push_back(pi);
+            for (auto &entry : portnumModules)
+                entry.modules.push_back(pi);
+        }
+        for (uint8_t i = 0; i < pi->numPortnums; i++)
+            findPortnum(pi->portnums[i])->modules.push_back(pi);
+
+        if (pi->encryptedOk)
+            encryptedModules.push_back(pi);
+
+        pi->boundChannels = 0;
+        if (pi->boundChannel) {
+            for (ChannelIndex i = 0; i < channels.getNumChannels(); i++)
+                if (strcasecmp(channels.getByIndex(i).settings.name, pi->boundChannel) == 0)
+                    pi->boundChannels |= 1 << i;
+        }
+    }
 }
 
 // ⚠️ **Only call once** to set the initial delay before a module starts broadcasting periodically
@@ -87,6 +171,7 @@ meshtastic_MeshPacket *MeshModule::allocErrorResponse(meshtastic_Routing_Error e
 
 void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 {
+    PROFILE_SCOPE("router", "modules");
     // LOG_DEBUG("In call modules");
     bool moduleFound = false;
 
@@ -101,36 +186,34 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
     auto ourNodeNum = nodeDB->getNodeNum();
     bool toUs = isBroadcast(mp.to) || isToUs(&mp);
 
-    for (auto i = modules->begin(); i != modules->end(); ++i) {
-        auto &pi = **i;
+    // Only a nested call can find the table dirty while it is in use, that one makes do with the table as it is
+    if (dispatchDirty && callDepth == 0)
+        buildDispatch();
+    callDepth++;
+
+    const std::vector<MeshModule *> &interested = isDecoded ? modulesForPortnum(mp.decoded.portnum) : encryptedModules;
+    for (MeshModule *module : interested) {
+        auto &pi = *module;
 
         pi.currentRequest = &mp;
 
         /// We only call modules that are interested in the packet (and the message is destined to us or we are promiscious)
-        bool wantsPacket = (isDecoded || pi.encryptedOk) && (pi.isPromiscuous || toUs) && pi.wantPacket(&mp);
-
-        if ((src == RX_SRC_LOCAL) && !(pi.loopbackOk)) {
-            // new case, monitor separately for now, then FIXME merge above
-            wantsPacket = false;
-        }
+        /// Locally generated packets only go to the modules that asked for them, see loopbackOk
+        bool wantsPacket = (src != RX_SRC_LOCAL || pi.loopbackOk) && (pi.isPromiscuous || toUs) && pi.wantPacket(&mp);
 
         assert(!pi.myReply); // If it is !null it means we have a bug, because it should have been sent the previous time
 
         if (wantsPacket) {
-            LOG_DEBUG("Module '%s' wantsPacket=%d", pi.name, wantsPacket);
-
             moduleFound = true;
 
-            /// received channel (or NULL if not decoded)
-            meshtastic_Channel *ch = isDecoded ? &channels.getByIndex(mp.channel) : NULL;
-
             /// Is the channel this packet arrived on acceptable? (security check)
             /// Note: we can't know channel names for encrypted packets, so those are NEVER sent to boundChannel modules
 
             /// Also: if a packet comes in on the local PC interface, we don't check for bound channels, because it is TRUSTED and
             /// it needs to to be able to fetch the initial admin packets without yet knowing any channels.
 
-            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) || (ch && strcasecmp(ch->settings.name, pi.boundChannel) == 0);
+            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) ||
+                               (isDecoded && mp.channel < MAX_NUM_CHANNELS && (pi.boundChannels & (1 << mp.channel)));
 
             if (!rxChannelOk) {
                 // no one should have already replied!
@@ -142,7 +225,11 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
                 } else
                     printPacket("packet on wrong channel, but can't respond", &mp);
             } else {
-                ProcessMessage handled = pi.handleReceived(mp);
+                ProcessMessage handled;
+                {
+                    PROFILE_SCOPE_CACHED("module", pi.name, pi.profilePoint);
+                    handled = pi.handleReceived(mp);
+                }
 
                 pi.alterReceived(mp);
 
@@ -178,6 +265,7 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 
         pi.currentRequest = NULL;
     }
+    callDepth--;
 
     if (isDecoded && mp.decoded.want_response && toUs) {
         if (currentReply) {
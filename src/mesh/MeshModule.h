@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Profiler.h"
 #include "mesh/Channels.h"
 #include "mesh/MeshTypes.h"
 #include <vector>
@@ -76,6 +77,10 @@ class MeshModule
      */
     static void callModules(meshtastic_MeshPacket &mp, RxSource src = RX_SRC_RADIO);
 
+    /** For use only by Channels, the bound channels of modules are looked up again before the next packet
+     */
+    static void onChannelsChanged() { dispatchDirty = true; }
+
     static std::vector<MeshModule *> GetMeshModulesWithUIFrames(int startIndex);
     static void observeUIEvents(Observer<const UIFrameEvent *> *observer);
     static AdminMessageHandleResult handleAdminMessageForAllModules(const meshtastic_MeshPacket &mp,
@@ -118,6 +123,14 @@ class MeshModule
         return false;
     }
 
+    /** Declare a portnum this module wants, from its constructor. callModules() only asks wantPacket() about packets on one of
+     * the declared portnums, or about every packet if the module declared none. SinglePortModule declares its own portnum.
+     */
+    void wantPortnum(meshtastic_PortNum portnum);
+
+    /// Be asked about packets on every portnum again, forgetting the portnums declared so far
+    void wantAllPortnums();
+
     /** If a bound channel name is set, we will only accept received packets that come in on that channel.
      * A special exception (FIXME, not sure if this is a good idea) - packets that arrive on the local interface
      * are allowed on any channel (this lets the local user do anything).
@@ -226,6 +239,22 @@ class MeshModule
      */
     static meshtastic_MeshPacket *currentReply;
 
+    /// Set when modules, their portnums or the channels changed, so callModules() has to rebuild its dispatch table
+    static bool dispatchDirty;
+
+    static constexpr uint8_t MAX_PORTNUMS = 4;
+    meshtastic_PortNum portnums[MAX_PORTNUMS];
+    uint8_t numPortnums = 0; // 0 if we want every portnum
+
+    /// The channels named boundChannel, bit n set for channel index n
+    uint8_t boundChannels = 0;
+
+    /// Where the profiler keeps the run times of handleReceived()
+    int16_t profilePoint = PROFILER_UNKNOWN_POINT;
+
+    /// Group the modules by the portnums they want, and look up their bound channels
+    static void buildDispatch();
+
     friend class ReliableRouter;
 
     /** Messages can be received that have the want_response bit set.  If set, this callback will be invoked
@@ -28,11 +28,138 @@ bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_Mes
     return (p1p != p2p) ? (p1p > p2p) : (!isFromUs(p1) && isFromUs(p2));
 }
 
-MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen) {}
+/// Children per heap node. A wider heap is shallower, which pays off since sifting down is the common operation (dequeue)
+#define HEAP_ARITY 4
+
+MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen)
+{
+    assert(maxLen < NO_ENTRY);
+    entries.resize(maxLen);
+    heap.reserve(maxLen);
+    freeEntries.reserve(maxLen);
+    for (size_t i = maxLen; i > 0; i--)
+        freeEntries.push_back(i - 1);
+
+    // Twice as many buckets as entries keeps the chains short
+    size_t numBuckets = 1;
+    while (numBuckets < maxLen * 2)
+        numBuckets <<= 1;
+    buckets.assign(numBuckets, (EntryIndex)NO_ENTRY);
+}
 
 bool MeshPacketQueue::empty()
 {
-    return queue.empty();
+    return heap.empty();
+}
+
+bool MeshPacketQueue::isBefore(EntryIndex a, EntryIndex b) const
+{
+    const Entry &ea = entries[a], &eb = entries[b];
+    if (CompareMeshPacketFunc(ea.p, eb.p))
+        return true;
+    if (CompareMeshPacketFunc(eb.p, ea.p))
+        return false;
+    return (int32_t)(ea.seq - eb.seq) < 0; // Same rank, the one enqueued first goes first
+}
+
+size_t MeshPacketQueue::bucketOf(NodeNum from, PacketId id) const
+{
+    uint32_t h = id ^ (from * 0x9E3779B1u);
+    h ^= h >> 16;
+    return h & (buckets.size() - 1);
+}
+
+void MeshPacketQueue::placeAt(size_t pos, EntryIndex e)
+{
+    heap[pos] = e;
+    entries[e].heapPos = pos;
+}
+
+void MeshPacketQueue::siftUp(size_t pos)
+{
+    EntryIndex e = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / HEAP_ARITY;
+        if (!isBefore(e, heap[parent]))
+            break;
+        placeAt(pos, heap[parent]);
+        pos = parent;
+    }
+    placeAt(pos, e);
+}
+
+void MeshPacketQueue::siftDown(size_t pos)
+{
+    EntryIndex e = heap[pos];
+    for (;;) {
+        size_t first = pos * HEAP_ARITY + 1;
+        if (first >= heap.size())
+            break;
+        size_t best = first;
+        for (size_t c = first + 1; c < first + HEAP_ARITY && c < heap.size(); c++)
+            if (isBefore(heap[c], heap[best]))
+                best = c;
+        if (!isBefore(heap[best], e))
+            break;
+        placeAt(pos, heap[best]);
+        pos = best;
+    }
+    placeAt(pos, e);
+}
+
+MeshPacketQueue::EntryIndex MeshPacketQueue::findEntry(NodeNum from, PacketId id, bool tx_normal, bool tx_late,
+                                                       uint8_t hop_limit_lt) const
+{
+    EntryIndex found = NO_ENTRY;
+    for (EntryIndex e = buckets[bucketOf(from, id)]; e != NO_ENTRY; e = entries[e].nextInBucket) {
+        const meshtastic_MeshPacket *p = entries[e].p;
+        if (entries[e].from == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after)) &&
+            (!hop_limit_lt || p->hop_limit < hop_limit_lt)) {
+            // Should (from, id) be queued more than once, report the copy that goes out first like a front to back scan would
+            if (found == NO_ENTRY || isBefore(e, found))
+                found = e;
+        }
+    }
+    return found;
+}
+
+MeshPacketQueue::EntryIndex MeshPacketQueue::findLast(bool nonLateOnly) const
+{
+    // Only needed to make room in a full queue, so a scan is fine here
+    EntryIndex last = NO_ENTRY;
+    for (EntryIndex e : heap) {
+        if (nonLateOnly && entries[e].p->tx_after)
+            continue;
+        if (last == NO_ENTRY || isBefore(last, e))
+            last = e;
+    }
+    return last;
+}
+
+meshtastic_MeshPacket *MeshPacketQueue::removeEntry(EntryIndex e)
+{
+    Entry &entry = entries[e];
+
+    // Unlink from the hash index
+    EntryIndex *link = &buckets[bucketOf(entry.from, entry.p->id)];
+    while (*link != e)
+        link = &entries[*link].nextInBucket;
+    *link = entry.nextInBucket;
+
+    // Fill the hole with the last heap element and restore the heap order around it
+    size_t pos = entry.heapPos;
+    EntryIndex moved = heap.back();
+    heap.pop_back();
+    if (moved != e) {
+        placeAt(pos, moved);
+        siftUp(pos);
+        siftDown(entries[moved].heapPos);
+    }
+
+    meshtastic_MeshPacket *p = entry.p;
+    entry.p = NULL;
+    freeEntries.push_back(e);
+    return p;
 }
 
 /**
@@ -68,7 +195,7 @@ void fixPriority(meshtastic_MeshPacket *p)
 bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p, bool *dropped)
 {
     // no space - try to replace a lower priority packet in the queue
-    if (queue.size() >= maxLen) {
+    if (heap.size() >= maxLen) {
         bool replaced = replaceLowerPriorityPacket(p);
         if (!replaced) {
             LOG_WARN("TX queue is full, and there is no lower-priority packet available to evict in favour of 0x%08x", p->id);
@@ -83,9 +210,19 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p, bool *dropped)
         *dropped = false;
     }
 
-    // Find the correct position using upper_bound to maintain a stable order
-    auto it = std::upper_bound(queue.begin(), queue.end(), p, CompareMeshPacketFunc);
-    queue.insert(it, p); // Insert packet at the found position
+    EntryIndex e = freeEntries.back();
+    freeEntries.pop_back();
+    Entry &entry = entries[e];
+    entry.p = p;
+    entry.from = getFrom(p);
+    entry.seq = nextSeq++;
+
+    size_t bucket = bucketOf(entry.from, p->id);
+    entry.nextInBucket = buckets[bucket];
+    buckets[bucket] = e;
+
+    heap.push_back(e);
+    siftUp(heap.size() - 1);
     return true;
 }
 
@@ -95,9 +232,7 @@ meshtastic_MeshPacket *MeshPacketQueue::dequeue()
         return NULL;
     }
 
-    auto *p = queue.front();
-    queue.erase(queue.begin()); // Remove the highest-priority packet
-    return p;
+    return removeEntry(heap.front()); // Remove the highest-priority packet
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::getFront()
@@ -106,36 +241,22 @@ meshtastic_MeshPacket *MeshPacketQueue::getFront()
         return NULL;
     }
 
-    auto *p = queue.front();
+    auto *p = entries[heap.front()].p;
     return p;
 }
 
 /** Get a packet from this queue. Returns a pointer to the packet, or NULL if not found. */
 meshtastic_MeshPacket *MeshPacketQueue::getPacketFromQueue(NodeNum from, PacketId id)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
-        if (getFrom(p) == from && p->id == id) {
-            return p;
-        }
-    }
-
-    return NULL;
+    EntryIndex e = findEntry(from, id);
+    return (e != NO_ENTRY) ? entries[e].p : NULL;
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns a pointer to the removed packet, or NULL if not found */
 meshtastic_MeshPacket *MeshPacketQueue::remove(NodeNum from, PacketId id, bool tx_normal, bool tx_late, uint8_t hop_limit_lt)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
-        if (getFrom(p) == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after)) &&
-            (!hop_limit_lt || p->hop_limit < hop_limit_lt)) {
-            queue.erase(it);
-            return p;
-        }
-    }
-
-    return NULL;
+    EntryIndex e = findEntry(from, id, tx_normal, tx_late, hop_limit_lt);
+    return (e != NO_ENTRY) ? removeEntry(e) : NULL;
 }
 
 /* Attempt to find a packet from this queue. Return true if it was found. */
@@ -151,17 +272,17 @@ bool MeshPacketQueue::find(const NodeNum from, const PacketId id)
 bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 {
 
-    if (queue.empty()) {
+    if (empty()) {
         return false; // No packets to replace
     }
 
     // Check if the packet at the back has a lower priority than the new packet
-    auto *backPacket = queue.back();
+    EntryIndex back = findLast(false);
+    auto *backPacket = entries[back].p;
     if (!backPacket->tx_after && backPacket->priority < p->priority) {
         LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", backPacket->id, p->id);
         // Remove the back packet
-        queue.pop_back();
-        packetPool.release(backPacket);
+        packetPool.release(removeEntry(back));
         // Insert the new packet in the correct order
         enqueue(p);
         return true;
@@ -169,15 +290,12 @@ bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 
     if (backPacket->tx_after) {
         // Check if there's a non-late packet with lower priority
-        auto it = queue.end();
-        auto refPacket = *--it;
-        for (; refPacket->tx_after && it != queue.begin(); refPacket = *--it)
-            ;
-        if (!refPacket->tx_after && refPacket->priority < p->priority) {
+        EntryIndex ref = findLast(true);
+        if (ref != NO_ENTRY && entries[ref].p->priority < p->priority) {
+            auto *refPacket = entries[ref].p;
             LOG_WARN("Dropping non-late packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x",
                      refPacket->id, p->id);
-            queue.erase(it);
-            packetPool.release(refPacket);
+            packetPool.release(removeEntry(ref));
             // Insert the new packet in the correct order
             enqueue(p);
             return true;
@@ -199,8 +317,7 @@ bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
                          "with no TX delay",
                          backPacket->id, dt, p->id);
             }
-            queue.pop_back();
-            packetPool.release(backPacket);
+            packetPool.release(removeEntry(back));
             // Insert the new packet in the correct order
             enqueue(p);
             return true;
@@ -209,4 +326,4 @@ bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 
     // If the back packet's priority is not lower, no replacement occurs
     return false;
-}
\ No newline at end of file
+}
@@ -2,20 +2,56 @@
 
 #include "MeshTypes.h"
 
-#include <queue>
+#include <vector>
 
 /**
  * A priority queue of packets
+ *
+ * Implemented as an indexed 4-ary heap ordered by CompareMeshPacketFunc, with ties broken by enqueue order so equal packets
+ * stay FIFO. A (from, id) hash index points at every queued packet, so find/remove don't have to scan the queue.
  */
 class MeshPacketQueue
 {
+    typedef uint16_t EntryIndex;
+    static const EntryIndex NO_ENTRY = 0xFFFF;
+
+    struct Entry {
+        meshtastic_MeshPacket *p;
+        NodeNum from;            // getFrom(p) when enqueued, the key of the hash index together with p->id
+        uint32_t seq;            // Enqueue order, breaks ties in the packet order
+        EntryIndex heapPos;      // Position of this entry in heap
+        EntryIndex nextInBucket; // Next entry in the same hash bucket, NO_ENTRY terminated
+    };
+
     size_t maxLen;
-    std::vector<meshtastic_MeshPacket *> queue;
+    std::vector<Entry> entries; // maxLen slots, the ones not in use are listed in freeEntries
+    std::vector<EntryIndex> freeEntries;
+    std::vector<EntryIndex> heap;    // Indexes into entries, heap[0] is the next packet to send
+    std::vector<EntryIndex> buckets; // Hash index over (from, id), first entry of each bucket or NO_ENTRY
+    uint32_t nextSeq = 0;
 
     /** Replace a lower priority package in the queue with 'mp' (provided there are lower pri packages). Return true if replaced.
      */
     bool replaceLowerPriorityPacket(meshtastic_MeshPacket *mp);
 
+    /// @return true if entry a is sent before entry b
+    bool isBefore(EntryIndex a, EntryIndex b) const;
+
+    size_t bucketOf(NodeNum from, PacketId id) const;
+
+    /** Find the queued entry for (from, id) that is sent first and passes the tx_after/hop_limit filters, or NO_ENTRY */
+    EntryIndex findEntry(NodeNum from, PacketId id, bool tx_normal = true, bool tx_late = true, uint8_t hop_limit_lt = 0) const;
+
+    /** Find the entry sent last, optionally only looking at packets that are not in the late transmit window */
+    EntryIndex findLast(bool nonLateOnly) const;
+
+    /** Remove an entry from the heap and the index, returning its packet */
+    meshtastic_MeshPacket *removeEntry(EntryIndex e);
+
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void placeAt(size_t pos, EntryIndex e);
+
   public:
     explicit MeshPacketQueue(size_t _maxLen);
 
@@ -28,7 +64,7 @@ class MeshPacketQueue
     bool empty();
 
     /** return amount of free packets in Queue */
-    size_t getFree() { return maxLen - queue.size(); }
+    size_t getFree() { return maxLen - heap.size(); }
 
     /** return total size of the Queue */
     size_t getMaxLen() { return maxLen; }
@@ -46,4 +82,4 @@ class MeshPacketQueue
 
     /* Attempt to find a packet from this queue. Return true if it was found. */
     bool find(const NodeNum from, const PacketId id);
-};
\ No newline at end of file
+};
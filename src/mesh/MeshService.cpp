@@ -12,6 +12,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "TypeConversions.h"
+#include "concurrency/LockGuard.h"
 #include "graphics/draw/MessageRenderer.h"
 #include "main.h"
 #include "mesh-pb-constants.h"
@@ -66,9 +67,11 @@ Allocator<meshtastic_QueueStatus> &queueStatusPool = staticQueueStatusPool;
 #include "Router.h"
 
 MeshService::MeshService()
+    : toPhoneRing(MAX_RX_TOPHONE, packetPool)
 #ifdef ARCH_PORTDUINO
-    : toPhoneQueue(MAX_RX_TOPHONE), toPhoneQueueStatusQueue(MAX_RX_QUEUESTATUS_TOPHONE),
-      toPhoneMqttProxyQueue(MAX_RX_MQTTPROXY_TOPHONE), toPhoneClientNotificationQueue(MAX_RX_NOTIFICATION_TOPHONE)
+      ,
+      toPhoneQueueStatusQueue(MAX_RX_QUEUESTATUS_TOPHONE), toPhoneMqttProxyQueue(MAX_RX_MQTTPROXY_TOPHONE),
+      toPhoneClientNotificationQueue(MAX_RX_NOTIFICATION_TOPHONE)
 #endif
 {
     lastQueueStatus = {0, 0, 16, 0};
@@ -158,17 +161,37 @@ void MeshService::reloadOwner(bool shouldSave)
 // search the queue for a request id and return the matching nodenum
 NodeNum MeshService::getNodenumFromRequestId(uint32_t request_id)
 {
-    NodeNum nodenum = 0;
-    for (int i = 0; i < toPhoneQueue.numUsed(); i++) {
-        meshtastic_MeshPacket *p = toPhoneQueue.dequeuePtr(0);
-        if (p->id == request_id) {
-            nodenum = p->to;
-            // make sure to continue this to make one full loop
-        }
-        // put it right back on the queue
-        toPhoneQueue.enqueue(p, 0);
-    }
-    return nodenum;
+    concurrency::LockGuard g(&toPhoneLock);
+    const meshtastic_MeshPacket *p = toPhoneRing.findById(request_id);
+    return p ? p->to : 0;
+}
+
+void MeshService::addPhoneReader(PacketFanout::Reader *reader)
+{
+    concurrency::LockGuard g(&toPhoneLock);
+    toPhoneRing.addReader(reader);
+}
+
+void MeshService::removePhoneReader(PacketFanout::Reader *reader)
+{
+    concurrency::LockGuard g(&toPhoneLock);
+    toPhoneRing.removeReader(reader);
+}
+
+const meshtastic_MeshPacket *MeshService::getForPhone(PacketFanout::Reader *reader)
+{
+    concurrency::LockGuard g(&toPhoneLock);
+    uint32_t dropped = reader->dropped;
+    const meshtastic_MeshPacket *p = toPhoneRing.peek(reader);
+    if (reader->dropped != dropped)
+        LOG_WARN("Client fell behind, %u packets for it were discarded (%u total)", reader->dropped - dropped, reader->dropped);
+    return p;
+}
+
+void MeshService::releaseForPhone(PacketFanout::Reader *reader)
+{
+    concurrency::LockGuard g(&toPhoneLock);
+    toPhoneRing.release(reader);
 }
 
 /**
@@ -316,26 +339,13 @@ void MeshService::sendToPhone(meshtastic_MeshPacket *p)
 #endif
 #endif
 
-    if (toPhoneQueue.numFree() == 0) {
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP ||
-            p->decoded.portnum == meshtastic_PortNum_RANGE_TEST_APP) {
-            LOG_WARN("ToPhone queue is full, discard oldest");
-            meshtastic_MeshPacket *d = toPhoneQueue.dequeuePtr(0);
-            if (d)
-                releaseToPool(d);
-        } else {
-            LOG_WARN("ToPhone queue is full, drop packet");
-            releaseToPool(p);
-            fromNum++; // Make sure to notify observers in case they are reconnected so they can get the packets
-            return;
-        }
-    }
-
-    if (toPhoneQueue.enqueue(p, 0) == false) {
-        LOG_CRIT("Failed to queue a packet into toPhoneQueue!");
-        abort();
-    }
-    fromNum++;
+    concurrency::LockGuard g(&toPhoneLock);
+    // Once some client read the oldest packet, the ring discards it for newer ones anyway so slow clients can't stall the others
+    bool important =
+        p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP || p->decoded.portnum == meshtastic_PortNum_RANGE_TEST_APP;
+    if (!toPhoneRing.push(p, important))
+        LOG_WARN("ToPhone queue is full, drop packet");
+    fromNum++; // Make sure to notify observers in case they are reconnected so they can get the packets
 }
 
 void MeshService::sendMqttMessageToClientProxy(meshtastic_MqttClientProxyMessage *m)
@@ -450,7 +460,8 @@ int MeshService::onGPSChanged(const meshtastic::GPSStatus *newStatus)
 #endif
 bool MeshService::isToPhoneQueueEmpty()
 {
-    return toPhoneQueue.isEmpty();
+    concurrency::LockGuard g(&toPhoneLock);
+    return !toPhoneRing.hasUnread(); // Nothing left that no client has read
 }
 
 uint32_t MeshService::GetTimeSinceMeshPacket(const meshtastic_MeshPacket *mp)
@@ -9,6 +9,8 @@
 #include "MeshRadio.h"
 #include "MeshTypes.h"
 #include "Observer.h"
+#include "PacketFanout.h"
+#include "concurrency/Lock.h"
 #ifdef ARCH_PORTDUINO
 #include "PointerQueue.h"
 #else
@@ -38,15 +40,10 @@ class MeshService
     CallbackObserver<MeshService, const meshtastic::GPSStatus *> gpsObserver =
         CallbackObserver<MeshService, const meshtastic::GPSStatus *>(this, &MeshService::onGPSChanged);
 #endif
-    /// received packets waiting for the phone to process them
-    /// FIXME, change to a DropOldestQueue and keep a count of the number of dropped packets to ensure
-    /// we never hang because android hasn't been there in a while
+    /// received packets waiting for the phone to process them, shared by all connected API clients (see addPhoneReader())
     /// FIXME - save this to flash on deep sleep
-#ifdef ARCH_PORTDUINO
-    PointerQueue<meshtastic_MeshPacket> toPhoneQueue;
-#else
-    StaticPointerQueue<meshtastic_MeshPacket, MAX_RX_TOPHONE> toPhoneQueue;
-#endif
+    PacketFanout toPhoneRing;
+    concurrency::Lock toPhoneLock; // BLE reads the ring from its own task
 
     // keep list of QueueStatus packets to be send to the phone
 #ifdef ARCH_PORTDUINO
@@ -113,9 +110,19 @@ class MeshService
     /// Do idle processing (mostly processing messages which have been queued from the radio)
     void loop();
 
-    /// Return the next packet destined to the phone.  FIXME, somehow use fromNum to allow the phone to retry the
+    /// Start delivering packets to a client. A new client starts with the packets no client has read yet.
+    void addPhoneReader(PacketFanout::Reader *reader);
+
+    /// Stop delivering packets to a client, call releaseForPhone() first if it still holds one
+    void removePhoneReader(PacketFanout::Reader *reader);
+
+    /// Return the next packet destined to this client, or NULL. The packet is shared with the other clients, so it must not be
+    /// changed, and stays valid until releaseForPhone(). FIXME, somehow use fromNum to allow the phone to retry the
     /// last few packets if needs to.
-    meshtastic_MeshPacket *getForPhone() { return toPhoneQueue.dequeuePtr(0); }
+    const meshtastic_MeshPacket *getForPhone(PacketFanout::Reader *reader);
+
+    /// The client is done with the packet getForPhone() returned, move on to the next one
+    void releaseForPhone(PacketFanout::Reader *reader);
 
     /// Allows the bluetooth handler to free packets after they have been sent
     void releaseToPool(meshtastic_MeshPacket *p) { packetPool.release(p); }
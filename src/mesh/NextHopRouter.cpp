@@ -1,5 +1,7 @@
 #include "NextHopRouter.h"
 #include "MeshTypes.h"
+#include "Profiler.h"
+#include "RoutingTable.h"
 #include "meshUtils.h"
 #if !MESHTASTIC_EXCLUDE_TRACEROUTE
 #include "modules/TraceRouteModule.h"
@@ -52,6 +54,11 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 
         if (p->transport_mechanism == meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA) {
             rxDupe++;
+            // Hearing the next hop we asked relay it is as good as an ACK for that route
+            PendingPacket *relayed = findPendingPacket(p->from, p->id);
+            if (relayed && !isBroadcast(relayed->packet->to) && relayed->packet->next_hop != NO_NEXT_HOP_PREFERENCE &&
+                relayed->packet->next_hop == p->relay_node)
+                routingTable.recordSuccess(relayed->packet->to, p->relay_node, millis());
             stopRetransmission(p->from, p->id);
         }
 
@@ -87,6 +94,13 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
 {
     NodeNum ourNodeNum = getNodeNum();
     uint8_t ourRelayID = nodeDB->getLastByteOfNodeNum(ourNodeNum);
+    uint32_t now = millis();
+    if (p->transport_mechanism == meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA && p->hop_start != 0) {
+        routingTable.recordLink(p->relay_node, p->rx_snr, now);
+        // Heard straight from the sender, so it can be reached without a relay
+        if (getHopsAway(*p) == 0 && p->from != ourNodeNum)
+            routingTable.learn(p->from, nodeDB->getLastByteOfNodeNum(p->from), RouteSource::OVERHEARD, now);
+    }
     bool isAckorReply = (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) &&
                         (p->decoded.request_id != 0 || p->decoded.reply_id != 0);
     if (isAckorReply) {
@@ -102,6 +116,7 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
                 bool weWereSoleRelayer = false;
                 bool weWereRelayer = wasRelayer(ourRelayID, p->decoded.request_id, p->to, &weWereSoleRelayer);
                 if ((weWereRelayer && wasAlreadyRelayer) || (getHopsAway(*p) == 0 && weWereSoleRelayer)) {
+                    routingTable.learn(p->from, p->relay_node, RouteSource::ACK, now);
                     if (origTx->next_hop != p->relay_node) { // Not already set
                         LOG_INFO("Update next hop of 0x%x to 0x%x based on ACK/reply (was relayer %d we were sole %d)", p->from,
                                  p->relay_node, wasAlreadyRelayer, weWereSoleRelayer);
@@ -126,6 +141,7 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
 /* Check if we should be rebroadcasting this packet if so, do so. */
 bool NextHopRouter::perhapsRebroadcast(const meshtastic_MeshPacket *p)
 {
+    PROFILE_SCOPE("router", "rebroadcast");
     if (!isToUs(p) && !isFromUs(p) && p->hop_limit > 0) {
         if (p->id != 0) {
             if (isRebroadcaster()) {
@@ -175,6 +191,11 @@ std::optional<uint8_t> NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
     if (isBroadcast(to))
         return std::nullopt;
 
+    std::optional<uint8_t> best = routingTable.getNextHop(to, relay_node, millis());
+    if (best)
+        return best;
+
+    // Nothing in the routing table (e.g. right after a reboot), use the next hop kept in the NodeDB
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(to);
     if (node && node->next_hop) {
         // We are careful not to return the relay node as the next hop
@@ -231,6 +252,7 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
 
         // Regardless of whether or not we canceled this packet from the txQueue, remove it from our pending list so it
         // doesn't get scheduled again. (This is the core of stopRetransmission.)
+        queueRemove(old);
         auto numErased = pending.erase(key);
         assert(numErased == 1);
 
@@ -249,14 +271,14 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
 PendingPacket *NextHopRouter::startRetransmission(meshtastic_MeshPacket *p, uint8_t numReTx)
 {
     auto id = GlobalPacketId(p);
-    auto rec = PendingPacket(p, numReTx);
 
     stopRetransmission(getFrom(p), p->id);
 
-    setNextTx(&rec);
-    pending[id] = rec;
+    PendingPacket *rec = &(pending[id] = PendingPacket(p, numReTx));
+    setNextTx(rec);
+    queuePush(rec);
 
-    return &pending[id];
+    return rec;
 }
 
 /**
@@ -265,66 +287,169 @@ PendingPacket *NextHopRouter::startRetransmission(meshtastic_MeshPacket *p, uint
 int32_t NextHopRouter::doRetransmissions()
 {
     uint32_t now = millis();
-    int32_t d = INT32_MAX;
-
-    // FIXME, we should use a better datastructure rather than walking through this map.
-    // for(auto el: pending) {
-    for (auto it = pending.begin(), nextIt = it; it != pending.end(); it = nextIt) {
-        ++nextIt; // we use this odd pattern because we might be deleting it...
-        auto &p = it->second;
-
-        bool stillValid = true; // assume we'll keep this record around
-
-        // FIXME, handle 51 day rolloever here!!!
-        if (p.nextTxMsec <= now) {
-            if (p.numRetransmissions == 0) {
-                if (isFromUs(p.packet)) {
-                    LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
-                              p.packet->id);
-                    sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
+
+    // Only the due entries are visited, they are at the front of the queue
+    while (!retransmitQueue.empty() && (int32_t)(retransmitQueue[0]->nextTxMsec - now) <= 0) {
+        PendingPacket &p = *retransmitQueue[0];
+        GlobalPacketId key(p.packet);
+
+        if (p.numRetransmissions == 0) {
+            if (isFromUs(p.packet)) {
+                LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
+                          p.packet->id);
+                sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
+            }
+            // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
+            stopRetransmission(key);
+        } else {
+            LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
+                      p.packet->id, p.numRetransmissions);
+
+            meshtastic_MeshPacket *packet = p.packet;
+            bool failedOver = false;
+            if (!isBroadcast(packet->to)) {
+                std::optional<uint8_t> failover;
+                if (packet->next_hop != NO_NEXT_HOP_PREFERENCE) {
+                    // The next hop didn't relay it (or we didn't hear it do so), count that against the route
+                    routingTable.recordFailure(packet->to, packet->next_hop, now);
+                    // Only failovers change it, so the first retransmission finds the next hop the packet went out with
+                    if (p.numTried == 0)
+                        p.tried[p.numTried++] = packet->next_hop;
+                    if (p.numRetransmissions == 1 && p.numTried < ROUTING_MAX_CANDIDATES)
+                        failover = routingTable.getNextHop(packet->to, p.tried, p.numTried, now);
                 }
-                // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
-                stopRetransmission(it->first);
-                stillValid = false; // just deleted it
-            } else {
-                LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
-                          p.packet->id, p.numRetransmissions);
-
-                if (!isBroadcast(p.packet->to)) {
-                    if (p.numRetransmissions == 1) {
-                        // Last retransmission, reset next_hop (fallback to FloodingRouter)
-                        p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        // Also reset it in the nodeDB
-                        meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
-                        if (sentTo) {
-                            LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
-                            sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        }
-                        FloodingRouter::send(packetPool.allocCopy(*p.packet));
-                    } else {
-                        NextHopRouter::send(packetPool.allocCopy(*p.packet));
+
+                if (failover) {
+                    // Last retransmission, but there is another candidate we haven't tried yet worth trying before we flood
+                    LOG_INFO("Fail over next hop for dest 0x%x from 0x%x to 0x%x", packet->to, packet->next_hop, *failover);
+                    packet->next_hop = *failover;
+                    p.tried[p.numTried++] = *failover;
+                    failedOver = true;
+                    // The superclass version keeps our next_hop and the retransmission record
+                    FloodingRouter::send(packetPool.allocCopy(*packet));
+                } else if (p.numRetransmissions == 1) {
+                    // Last retransmission, reset next_hop (fallback to FloodingRouter)
+                    packet->next_hop = NO_NEXT_HOP_PREFERENCE;
+                    // Also reset it in the nodeDB
+                    meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(packet->to);
+                    if (sentTo) {
+                        LOG_INFO("Resetting next hop for packet with dest 0x%x\n", packet->to);
+                        sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
                     }
+                    FloodingRouter::send(packetPool.allocCopy(*packet));
                 } else {
-                    // Note: we call the superclass version because we don't want to have our version of send() add a new
-                    // retransmission record
-                    FloodingRouter::send(packetPool.allocCopy(*p.packet));
+                    NextHopRouter::send(packetPool.allocCopy(*packet));
                 }
+            } else {
+                // Note: we call the superclass version because we don't want to have our version of send() add a new
+                // retransmission record
+                FloodingRouter::send(packetPool.allocCopy(*packet));
+            }
 
-                // Queue again
-                --p.numRetransmissions;
-                setNextTx(&p);
+            // Queue again, unless sending replaced or removed the record
+            PendingPacket *again = findPendingPacket(key);
+            if (again && again->packet == packet) {
+                // A failover keeps the flood as the final fallback
+                if (!failedOver)
+                    --again->numRetransmissions;
+                setNextTx(again);
             }
         }
+    }
 
-        if (stillValid) {
-            // Update our desired sleep delay
-            int32_t t = p.nextTxMsec - now;
+    return msecUntilNextRetransmission();
+}
 
-            d = min(t, d);
-        }
+int32_t NextHopRouter::msecUntilNextRetransmission() const
+{
+    if (retransmitQueue.empty())
+        return INT32_MAX;
+    int32_t t = retransmitQueue[0]->nextTxMsec - millis();
+    return t > 0 ? t : 0;
+}
+
+void NextHopRouter::delayRetransmissions(uint32_t msec, std::optional<PacketId> exceptId)
+{
+    // Delaying everything by the same amount keeps the heap order, only skipped entries need it restored
+    bool skipped = false;
+    for (PendingPacket *p : retransmitQueue) {
+        if (exceptId && p->packet->id == *exceptId)
+            skipped = true;
+        else
+            p->nextTxMsec += msec;
     }
+    if (skipped)
+        for (size_t pos = retransmitQueue.size() / 2; pos-- > 0;)
+            queueSiftDown(pos);
+}
 
-    return d;
+void NextHopRouter::queuePlace(size_t pos, PendingPacket *p)
+{
+    retransmitQueue[pos] = p;
+    p->queuePos = pos;
+}
+
+void NextHopRouter::queueSiftUp(size_t pos)
+{
+    PendingPacket *p = retransmitQueue[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!dueBefore(p, retransmitQueue[parent]))
+            break;
+        queuePlace(pos, retransmitQueue[parent]);
+        pos = parent;
+    }
+    queuePlace(pos, p);
+}
+
+void NextHopRouter::queueSiftDown(size_t pos)
+{
+    PendingPacket *p = retransmitQueue[pos];
+    size_t n = retransmitQueue.size();
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && dueBefore(retransmitQueue[child + 1], retransmitQueue[child]))
+            child++;
+        if (!dueBefore(retransmitQueue[child], p))
+            break;
+        queuePlace(pos, retransmitQueue[child]);
+        pos = child;
+    }
+    queuePlace(pos, p);
+}
+
+void NextHopRouter::queuePush(PendingPacket *p)
+{
+    retransmitQueue.push_back(p);
+    queueSiftUp(retransmitQueue.size() - 1);
+}
+
+void NextHopRouter::queueRemove(PendingPacket *p)
+{
+    size_t pos = p->queuePos;
+    if (pos == PendingPacket::NOT_QUEUED)
+        return;
+    p->queuePos = PendingPacket::NOT_QUEUED;
+
+    PendingPacket *last = retransmitQueue.back();
+    retransmitQueue.pop_back();
+    if (last != p) {
+        queuePlace(pos, last);
+        queueUpdate(last);
+    }
+}
+
+void NextHopRouter::queueUpdate(PendingPacket *p)
+{
+    size_t pos = p->queuePos;
+    if (pos == PendingPacket::NOT_QUEUED)
+        return;
+    if (pos > 0 && dueBefore(p, retransmitQueue[(pos - 1) / 2]))
+        queueSiftUp(pos);
+    else
+        queueSiftDown(pos);
 }
 
 void NextHopRouter::setNextTx(PendingPacket *pending)
@@ -332,6 +457,7 @@ void NextHopRouter::setNextTx(PendingPacket *pending)
     assert(iface);
     auto d = iface->getRetransmissionMsec(pending->packet);
     pending->nextTxMsec = millis() + d;
+    queueUpdate(pending);
     LOG_DEBUG("Setting next retransmission in %u msecs: ", d);
     printPacket("", pending->packet);
     setReceivedMessage(); // Run ASAP, so we can figure out our correct sleep time
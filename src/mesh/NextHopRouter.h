@@ -1,8 +1,10 @@
 #pragma once
 
 #include "FloodingRouter.h"
+#include "RoutingTable.h"
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 /**
  * An identifier for a globally unique message - a pair of the sending nodenum and the packet id assigned
@@ -39,6 +41,14 @@ struct PendingPacket {
     /** Starts at NUM_RETRANSMISSIONS -1 and counts down.  Once zero it will be removed from the list */
     uint8_t numRetransmissions = 0;
 
+    /** The next hops the packet went out through, a failover only picks a candidate that isn't one of them */
+    uint8_t tried[ROUTING_MAX_CANDIDATES] = {};
+    uint8_t numTried = 0;
+
+    /** Position in NextHopRouter::retransmitQueue, NOT_QUEUED while not in it */
+    static const size_t NOT_QUEUED = SIZE_MAX;
+    size_t queuePos = NOT_QUEUED;
+
     PendingPacket() {}
     explicit PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions);
 };
@@ -58,6 +68,10 @@ class GlobalPacketIdHashFunction
   NextHopRouter only 1 time). For the final retry, if no one actually relayed the packet, it will reset the next hop in order to
   fall back to the FloodingRouter again. Note that thus also intermediate hops will do a single retransmission if the intended
   next-hop didn’t relay, in order to fix changes in the middle of the route.
+
+  Next hops come from the RoutingTable, which keeps several ranked candidates per destination, learned from ACKs, traceroutes,
+  NeighborInfo and nodes heard directly. A next hop that didn't relay counts against it, and before falling back to flooding the
+  final retry goes to the next best candidate not tried yet, if there is one worth trying.
 */
 class NextHopRouter : public FloodingRouter
 {
@@ -83,8 +97,8 @@ class NextHopRouter : public FloodingRouter
         int32_t r = FloodingRouter::runOnce();
 
         // Also after calling runOnce there might be new packets to retransmit
-        auto d = doRetransmissions();
-        return min(d, r);
+        doRetransmissions();
+        return min(msecUntilNextRetransmission(), r);
     }
 
     // The number of retransmissions intermediate nodes will do (actually 1 less than this)
@@ -98,6 +112,12 @@ class NextHopRouter : public FloodingRouter
      */
     std::unordered_map<GlobalPacketId, PendingPacket, GlobalPacketIdHashFunction> pending;
 
+    /**
+     * Binary min-heap over the entries of pending, ordered by nextTxMsec (wrap-safe), so the next retransmission is always
+     * at the front. Map nodes don't move on rehash, so pointing into pending is safe.
+     */
+    std::vector<PendingPacket *> retransmitQueue;
+
     /**
      * Should this incoming filter be dropped?
      *
@@ -140,9 +160,29 @@ class NextHopRouter : public FloodingRouter
      */
     int32_t doRetransmissions();
 
+    /// @return the number of msecs until our next retransmission (0 if overdue) or MAXINT if none scheduled
+    int32_t msecUntilNextRetransmission() const;
+
     void setNextTx(PendingPacket *pending);
 
+    /**
+     * Push back all pending retransmissions by msec, e.g. for the airtime of a packet during which we can't hear an ACK
+     * @param exceptId packets with this id keep their schedule
+     */
+    void delayRetransmissions(uint32_t msec, std::optional<PacketId> exceptId = std::nullopt);
+
   private:
+    /// @return true if a is due before b, correct across millis() rollover
+    static bool dueBefore(const PendingPacket *a, const PendingPacket *b) { return (int32_t)(a->nextTxMsec - b->nextTxMsec) < 0; }
+
+    void queuePush(PendingPacket *p);
+    void queueRemove(PendingPacket *p);
+    /// Restore the heap order around p after its nextTxMsec changed
+    void queueUpdate(PendingPacket *p);
+    void queueSiftUp(size_t pos);
+    void queueSiftDown(size_t pos);
+    void queuePlace(size_t pos, PendingPacket *p);
+
     /**
      * Get the next hop for a destination, given the relay node
      * @return the node number of the next hop, 0 if no preference (fallback to FloodingRouter)
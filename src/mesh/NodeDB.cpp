@@ -10,6 +10,7 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeInfoCache.h"
 #include "PacketHistory.h"
 #include "PowerFSM.h"
 #include "RTC.h"
@@ -70,6 +71,17 @@ meshtastic_DeviceUIConfig uiconfig{.screen_brightness = 153, .screen_timeout = 3
 meshtastic_LocalModuleConfig moduleConfig;
 meshtastic_ChannelFile channelFile;
 
+/*
+ * Node journal records: a crc32 over the rest of the record, the payload length (uint16), the record type and a reserved byte,
+ * then the payload. That is an encoded NodeInfoLite for NODE_JOURNAL_PUT and the NodeNum for NODE_JOURNAL_REMOVE.
+ * Records are replayed in order and hold the whole node, so replaying one twice does no harm.
+ */
+#define NODE_JOURNAL_HEADER_SIZE 8
+#define NODE_JOURNAL_PUT 1
+#define NODE_JOURNAL_REMOVE 2
+// Fold the journal into nodes.proto once it is a quarter of the snapshot size, but don't bother below this
+#define NODE_JOURNAL_MIN_COMPACT_BYTES 4096
+
 #ifdef USERPREFS_USE_ADMIN_KEY_0
 static unsigned char userprefs_admin_key_0[] = USERPREFS_USE_ADMIN_KEY_0;
 #endif
@@ -449,7 +461,7 @@ NodeDB::NodeDB()
 #endif
     }
 #endif
-    sortMeshDB();
+    rebuildNodeIndex();
     saveToDisk(saveWhat);
 }
 
@@ -548,6 +560,7 @@ void NodeDB::installDefaultNodeDatabase()
     nodeDatabase.nodes = std::vector<meshtastic_NodeInfoLite>(MAX_NUM_NODES);
     numMeshNodes = 0;
     meshNodes = &nodeDatabase.nodes;
+    rebuildNodeIndex();
 }
 
 void NodeDB::installDefaultConfig(bool preserveKey = false)
@@ -1019,21 +1032,24 @@ void NodeDB::resetNodes(bool keepFavorites)
 {
     if (!config.position.fixed_position)
         clearLocalPosition();
-    numMeshNodes = 1;
-    if (keepFavorites) {
+    if (keepFavorites)
         LOG_INFO("Clearing node database - preserving favorites");
-        for (size_t i = 0; i < meshNodes->size(); i++) {
-            meshtastic_NodeInfoLite &node = meshNodes->at(i);
-            if (i > 0 && !node.is_favorite) {
-                node = meshtastic_NodeInfoLite();
-            } else {
-                numMeshNodes += 1;
-            }
-        };
-    } else {
+    else
         LOG_INFO("Clearing node database - removing favorites");
-        std::fill(nodeDatabase.nodes.begin() + 1, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
+    // Our own node is kept, wherever it is stored
+    int newPos = 0;
+    for (int i = 0; i < numMeshNodes; i++) {
+        const meshtastic_NodeInfoLite &node = meshNodes->at(i);
+        if (node.num == getNodeNum() || (keepFavorites && node.is_favorite)) {
+            if (newPos != i)
+                meshNodes->at(newPos) = node;
+            newPos++;
+        }
     }
+    numMeshNodes = newPos;
+    std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
+    nodeInfoCache.clear();
     devicestate.has_rx_text_message = false;
     devicestate.has_rx_waypoint = false;
     saveNodeDatabaseToDisk();
@@ -1046,16 +1062,25 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
 {
     int newPos = 0, removed = 0;
     for (int i = 0; i < numMeshNodes; i++) {
-        if (meshNodes->at(i).num != nodeNum)
+        if (meshNodes->at(i).num != nodeNum) {
             meshNodes->at(newPos++) = meshNodes->at(i);
-        else
+        } else {
+#if !(MESHTASTIC_EXCLUDE_PKI)
+            if (meshNodes->at(i).user.public_key.size == 32)
+                crypto->invalidateSharedKey(meshNodes->at(i).user.public_key.bytes);
+#endif
             removed++;
+        }
     }
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
-    saveNodeDatabaseToDisk();
+    if (removed) {
+        appendNodeJournal(NODE_JOURNAL_REMOVE, (const uint8_t *)&nodeNum, sizeof(nodeNum));
+        nodeInfoCache.forget(nodeNum);
+    }
 }
 
 void NodeDB::clearLocalPosition()
@@ -1090,6 +1115,7 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("cleanupMeshDB purged %d entries", removed);
 }
 
@@ -1253,6 +1279,13 @@ void NodeDB::loadFromDisk()
         numMeshNodes = MAX_NUM_NODES;
     }
     meshNodes->resize(MAX_NUM_NODES);
+    bool journalClean = replayNodeJournal();
+    rebuildNodeIndex();
+    if (!journalClean) {
+        // Anything we append after a torn record would never be replayed
+        LOG_WARN("%s ends in a torn record, fold it into %s", nodeJournalFileName, nodeDatabaseFileName);
+        saveNodeDatabaseToDisk();
+    }
 
     // static DeviceState scratch; We no longer read into a tempbuf because this structure is 15KB of valuable RAM
     state = loadProto(deviceStateFileName, meshtastic_DeviceState_size, sizeof(meshtastic_DeviceState),
@@ -1530,7 +1563,152 @@ bool NodeDB::saveNodeDatabaseToDisk()
 #endif
     size_t nodeDatabaseSize;
     pb_get_encoded_size(&nodeDatabaseSize, meshtastic_NodeDatabase_fields, &nodeDatabase);
-    return saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+    if (!saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false))
+        return false;
+
+    // The snapshot now holds everything the journal did. Should we die before removing it, replaying the journal again only
+    // rolls back what changed since without being journaled (last_heard, snr...) of the nodes it mentions.
+#ifdef FSCom
+    spiLock->lock();
+    FSCom.remove(nodeJournalFileName);
+    spiLock->unlock();
+#endif
+    nodeJournalBytes = 0;
+    nodeSnapshotBytes = nodeDatabaseSize;
+    return true;
+}
+
+bool NodeDB::saveNodeToDisk(const meshtastic_NodeInfoLite &node)
+{
+    uint8_t payload[meshtastic_NodeInfoLite_size];
+    pb_ostream_t stream = pb_ostream_from_buffer(payload, sizeof(payload));
+    if (!pb_encode(&stream, &meshtastic_NodeInfoLite_msg, &node)) {
+        LOG_ERROR("Error: can't encode node 0x%x %s", node.num, PB_GET_ERROR(&stream));
+        return false;
+    }
+    return appendNodeJournal(NODE_JOURNAL_PUT, payload, stream.bytes_written);
+}
+
+bool NodeDB::appendNodeJournal(uint8_t type, const uint8_t *payload, uint16_t len)
+{
+    // do not try to save anything if power level is not safe. In many cases flash will be lock-protected
+    // and all writes will fail anyway. Device should be sleeping at this point anyway.
+    if (!powerHAL_isPowerLevelSafe()) {
+        LOG_ERROR("Error: trying to appendNodeJournal() on unsafe device power level.");
+        return false;
+    }
+
+    size_t recordSize = NODE_JOURNAL_HEADER_SIZE + len;
+    if (nodeJournalBytes + recordSize > std::max<size_t>(NODE_JOURNAL_MIN_COMPACT_BYTES, nodeSnapshotBytes / 4)) {
+        LOG_DEBUG("Node journal has %u bytes, compact it", nodeJournalBytes);
+        return saveNodeDatabaseToDisk();
+    }
+
+    bool okay = false;
+#ifdef FSCom
+    uint8_t record[NODE_JOURNAL_HEADER_SIZE + meshtastic_NodeInfoLite_size];
+    assert(len <= meshtastic_NodeInfoLite_size);
+    memcpy(record + 4, &len, sizeof(len));
+    record[6] = type;
+    record[7] = 0;
+    memcpy(record + NODE_JOURNAL_HEADER_SIZE, payload, len);
+    uint32_t crc = crc32Buffer(record + 4, recordSize - 4);
+    memcpy(record, &crc, sizeof(crc));
+
+    spiLock->lock();
+    FSCom.mkdir("/prefs");
+    auto f = FSCom.open(nodeJournalFileName, FILE_O_APPEND);
+    if (f) {
+        okay = f.write((uint8_t const *)record, recordSize) == recordSize;
+        f.close();
+    }
+    spiLock->unlock();
+
+    if (okay) {
+        nodeJournalBytes += recordSize;
+    } else {
+        // Records after a torn one are never replayed, start over from a full snapshot
+        LOG_ERROR("Can't append to %s, save the whole node database", nodeJournalFileName);
+        okay = saveNodeDatabaseToDisk();
+    }
+#else
+    LOG_ERROR("ERROR: Filesystem not implemented");
+#endif
+    return okay;
+}
+
+bool NodeDB::replayNodeJournal()
+{
+    nodeJournalBytes = 0;
+    bool clean = true;
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    auto snapshot = FSCom.open(nodeDatabaseFileName, FILE_O_READ);
+    if (snapshot) {
+        nodeSnapshotBytes = snapshot.size();
+        snapshot.close();
+    }
+    auto f = FSCom.open(nodeJournalFileName, FILE_O_READ);
+    if (!f)
+        return true;
+
+    uint8_t record[NODE_JOURNAL_HEADER_SIZE + meshtastic_NodeInfoLite_size];
+    uint32_t applied = 0;
+    while (f.available()) {
+        uint32_t crc;
+        uint16_t len;
+        if (f.read(record, NODE_JOURNAL_HEADER_SIZE) != NODE_JOURNAL_HEADER_SIZE) { // Torn header
+            clean = false;
+            break;
+        }
+        memcpy(&crc, record, sizeof(crc));
+        memcpy(&len, record + 4, sizeof(len));
+        uint8_t type = record[6];
+        if (len > meshtastic_NodeInfoLite_size || f.read(record + NODE_JOURNAL_HEADER_SIZE, len) != (int)len ||
+            crc32Buffer(record + 4, NODE_JOURNAL_HEADER_SIZE - 4 + len) != crc) {
+            clean = false;
+            break;
+        }
+
+        const uint8_t *payload = record + NODE_JOURNAL_HEADER_SIZE;
+        auto nodesEnd = meshNodes->begin() + numMeshNodes;
+        if (type == NODE_JOURNAL_PUT) {
+            meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_default;
+            pb_istream_t stream = pb_istream_from_buffer(payload, len);
+            if (!pb_decode(&stream, &meshtastic_NodeInfoLite_msg, &node)) {
+                clean = false;
+                break;
+            }
+            auto it =
+                std::find_if(meshNodes->begin(), nodesEnd, [&](const meshtastic_NodeInfoLite &n) { return n.num == node.num; });
+            if (it != nodesEnd) {
+                *it = node;
+            } else if (numMeshNodes < MAX_NUM_NODES) {
+                meshNodes->at(numMeshNodes++) = node;
+            } else {
+                // It made room for itself in a full DB, which only the snapshot remembers the evicted node from
+                int evict = findNodeToEvict();
+                if (evict != -1)
+                    meshNodes->at(evict) = node;
+            }
+        } else if (type == NODE_JOURNAL_REMOVE && len == sizeof(NodeNum)) {
+            NodeNum num;
+            memcpy(&num, payload, sizeof(num));
+            auto it =
+                std::remove_if(meshNodes->begin(), nodesEnd, [&](const meshtastic_NodeInfoLite &n) { return n.num == num; });
+            std::fill(it, nodesEnd, meshtastic_NodeInfoLite());
+            numMeshNodes = it - meshNodes->begin();
+        } else {
+            clean = false;
+            break;
+        }
+        nodeJournalBytes += NODE_JOURNAL_HEADER_SIZE + len;
+        applied++;
+    }
+    f.close();
+    LOG_INFO("Replayed %u records of %s, %u bytes", applied, nodeJournalFileName, nodeJournalBytes);
+#endif
+    return clean;
 }
 
 bool NodeDB::saveToDiskNoRetry(int saveWhat)
@@ -1629,7 +1807,7 @@ bool NodeDB::saveToDisk(int saveWhat)
 const meshtastic_NodeInfoLite *NodeDB::readNextMeshNode(uint32_t &readIndex)
 {
     if (readIndex < numMeshNodes)
-        return &meshNodes->at(readIndex++);
+        return getMeshNodeByIndex(readIndex++);
     else
         return NULL;
 }
@@ -1692,7 +1870,6 @@ size_t NodeDB::getNumOnlineMeshNodes(bool localOnly)
 }
 
 #include "MeshModule.h"
-#include "Throttle.h"
 
 /** Update position info for this node based on received position data
  */
@@ -1779,6 +1956,13 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
             return;
         }
     }
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    // Whatever key this node ends up with below, the AES key derived from the old one must not be used anymore
+    if (info->user.public_key.size == 32 && (contact.should_ignore || contact.user.public_key.size != 32 ||
+                                             memcmp(contact.user.public_key.bytes, info->user.public_key.bytes, 32) != 0)) {
+        crypto->invalidateSharedKey(info->user.public_key.bytes);
+    }
+#endif
     info->num = contact.node_num;
     info->has_user = true;
     info->user = TypeConversions::ConvertToUserLite(contact.user);
@@ -1818,10 +2002,20 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
         }
         // Mark the node's key as manually verified to indicate trustworthiness.
         updateGUIforNode = info;
-        sortMeshDB();
+        updateNodeOrder(info);
         notifyObservers(true); // Force an update whether or not our node counts have changed
     }
-    saveNodeDatabaseToDisk();
+    saveNodeToDisk(*info);
+}
+
+/// Compare the stored fields one by one, a memcmp would also see the struct padding
+static bool sameUserLite(const meshtastic_UserLite &a, const meshtastic_UserLite &b)
+{
+    return memcmp(a.macaddr, b.macaddr, sizeof(a.macaddr)) == 0 && strncmp(a.long_name, b.long_name, sizeof(a.long_name)) == 0 &&
+           strncmp(a.short_name, b.short_name, sizeof(a.short_name)) == 0 && a.hw_model == b.hw_model &&
+           a.is_licensed == b.is_licensed && a.role == b.role && a.public_key.size == b.public_key.size &&
+           memcmp(a.public_key.bytes, b.public_key.bytes, a.public_key.size) == 0 &&
+           a.has_is_unmessagable == b.has_is_unmessagable && a.is_unmessagable == b.is_unmessagable;
 }
 
 /** Update user info and channel for this node based on received user data
@@ -1869,9 +2063,10 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
     // Always ensure user.id is derived from nodeId, regardless of what was received
     snprintf(p.id, sizeof(p.id), "!%08x", nodeId);
 
-    // Both of info->user and p start as filled with zero so I think this is okay
     auto lite = TypeConversions::ConvertToUserLite(p);
-    bool changed = memcmp(&info->user, &lite, sizeof(info->user)) || (info->channel != channelIndex);
+    // Our own channel is never stored, so it must not count as a change either
+    bool changed =
+        !info->has_user || !sameUserLite(info->user, lite) || (nodeId != getNodeNum() && info->channel != channelIndex);
 
     info->user = lite;
     if (info->user.public_key.size == 32) {
@@ -1887,15 +2082,8 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
         updateGUIforNode = info;
         notifyObservers(true); // Force an update whether or not our node counts have changed
 
-        // We just changed something about a User,
-        // store our DB unless we just did so less than a minute ago
-
-        if (!Throttle::isWithinTimespanMs(lastNodeDbSave, ONE_MINUTE_MS)) {
-            saveToDisk(SEGMENT_NODEDATABASE);
-            lastNodeDbSave = millis();
-        } else {
-            LOG_DEBUG("Defer NodeDB saveToDisk for now");
-        }
+        // Only a stored field changed gets here, so the periodic NodeInfo broadcasts don't grow the journal
+        saveNodeToDisk(*info);
     }
 
     return changed;
@@ -1931,7 +2119,7 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             info->has_hops_away = true;
             info->hops_away = hopsAway;
         }
-        sortMeshDB();
+        updateNodeOrder(info);
     }
 }
 
@@ -1940,8 +2128,8 @@ void NodeDB::set_favorite(bool is_favorite, uint32_t nodeId)
     meshtastic_NodeInfoLite *lite = getMeshNode(nodeId);
     if (lite && lite->is_favorite != is_favorite) {
         lite->is_favorite = is_favorite;
-        sortMeshDB();
-        saveNodeDatabaseToDisk();
+        updateNodeOrder(lite);
+        saveNodeToDisk(*lite);
     }
 }
 
@@ -1963,80 +2151,177 @@ bool NodeDB::isFavorite(uint32_t nodeId)
 
 bool NodeDB::isFromOrToFavoritedNode(const meshtastic_MeshPacket &p)
 {
-    // This method is logically equivalent to:
-    //   return isFavorite(p.from) || isFavorite(p.to);
-    // but is more efficient by:
-    //   1. doing only one pass through the database, instead of two
-    //   2. exiting early when a favorite is found, or if both from and to have been seen
-
+    // Both lookups go through the node index, so this is just two hash probes
     if (p.to == NODENUM_BROADCAST)
         return isFavorite(p.from); // we never store NODENUM_BROADCAST in the DB, so we only need to check p.from
 
-    meshtastic_NodeInfoLite *lite = NULL;
+    return isFavorite(p.from) || isFavorite(p.to);
+}
 
-    bool seenFrom = false;
-    bool seenTo = false;
+void NodeDB::pause_sort(bool paused)
+{
+    sortingIsPaused = paused;
+    if (!paused && nodeOrderDirty)
+        sortMeshDB();
+}
 
-    for (int i = 0; i < numMeshNodes; i++) {
-        lite = &meshNodes->at(i);
+/// Full sort of nodeOrder, meshNodes itself stays put so this only moves 16 bit indexes around
+void NodeDB::sortMeshDB()
+{
+    if (sortingIsPaused) {
+        nodeOrderDirty = true;
+        return;
+    }
+    uint32_t start = millis();
+    orderedForNode = getNodeNum();
+    std::stable_sort(nodeOrder.begin(), nodeOrder.end(), [this](uint16_t a, uint16_t b) { return nodeSortsBefore(a, b); });
+    for (size_t pos = 0; pos < nodeOrder.size(); pos++)
+        nodeOrderPos[nodeOrder[pos]] = pos;
+    nodeOrderDirty = false;
+    LOG_DEBUG("Sort took %u milliseconds", millis() - start);
+}
 
-        if (lite->num == p.from) {
-            if (lite->is_favorite)
-                return true;
+bool NodeDB::nodeSortsBefore(uint16_t a, uint16_t b) const
+{
+    // Our own node first, then favorites, then the most recently heard
+    const meshtastic_NodeInfoLite &x = (*meshNodes)[a];
+    const meshtastic_NodeInfoLite &y = (*meshNodes)[b];
+    if (x.num == orderedForNode || y.num == orderedForNode)
+        return x.num == orderedForNode && y.num != orderedForNode;
+    if (x.is_favorite != y.is_favorite)
+        return x.is_favorite;
+    return x.last_heard > y.last_heard;
+}
 
-            seenFrom = true;
-        }
+/*
+ * Moving a node finds its new position by binary search, but then shifts the 16 bit indexes in between by one, which is
+ * O(n) rather than O(log n). At MAX_NUM_NODES (at most 250 on the MCUs) that is a memmove of up to 500 bytes, cheaper than the
+ * per-node pointers and rebalancing a search tree would take, and test_node_db's 5k node benchmark shows it also holds for
+ * big native DBs. The NodeInfoLite structs themselves are never moved.
+ */
+void NodeDB::updateNodeOrder(const meshtastic_NodeInfoLite *node)
+{
+    ensureNodeIndex();
+    if (sortingIsPaused || nodeOrderDirty) {
+        nodeOrderDirty = true;
+        return;
+    }
 
-        if (lite->num == p.to) {
-            if (lite->is_favorite)
-                return true;
+    uint16_t index = node - meshNodes->data();
+    size_t pos = nodeOrderPos[index];
+    auto cmp = [this](uint16_t a, uint16_t b) { return nodeSortsBefore(a, b); };
+    size_t first, last; // Range of nodeOrder that gets rotated by one
+    if (pos > 0 && nodeSortsBefore(index, nodeOrder[pos - 1])) {
+        // Moved up, e.g. just heard from: binary search the sorted part above it
+        first = std::upper_bound(nodeOrder.begin(), nodeOrder.begin() + pos, index, cmp) - nodeOrder.begin();
+        last = pos;
+        std::rotate(nodeOrder.begin() + first, nodeOrder.begin() + pos, nodeOrder.begin() + pos + 1);
+    } else if (pos + 1 < nodeOrder.size() && nodeSortsBefore(nodeOrder[pos + 1], index)) {
+        // Moved down, e.g. no longer a favorite
+        first = pos;
+        last = std::upper_bound(nodeOrder.begin() + pos + 1, nodeOrder.end(), index, cmp) - nodeOrder.begin() - 1;
+        std::rotate(nodeOrder.begin() + pos, nodeOrder.begin() + pos + 1, nodeOrder.begin() + last + 1);
+    } else {
+        return;
+    }
+    for (size_t i = first; i <= last; i++)
+        nodeOrderPos[nodeOrder[i]] = i;
+}
 
-            seenTo = true;
-        }
+void NodeDB::nodeOrderInsert(uint16_t index)
+{
+    size_t pos = nodeOrder.size();
+    if (sortingIsPaused || nodeOrderDirty)
+        nodeOrderDirty = true; // Park it at the end until the next full sort
+    else
+        pos = std::upper_bound(nodeOrder.begin(), nodeOrder.end(), index,
+                               [this](uint16_t a, uint16_t b) { return nodeSortsBefore(a, b); }) -
+              nodeOrder.begin();
+    nodeOrder.insert(nodeOrder.begin() + pos, index);
+    for (size_t i = pos; i < nodeOrder.size(); i++)
+        nodeOrderPos[nodeOrder[i]] = i;
+}
 
-        if (seenFrom && seenTo)
-            return false; // we've seen both, and neither is a favorite, so we can stop searching early
+void NodeDB::nodeOrderRemove(uint16_t index)
+{
+    size_t pos = nodeOrderPos[index];
+    nodeOrder.erase(nodeOrder.begin() + pos);
+    for (size_t i = pos; i < nodeOrder.size(); i++)
+        nodeOrderPos[nodeOrder[i]] = i;
+}
+
+void NodeDB::ensureNodeIndex()
+{
+    if (indexedNodes != meshNodes || indexedCount != numMeshNodes)
+        rebuildNodeIndex();
+    else if (orderedForNode != getNodeNum())
+        sortMeshDB();
+    else if (nodeOrderDirty && !sortingIsPaused)
+        sortMeshDB();
+}
 
-        // Note: if we knew that sortMeshDB was always called after any change to is_favorite, we could exit early after searching
-        // all favorited nodes first.
+void NodeDB::rebuildNodeIndex()
+{
+    indexedNodes = meshNodes;
+    indexedCount = numMeshNodes;
+
+    // Size for the whole array, so adding nodes never has to grow the index. At least half of the buckets stay empty.
+    size_t capacity = std::max<size_t>(meshNodes ? meshNodes->size() : 0, numMeshNodes);
+    size_t buckets = 16;
+    while (buckets < 2 * capacity)
+        buckets *= 2;
+    nodeIndexBuckets.assign(buckets, 0);
+    nodeOrder.clear();
+    nodeOrder.reserve(capacity);
+    nodeOrderPos.assign(capacity, 0);
+
+    for (uint16_t i = 0; i < numMeshNodes; i++) {
+        nodeIndexAdd(i);
+        nodeOrder.push_back(i);
     }
+    sortMeshDB();
+}
 
-    return false;
+size_t NodeDB::nodeBucketOf(NodeNum n) const
+{
+    // Node numbers come from MAC addresses, mix them before masking (murmur3 finalizer)
+    uint32_t h = n;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h & (nodeIndexBuckets.size() - 1);
 }
 
-void NodeDB::pause_sort(bool paused)
+void NodeDB::nodeIndexAdd(uint16_t index)
 {
-    sortingIsPaused = paused;
+    size_t mask = nodeIndexBuckets.size() - 1;
+    size_t b = nodeBucketOf(meshNodes->at(index).num);
+    while (nodeIndexBuckets[b] != 0)
+        b = (b + 1) & mask;
+    nodeIndexBuckets[b] = index + 1;
 }
 
-void NodeDB::sortMeshDB()
+void NodeDB::nodeIndexRemove(uint16_t index)
 {
-    if (!sortingIsPaused && (lastSort == 0 || !Throttle::isWithinTimespanMs(lastSort, 1000 * 5))) {
-        lastSort = millis();
-        bool changed = true;
-        while (changed) { // dumb reverse bubble sort, but probably not bad for what we're doing
-            changed = false;
-            for (int i = numMeshNodes - 1; i > 0; i--) { // lowest case this should examine is i == 1
-                if (meshNodes->at(i - 1).num == getNodeNum()) {
-                    // noop
-                } else if (meshNodes->at(i).num ==
-                           getNodeNum()) { // in the oddball case our own node num is not at location 0, put it there
-                    // TODO: Look for at(i-1) also matching own node num, and throw the DB in the trash
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                } else if (meshNodes->at(i).is_favorite && !meshNodes->at(i - 1).is_favorite) {
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                } else if (!meshNodes->at(i).is_favorite && meshNodes->at(i - 1).is_favorite) {
-                    // noop
-                } else if (meshNodes->at(i).last_heard > meshNodes->at(i - 1).last_heard) {
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                }
-            }
+    size_t mask = nodeIndexBuckets.size() - 1;
+    size_t hole = nodeBucketOf(meshNodes->at(index).num);
+    while (nodeIndexBuckets[hole] != index + 1) {
+        if (nodeIndexBuckets[hole] == 0)
+            return;
+        hole = (hole + 1) & mask;
+    }
+
+    // Backward shift deletion: pull later entries of the probe run into the hole unless that would put them before their home
+    for (size_t b = (hole + 1) & mask; nodeIndexBuckets[b] != 0; b = (b + 1) & mask) {
+        size_t home = nodeBucketOf(meshNodes->at(nodeIndexBuckets[b] - 1).num);
+        if (((b - home) & mask) >= ((b - hole) & mask)) {
+            nodeIndexBuckets[hole] = nodeIndexBuckets[b];
+            hole = b;
         }
-        LOG_INFO("Sort took %u milliseconds", millis() - lastSort);
     }
+    nodeIndexBuckets[hole] = 0;
 }
 
 uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
@@ -2056,14 +2341,25 @@ std::string NodeDB::getNodeId() const
 }
 
 /// Find a node in our DB, return null for missing
-/// NOTE: This function might be called from an ISR
+/// NOTE: This function might be called from an ISR, so it never rebuilds the index: the functions that change meshNodes
+/// keep it up to date, and if meshNodes was swapped behind our back (as test mocks do) we scan it like we used to
 meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
 {
-    for (int i = 0; i < numMeshNodes; i++)
-        if (meshNodes->at(i).num == n)
-            return &meshNodes->at(i);
-
-    return NULL;
+    if (indexedNodes != meshNodes || indexedCount != numMeshNodes) {
+        for (int i = 0; i < numMeshNodes; i++) {
+            if (meshNodes->at(i).num == n)
+                return &meshNodes->at(i);
+        }
+        return NULL;
+    }
+    size_t mask = nodeIndexBuckets.size() - 1;
+    for (size_t b = nodeBucketOf(n);; b = (b + 1) & mask) {
+        uint16_t entry = nodeIndexBuckets[b];
+        if (entry == 0)
+            return NULL;
+        if (meshNodes->at(entry - 1).num == n)
+            return &meshNodes->at(entry - 1);
+    }
 }
 
 // returns true if the maximum number of nodes is reached or we are running low on memory
@@ -2075,57 +2371,68 @@ bool NodeDB::isFull()
 /// Find a node in our DB, create an empty NodeInfo if missing
 meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
 {
+    // We are about to change the index, so it must describe meshNodes as it is now
+    ensureNodeIndex();
     meshtastic_NodeInfoLite *lite = getMeshNode(n);
 
     if (!lite) {
         if (isFull()) {
             LOG_INFO("Node database full with %i nodes and %u bytes free. Erasing oldest entry", numMeshNodes,
                      memGet.getFreeHeap());
-            // look for oldest node and erase it
-            uint32_t oldest = UINT32_MAX;
-            uint32_t oldestBoring = UINT32_MAX;
-            int oldestIndex = -1;
-            int oldestBoringIndex = -1;
-            for (int i = 1; i < numMeshNodes; i++) {
-                // Simply the oldest non-favorite, non-ignored, non-verified node
-                if (!meshNodes->at(i).is_favorite && !meshNodes->at(i).is_ignored &&
-                    !(meshNodes->at(i).bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK) &&
-                    meshNodes->at(i).last_heard < oldest) {
-                    oldest = meshNodes->at(i).last_heard;
-                    oldestIndex = i;
-                }
-                // The oldest "boring" node
-                if (!meshNodes->at(i).is_favorite && !meshNodes->at(i).is_ignored && meshNodes->at(i).user.public_key.size == 0 &&
-                    meshNodes->at(i).last_heard < oldestBoring) {
-                    oldestBoring = meshNodes->at(i).last_heard;
-                    oldestBoringIndex = i;
-                }
-            }
-            // if we found a "boring" node, evict it
-            if (oldestBoringIndex != -1) {
-                oldestIndex = oldestBoringIndex;
-            }
-
+            int oldestIndex = findNodeToEvict();
             if (oldestIndex != -1) {
-                // Shove the remaining nodes down the chain
-                for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
-                    meshNodes->at(i) = meshNodes->at(i + 1);
-                }
-                (numMeshNodes)--;
+                // Reuse its slot, the sort order lives in nodeOrder so nothing needs to be shifted. Like an explicit removal,
+                // the evicted node must not linger in clients that only download changes
+                nodeInfoCache.forget(meshNodes->at(oldestIndex).num);
+                nodeIndexRemove(oldestIndex);
+                nodeOrderRemove(oldestIndex);
+                lite = &meshNodes->at(oldestIndex);
             }
         }
-        // add the node at the end
-        lite = &meshNodes->at((numMeshNodes)++);
+        if (!lite) {
+            // add the node at the end
+            lite = &meshNodes->at((numMeshNodes)++);
+            indexedCount = numMeshNodes;
+        }
 
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        nodeIndexAdd(lite - meshNodes->data());
+        nodeOrderInsert(lite - meshNodes->data());
         LOG_INFO("Adding node to database with %i nodes and %u bytes free!", numMeshNodes, memGet.getFreeHeap());
     }
 
     return lite;
 }
 
+int NodeDB::findNodeToEvict() const
+{
+    // look for oldest node and erase it
+    uint32_t oldest = UINT32_MAX;
+    uint32_t oldestBoring = UINT32_MAX;
+    int oldestIndex = -1;
+    int oldestBoringIndex = -1;
+    for (int i = 0; i < numMeshNodes; i++) {
+        const meshtastic_NodeInfoLite &node = meshNodes->at(i);
+        if (node.num == myNodeInfo.my_node_num)
+            continue;
+        // Simply the oldest non-favorite, non-ignored, non-verified node
+        if (!node.is_favorite && !node.is_ignored && !(node.bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK) &&
+            node.last_heard < oldest) {
+            oldest = node.last_heard;
+            oldestIndex = i;
+        }
+        // The oldest "boring" node
+        if (!node.is_favorite && !node.is_ignored && node.user.public_key.size == 0 && node.last_heard < oldestBoring) {
+            oldestBoring = node.last_heard;
+            oldestBoringIndex = i;
+        }
+    }
+    // if we found a "boring" node, evict it
+    return oldestBoringIndex != -1 ? oldestBoringIndex : oldestIndex;
+}
+
 /// Sometimes we will have Position objects that only have a time, so check for
 /// valid lat/lon
 bool NodeDB::hasValidPosition(const meshtastic_NodeInfoLite *n)
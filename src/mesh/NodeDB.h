@@ -98,6 +98,7 @@ extern meshtastic_Position localPosition;
 static constexpr const char *deviceStateFileName = "/prefs/device.proto";
 static constexpr const char *legacyPrefFileName = "/prefs/db.proto";
 static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto";
+static constexpr const char *nodeJournalFileName = "/prefs/nodes.journal";
 static constexpr const char *configFileName = "/prefs/config.proto";
 static constexpr const char *uiconfigFileName = "/prefs/uiconfig.proto";
 static constexpr const char *moduleConfigFileName = "/prefs/module.proto";
@@ -133,9 +134,7 @@ class NodeDB
 {
     // NodeNum provisionalNodeNum; // if we are trying to find a node num this is our current attempt
 
-    // A NodeInfo for every node we've seen
-    // Eventually use a smarter datastructure
-    // HashMap<NodeNum, NodeInfo> nodes;
+    // A NodeInfo for every node we've seen, looked up through the node index below
     // Note: these two references just point into our static array we serialize to/from disk
 
   public:
@@ -157,6 +156,13 @@ class NodeDB
     bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
                                    SEGMENT_NODEDATABASE);
 
+    /**
+     * Persist one changed node by appending it to the node journal, instead of rewriting the whole node database.
+     * The journal is replayed on top of nodes.proto at boot, and folded into it once it grows too big.
+     * @return true if the save was successful
+     */
+    bool saveNodeToDisk(const meshtastic_NodeInfoLite &node);
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -205,6 +211,11 @@ class NodeDB
      */
     void pause_sort(bool paused);
 
+    /**
+     * Move a node to its place in the sorted node list, call after changing its is_favorite or last_heard in place
+     */
+    void updateNodeOrder(const meshtastic_NodeInfoLite *node);
+
     /// @return our node number
     NodeNum getNodeNum() { return myNodeInfo.my_node_num; }
 
@@ -247,10 +258,12 @@ class NodeDB
 
     const meshtastic_NodeInfoLite *readNextMeshNode(uint32_t &readIndex);
 
+    /// @return the node at position x of the sorted node list (us first, then favorites, then most recently heard)
     meshtastic_NodeInfoLite *getMeshNodeByIndex(size_t x)
     {
         assert(x < numMeshNodes);
-        return &meshNodes->at(x);
+        ensureNodeIndex();
+        return &meshNodes->at(nodeOrder[x]);
     }
 
     virtual meshtastic_NodeInfoLite *getMeshNode(NodeNum n);
@@ -310,17 +323,42 @@ class NodeDB
   private:
     bool duplicateWarned = false;
     bool localPositionUpdatedSinceBoot = false;
-    uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
-    uint32_t lastSort = 0;          // When last sorted the nodeDB
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
+    /// @return the meshNodes index of the node to make room for a new one in a full DB, or -1 if all are worth keeping
+    int findNodeToEvict() const;
 
     /*
      * Internal boolean to track sorting paused
      */
     bool sortingIsPaused = false;
 
+    /*
+     * Lookup index and sort order over meshNodes, which itself is never reordered.
+     * nodeIndexBuckets is an open addressing NodeNum hash holding meshNodes index + 1 (0 marks an empty bucket).
+     * nodeOrder lists the meshNodes indexes in sorted order and nodeOrderPos is its inverse.
+     * Both are rebuilt when meshNodes or numMeshNodes are changed behind our back.
+     */
+    std::vector<uint16_t> nodeIndexBuckets;
+    std::vector<uint16_t> nodeOrder;
+    std::vector<uint16_t> nodeOrderPos;
+    const std::vector<meshtastic_NodeInfoLite> *indexedNodes = nullptr;
+    pb_size_t indexedCount = 0;
+    NodeNum orderedForNode = 0;  // Our node number when nodeOrder was sorted, we always sort first
+    bool nodeOrderDirty = false; // nodeOrder needs a full sort, e.g. because sorting was paused
+
+    /// Rebuild the index if meshNodes changed behind our back, and catch up on a pending sort
+    void ensureNodeIndex();
+    void rebuildNodeIndex();
+    size_t nodeBucketOf(NodeNum n) const;
+    void nodeIndexAdd(uint16_t index);
+    void nodeIndexRemove(uint16_t index);
+    /// @return true if meshNodes[a] sorts before meshNodes[b]
+    bool nodeSortsBefore(uint16_t a, uint16_t b) const;
+    void nodeOrderInsert(uint16_t index);
+    void nodeOrderRemove(uint16_t index);
+
     /// pick a provisional nodenum we hope no one is using
     void pickNewNodeNum();
 
@@ -341,6 +379,15 @@ class NodeDB
     bool saveChannelsToDisk();
     bool saveDeviceStateToDisk();
     bool saveNodeDatabaseToDisk();
+
+    size_t nodeJournalBytes = 0;  // Size of nodeJournalFileName, it has to be folded into nodes.proto past a limit
+    size_t nodeSnapshotBytes = 0; // Size of nodes.proto when we last wrote it
+
+    /// Append a record to the node journal, or save the whole node database if the journal is due for compaction
+    bool appendNodeJournal(uint8_t type, const uint8_t *payload, uint16_t len);
+
+    /// Apply the node journal to the loaded node database, @return false if it ends in a torn or corrupt record
+    bool replayNodeJournal();
     void sortMeshDB();
 };
 
@@ -0,0 +1,170 @@
+#include "NodeInfoCache.h"
+#include "NodeDB.h"
+#include "concurrency/LockGuard.h"
+#include <algorithm>
+#include <string.h>
+
+NodeInfoCache nodeInfoCache;
+
+/// FNV-1a, one field at a time so the struct padding and the bytes after a string's end don't count
+static uint32_t mixBytes(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+template <typename T> static uint32_t mix(uint32_t hash, const T &field)
+{
+    return mixBytes(hash, &field, sizeof(field));
+}
+
+static uint32_t mixString(uint32_t hash, const char *s, size_t size)
+{
+    return mixBytes(hash, s, strnlen(s, size) + 1);
+}
+
+uint32_t NodeInfoCache::fingerprint(const meshtastic_NodeInfoLite &node)
+{
+    uint32_t h = 2166136261u;
+    h = mix(h, node.num);
+    h = mix(h, node.has_user);
+    if (node.has_user) {
+        const meshtastic_UserLite &u = node.user;
+        h = mixBytes(h, u.macaddr, sizeof(u.macaddr));
+        h = mixString(h, u.long_name, sizeof(u.long_name));
+        h = mixString(h, u.short_name, sizeof(u.short_name));
+        h = mix(h, u.hw_model);
+        h = mix(h, u.is_licensed);
+        h = mix(h, u.role);
+        h = mix(h, u.public_key.size);
+        h = mixBytes(h, u.public_key.bytes, u.public_key.size);
+        h = mix(h, u.has_is_unmessagable);
+        h = mix(h, u.is_unmessagable);
+    }
+    h = mix(h, node.has_position);
+    if (node.has_position) {
+        h = mix(h, node.position.latitude_i);
+        h = mix(h, node.position.longitude_i);
+        h = mix(h, node.position.altitude);
+        h = mix(h, node.position.time);
+        h = mix(h, node.position.location_source);
+    }
+    h = mix(h, node.snr);
+    h = mix(h, node.last_heard);
+    h = mix(h, node.has_device_metrics);
+    if (node.has_device_metrics) {
+        const meshtastic_DeviceMetrics &m = node.device_metrics;
+        h = mix(h, m.has_battery_level);
+        h = mix(h, m.battery_level);
+        h = mix(h, m.has_voltage);
+        h = mix(h, m.voltage);
+        h = mix(h, m.has_channel_utilization);
+        h = mix(h, m.channel_utilization);
+        h = mix(h, m.has_air_util_tx);
+        h = mix(h, m.air_util_tx);
+        h = mix(h, m.has_uptime_seconds);
+        h = mix(h, m.uptime_seconds);
+    }
+    h = mix(h, node.channel);
+    h = mix(h, node.via_mqtt);
+    h = mix(h, node.has_hops_away);
+    h = mix(h, node.hops_away);
+    h = mix(h, node.is_favorite);
+    h = mix(h, node.is_ignored);
+    h = mix(h, node.next_hop);
+    h = mix(h, node.bitfield);
+    return h;
+}
+
+size_t NodeInfoCache::get(NodeNum num, uint32_t fingerprint, uint8_t *buf)
+{
+    concurrency::LockGuard g(&lock);
+    auto it = records.find(num);
+    if (it == records.end() || it->second.fingerprint != fingerprint) {
+        misses++;
+        return 0;
+    }
+    hits++;
+    memcpy(buf, it->second.bytes.data(), it->second.bytes.size());
+    return it->second.bytes.size();
+}
+
+void NodeInfoCache::put(NodeNum num, uint32_t fingerprint, const uint8_t *buf, size_t len)
+{
+    bool full;
+    {
+        concurrency::LockGuard g(&lock);
+        full = records.size() >= MAX_NUM_NODES && !records.count(num);
+    }
+    if (full)
+        prune();
+
+    concurrency::LockGuard g(&lock);
+    Record &r = records[num];
+    r.fingerprint = fingerprint;
+    r.bytes.assign(buf, buf + len);
+}
+
+void NodeInfoCache::forget(NodeNum num)
+{
+    concurrency::LockGuard g(&lock);
+    records.erase(num);
+    // Only sending the changed nodes can't tell a client a node is gone
+    std::fill(std::begin(downloads), std::end(downloads), Download{});
+}
+
+void NodeInfoCache::clear()
+{
+    concurrency::LockGuard g(&lock);
+    records.clear();
+    std::fill(std::begin(downloads), std::end(downloads), Download{});
+}
+
+uint32_t NodeInfoCache::getLastDownload(uint64_t clientKey)
+{
+    concurrency::LockGuard g(&lock);
+    for (const Download &d : downloads)
+        if (clientKey && d.clientKey == clientKey)
+            return d.time;
+    return 0;
+}
+
+void NodeInfoCache::setLastDownload(uint64_t clientKey, uint32_t time)
+{
+    if (!clientKey)
+        return;
+    concurrency::LockGuard g(&lock);
+    // The client's own entry, or else the one of the client we haven't seen the longest
+    Download *slot = &downloads[0];
+    for (Download &d : downloads) {
+        if (d.clientKey == clientKey) {
+            slot = &d;
+            break;
+        }
+        if (d.time < slot->time)
+            slot = &d;
+    }
+    slot->clientKey = clientKey;
+    slot->time = time;
+}
+
+void NodeInfoCache::prune()
+{
+    // NodeDB evicts old nodes to make room without telling us. Look them up without our lock, so a download on another task
+    // never waits for NodeDB.
+    std::vector<NodeNum> nums;
+    {
+        concurrency::LockGuard g(&lock);
+        nums.reserve(records.size());
+        for (const auto &r : records)
+            nums.push_back(r.first);
+    }
+    nums.erase(std::remove_if(nums.begin(), nums.end(), [](NodeNum num) { return nodeDB->getMeshNode(num) != nullptr; }),
+               nums.end());
+
+    concurrency::LockGuard g(&lock);
+    for (NodeNum num : nums)
+        records.erase(num);
+}
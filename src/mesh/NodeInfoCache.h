@@ -0,0 +1,81 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "concurrency/Lock.h"
+
+#include <unordered_map>
+#include <vector>
+
+/// Keep the encoded FromRadio of every node we sent to a client, so the next download (by any client) can copy it instead of
+/// converting and encoding the node again. Uses a few hundred bytes per node, so only enabled by default where RAM is plenty.
+#ifndef NODEINFO_CACHE_ENABLED
+#ifdef ARCH_PORTDUINO
+#define NODEINFO_CACHE_ENABLED 1
+#else
+#define NODEINFO_CACHE_ENABLED 0
+#endif
+#endif
+
+/// How many clients we remember the last node download of, for SPECIAL_NONCE_ONLY_CHANGED_NODES
+#ifndef NODEINFO_DOWNLOAD_CLIENTS
+#define NODEINFO_DOWNLOAD_CLIENTS 8
+#endif
+
+/**
+ * What node downloads keep across client connections
+ *
+ * Encoded FromRadio.node_info records, keyed by node number. Each record remembers a fingerprint of the NodeInfoLite it was
+ * encoded from, so a node that changed since simply misses and gets encoded again. NodeDB forgets the records of nodes it
+ * removes.
+ *
+ * And when the last complete node download of each recent client started, as a PhoneAPI only lives as long as a connection.
+ * Clients are told apart by a key their transport makes from their address, see PhoneAPI::setClientAddress().
+ */
+class NodeInfoCache
+{
+  public:
+    /// @return a fingerprint of everything a node's FromRadio depends on
+    static uint32_t fingerprint(const meshtastic_NodeInfoLite &node);
+
+    /// Copy the cached record for this node into buf, if it was encoded from the same node contents
+    /// @return number of bytes copied, 0 on a miss
+    size_t get(NodeNum num, uint32_t fingerprint, uint8_t *buf);
+
+    /// Remember the encoded record of a node
+    void put(NodeNum num, uint32_t fingerprint, const uint8_t *buf, size_t len);
+
+    /// Forget a removed node. Clients that still have it need a full download again.
+    void forget(NodeNum num);
+
+    void clear();
+
+    /// @return when the last complete node download to this client started, 0 if we don't know of one
+    uint32_t getLastDownload(uint64_t clientKey);
+
+    /// Remember that a node download to this client, which started at time, is complete
+    void setLastDownload(uint64_t clientKey, uint32_t time);
+
+    uint32_t getHits() const { return hits; }
+    uint32_t getMisses() const { return misses; }
+
+  private:
+    struct Record {
+        uint32_t fingerprint;
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Download {
+        uint64_t clientKey;
+        uint32_t time;
+    };
+
+    std::unordered_map<NodeNum, Record> records;
+    Download downloads[NODEINFO_DOWNLOAD_CLIENTS] = {};
+    concurrency::Lock lock; // Some BLE stacks download from their own task
+    uint32_t hits = 0, misses = 0;
+
+    /// Drop the records of nodes NodeDB no longer has, call without lock held
+    void prune();
+};
+
+extern NodeInfoCache nodeInfoCache;
@@ -0,0 +1,126 @@
+#include "PacketFanout.h"
+#include "configuration.h"
+#include <assert.h>
+
+#include <algorithm>
+
+PacketFanout::PacketFanout(size_t capacity, Allocator<meshtastic_MeshPacket> &pool) : pool(pool)
+{
+    assert(capacity > 0);
+    slots.assign(capacity, Slot{NULL, 0, 0});
+}
+
+PacketFanout::~PacketFanout()
+{
+    while (tail != head)
+        dropOldest();
+}
+
+bool PacketFanout::push(meshtastic_MeshPacket *p, bool dropOldestUnread)
+{
+    if (head - tail == slots.size()) {
+        const Slot &oldest = slotOf(tail);
+        bool readByAnyone = delivered > tail;
+        if (oldest.holds > 0 || (!readByAnyone && !dropOldestUnread)) {
+            pool.release(p);
+            return false;
+        }
+        dropOldest();
+    }
+
+    Slot &s = slotOf(head++);
+    s.p = p;
+    s.refs = readers.size();
+    s.holds = 0;
+    return true;
+}
+
+void PacketFanout::addReader(Reader *r)
+{
+    r->cursor = std::max(delivered, tail);
+    r->dropped = 0;
+    for (uint32_t seq = r->cursor; seq != head; seq++)
+        slotOf(seq).refs++;
+    readers.push_back(r);
+}
+
+void PacketFanout::removeReader(Reader *r)
+{
+    readers.erase(std::remove(readers.begin(), readers.end(), r), readers.end());
+    for (uint32_t seq = std::max(r->cursor, tail); seq != head; seq++)
+        unref(seq);
+    trimTail();
+}
+
+const meshtastic_MeshPacket *PacketFanout::peek(Reader *r)
+{
+    if (r->cursor < tail) {
+        r->dropped += tail - r->cursor;
+        r->cursor = tail;
+    }
+    if (r->cursor == head)
+        return NULL;
+
+    Slot &s = slotOf(r->cursor);
+    s.holds++;
+    return s.p;
+}
+
+void PacketFanout::release(Reader *r)
+{
+    Slot &s = slotOf(r->cursor);
+    assert(s.holds > 0);
+    s.holds--;
+    r->cursor++;
+    delivered = std::max(delivered, r->cursor);
+    unref(r->cursor - 1);
+    trimTail();
+}
+
+const meshtastic_MeshPacket *PacketFanout::findById(PacketId id) const
+{
+    const meshtastic_MeshPacket *found = NULL;
+    for (uint32_t seq = tail; seq != head; seq++) {
+        const meshtastic_MeshPacket *p = slotOf(seq).p;
+        if (p && p->id == id)
+            found = p;
+    }
+    return found;
+}
+
+size_t PacketFanout::numQueued() const
+{
+    size_t n = 0;
+    for (uint32_t seq = tail; seq != head; seq++)
+        n += slotOf(seq).p != NULL;
+    return n;
+}
+
+void PacketFanout::unref(uint32_t seq)
+{
+    Slot &s = slotOf(seq);
+    assert(s.refs > 0);
+    // A packet nobody read yet stays around for the next reader, even if the readers it was meant for are gone
+    if (--s.refs == 0 && seq < delivered && s.p) {
+        pool.release(s.p);
+        s.p = NULL;
+    }
+}
+
+void PacketFanout::dropOldest()
+{
+    Slot &s = slotOf(tail++);
+    if (s.p) {
+        pool.release(s.p);
+        s.p = NULL;
+    }
+    s.refs = 0;
+    delivered = std::max(delivered, tail);
+}
+
+void PacketFanout::trimTail()
+{
+    while (tail != head && !slotOf(tail).p)
+        tail++;
+    delivered = std::max(delivered, tail);
+}
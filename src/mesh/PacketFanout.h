@@ -0,0 +1,86 @@
+#pragma once
+
+#include "MemoryPool.h"
+#include "MeshTypes.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * A fixed size ring of received packets shared by several readers (the connected API clients), each at its own cursor
+ *
+ * Packets are owned by the ring and never changed once pushed, so every reader gets the same buffer instead of a copy. Each
+ * slot counts the readers still due to read it, and the buffer goes back to the pool as soon as the last of them did. Packets
+ * pushed while no reader is attached are kept for the next reader to attach, which starts with the packets no reader has read
+ * yet.
+ *
+ * When the ring is full the oldest packet makes room. Readers that hadn't got to it yet skip it and count it in their dropped
+ * counter, so one slow reader can't stall the others.
+ *
+ * Not thread safe, callers serialize access.
+ */
+class PacketFanout
+{
+  public:
+    /// A reader of the ring, owned by the caller and attached with addReader()
+    struct Reader {
+        uint32_t cursor = 0;  // Sequence number of the next packet to read
+        uint32_t dropped = 0; // Packets this reader missed because the ring was full
+    };
+
+    PacketFanout(size_t capacity, Allocator<meshtastic_MeshPacket> &pool);
+    ~PacketFanout();
+
+    /**
+     * Append a packet, the ring takes ownership of it
+     * @param dropOldestUnread when full and no reader read the oldest packet yet, drop it rather than p
+     * @return false if p was dropped (and released) because the ring was full
+     */
+    bool push(meshtastic_MeshPacket *p, bool dropOldestUnread);
+
+    void addReader(Reader *r);
+
+    /// Detach a reader, call release() first if it holds a packet
+    void removeReader(Reader *r);
+
+    /// @return the next packet for this reader, or NULL. It stays valid until release(), even if the ring overflows meanwhile
+    const meshtastic_MeshPacket *peek(Reader *r);
+
+    /// The reader is done with the packet peek() returned, move on to the next one
+    void release(Reader *r);
+
+    /// @return true if some packets were not read by any reader yet
+    bool hasUnread() const { return std::max(delivered, tail) != head; }
+
+    /// @return the newest queued packet with this id, or NULL
+    const meshtastic_MeshPacket *findById(PacketId id) const;
+
+    /// @return number of packets held by the ring
+    size_t numQueued() const;
+
+  private:
+    struct Slot {
+        meshtastic_MeshPacket *p; // NULL once every reader is done with it
+        uint16_t refs;            // Readers that still have to read this packet
+        uint16_t holds;           // Readers between peek() and release() on this packet
+    };
+
+    Allocator<meshtastic_MeshPacket> &pool;
+    std::vector<Slot> slots;
+    std::vector<Reader *> readers;
+    uint32_t head = 0;      // Sequence number of the next packet pushed, slots are indexed by sequence number % capacity
+    uint32_t tail = 0;      // Sequence number of the oldest slot in use
+    uint32_t delivered = 0; // Packets before this one were read by at least one reader
+
+    Slot &slotOf(uint32_t seq) { return slots[seq % slots.size()]; }
+    const Slot &slotOf(uint32_t seq) const { return slots[seq % slots.size()]; }
+
+    /// One reader less has to read this packet, free it if it was the last and the packet was read at all
+    void unref(uint32_t seq);
+
+    /// Free the packet in the oldest slot, if any, and advance tail
+    void dropOldest();
+
+    /// Advance tail over slots whose packets are already freed
+    void trimTail();
+};
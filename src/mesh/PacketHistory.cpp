@@ -22,26 +22,50 @@ PacketHistory::PacketHistory(uint32_t size) : recentPacketsCapacity(0), recentPa
         LOG_WARN("Packet History - Invalid size %d, using default %d", size, PACKETHISTORY_MAX);
         size = PACKETHISTORY_MAX; // Use default size if invalid
     }
+    if (size >= NO_SLOT) {
+        LOG_WARN("Packet History - Size %d exceeds index limit, using %d", size, NO_SLOT - 1);
+        size = NO_SLOT - 1;
+    }
+
+    // Hash index gets at least twice as many buckets as records, keeping linear probe chains short
+    uint32_t buckets = 1;
+    while (buckets < size * 2)
+        buckets <<= 1;
 
-    // Allocate memory for the recent packets array
+    // Allocate memory for the recent packets array, its hash index and the age order links
     recentPacketsCapacity = size;
     recentPackets = new PacketRecord[recentPacketsCapacity];
-    if (!recentPackets) { // No logging here, console/log probably uninitialized yet.
+    recentIndex = new SlotIndex[buckets];
+    ageLinks = new AgeLink[recentPacketsCapacity];
+    if (!recentPackets || !recentIndex || !ageLinks) { // No logging here, console/log probably uninitialized yet.
         LOG_ERROR("Packet History - Memory allocation failed for size=%d entries / %d Bytes", size,
-                  sizeof(PacketRecord) * recentPacketsCapacity);
+                  (sizeof(PacketRecord) + sizeof(AgeLink)) * recentPacketsCapacity + sizeof(SlotIndex) * buckets);
+        delete[] recentPackets;
+        delete[] recentIndex;
+        delete[] ageLinks;
+        recentPackets = NULL;
+        recentIndex = NULL;
+        ageLinks = NULL;
         recentPacketsCapacity = 0; // mark allocation fail
         return;                    // return early
     }
+    recentIndexMask = buckets - 1;
 
-    // Initialize the recent packets array to zero
+    // Initialize the recent packets array and the index to zero
     memset(recentPackets, 0, sizeof(PacketRecord) * recentPacketsCapacity);
+    memset(recentIndex, 0, sizeof(SlotIndex) * buckets);
+    memset(ageLinks, 0xFF, sizeof(AgeLink) * recentPacketsCapacity); // NO_SLOT everywhere
 }
 
 PacketHistory::~PacketHistory()
 {
     recentPacketsCapacity = 0;
     delete[] recentPackets;
+    delete[] recentIndex;
+    delete[] ageLinks;
     recentPackets = NULL;
+    recentIndex = NULL;
+    ageLinks = NULL;
 }
 
 /** Update recentPackets and return true if we have already seen this packet */
@@ -205,17 +229,15 @@ PacketHistory::PacketRecord *PacketHistory::find(NodeNum sender, PacketId id)
         return NULL;
     }
 
-    PacketRecord *it = NULL;
-    for (it = recentPackets; it < (recentPackets + recentPacketsCapacity); ++it) {
-        if (it->id == id && it->sender == sender) {
+    SlotIndex slot = findSlot(sender, id);
+    if (slot != NO_SLOT) {
+        PacketRecord *it = recentPackets + slot;
 #if VERBOSE_PACKET_HISTORY
-            LOG_DEBUG("Packet History - find: s=%08x id=%08x FOUND nh=%02x rby=%02x %02x %02x age=%d slot=%d/%d", it->sender,
-                      it->id, it->next_hop, it->relayed_by[0], it->relayed_by[1], it->relayed_by[2], millis() - (it->rxTimeMsec),
-                      it - recentPackets, recentPacketsCapacity);
+        LOG_DEBUG("Packet History - find: s=%08x id=%08x FOUND nh=%02x rby=%02x %02x %02x age=%d slot=%d/%d", it->sender, it->id,
+                  it->next_hop, it->relayed_by[0], it->relayed_by[1], it->relayed_by[2], millis() - (it->rxTimeMsec), slot,
+                  recentPacketsCapacity);
 #endif
-            // only the first match is returned, so be careful not to create duplicate entries
-            return it; // Return pointer to the found record
-        }
+        return it; // Return pointer to the found record
     }
 
 #if VERBOSE_PACKET_HISTORY
@@ -227,69 +249,50 @@ PacketHistory::PacketRecord *PacketHistory::find(NodeNum sender, PacketId id)
 /** Insert/Replace oldest PacketRecord in recentPackets. */
 void PacketHistory::insert(const PacketRecord &r)
 {
+    if (r.rxTimeMsec == 0) {
+#if VERBOSE_PACKET_HISTORY
+        LOG_WARN("Packet History - insert: I will not store packet with rxTimeMsec = 0.");
+#endif
+        return; // Return early if we can't update the history
+    }
+
     uint32_t now_millis = millis(); // Should not jump with time changes
     uint32_t OldtrxTimeMsec = 0;
-    PacketRecord *tu = NULL; // Will insert here.
-    PacketRecord *it = NULL;
 
-    // Find a free, matching or oldest used slot in the recentPackets array
-    for (it = recentPackets; it < (recentPackets + recentPacketsCapacity); ++it) {
-        if (it->id == 0 && it->sender == 0 /*&& rxTimeMsec == 0*/) { // Record is empty
-            tu = it;                                                 // Remember the free slot
-#if VERBOSE_PACKET_HISTORY >= 2
-            LOG_DEBUG("Packet History - insert: Free slot@ %d/%d", tu - recentPackets, recentPacketsCapacity);
-#endif
-            // We have that, Exit the loop
-            it = (recentPackets + recentPacketsCapacity);
-        } else if (it->id == r.id && it->sender == r.sender) { // Record matches the packet we want to insert
-            tu = it;                                           // Remember the matching slot
-            OldtrxTimeMsec = now_millis - it->rxTimeMsec;      // ..and save current entry's age
-#if VERBOSE_PACKET_HISTORY >= 2
-            LOG_DEBUG("Packet History - insert: Matched slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
-                      OldtrxTimeMsec);
-#endif
-            // We have that, Exit the loop
-            it = (recentPackets + recentPacketsCapacity);
-        } else {
-            if (it->rxTimeMsec == 0) {
-                LOG_WARN(
-                    "Packet History - insert: Found packet s=%08x id=%08x with rxTimeMsec = 0, slot %d/%d. Should never happen!",
-                    it->sender, it->id, it - recentPackets, recentPacketsCapacity);
-            }
-            if ((now_millis - it->rxTimeMsec) > OldtrxTimeMsec) { // 49.7 days rollover friendly
-                OldtrxTimeMsec = now_millis - it->rxTimeMsec;
-                tu = it; // remember the oldest packet
-#if VERBOSE_PACKET_HISTORY >= 2
-                LOG_DEBUG("Packet History - insert: Older slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
-                          OldtrxTimeMsec);
-#endif
-            }
-            // keep looking for oldest till entire array is checked
+    // Use the matching slot, else a never used one, else the oldest used one (head of the age list)
+    SlotIndex slot = findSlot(r.sender, r.id);
+    bool matched = (slot != NO_SLOT);
+    bool fresh = false;
+    if (matched) {
+        OldtrxTimeMsec = now_millis - recentPackets[slot].rxTimeMsec; // ..and save current entry's age
+    } else if (usedSlots < recentPacketsCapacity) {
+        slot = usedSlots++;
+        fresh = true;
+    } else {
+        slot = oldestSlot;
+        if (slot == NO_SLOT) {
+            LOG_ERROR("Packet History - insert: No free slot, no matched packet, no oldest to reuse. Something leaked."); // mx
+            return; // Return early if we can't update the history
         }
+        OldtrxTimeMsec = now_millis - recentPackets[slot].rxTimeMsec; // 49.7 days rollover friendly
+        indexRemove(slot);
     }
-
-    if (tu == NULL) {
-        LOG_ERROR("Packet History - insert: No free slot, no matched packet, no oldest to reuse. Something leaked."); // mx
-        // assert(false); // This should never happen, we should always have at least one packet to clear
-        return; // Return early if we can't update the history
-    }
+    PacketRecord *tu = recentPackets + slot; // Will insert here.
 
 #if VERBOSE_PACKET_HISTORY
-    if (tu->id == 0 && tu->sender == 0) {
-        LOG_DEBUG("Packet History - insert: slot@ %d/%d is NEW", tu - recentPackets, recentPacketsCapacity);
-    } else if (tu->id == r.id && tu->sender == r.sender) {
-        LOG_DEBUG("Packet History - insert: slot@ %d/%d MATCHED, age=%d", tu - recentPackets, recentPacketsCapacity,
-                  OldtrxTimeMsec);
+    if (fresh) {
+        LOG_DEBUG("Packet History - insert: slot@ %d/%d is NEW", slot, recentPacketsCapacity);
+    } else if (matched) {
+        LOG_DEBUG("Packet History - insert: slot@ %d/%d MATCHED, age=%d", slot, recentPacketsCapacity, OldtrxTimeMsec);
     } else {
-        LOG_DEBUG("Packet History - insert: slot@ %d/%d REUSE OLDEST, age=%d", tu - recentPackets, recentPacketsCapacity,
-                  OldtrxTimeMsec);
+        LOG_DEBUG("Packet History - insert: slot@ %d/%d REUSE OLDEST, age=%d", slot, recentPacketsCapacity, OldtrxTimeMsec);
     }
 #endif
 
     // If we are reusing a slot, we should warn if the packet is too recent
 #if RECENT_WARN_AGE > 0
     if (tu->rxTimeMsec && (OldtrxTimeMsec < RECENT_WARN_AGE)) {
-        if (!(tu->id == r.id && tu->sender == r.sender)) {
+        if (!matched) {
 #if VERBOSE_PACKET_HISTORY
             LOG_WARN("Packet History - insert: Reusing slot aged %ds < %ds RECENT_WARN_AGE", OldtrxTimeMsec / 1000,
                      RECENT_WARN_AGE / 1000);
@@ -306,7 +309,7 @@ void PacketHistory::insert(const PacketRecord &r)
 #if PACKET_HISTORY_TRACE_AGING
     if (tu->rxTimeMsec != 0) {
         LOG_INFO("Packet History - insert: Reusing slot aged %.3fs TRACE %s", OldtrxTimeMsec / 1000.,
-                 (tu->id == r.id && tu->sender == r.sender) ? "MATCHED PACKET" : "OLDEST SLOT");
+                 matched ? "MATCHED PACKET" : "OLDEST SLOT");
     } else {
         LOG_INFO("Packet History - insert: Using new slot @uptime %.3fs TRACE NEW", millis() / 1000.);
     }
@@ -315,25 +318,106 @@ void PacketHistory::insert(const PacketRecord &r)
 #endif
 
 #if VERBOSE_PACKET_HISTORY
-    LOG_DEBUG("Packet History - insert: Store slot@ %d/%d s=%08x id=%08x nh=%02x rby=%02x %02x %02x rxT=%d BEFORE",
-              tu - recentPackets, recentPacketsCapacity, tu->sender, tu->id, tu->next_hop, tu->relayed_by[0], tu->relayed_by[1],
-              tu->relayed_by[2], tu->rxTimeMsec);
+    LOG_DEBUG("Packet History - insert: Store slot@ %d/%d s=%08x id=%08x nh=%02x rby=%02x %02x %02x rxT=%d BEFORE", slot,
+              recentPacketsCapacity, tu->sender, tu->id, tu->next_hop, tu->relayed_by[0], tu->relayed_by[1], tu->relayed_by[2],
+              tu->rxTimeMsec);
 #endif
 
-    if (r.rxTimeMsec == 0) {
+    *tu = r; // store the packet
+
+    // The record is now the most recent one. Index it under its new key unless it kept the old one.
+    if (!matched)
+        indexAdd(slot);
+    if (!fresh)
+        ageUnlink(slot);
+    ageAppend(slot);
+
 #if VERBOSE_PACKET_HISTORY
-        LOG_WARN("Packet History - insert: I will not store packet with rxTimeMsec = 0.");
+    LOG_DEBUG("Packet History - insert: Store slot@ %d/%d s=%08x id=%08x nh=%02x rby=%02x %02x %02x rxT=%d AFTER", slot,
+              recentPacketsCapacity, tu->sender, tu->id, tu->next_hop, tu->relayed_by[0], tu->relayed_by[1], tu->relayed_by[2],
+              tu->rxTimeMsec);
 #endif
-        return; // Return early if we can't update the history
+}
+
+/** Home bucket of a (sender, id) key in recentIndex */
+uint32_t PacketHistory::bucketOf(NodeNum sender, PacketId id) const
+{
+    // Packet ids are random-ish but senders are not, so mix both before masking (murmur3 finalizer)
+    uint32_t h = id ^ (sender * 0x9E3779B1u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h & recentIndexMask;
+}
+
+/** Look up the slot holding (sender, id), NO_SLOT if not in history */
+PacketHistory::SlotIndex PacketHistory::findSlot(NodeNum sender, PacketId id) const
+{
+    for (uint32_t b = bucketOf(sender, id);; b = (b + 1) & recentIndexMask) {
+        SlotIndex entry = recentIndex[b];
+        if (entry == 0)
+            return NO_SLOT;
+        const PacketRecord &it = recentPackets[entry - 1];
+        if (it.id == id && it.sender == sender)
+            return entry - 1;
     }
+}
 
-    *tu = r; // store the packet
+/** Index the record in slot under its (sender, id). The table never fills since it has twice as many buckets as slots. */
+void PacketHistory::indexAdd(SlotIndex slot)
+{
+    uint32_t b = bucketOf(recentPackets[slot].sender, recentPackets[slot].id);
+    while (recentIndex[b] != 0)
+        b = (b + 1) & recentIndexMask;
+    recentIndex[b] = slot + 1;
+}
 
-#if VERBOSE_PACKET_HISTORY
-    LOG_DEBUG("Packet History - insert: Store slot@ %d/%d s=%08x id=%08x nh=%02x rby=%02x %02x %02x rxT=%d AFTER",
-              tu - recentPackets, recentPacketsCapacity, tu->sender, tu->id, tu->next_hop, tu->relayed_by[0], tu->relayed_by[1],
-              tu->relayed_by[2], tu->rxTimeMsec);
-#endif
+/** Drop the record in slot from the index, shifting later probe chain members back so no tombstones are needed */
+void PacketHistory::indexRemove(SlotIndex slot)
+{
+    uint32_t hole = bucketOf(recentPackets[slot].sender, recentPackets[slot].id);
+    while (recentIndex[hole] != slot + 1) {
+        if (recentIndex[hole] == 0)
+            return; // Not indexed
+        hole = (hole + 1) & recentIndexMask;
+    }
+
+    for (uint32_t b = (hole + 1) & recentIndexMask; recentIndex[b] != 0; b = (b + 1) & recentIndexMask) {
+        const PacketRecord &it = recentPackets[recentIndex[b] - 1];
+        uint32_t home = bucketOf(it.sender, it.id);
+        // Move the entry into the hole if its home bucket does not lie cyclically in (hole, b]
+        if (((b - home) & recentIndexMask) >= ((b - hole) & recentIndexMask)) {
+            recentIndex[hole] = recentIndex[b];
+            hole = b;
+        }
+    }
+    recentIndex[hole] = 0;
+}
+
+void PacketHistory::ageUnlink(SlotIndex slot)
+{
+    AgeLink &l = ageLinks[slot];
+    if (l.prev != NO_SLOT)
+        ageLinks[l.prev].next = l.next;
+    else
+        oldestSlot = l.next;
+    if (l.next != NO_SLOT)
+        ageLinks[l.next].prev = l.prev;
+    else
+        newestSlot = l.prev;
+    l.prev = l.next = NO_SLOT;
+}
+
+void PacketHistory::ageAppend(SlotIndex slot)
+{
+    AgeLink &l = ageLinks[slot];
+    l.prev = newestSlot;
+    l.next = NO_SLOT;
+    if (newestSlot != NO_SLOT)
+        ageLinks[newestSlot].next = slot;
+    else
+        oldestSlot = slot;
+    newestSlot = slot;
 }
 
 /* Check if a certain node was a relayer of a packet in the history given an ID and sender
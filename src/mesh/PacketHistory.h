@@ -24,17 +24,43 @@ class PacketHistory
         uint8_t relayed_by[NUM_RELAYERS]; // Array of nodes that relayed this packet
     };                                    // 4B + 4B + 4B + 1B + 1B + 6B = 20B
 
+    // Slot numbers are stored 16 bit wide to keep the index small on MCUs, which caps the history at 65534 records.
+    typedef uint16_t SlotIndex;
+    static const SlotIndex NO_SLOT = 0xFFFF;
+
+    struct AgeLink {    // Doubly linked age order over the slots of recentPackets, oldest first
+        SlotIndex prev; // Next older record, NO_SLOT if this is the oldest
+        SlotIndex next; // Next newer record, NO_SLOT if this is the newest
+    };
+
     uint32_t recentPacketsCapacity =
         0; // Can be set in constructor, no need to recompile. Used to allocate memory for mx_recentPackets.
     PacketRecord *recentPackets = NULL; // Simple and fixed in size. Debloat.
 
+    // Open addressing (linear probing) hash index over (sender, id). Each bucket holds slot + 1, 0 means empty.
+    SlotIndex *recentIndex = NULL;
+    uint32_t recentIndexMask = 0; // Bucket count - 1, bucket count is a power of two >= 2 * recentPacketsCapacity
+
+    AgeLink *ageLinks = NULL;    // One per slot in recentPackets
+    SlotIndex oldestSlot = NO_SLOT;
+    SlotIndex newestSlot = NO_SLOT;
+    uint32_t usedSlots = 0; // Slots are handed out in order and never freed, so [0, usedSlots) are in use
+
+    uint32_t bucketOf(NodeNum sender, PacketId id) const;
+    SlotIndex findSlot(NodeNum sender, PacketId id) const;
+    void indexAdd(SlotIndex slot);
+    void indexRemove(SlotIndex slot);
+    void ageUnlink(SlotIndex slot);
+    void ageAppend(SlotIndex slot);
+
     /** Find a packet record in history.
      * @param sender NodeNum
      * @param id PacketId
      * @return pointer to PacketRecord if found, NULL if not found */
     PacketRecord *find(NodeNum sender, PacketId id);
 
-    /** Insert/Replace oldest PacketRecord in mx_recentPackets.
+    /** Insert/Replace oldest PacketRecord in mx_recentPackets. Constant time: the slot is found through recentIndex and the
+     * oldest slot is the head of the age list.
      * @param r PacketRecord to insert or replace */
     void insert(const PacketRecord &r); // Insert or replace a packet record in the history
 
@@ -8,14 +8,17 @@
 #include "FSCommon.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeInfoCache.h"
 #include "PacketHistory.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
+#include "Profiler.h"
 #include "RadioInterface.h"
 #include "Router.h"
 #include "SPILock.h"
 #include "TypeConversions.h"
 #include "concurrency/LockGuard.h"
+#include "concurrency/OSThread.h"
 #include "main.h"
 #include "modules/NodeInfoModule.h"
 #include "xmodem.h"
@@ -32,6 +35,7 @@
 #endif
 #include "Throttle.h"
 #include <RTC.h>
+#include <algorithm>
 
 // Flag to indicate a heartbeat was received and we should send queue status
 bool heartbeatReceived = false;
@@ -47,11 +51,21 @@ PhoneAPI::~PhoneAPI()
     close();
 }
 
+void PhoneAPI::setClientAddress(const uint8_t *addr, size_t len)
+{
+    // The length goes in the top byte, so an IPv4 address can't be taken for a BLE one
+    len = std::min(len, (size_t)6);
+    clientKey = (uint64_t)len << 56;
+    for (size_t i = 0; i < len; i++)
+        clientKey |= (uint64_t)addr[i] << (8 * i);
+}
+
 void PhoneAPI::handleStartConfig()
 {
     // Must be before setting state (because state is how we know !connected)
     if (!isConnected()) {
         onConnectionChanged(true);
+        service->addPhoneReader(&toPhoneReader);
         observe(&service->fromNumChanged);
 #ifdef FSCom
         observe(&xModem.packetReady);
@@ -62,7 +76,7 @@ void PhoneAPI::handleStartConfig()
     onConfigStart();
 
     // even if we were already connected - restart our state machine
-    if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+    if (wantsOnlyNodes()) {
         // If client only wants node info, jump directly to sending nodes
         state = STATE_SEND_OWN_NODEINFO;
         LOG_INFO("Client only wants node info, skipping other config");
@@ -83,6 +97,12 @@ void PhoneAPI::handleStartConfig()
         nodeInfoQueue.clear();
     }
     resetReadIndex();
+    if (config_nonce == SPECIAL_NONCE_ONLY_CHANGED_NODES) {
+        // The PhoneAPI of a TCP client only lives as long as its connection, so this is kept with the node cache
+        nodeInfoSince = nodeInfoCache.getLastDownload(clientKey);
+        LOG_INFO("Client only wants nodes heard since %u", nodeInfoSince);
+    }
+    nodeDownloadStart = getTime();
 }
 
 void PhoneAPI::close()
@@ -109,6 +129,7 @@ void PhoneAPI::close()
         unobserve(&xModem.packetReady);
 #endif
         releasePhonePacket(); // Don't leak phone packets on shutdown
+        service->removePhoneReader(&toPhoneReader);
         releaseQueueStatusPhonePacket();
         releaseMqttClientProxyPhonePacket();
         releaseClientNotification();
@@ -128,6 +149,7 @@ void PhoneAPI::close()
         fromRadioNum = 0;
         config_nonce = 0;
         config_state = 0;
+        nodeInfoSince = 0;
         pauseBluetoothLogging = false;
         heartbeatReceived = false;
     }
@@ -197,6 +219,9 @@ bool PhoneAPI::handleToRadio(const uint8_t *buf, size_t bufLength)
             // factory_reset without waiting out the normal 10-minute
             // NodeInfo send cooldown. Mirrors the TCP/UDP path in
             // `src/mesh/api/PacketAPI.cpp:74-79` for serial clients.
+            // nonce==2 asks which threads use the most CPU time, nonce==3
+            // for the profiler's run time histograms, both answered with a
+            // ClientNotification.
             // Default nonce (0) remains a plain keepalive that triggers
             // a queue-status reply.
             if (toRadioScratch.heartbeat.nonce == 1) {
@@ -204,6 +229,12 @@ bool PhoneAPI::handleToRadio(const uint8_t *buf, size_t bufLength)
                     LOG_INFO("Broadcasting nodeinfo ping (serial)");
                     nodeInfoModule->sendOurNodeInfo(NODENUM_BROADCAST, true, 0, true);
                 }
+            } else if (toRadioScratch.heartbeat.nonce == 2) {
+                sendThreadStats();
+#if !MESHTASTIC_EXCLUDE_PROFILER
+            } else if (toRadioScratch.heartbeat.nonce == 3) {
+                sendProfile();
+#endif
             } else {
                 LOG_DEBUG("Got client heartbeat");
                 heartbeatReceived = true;
@@ -302,7 +333,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
                 nodeInfoForPhone.num = 0;
             }
         }
-        if (config_nonce == SPECIAL_NONCE_ONLY_NODES) {
+        if (wantsOnlyNodes()) {
             // If client only wants node info, jump directly to sending nodes
             state = STATE_SEND_OTHER_NODEINFOS;
             onNowHasData(0);
@@ -314,6 +345,11 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 
     case STATE_SEND_METADATA:
         LOG_DEBUG("Send device metadata");
+        {
+            const AllocatorStats pool = packetPool.getStats();
+            LOG_DEBUG("Packet pool: %u in use, %u high water, %u capacity, %u alloc failures", pool.inUse, pool.highWater,
+                      pool.capacity, pool.allocFailures);
+        }
         fromRadioScratch.which_payload_variant = meshtastic_FromRadio_metadata_tag;
         fromRadioScratch.metadata = getDeviceMetadata();
         state = STATE_SEND_CHANNELS;
@@ -491,7 +527,10 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
         }
 
         meshtastic_NodeInfo infoToSend = {};
-        {
+        size_t numbytes = 0;
+        if (useNodeInfoCache()) {
+            numbytes = encodeNextNodeInfo(buf);
+        } else {
             concurrency::LockGuard guard(&nodeInfoMutex);
             if (nodeInfoForPhone.num == 0 && !nodeInfoQueue.empty()) {
                 // Serve the next cached node without re-reading from the DB iterator.
@@ -503,10 +542,9 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
                 nodeInfoForPhone = {};
         }
 
-        if (infoToSend.num != 0) {
-            // Just in case we stored a different user.id in the past, but should never happen going forward
-            sprintf(infoToSend.user.id, "!%08x", infoToSend.num);
-
+        if (numbytes) {
+            return numbytes; // Already encoded into buf
+        } else if (infoToSend.num != 0) {
             // Logging this really slows down sending nodes on initial connection because the serial console is so slow, so only
             // uncomment if you really need to:
             // LOG_INFO("nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s", nodeInfoForPhone.num, nodeInfoForPhone.last_heard,
@@ -521,7 +559,10 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
             fromRadioScratch.node_info = infoToSend;
             prefetchNodeInfos();
         } else {
-            LOG_DEBUG("Done sending %d of %d nodeinfos millis=%u", readIndex, nodeDB->getNumMeshNodes(), millis());
+            LOG_DEBUG("Done sending %d of %d nodeinfos millis=%u, %u cached encodings reused so far", readIndex,
+                      nodeDB->getNumMeshNodes(), millis(), nodeInfoCache.getHits());
+            nodeInfoCache.setLastDownload(clientKey, nodeDownloadStart);
+            nodeInfoSince = 0;
             concurrency::LockGuard guard(&nodeInfoMutex);
             nodeInfoQueue.clear();
             state = STATE_SEND_FILEMANIFEST;
@@ -534,8 +575,7 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
     case STATE_SEND_FILEMANIFEST: {
         LOG_DEBUG("FromRadio=STATE_SEND_FILEMANIFEST");
         // last element
-        if (config_state == filesManifest.size() ||
-            config_nonce == SPECIAL_NONCE_ONLY_NODES) { // also handles an empty filesManifest
+        if (config_state == filesManifest.size() || wantsOnlyNodes()) { // also handles an empty filesManifest
             config_state = 0;
             filesManifest.clear();
             // Skip to complete packet
@@ -631,7 +671,11 @@ void PhoneAPI::sendConfigComplete()
 void PhoneAPI::releasePhonePacket()
 {
     if (packetForPhone) {
-        service->releaseToPool(packetForPhone); // we just copied the bytes, so don't need this buffer anymore
+        // we just copied the bytes, so don't need this buffer anymore
+        if (packetForPhoneIsShared)
+            service->releaseForPhone(&toPhoneReader);
+        else
+            service->releaseToPool(const_cast<meshtastic_MeshPacket *>(packetForPhone));
         packetForPhone = NULL;
     }
 }
@@ -644,6 +688,21 @@ void PhoneAPI::releaseQueueStatusPhonePacket()
     }
 }
 
+/// Convert a node the way clients get it in the node download
+static meshtastic_NodeInfo convertForPhone(const meshtastic_NodeInfoLite *node)
+{
+    auto info = TypeConversions::ConvertToNodeInfo(node);
+    bool isUs = info.num == nodeDB->getNodeNum();
+    info.hops_away = isUs ? 0 : info.hops_away;
+    info.last_heard = isUs ? getValidTime(RTCQualityFromNet) : info.last_heard;
+    info.snr = isUs ? 0 : info.snr;
+    info.via_mqtt = isUs ? false : info.via_mqtt;
+    info.is_favorite = info.is_favorite || isUs;
+    // Just in case we stored a different user.id in the past, but should never happen going forward
+    sprintf(info.user.id, "!%08x", info.num);
+    return info;
+}
+
 void PhoneAPI::prefetchNodeInfos()
 {
     bool added = false;
@@ -654,15 +713,10 @@ void PhoneAPI::prefetchNodeInfos()
             auto nextNode = nodeDB->readNextMeshNode(readIndex);
             if (!nextNode)
                 break;
+            if (!wantsNodeInfo(nextNode))
+                continue;
 
-            auto info = TypeConversions::ConvertToNodeInfo(nextNode);
-            bool isUs = info.num == nodeDB->getNodeNum();
-            info.hops_away = isUs ? 0 : info.hops_away;
-            info.last_heard = isUs ? getValidTime(RTCQualityFromNet) : info.last_heard;
-            info.snr = isUs ? 0 : info.snr;
-            info.via_mqtt = isUs ? false : info.via_mqtt;
-            info.is_favorite = info.is_favorite || isUs;
-            nodeInfoQueue.push_back(info);
+            nodeInfoQueue.push_back(convertForPhone(nextNode));
             added = true;
         }
     }
@@ -671,6 +725,40 @@ void PhoneAPI::prefetchNodeInfos()
         onNowHasData(0);
 }
 
+bool PhoneAPI::wantsNodeInfo(const meshtastic_NodeInfoLite *node) const
+{
+    return nodeInfoSince == 0 || node->last_heard >= nodeInfoSince;
+}
+
+bool PhoneAPI::useNodeInfoCache()
+{
+    return NODEINFO_CACHE_ENABLED && !needsFromRadioScratch();
+}
+
+size_t PhoneAPI::encodeNextNodeInfo(uint8_t *buf)
+{
+    const meshtastic_NodeInfoLite *node;
+    while ((node = nodeDB->readNextMeshNode(readIndex)) != NULL) {
+        if (!wantsNodeInfo(node))
+            continue;
+
+        // Our own record carries the current time, no use caching it
+        bool isUs = node->num == nodeDB->getNodeNum();
+        uint32_t fingerprint = NodeInfoCache::fingerprint(*node);
+        size_t numbytes = isUs ? 0 : nodeInfoCache.get(node->num, fingerprint, buf);
+        if (numbytes)
+            return numbytes;
+
+        fromRadioScratch.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+        fromRadioScratch.node_info = convertForPhone(node);
+        numbytes = pb_encode_to_bytes(buf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadioScratch);
+        if (!isUs)
+            nodeInfoCache.put(node->num, fingerprint, buf, numbytes);
+        return numbytes;
+    }
+    return 0;
+}
+
 void PhoneAPI::releaseMqttClientProxyPhonePacket()
 {
     if (mqttClientProxyMessageForPhone) {
@@ -707,6 +795,8 @@ bool PhoneAPI::available()
         return true;
 
     case STATE_SEND_OTHER_NODEINFOS: {
+        if (useNodeInfoCache())
+            return true; // getFromRadio() encodes the nodes itself, nothing to prefetch
         concurrency::LockGuard guard(&nodeInfoMutex);
         if (nodeInfoQueue.empty()) {
             // Drop the lock before prefetching; prefetchNodeInfos() will re-acquire it.
@@ -740,13 +830,17 @@ bool PhoneAPI::available()
 #ifdef ARCH_ESP32
 #if !MESHTASTIC_EXCLUDE_STOREFORWARD
         // Check if StoreForward has packets stored for us.
-        if (!packetForPhone && storeForwardModule)
+        if (!packetForPhone && storeForwardModule) {
             packetForPhone = storeForwardModule->getForPhone();
+            packetForPhoneIsShared = false;
+        }
 #endif
 #endif
 
-        if (!packetForPhone)
-            packetForPhone = service->getForPhone();
+        if (!packetForPhone) {
+            packetForPhone = service->getForPhone(&toPhoneReader);
+            packetForPhoneIsShared = true;
+        }
         hasPacket = !!packetForPhone;
         return hasPacket;
     }
@@ -768,6 +862,27 @@ void PhoneAPI::sendNotification(meshtastic_LogRecord_Level level, uint32_t reply
     service->sendClientNotification(cn);
 }
 
+#if !MESHTASTIC_EXCLUDE_PROFILER
+void PhoneAPI::sendProfile()
+{
+    meshtastic_ClientNotification *cn = clientNotificationPool.allocZeroed();
+    cn->level = meshtastic_LogRecord_Level_INFO;
+    cn->time = getValidTime(RTCQualityFromNet);
+    profiler.describe(cn->message, sizeof(cn->message), 6);
+    service->sendClientNotification(cn);
+}
+#endif
+
+void PhoneAPI::sendThreadStats()
+{
+    meshtastic_ClientNotification *cn = clientNotificationPool.allocZeroed();
+    cn->level = meshtastic_LogRecord_Level_INFO;
+    cn->time = getValidTime(RTCQualityFromNet);
+    concurrency::mainController.describeBusiest(cn->message, sizeof(cn->message), 10);
+    LOG_INFO("Busiest threads: %s", cn->message);
+    service->sendClientNotification(cn);
+}
+
 bool PhoneAPI::wasSeenRecently(uint32_t id)
 {
     for (int i = 0; i < 20; i++) {
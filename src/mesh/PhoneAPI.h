@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Observer.h"
+#include "PacketFanout.h"
 #include "concurrency/Lock.h"
 #include "mesh-pb-constants.h"
 #include "meshtastic/portnums.pb.h"
@@ -22,6 +23,8 @@
 
 #define SPECIAL_NONCE_ONLY_CONFIG 69420
 #define SPECIAL_NONCE_ONLY_NODES 69421 // ( ͡° ͜ʖ ͡°)
+// Like SPECIAL_NONCE_ONLY_NODES, but only the nodes heard since the previous node download to the same client
+#define SPECIAL_NONCE_ONLY_CHANGED_NODES 69422
 
 /**
  * Provides our protobuf based API which phone/PC clients can use to talk to our device
@@ -65,7 +68,11 @@ class PhoneAPI
 
     /// We temporarily keep the packet here between the call to available and getFromRadio.  We will free it after the phone
     /// downloads it
-    meshtastic_MeshPacket *packetForPhone = NULL;
+    const meshtastic_MeshPacket *packetForPhone = NULL;
+    bool packetForPhoneIsShared = false; // packetForPhone came from the to-phone ring we share with other clients
+
+    /// Our read position in the to-phone ring of MeshService, while connected
+    PacketFanout::Reader toPhoneReader;
 
     // file transfer packets destined for phone. Push it to the queue then free it.
     meshtastic_XModem xmodemPacketForPhone = meshtastic_XModem_init_zero;
@@ -95,6 +102,13 @@ class PhoneAPI
     uint32_t config_nonce = 0;
     uint32_t readIndex = 0;
 
+    /// Only send the nodes heard at or after this time (0 sends them all), for SPECIAL_NONCE_ONLY_CHANGED_NODES
+    uint32_t nodeInfoSince = 0;
+    /// When the node download in progress started
+    uint32_t nodeDownloadStart = 0;
+    /// Who is on the other end, 0 if unknown, see setClientAddress()
+    uint64_t clientKey = 0;
+
     std::vector<meshtastic_FileInfo> filesManifest = {};
 
     void resetReadIndex() { readIndex = 0; }
@@ -120,6 +134,16 @@ class PhoneAPI
      */
     virtual void sendNotification(meshtastic_LogRecord_Level level, uint32_t replyId, const char *message);
 
+    /**
+     * Send the threads that used the most CPU time so far, with their run counts, as a (client)notification
+     */
+    void sendThreadStats();
+
+    /**
+     * Send the run time percentiles of the profile points that took the most time as a (client)notification
+     */
+    void sendProfile();
+
     /**
      * Get the next packet we want to send to the phone
      *
@@ -138,6 +162,13 @@ class PhoneAPI
     bool isConnected() { return state != STATE_SEND_NOTHING; }
     bool isSendingPackets() { return state == STATE_SEND_PACKETS; }
 
+    /**
+     * Tell which client is on the other end, by its IP or BLE address, so a SPECIAL_NONCE_ONLY_CHANGED_NODES download after it
+     * reconnects only sends the nodes heard since its last one. Transports that can't tell clients apart don't call this, and
+     * their clients always get all nodes.
+     */
+    void setClientAddress(const uint8_t *addr, size_t len);
+
   protected:
     /// Our fromradio packet while it is being assembled
     meshtastic_FromRadio fromRadioScratch = {};
@@ -164,6 +195,10 @@ class PhoneAPI
     virtual void onConfigStart() {}
     virtual void onConfigComplete() {}
 
+    /// Subclasses that read fromRadioScratch after getFromRadio() return true, so we always fill it instead of copying
+    /// pre-encoded records into the buffer
+    virtual bool needsFromRadioScratch() { return false; }
+
     /// begin a new connection
     void handleStartConfig();
 
@@ -186,6 +221,22 @@ class PhoneAPI
 
     void prefetchNodeInfos();
 
+    /// @return true if the client only asked for the node database
+    bool wantsOnlyNodes() const
+    {
+        return config_nonce == SPECIAL_NONCE_ONLY_NODES || config_nonce == SPECIAL_NONCE_ONLY_CHANGED_NODES;
+    }
+
+    /// @return true if this node belongs in the node download in progress
+    bool wantsNodeInfo(const meshtastic_NodeInfoLite *node) const;
+
+    /// @return true if we serve nodes from nodeInfoCache rather than through nodeInfoQueue
+    bool useNodeInfoCache();
+
+    /// Encode the next node of the download into buf, from nodeInfoCache if it didn't change
+    /// @return number of bytes, 0 when there are no more nodes
+    size_t encodeNextNodeInfo(uint8_t *buf);
+
     void releaseMqttClientProxyPhonePacket();
 
     void releaseClientNotification();
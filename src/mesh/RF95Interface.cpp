@@ -257,12 +257,12 @@ bool RF95Interface::reconfigure()
 }
 
 /**
- * Add SNR data to received messages
+ * Add SNR data to received frames
  */
-void RF95Interface::addReceiveMetadata(meshtastic_MeshPacket *mp)
+void RF95Interface::addReceiveMetadata(RxFrame *frame)
 {
-    mp->rx_snr = lora->getSNR();
-    mp->rx_rssi = lround(lora->getRSSI());
+    frame->snr = lora->getSNR();
+    frame->rssi = lround(lora->getRSSI());
     LOG_DEBUG("Corrected frequency offset: %f", lora->getFrequencyError());
 }
 
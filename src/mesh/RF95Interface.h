@@ -54,9 +54,9 @@ class RF95Interface : public RadioLibInterface
     virtual void startReceive() override;
 
     /**
-     * Add SNR data to received messages
+     * Add SNR data to received frames
      */
-    virtual void addReceiveMetadata(meshtastic_MeshPacket *mp) override;
+    virtual void addReceiveMetadata(RxFrame *frame) override;
 
     virtual void setStandby() override;
 
@@ -18,9 +18,11 @@
 #include "main.h"
 #include "meshUtils.h" // for pow_of_2
 #include "sleep.h"
+#include <algorithm>
 #include <assert.h>
 #include <pb_decode.h>
 #include <pb_encode.h>
+#include <stdarg.h>
 
 #ifdef ARCH_PORTDUINO
 #include "platform/portduino/PortduinoGlue.h"
@@ -634,61 +636,107 @@ uint32_t RadioInterface::getTxDelayMsecWeighted(meshtastic_MeshPacket *p)
     return delay;
 }
 
-void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
+void capturePacketLogRecord(PacketLogRecord &rec, const meshtastic_MeshPacket *p)
 {
-#if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
-    std::string out =
-        DEBUG_PORT.mt_sprintf("%s (id=0x%08x fr=0x%08x to=0x%08x, transport = %u, WantAck=%d, HopLim=%d Ch=0x%x", prefix, p->id,
-                              p->from, p->to, p->transport_mechanism, p->want_ack, p->hop_limit, p->channel);
-    if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-        auto &s = p->decoded;
-
-        out += DEBUG_PORT.mt_sprintf(" Portnum=%d", s.portnum);
-
-        if (s.want_response)
-            out += DEBUG_PORT.mt_sprintf(" WANTRESP");
-
-        if (p->pki_encrypted)
-            out += DEBUG_PORT.mt_sprintf(" PKI");
-
-        if (s.source != 0)
-            out += DEBUG_PORT.mt_sprintf(" source=%08x", s.source);
-
-        if (s.dest != 0)
-            out += DEBUG_PORT.mt_sprintf(" dest=%08x", s.dest);
+    memset(&rec, 0, sizeof(rec));
+    rec.id = p->id;
+    rec.from = p->from;
+    rec.to = p->to;
+    rec.transport = p->transport_mechanism;
+    rec.wantAck = p->want_ack;
+    rec.hopLimit = p->hop_limit;
+    rec.channel = p->channel;
+    rec.decoded = p->which_payload_variant == meshtastic_MeshPacket_decoded_tag;
+    if (rec.decoded) {
+        rec.portnum = p->decoded.portnum;
+        rec.wantResponse = p->decoded.want_response;
+        rec.source = p->decoded.source;
+        rec.dest = p->decoded.dest;
+        rec.requestId = p->decoded.request_id;
+    } else {
+        rec.encryptedLen = p->encrypted.size + sizeof(PacketHeader);
+    }
+    rec.pkiEncrypted = p->pki_encrypted;
+    rec.rxTime = p->rx_time;
+    rec.rxSnr = p->rx_snr;
+    rec.rxRssi = p->rx_rssi;
+    rec.viaMqtt = p->via_mqtt;
+    rec.hopStart = p->hop_start;
+    rec.nextHop = p->next_hop;
+    rec.relayNode = p->relay_node;
+    rec.priority = p->priority;
+}
 
-        if (s.request_id)
-            out += DEBUG_PORT.mt_sprintf(" requestId=%0x", s.request_id);
+/// snprintf at buf + pos, advancing pos but never past the terminating NUL of a full buffer
+static void appendf(char *buf, size_t bufLen, size_t &pos, const char *format, ...) __attribute__((format(printf, 4, 5)));
+static void appendf(char *buf, size_t bufLen, size_t &pos, const char *format, ...)
+{
+    if (pos + 1 >= bufLen)
+        return;
+    va_list arg;
+    va_start(arg, format);
+    int n = vsnprintf(buf + pos, bufLen - pos, format, arg);
+    va_end(arg);
+    if (n > 0)
+        pos = std::min(pos + n, bufLen - 1);
+}
 
-        /* now inside Data and therefore kinda opaque
-        if (s.which_ackVariant == SubPacket_success_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" successId=%08x", s.ackVariant.success_id);
-        else if (s.which_ackVariant == SubPacket_fail_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" failId=%08x", s.ackVariant.fail_id); */
+size_t formatPacketLogRecord(char *buf, size_t bufLen, const char *prefix, const PacketLogRecord &rec)
+{
+    size_t pos = 0;
+    if (bufLen == 0)
+        return 0;
+    buf[0] = '\0';
+    appendf(buf, bufLen, pos, "%s (id=0x%08x fr=0x%08x to=0x%08x, transport = %u, WantAck=%d, HopLim=%d Ch=0x%x", prefix, rec.id,
+            rec.from, rec.to, rec.transport, rec.wantAck, rec.hopLimit, rec.channel);
+    if (rec.decoded) {
+        appendf(buf, bufLen, pos, " Portnum=%d", rec.portnum);
+        if (rec.wantResponse)
+            appendf(buf, bufLen, pos, " WANTRESP");
+        if (rec.pkiEncrypted)
+            appendf(buf, bufLen, pos, " PKI");
+        if (rec.source != 0)
+            appendf(buf, bufLen, pos, " source=%08x", rec.source);
+        if (rec.dest != 0)
+            appendf(buf, bufLen, pos, " dest=%08x", rec.dest);
+        if (rec.requestId)
+            appendf(buf, bufLen, pos, " requestId=%0x", rec.requestId);
     } else {
-        out += " encrypted";
-        out += DEBUG_PORT.mt_sprintf(" len=%d", p->encrypted.size + sizeof(PacketHeader));
+        appendf(buf, bufLen, pos, " encrypted len=%d", rec.encryptedLen);
     }
 
-    if (p->rx_time != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxtime=%u", p->rx_time);
-    if (p->rx_snr != 0.0)
-        out += DEBUG_PORT.mt_sprintf(" rxSNR=%g", p->rx_snr);
-    if (p->rx_rssi != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxRSSI=%i", p->rx_rssi);
-    if (p->via_mqtt != 0)
-        out += DEBUG_PORT.mt_sprintf(" via MQTT");
-    if (p->hop_start != 0)
-        out += DEBUG_PORT.mt_sprintf(" hopStart=%d", p->hop_start);
-    if (p->next_hop != 0)
-        out += DEBUG_PORT.mt_sprintf(" nextHop=0x%x", p->next_hop);
-    if (p->relay_node != 0)
-        out += DEBUG_PORT.mt_sprintf(" relay=0x%x", p->relay_node);
-    if (p->priority != 0)
-        out += DEBUG_PORT.mt_sprintf(" priority=%d", p->priority);
-
-    out += ")";
-    LOG_DEBUG("%s", out.c_str());
+    if (rec.rxTime != 0)
+        appendf(buf, bufLen, pos, " rxtime=%u", rec.rxTime);
+    if (rec.rxSnr != 0.0)
+        appendf(buf, bufLen, pos, " rxSNR=%g", rec.rxSnr);
+    if (rec.rxRssi != 0)
+        appendf(buf, bufLen, pos, " rxRSSI=%i", rec.rxRssi);
+    if (rec.viaMqtt)
+        appendf(buf, bufLen, pos, " via MQTT");
+    if (rec.hopStart != 0)
+        appendf(buf, bufLen, pos, " hopStart=%d", rec.hopStart);
+    if (rec.nextHop != 0)
+        appendf(buf, bufLen, pos, " nextHop=0x%x", rec.nextHop);
+    if (rec.relayNode != 0)
+        appendf(buf, bufLen, pos, " relay=0x%x", rec.relayNode);
+    if (rec.priority != 0)
+        appendf(buf, bufLen, pos, " priority=%d", rec.priority);
+    appendf(buf, bufLen, pos, ")");
+    return pos;
+}
+
+void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
+{
+#if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
+    // Called for every packet we send or receive, so don't build a line that the log level drops anyway
+    if (!LOG_LEVEL_ENABLED(MESHTASTIC_LOG_LEVEL_DEBUG))
+        return;
+
+    PacketLogRecord rec;
+    capturePacketLogRecord(rec, p);
+    char out[256];
+    formatPacketLogRecord(out, sizeof(out), prefix, rec);
+    LOG_DEBUG("%s", out);
 #endif
 }
 
@@ -286,5 +286,26 @@ class RadioInterface
 
 std::unique_ptr<RadioInterface> initLoRa();
 
-/// Debug printing for packets
+/**
+ * The packet fields printPacket() shows, copied out without any formatting. Taking one is cheap enough for every TX/RX,
+ * the text is only built by formatPacketLogRecord() once someone wants to see it.
+ */
+struct PacketLogRecord {
+    uint32_t id, from, to;
+    uint32_t source, dest, requestId; // Only for decoded packets
+    uint32_t rxTime;
+    float rxSnr;
+    int32_t rxRssi;
+    uint16_t portnum;      // Only for decoded packets
+    uint16_t encryptedLen; // Only for encrypted packets, including the header
+    uint8_t transport, hopLimit, hopStart, channel, nextHop, relayNode, priority;
+    bool decoded, wantAck, wantResponse, pkiEncrypted, viaMqtt;
+};
+
+void capturePacketLogRecord(PacketLogRecord &rec, const meshtastic_MeshPacket *p);
+
+/// Format rec the way printPacket() logs it, truncated to fit buf. @return the length of the text
+size_t formatPacketLogRecord(char *buf, size_t bufLen, const char *prefix, const PacketLogRecord &rec);
+
+/// Debug printing for packets, does nothing unless debug logging is enabled
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p);
@@ -2,6 +2,7 @@
 #include "MeshTypes.h"
 #include "NodeDB.h"
 #include "PowerMon.h"
+#include "Router.h"
 #include "SPILock.h"
 #include "Throttle.h"
 #include "configuration.h"
@@ -464,72 +465,57 @@ void RadioLibInterface::handleReceiveInterrupt()
     }
 #endif
 
-    int state = iface->readData((uint8_t *)&radioBuffer, length);
+    // Read straight into the Router's ring of raw frames, the Router parses and decodes them on its own thread
+    RxFrameRing *rxFrames = router ? &router->getRxFrames() : nullptr;
+    RxFrame *frame = rxFrames ? rxFrames->beginWrite() : nullptr;
+    if (!frame) {
+        if (rxFrames)
+            LOG_WARN("RX frame ring full, drop frame (%u dropped so far)", rxFrames->getOverflows());
+        airTime->logAirtime(RX_ALL_LOG, rxMsec);
+        return;
+    }
+
+    RadioBuffer &rxBuffer = frame->buffer;
+    int state = iface->readData((uint8_t *)&rxBuffer, length);
 #if ARCH_PORTDUINO
     if (portduino_config.logoutputlevel == level_trace) {
-        printBytes("Raw incoming packet: ", (uint8_t *)&radioBuffer, length);
+        printBytes("Raw incoming packet: ", (uint8_t *)&rxBuffer, length);
     }
 #endif
     if (state != RADIOLIB_ERR_NONE) {
         // Log PacketHeader similar to RadioInterface::printPacket so we can try to match RX errors to other packets in the logs.
         LOG_ERROR("Ignore received packet due to error=%d (maybe id=0x%08x fr=0x%08x to=0x%08x flags=0x%02x rxSNR=%g rxRSSI=%i "
                   "nextHop=0x%x relay=0x%x)",
-                  state, radioBuffer.header.id, radioBuffer.header.from, radioBuffer.header.to, radioBuffer.header.flags,
-                  iface->getSNR(), lround(iface->getRSSI()), radioBuffer.header.next_hop, radioBuffer.header.relay_node);
+                  state, rxBuffer.header.id, rxBuffer.header.from, rxBuffer.header.to, rxBuffer.header.flags, iface->getSNR(),
+                  lround(iface->getRSSI()), rxBuffer.header.next_hop, rxBuffer.header.relay_node);
         rxBad++;
 
         airTime->logAirtime(RX_ALL_LOG, rxMsec);
 
+    } else if (length < sizeof(PacketHeader)) {
+        // check for short packets
+        LOG_WARN("Ignore received packet too short");
+        rxBad++;
+        airTime->logAirtime(RX_ALL_LOG, rxMsec);
     } else {
-        // Skip the 4 headers that are at the beginning of the rxBuf
-        int32_t payloadLen = length - sizeof(PacketHeader);
+        rxGood++;
+        // altered packet with "from == 0" can do Remote Node Administration without permission
+        if (rxBuffer.header.from == 0) {
+            LOG_WARN("Ignore received packet without sender");
+            return;
+        }
 
-        // check for short packets
-        if (payloadLen < 0) {
-            LOG_WARN("Ignore received packet too short");
-            rxBad++;
-            airTime->logAirtime(RX_ALL_LOG, rxMsec);
-        } else {
-            rxGood++;
-            // altered packet with "from == 0" can do Remote Node Administration without permission
-            if (radioBuffer.header.from == 0) {
-                LOG_WARN("Ignore received packet without sender");
-                return;
-            }
+        // Note: we deliver _all_ packets to our router (i.e. our interface is intentionally promiscuous).
+        // This allows the router and other apps on our node to sniff packets (usually routing) between other
+        // nodes.
+        frame->length = length;
+        frame->receivedAtMs = millis();
+        addReceiveMetadata(frame);
 
-            // Note: we deliver _all_ packets to our router (i.e. our interface is intentionally promiscuous).
-            // This allows the router and other apps on our node to sniff packets (usually routing) between other
-            // nodes.
-            meshtastic_MeshPacket *mp = packetPool.allocZeroed();
-
-            // Keep the assigned fields in sync with src/mqtt/MQTT.cpp:onReceiveProto
-            mp->from = radioBuffer.header.from;
-            mp->to = radioBuffer.header.to;
-            mp->id = radioBuffer.header.id;
-            mp->channel = radioBuffer.header.channel;
-            assert(HOP_MAX <= PACKET_FLAGS_HOP_LIMIT_MASK); // If hopmax changes, carefully check this code
-            mp->hop_limit = radioBuffer.header.flags & PACKET_FLAGS_HOP_LIMIT_MASK;
-            mp->hop_start = (radioBuffer.header.flags & PACKET_FLAGS_HOP_START_MASK) >> PACKET_FLAGS_HOP_START_SHIFT;
-            mp->want_ack = !!(radioBuffer.header.flags & PACKET_FLAGS_WANT_ACK_MASK);
-            mp->via_mqtt = !!(radioBuffer.header.flags & PACKET_FLAGS_VIA_MQTT_MASK);
-            // If hop_start is not set, next_hop and relay_node are invalid (firmware <2.3)
-            mp->next_hop = mp->hop_start == 0 ? NO_NEXT_HOP_PREFERENCE : radioBuffer.header.next_hop;
-            mp->relay_node = mp->hop_start == 0 ? NO_RELAY_NODE : radioBuffer.header.relay_node;
-
-            addReceiveMetadata(mp);
-
-            mp->which_payload_variant =
-                meshtastic_MeshPacket_encrypted_tag; // Mark that the payload is still encrypted at this point
-            assert(((uint32_t)payloadLen) <= sizeof(mp->encrypted.bytes));
-            memcpy(mp->encrypted.bytes, radioBuffer.payload, payloadLen);
-            mp->encrypted.size = payloadLen;
-
-            printPacket("Lora RX", mp);
-
-            airTime->logAirtime(RX_LOG, rxMsec);
-
-            deliverToReceiver(mp);
-        }
+        airTime->logAirtime(RX_LOG, rxMsec);
+
+        rxFrames->commitWrite();
+        router->setReceivedMessage();
     }
 }
 
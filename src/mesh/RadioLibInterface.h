@@ -2,6 +2,7 @@
 
 #include "MeshPacketQueue.h"
 #include "RadioInterface.h"
+#include "RxFrameRing.h"
 #include "concurrency/NotifiedWorkerThread.h"
 
 #include <RadioLib.h>
@@ -232,9 +233,9 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
     void completeSending();
 
     /**
-     * Add SNR data to received messages
+     * Add SNR data to received frames
      */
-    virtual void addReceiveMetadata(meshtastic_MeshPacket *mp) = 0;
+    virtual void addReceiveMetadata(RxFrame *frame) = 0;
 
     /**
      * Subclasses must override, implement and then call into this base class implementation
@@ -27,11 +27,7 @@ ErrorCode ReliableRouter::send(meshtastic_MeshPacket *p)
     /* If we have pending retransmissions, add the airtime of this packet to it, because during that time we cannot receive an
        (implicit) ACK. Otherwise, we might retransmit too early.
      */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        if (i->first.id != p->id) {
-            i->second.nextTxMsec += iface->getPacketTime(p);
-        }
-    }
+    delayRetransmissions(iface->getPacketTime(p), p->id);
 
     return isBroadcast(p->to) ? FloodingRouter::send(p) : NextHopRouter::send(p);
 }
@@ -70,9 +66,7 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
        because while receiving this packet, we could not have received an (implicit) ACK for it.
        If we don't add this, we will likely retransmit too early.
     */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        i->second.nextTxMsec += iface->getPacketTime(p, true);
-    }
+    delayRetransmissions(iface->getPacketTime(p, true));
 
     return isBroadcast(p->to) ? FloodingRouter::shouldFilterReceived(p) : NextHopRouter::shouldFilterReceived(p);
 }
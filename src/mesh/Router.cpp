@@ -4,6 +4,7 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "Profiler.h"
 #include "RTC.h"
 
 #include "configuration.h"
@@ -16,7 +17,7 @@
 #endif
 #include "Default.h"
 #if ARCH_PORTDUINO
-#include "Throttle.h"
+#include "platform/portduino/PacketCapture.h"
 #include "platform/portduino/PortduinoGlue.h"
 #endif
 #if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
@@ -30,13 +31,13 @@
 // And every TX packet might have a retransmission packet or an ack alive at any moment
 
 #ifdef ARCH_PORTDUINO
-// Portduino (native) targets can use dynamic memory pools with runtime-configurable sizes
+// Portduino (native) targets have runtime-configurable queue sizes, so the pool grows in slabs instead of being fixed
 #define MAX_PACKETS                                                                                                              \
     (MAX_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
-static MemoryDynamic<meshtastic_MeshPacket> dynamicPool;
-Allocator<meshtastic_MeshPacket> &packetPool = dynamicPool;
+static MemorySlab<meshtastic_MeshPacket, MAX_PACKETS> slabPool;
+Allocator<meshtastic_MeshPacket> &packetPool = slabPool;
 #elif defined(ARCH_STM32WL) || defined(BOARD_HAS_PSRAM)
 // On STM32 and boards with PSRAM, there isn't enough heap left over for the rest of the firmware if we allocate this statically.
 // For now, make it dynamic again.
@@ -136,6 +137,27 @@ bool Router::shouldDecrementHopLimit(const meshtastic_MeshPacket *p)
 int32_t Router::runOnce()
 {
     meshtastic_MeshPacket *mp;
+    const RxFrame *frame;
+    while ((frame = rxFrames.peek()) != NULL) {
+#if !MESHTASTIC_EXCLUDE_PROFILER
+        // How long frames wait for us, to tell whether the ring is big enough
+        static const int16_t rxWaitPoint = profiler.pointFor("router", "rx_wait");
+        profiler.record(rxWaitPoint, (millis() - frame->receivedAtMs) * 1000);
+#endif
+        mp = packetFromFrame(*frame);
+#if ARCH_PORTDUINO
+        if (packetCapture)
+            packetCapture->beginFrame(*frame);
+#endif
+        rxFrames.pop();
+        if (mp)
+            perhapsHandleReceived(mp);
+#if ARCH_PORTDUINO
+        if (packetCapture)
+            packetCapture->endFrame();
+#endif
+    }
+
     while ((mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
         // printPacket("handle fromRadioQ", mp);
         perhapsHandleReceived(mp);
@@ -145,6 +167,40 @@ int32_t Router::runOnce()
     return INT32_MAX; // Wait a long time - until we get woken for the message queue
 }
 
+meshtastic_MeshPacket *Router::packetFromFrame(const RxFrame &frame)
+{
+    const PacketHeader &header = frame.buffer.header;
+    meshtastic_MeshPacket *mp = packetPool.allocZeroed();
+    if (!mp)
+        return NULL;
+
+    // Keep the assigned fields in sync with src/mqtt/MQTT.cpp:onReceiveProto
+    mp->from = header.from;
+    mp->to = header.to;
+    mp->id = header.id;
+    mp->channel = header.channel;
+    assert(HOP_MAX <= PACKET_FLAGS_HOP_LIMIT_MASK); // If hopmax changes, carefully check this code
+    mp->hop_limit = header.flags & PACKET_FLAGS_HOP_LIMIT_MASK;
+    mp->hop_start = (header.flags & PACKET_FLAGS_HOP_START_MASK) >> PACKET_FLAGS_HOP_START_SHIFT;
+    mp->want_ack = !!(header.flags & PACKET_FLAGS_WANT_ACK_MASK);
+    mp->via_mqtt = !!(header.flags & PACKET_FLAGS_VIA_MQTT_MASK);
+    // If hop_start is not set, next_hop and relay_node are invalid (firmware <2.3)
+    mp->next_hop = mp->hop_start == 0 ? NO_NEXT_HOP_PREFERENCE : header.next_hop;
+    mp->relay_node = mp->hop_start == 0 ? NO_RELAY_NODE : header.relay_node;
+    mp->rx_snr = frame.snr;
+    mp->rx_rssi = frame.rssi;
+    mp->transport_mechanism = meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA;
+
+    mp->which_payload_variant = meshtastic_MeshPacket_encrypted_tag; // Mark that the payload is still encrypted at this point
+    const size_t payloadLen = frame.length - sizeof(PacketHeader);
+    assert(payloadLen <= sizeof(mp->encrypted.bytes));
+    memcpy(mp->encrypted.bytes, frame.buffer.payload, payloadLen);
+    mp->encrypted.size = payloadLen;
+
+    printPacket("Lora RX", mp);
+    return mp;
+}
+
 /**
  * RadioInterface calls this to queue up packets that have been received from the radio.  The router is now responsible for
  * freeing the packet
@@ -411,8 +467,66 @@ void Router::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Rout
     // FIXME, update nodedb here for any packet that passes through us
 }
 
+DecodeStats decodeStats;
+
+/** Read a protobuf varint of at most maxBytes bytes, advancing buf. Returns false if it is truncated or too long. */
+static bool readVarint(const uint8_t *&buf, const uint8_t *end, uint8_t maxBytes, uint64_t &value)
+{
+    value = 0;
+    for (uint8_t i = 0; i < maxBytes && buf < end; i++) {
+        uint8_t b = *buf++;
+        value |= (uint64_t)(b & 0x7f) << (7 * i);
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Walk the top level protobuf wire format of a decrypted payload without decoding it. A meshtastic_Data message must consist
+ * of well formed fields that exactly fill the buffer and carry a non zero portnum (field 1, varint).
+ */
+static bool isPlausibleDataPayload(const uint8_t *buf, size_t len)
+{
+    const uint8_t *end = buf + len;
+    bool hasPortnum = false;
+
+    while (buf < end) {
+        uint64_t key, value;
+        if (!readVarint(buf, end, 5, key) || (key >> 3) == 0)
+            return false;
+
+        uint64_t skip = 0;
+        switch (key & 0x07) {
+        case PB_WT_VARINT:
+            if (!readVarint(buf, end, 10, value))
+                return false;
+            if ((key >> 3) == meshtastic_Data_portnum_tag && value != meshtastic_PortNum_UNKNOWN_APP)
+                hasPortnum = true;
+            break;
+        case PB_WT_64BIT:
+            skip = 8;
+            break;
+        case PB_WT_32BIT:
+            skip = 4;
+            break;
+        case PB_WT_STRING:
+            if (!readVarint(buf, end, 5, skip))
+                return false;
+            break;
+        default: // Groups and invalid wire types
+            return false;
+        }
+        if (skip > (uint64_t)(end - buf))
+            return false;
+        buf += skip;
+    }
+    return hasPortnum;
+}
+
 DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 {
+    PROFILE_SCOPE("router", "decode");
     concurrency::LockGuard g(cryptLock);
 
     if (config.device.rebroadcast_mode == meshtastic_Config_DeviceConfig_RebroadcastMode_KNOWN_ONLY &&
@@ -466,10 +580,17 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
     // assert(p->which_payloadVariant == MeshPacket_encrypted_tag);
     if (!decrypted) {
-        // Try to find a channel that works with this hash
-        for (chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
+        // Only channels whose precomputed hash matches can work, try those
+        uint32_t candidates = channels.getCandidatesForHash(p->channel);
+        uint8_t attempts = 0;
+        decodeStats.packets++;
+        for (chIndex = 0; candidates != 0 && chIndex < channels.getNumChannels(); chIndex++) {
+            if (!(candidates & (1UL << chIndex)))
+                continue;
+            candidates &= ~(1UL << chIndex);
             // Try to use this hash/channel pair
             if (channels.decryptForHash(chIndex, p->channel)) {
+                attempts++;
                 // we have to copy into a scratch buffer, because these bytes are a union with the decoded protobuf. Create a
                 // fresh copy for each decrypt attempt.
                 memcpy(bytes, p->encrypted.bytes, rawSize);
@@ -478,9 +599,17 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
                 // printBytes("plaintext", bytes, p->encrypted.size);
 
+                // Wrong keys produce random bytes, which almost never form a valid Data message. Reject those cheaply.
+                if (!isPlausibleDataPayload(bytes, rawSize)) {
+                    decodeStats.rejectedEarly++;
+                    LOG_DEBUG("Decrypted payload of id=0x%08x is no Data message (bad psk?)", p->id);
+                    continue;
+                }
+
                 // Take those raw bytes and convert them back into a well structured protobuf we can understand
                 meshtastic_Data decodedtmp;
                 memset(&decodedtmp, 0, sizeof(decodedtmp));
+                decodeStats.pbDecodes++;
                 if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
                 } else if (decodedtmp.portnum == meshtastic_PortNum_UNKNOWN_APP) {
@@ -498,6 +627,9 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
                 }
             }
         }
+        decodeStats.attempts += attempts;
+        if (attempts > decodeStats.maxAttemptsPerPacket)
+            decodeStats.maxAttemptsPerPacket = attempts;
     }
 
     if (decrypted) {
@@ -528,33 +660,14 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
         printPacket("decoded message", p);
 #if ENABLE_JSON_LOGGING
-        LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
+        if (LOG_LEVEL_ENABLED(MESHTASTIC_LOG_LEVEL_TRACE))
+            LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
 #elif ARCH_PORTDUINO
         if (portduino_config.traceFilename != "" || portduino_config.logoutputlevel == level_trace) {
             LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
-        } else if (portduino_config.JSONFilename != "") {
-            if (portduino_config.JSONFileRotate != 0) {
-                static uint32_t fileage = 0;
-
-                if (portduino_config.JSONFileRotate != 0 &&
-                    (fileage == 0 || !Throttle::isWithinTimespanMs(fileage, portduino_config.JSONFileRotate * 60 * 1000))) {
-                    time_t timestamp = time(NULL);
-                    struct tm *timeinfo;
-                    char buffer[80];
-                    timeinfo = localtime(&timestamp);
-                    strftime(buffer, 80, "%Y%m%d-%H%M%S", timeinfo);
-
-                    std::string datetime(buffer);
-                    if (JSONFile.is_open()) {
-                        JSONFile.close();
-                    }
-                    JSONFile.open(portduino_config.JSONFilename + "_" + datetime, std::ios::out | std::ios::app);
-                    fileage = millis();
-                }
-            }
-            if (portduino_config.JSONFilter == (_meshtastic_PortNum)0 || portduino_config.JSONFilter == p->decoded.portnum) {
-                JSONFile << MeshPacketSerializer::JsonSerialize(p, false) << std::endl;
-            }
+        } else if (packetCapture) {
+            // Written to the JSON file by the capture thread
+            packetCapture->captureJson(p);
         }
 #endif
         return DecodeState::DECODE_SUCCESS;
@@ -719,6 +832,18 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     // Also, we should set the time from the ISR and it should have msec level resolution
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
 
+    // Nobody here can read this packet: no copy for MQTT, no decrypt attempts, just let RoutingModule relay it
+    if (isRelayOnly(p, src)) {
+#if ARCH_PORTDUINO
+        if (packetCapture)
+            packetCapture->setFrameResult(CaptureResult::RELAYED);
+#endif
+        rxRelayFastPath++;
+        printPacket("handleReceived(RELAY)", p);
+        MeshModule::callModules(*p, src);
+        return;
+    }
+
     // Store a copy of the encrypted packet for MQTT.
     // Local, not a class member: handleReceived re-enters itself when a module
     // reply broadcast goes through MeshService::sendToMesh -> Router::sendLocal,
@@ -730,6 +855,12 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
 
     // Take those raw bytes and convert them back into a well structured protobuf we can understand
     auto decodedState = perhapsDecode(p);
+#if ARCH_PORTDUINO
+    if (packetCapture && src == RX_SRC_RADIO)
+        packetCapture->setFrameResult(decodedState == DecodeState::DECODE_SUCCESS   ? CaptureResult::DECODED
+                                      : decodedState == DecodeState::DECODE_FAILURE ? CaptureResult::UNDECODABLE
+                                                                                    : CaptureResult::FATAL);
+#endif
     if (decodedState == DecodeState::DECODE_FATAL) {
         // Fatal decoding error, we can't do anything with this packet
         LOG_WARN("Fatal decode error, dropping packet");
@@ -822,12 +953,31 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     packetPool.release(p_encrypted); // Release the encrypted packet (release() handles nullptr)
 }
 
+bool Router::isRelayOnly(const meshtastic_MeshPacket *p, RxSource src) const
+{
+    if (src != RX_SRC_RADIO || p->which_payload_variant != meshtastic_MeshPacket_encrypted_tag || isToUs(p) || isFromUs(p))
+        return false;
+
+    // A channel with a matching hash might decrypt it (PKI only applies to packets to us, excluded above)
+    if (channels.getCandidatesForHash(p->channel) != 0)
+        return false;
+
+#if !MESHTASTIC_EXCLUDE_MQTT
+    // MQTT uplinks DMs between other nodes still encrypted, that needs the copy made in handleReceived()
+    if (moduleConfig.mqtt.enabled && moduleConfig.mqtt.encryption_enabled && p->channel == 0x00 && !isBroadcast(p->to))
+        return false;
+#endif
+
+    return true;
+}
+
 void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
 {
 #if ENABLE_JSON_LOGGING
     // Even ignored packets get logged in the trace
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
+    if (LOG_LEVEL_ENABLED(MESHTASTIC_LOG_LEVEL_TRACE))
+        LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
 #elif ARCH_PORTDUINO
     // Even ignored packets get logged in the trace
     if (portduino_config.traceFilename != "" || portduino_config.logoutputlevel == level_trace) {
@@ -861,7 +1011,12 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
         return;
     }
 
-    if (shouldFilterReceived(p)) {
+    bool filtered;
+    {
+        PROFILE_SCOPE("router", "filter");
+        filtered = shouldFilterReceived(p);
+    }
+    if (filtered) {
         LOG_DEBUG("Incoming msg was filtered from 0x%x", p->from);
         packetPool.release(p);
         return;
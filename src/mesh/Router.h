@@ -7,6 +7,7 @@
 #include "PacketHistory.h"
 #include "PointerQueue.h"
 #include "RadioInterface.h"
+#include "RxFrameRing.h"
 #include "concurrency/OSThread.h"
 #include <memory>
 
@@ -20,6 +21,9 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     /// forwarded to the phone.
     PointerQueue<meshtastic_MeshPacket> fromRadioQueue;
 
+    /// Raw LoRa frames, read in by the radio and parsed into packets by this thread
+    RxFrameRing rxFrames;
+
   protected:
     std::unique_ptr<RadioInterface> iface = nullptr;
 
@@ -78,6 +82,9 @@ class Router : protected concurrency::OSThread, protected PacketHistory
      */
     virtual void enqueueReceivedMessage(meshtastic_MeshPacket *p);
 
+    /// Where the radio puts the raw frames it receives, call setReceivedMessage() after committing one
+    RxFrameRing &getRxFrames() { return rxFrames; }
+
     /**
      * Send a packet on a suitable interface.  This routine will
      * later free() the packet to pool.  This routine is not allowed to stall.
@@ -92,6 +99,9 @@ class Router : protected concurrency::OSThread, protected PacketHistory
         before us */
     uint32_t rxDupe = 0, txRelayCanceled = 0;
 
+    /* Received packets that were only relayed, skipping decryption and the rest of the decode path (see isRelayOnly()) */
+    uint32_t rxRelayFastPath = 0;
+
   protected:
     friend class RoutingModule;
 
@@ -130,6 +140,12 @@ class Router : protected concurrency::OSThread, protected PacketHistory
                     bool ackWantsAck = false);
 
   private:
+    /**
+     * Turn a raw frame from the radio into a still encrypted packet
+     * @return the packet, or nullptr if the pool is out of packets
+     */
+    meshtastic_MeshPacket *packetFromFrame(const RxFrame &frame);
+
     /**
      * Called from loop()
      * Handle any packet that is received by an interface on this node.
@@ -150,12 +166,29 @@ class Router : protected concurrency::OSThread, protected PacketHistory
      */
     void handleReceived(meshtastic_MeshPacket *p, RxSource src = RX_SRC_RADIO);
 
+    /**
+     * Can this packet only be relayed by us? True for packets from the radio that no channel of ours (nor PKI) can decrypt and
+     * that MQTT won't uplink encrypted. The flood/next-hop decision only needs the header, so decoding them is wasted work.
+     */
+    bool isRelayOnly(const meshtastic_MeshPacket *p, RxSource src) const;
+
     /** Frees the provided packet, and generates a NAK indicating the specifed error while sending */
     void abortSendAndNak(meshtastic_Routing_Error err, meshtastic_MeshPacket *p);
 };
 
 enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
 
+/** Statistics for the channel decryption work done by perhapsDecode() */
+struct DecodeStats {
+    uint32_t packets = 0;             // Packets that needed a channel to be found for decryption
+    uint32_t attempts = 0;            // Decrypt attempts with channels whose hash matched
+    uint32_t rejectedEarly = 0;       // Attempts rejected by the plaintext check, without running pb_decode
+    uint32_t pbDecodes = 0;           // Attempts that ran a full pb_decode
+    uint8_t maxAttemptsPerPacket = 0; // Most decrypt attempts spent on a single packet
+};
+
+extern DecodeStats decodeStats;
+
 /** FIXME - move this into a mesh packet class
  * Remove any encryption and decode the protobufs inside this packet (if necessary).
  *
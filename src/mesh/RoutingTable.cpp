@@ -0,0 +1,272 @@
+#include "RoutingTable.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+RoutingTable routingTable;
+
+/// How much a candidate from each source is trusted before anything confirms it
+static uint8_t priorDelivery(RouteSource source)
+{
+    switch (source) {
+    case RouteSource::ACK:
+        return 230;
+    case RouteSource::OVERHEARD:
+        return 200;
+    case RouteSource::TRACEROUTE:
+        return 190;
+    case RouteSource::NEIGHBOR_INFO:
+    default:
+        return 150;
+    }
+}
+
+/// The delivery estimate after drifting back towards a coin flip for as long as nothing confirmed it
+static float effectiveDelivery(const RoutingTable::Candidate &candidate, uint32_t now)
+{
+    float factor = exp2f(-(float)(now - candidate.updatedMs) / ROUTING_HALF_LIFE_MS);
+    return 128 + (candidate.delivery - 128) * factor;
+}
+
+/// Fold the drift into the stored estimate, then move it a step towards target
+static void nudge(RoutingTable::Candidate &candidate, uint8_t target, uint8_t divisor, uint32_t now)
+{
+    float delivery = effectiveDelivery(candidate, now);
+    delivery += (target - delivery) / divisor;
+    candidate.delivery = (uint8_t)lroundf(fminf(fmaxf(delivery, 0), 255));
+    candidate.updatedMs = now;
+}
+
+static bool isExpired(const RoutingTable::Candidate &candidate, uint32_t now)
+{
+    return now - candidate.updatedMs > ROUTING_MAX_AGE_MS;
+}
+
+RoutingTable::Route *RoutingTable::find(NodeNum dest)
+{
+    for (Route &route : routes)
+        if (route.dest == dest)
+            return &route;
+    return nullptr;
+}
+
+const RoutingTable::Route *RoutingTable::find(NodeNum dest) const
+{
+    return const_cast<RoutingTable *>(this)->find(dest);
+}
+
+RoutingTable::Route *RoutingTable::findOrAdd(NodeNum dest, uint32_t now)
+{
+    Route *route = find(dest);
+    if (route)
+        return route;
+
+    // An unused slot, or else the one used longest ago
+    route = &routes[0];
+    for (Route &r : routes) {
+        if (r.dest == 0) {
+            route = &r;
+            break;
+        }
+        if (now - r.usedMs > now - route->usedMs)
+            route = &r;
+    }
+    memset(route, 0, sizeof(*route));
+    route->dest = dest;
+    route->usedMs = now;
+    return route;
+}
+
+RoutingTable::Candidate *RoutingTable::findCandidate(Route &route, uint8_t relay)
+{
+    for (uint8_t i = 0; i < route.numCandidates; i++)
+        if (route.candidates[i].relay == relay)
+            return &route.candidates[i];
+    return nullptr;
+}
+
+void RoutingTable::expire(Route &route, uint32_t now)
+{
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < route.numCandidates; i++)
+        if (!isExpired(route.candidates[i], now))
+            route.candidates[kept++] = route.candidates[i];
+    route.numCandidates = kept;
+}
+
+float RoutingTable::linkQuality(uint8_t relay, uint32_t now) const
+{
+    for (const Link &link : links) {
+        if (link.relay == relay && now - link.heardMs <= ROUTING_MAX_AGE_MS) {
+            // LoRa still decodes well below 0 dB, the weakest spreading factors give up around -20 dB
+            float snr = fminf(fmaxf(link.snr, -20), 0);
+            return 0.1f + 0.9f * (snr + 20) / 20;
+        }
+    }
+    return 0.8f; // Not heard lately, assume a fair link
+}
+
+float RoutingTable::etx(const Candidate &candidate, uint32_t now) const
+{
+    float delivery = fmaxf(effectiveDelivery(candidate, now) / 255, 0.01f);
+    return 1 / (delivery * linkQuality(candidate.relay, now));
+}
+
+void RoutingTable::learn(NodeNum dest, uint8_t relay, RouteSource source, uint32_t now)
+{
+    if (dest == 0 || dest == NODENUM_BROADCAST || relay == NO_NEXT_HOP_PREFERENCE)
+        return;
+
+    Route *route = findOrAdd(dest, now);
+    route->usedMs = now;
+    expire(*route, now);
+
+    Candidate *existing = findCandidate(*route, relay);
+    if (existing) {
+        // An ACK through the relay is a delivery, anything else just confirms the relay still leads there
+        nudge(*existing, source == RouteSource::ACK ? 255 : priorDelivery(source), 4, now);
+        if (source > existing->source)
+            existing->source = source;
+        return;
+    }
+
+    Candidate candidate = {relay, priorDelivery(source), source, now};
+    if (route->numCandidates < ROUTING_MAX_CANDIDATES) {
+        route->candidates[route->numCandidates++] = candidate;
+        return;
+    }
+
+    // Full, take the place of the worst candidate if we're better
+    Candidate *worst = &route->candidates[0];
+    for (uint8_t i = 1; i < route->numCandidates; i++)
+        if (etx(route->candidates[i], now) > etx(*worst, now))
+            worst = &route->candidates[i];
+    if (etx(candidate, now) < etx(*worst, now))
+        *worst = candidate;
+}
+
+void RoutingTable::recordLink(uint8_t relay, float snr, uint32_t now)
+{
+    if (relay == NO_RELAY_NODE)
+        return;
+
+    // The link to this relay, or else the one heard longest ago
+    Link *link = &links[0];
+    bool found = false;
+    for (Link &l : links) {
+        if (l.relay == relay) {
+            link = &l;
+            found = true;
+            break;
+        }
+        if (l.relay == 0 || now - l.heardMs > now - link->heardMs)
+            link = &l;
+    }
+
+    snr = fminf(fmaxf(snr, INT8_MIN), INT8_MAX);
+    if (found && now - link->heardMs <= ROUTING_HALF_LIFE_MS)
+        link->snr = (int8_t)lroundf((3 * link->snr + snr) / 4);
+    else
+        link->snr = (int8_t)lroundf(snr);
+    link->relay = relay;
+    link->heardMs = now;
+}
+
+void RoutingTable::recordSuccess(NodeNum dest, uint8_t relay, uint32_t now)
+{
+    Route *route = find(dest);
+    Candidate *candidate = route ? findCandidate(*route, relay) : nullptr;
+    if (candidate) {
+        nudge(*candidate, 255, 4, now);
+        route->usedMs = now;
+    }
+}
+
+void RoutingTable::recordFailure(NodeNum dest, uint8_t relay, uint32_t now)
+{
+    Route *route = find(dest);
+    Candidate *candidate = route ? findCandidate(*route, relay) : nullptr;
+    if (candidate)
+        nudge(*candidate, 0, 3, now); // One failure weighs more than one success
+}
+
+std::optional<uint8_t> RoutingTable::getNextHop(NodeNum dest, uint8_t exclude, uint32_t now) const
+{
+    return getNextHop(dest, &exclude, 1, now);
+}
+
+std::optional<uint8_t> RoutingTable::getNextHop(NodeNum dest, const uint8_t *exclude, size_t numExclude, uint32_t now) const
+{
+    const Route *route = find(dest);
+    if (!route)
+        return std::nullopt;
+
+    const Candidate *best = nullptr;
+    float bestEtx = ROUTING_MAX_ETX;
+    for (uint8_t i = 0; i < route->numCandidates; i++) {
+        const Candidate &candidate = route->candidates[i];
+        if (std::find(exclude, exclude + numExclude, candidate.relay) != exclude + numExclude || isExpired(candidate, now))
+            continue;
+        float candidateEtx = etx(candidate, now);
+        if (candidateEtx <= bestEtx) {
+            best = &candidate;
+            bestEtx = candidateEtx;
+        }
+    }
+    if (!best)
+        return std::nullopt;
+    return best->relay;
+}
+
+size_t RoutingTable::getCandidates(NodeNum dest, Candidate *out, size_t maxCandidates, uint32_t now) const
+{
+    const Route *route = find(dest);
+    if (!route)
+        return 0;
+
+    // Insertion sort, there are only a few
+    Candidate sorted[ROUTING_MAX_CANDIDATES];
+    float etxs[ROUTING_MAX_CANDIDATES];
+    size_t n = 0;
+    for (uint8_t i = 0; i < route->numCandidates; i++) {
+        const Candidate &candidate = route->candidates[i];
+        if (isExpired(candidate, now))
+            continue;
+        float candidateEtx = etx(candidate, now);
+        size_t pos = n++;
+        while (pos > 0 && etxs[pos - 1] > candidateEtx) {
+            etxs[pos] = etxs[pos - 1];
+            sorted[pos] = sorted[pos - 1];
+            pos--;
+        }
+        etxs[pos] = candidateEtx;
+        sorted[pos] = candidate;
+    }
+
+    if (n > maxCandidates)
+        n = maxCandidates;
+    memcpy(out, sorted, n * sizeof(Candidate));
+    return n;
+}
+
+void RoutingTable::forget(NodeNum dest)
+{
+    Route *route = find(dest);
+    if (route)
+        memset(route, 0, sizeof(*route));
+}
+
+void RoutingTable::clear()
+{
+    memset(routes, 0, sizeof(routes));
+    memset(links, 0, sizeof(links));
+}
+
+size_t RoutingTable::size() const
+{
+    size_t n = 0;
+    for (const Route &route : routes)
+        if (route.dest != 0)
+            n++;
+    return n;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+
+/// Destinations the table keeps routes for, the least recently used one makes room for a new one
+#ifndef ROUTING_TABLE_SIZE
+#if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
+#define ROUTING_TABLE_SIZE 128
+#else
+#define ROUTING_TABLE_SIZE 48
+#endif
+#endif
+
+/// Relay candidates kept per destination
+#define ROUTING_MAX_CANDIDATES 3
+
+/// Neighbors whose link SNR is remembered
+#define ROUTING_MAX_LINKS 24
+
+/// Candidates not confirmed for this long are forgotten
+#define ROUTING_MAX_AGE_MS (3 * 60 * 60 * 1000UL)
+
+/// How fast a candidate's delivery estimate drifts back to a coin flip when nothing confirms it
+#define ROUTING_HALF_LIFE_MS (30 * 60 * 1000UL)
+
+/// Candidates with an expected transmission count above this aren't worth trying, flooding is better
+#define ROUTING_MAX_ETX 6.0f
+
+/// How a relay candidate was learned, better sources start out more trusted
+enum class RouteSource : uint8_t {
+    /// We heard the destination directly, so it is its own next hop
+    OVERHEARD,
+    /// A neighbor's NeighborInfo lists the destination
+    NEIGHBOR_INFO,
+    /// The relay was on a traceroute towards the destination
+    TRACEROUTE,
+    /// An ACK or reply from the destination came back through the relay
+    ACK,
+};
+
+/**
+ * @brief Ranked next hop candidates for each destination
+ *
+ * Each destination has up to ROUTING_MAX_CANDIDATES relays, identified like next_hop by the last byte of their node number.
+ * Candidates are ranked by an ETX style metric: the expected number of transmissions for the packet to get through, estimated
+ * from how often the relay delivered (ACKs, hearing it relay, or nobody relaying before a retransmission) times how well we
+ * hear the relay (its SNR). Estimates drift back to a coin flip when not confirmed, and are dropped after ROUTING_MAX_AGE_MS.
+ *
+ * Callers pass the current millis() so tests can replay time. Only the Router thread and the modules it calls use the table.
+ */
+class RoutingTable
+{
+  public:
+    struct Candidate {
+        uint8_t relay;
+        /// Chance the relay gets a packet through, 0 (never) to 255 (always)
+        uint8_t delivery;
+        RouteSource source;
+        uint32_t updatedMs;
+    };
+
+    /// Add (or refresh) relay as a candidate for reaching dest
+    void learn(NodeNum dest, uint8_t relay, RouteSource source, uint32_t now);
+
+    /// Remember how well we heard a neighbor, used for every route through it
+    void recordLink(uint8_t relay, float snr, uint32_t now);
+
+    /// relay got a packet for dest through
+    void recordSuccess(NodeNum dest, uint8_t relay, uint32_t now);
+
+    /// relay was asked to relay a packet for dest but didn't
+    void recordFailure(NodeNum dest, uint8_t relay, uint32_t now);
+
+    /**
+     * The best candidate for reaching dest, other than exclude
+     * @return the relay, or nothing if there is no candidate worth trying
+     */
+    std::optional<uint8_t> getNextHop(NodeNum dest, uint8_t exclude, uint32_t now) const;
+
+    /**
+     * The best candidate for reaching dest, other than the numExclude relays in exclude
+     * @return the relay, or nothing if there is no candidate worth trying
+     */
+    std::optional<uint8_t> getNextHop(NodeNum dest, const uint8_t *exclude, size_t numExclude, uint32_t now) const;
+
+    /**
+     * The candidates for dest, best first
+     * @return how many were written to out
+     */
+    size_t getCandidates(NodeNum dest, Candidate *out, size_t maxCandidates, uint32_t now) const;
+
+    /// Expected transmissions for a candidate, lower is better
+    float etx(const Candidate &candidate, uint32_t now) const;
+
+    void forget(NodeNum dest);
+    void clear();
+
+    size_t size() const;
+
+  private:
+    struct Route {
+        NodeNum dest; // 0 when unused
+        uint32_t usedMs;
+        uint8_t numCandidates;
+        Candidate candidates[ROUTING_MAX_CANDIDATES];
+    };
+
+    struct Link {
+        uint8_t relay; // 0 when unused
+        int8_t snr;    // dB
+        uint32_t heardMs;
+    };
+
+    Route routes[ROUTING_TABLE_SIZE] = {};
+    Link links[ROUTING_MAX_LINKS] = {};
+
+    Route *find(NodeNum dest);
+    const Route *find(NodeNum dest) const;
+    Route *findOrAdd(NodeNum dest, uint32_t now);
+    static Candidate *findCandidate(Route &route, uint8_t relay);
+
+    /// Drop candidates too old to trust, and the route with them if none are left
+    static void expire(Route &route, uint32_t now);
+
+    /// Chance of hearing each other over the link to relay, from its SNR
+    float linkQuality(uint8_t relay, uint32_t now) const;
+};
+
+extern RoutingTable routingTable;
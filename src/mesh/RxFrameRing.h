@@ -0,0 +1,93 @@
+#pragma once
+
+#include "RadioInterface.h"
+#include <atomic>
+#include <stdint.h>
+
+/// Frames the radio may get ahead of the Router by, must be a power of two
+#ifndef RX_FRAME_RING_SIZE
+#define RX_FRAME_RING_SIZE 8
+#endif
+
+/**
+ * A LoRa frame as it came off the radio, not parsed yet
+ */
+struct RxFrame {
+    /// The header and the still encrypted payload
+    RadioBuffer buffer;
+    /// Of the whole frame, header included
+    uint16_t length;
+    float snr;
+    int32_t rssi;
+    uint32_t receivedAtMs;
+};
+
+/**
+ * @brief Raw frames on their way from the radio to the Router
+ *
+ * There is exactly one producer, the radio's receive path, and one consumer, the Router thread, so no locks are needed. The
+ * radio reads each frame straight into a slot, without allocating, copying or parsing a packet, and can be listening again right
+ * away. If the Router falls behind, new frames are dropped and counted rather than holding up the radio.
+ */
+class RxFrameRing
+{
+    static_assert(RX_FRAME_RING_SIZE > 0 && RX_FRAME_RING_SIZE <= 128 && (RX_FRAME_RING_SIZE & (RX_FRAME_RING_SIZE - 1)) == 0,
+                  "RX_FRAME_RING_SIZE must be a power of two, no more than 128");
+
+  public:
+    /// Producer: the slot to read the next frame into, or nullptr (counted as an overflow) if the ring is full
+    RxFrame *beginWrite()
+    {
+        const uint8_t t = tail.load(std::memory_order_relaxed);
+        if ((uint8_t)(t - head.load(std::memory_order_acquire)) == RX_FRAME_RING_SIZE) {
+            overflows++;
+            return nullptr;
+        }
+        return &frames[t % RX_FRAME_RING_SIZE];
+    }
+
+    /// Producer: hand the frame filled in since beginWrite() to the consumer
+    void commitWrite()
+    {
+        const uint8_t t = tail.load(std::memory_order_relaxed) + 1;
+        tail.store(t, std::memory_order_release);
+        written++;
+
+        const uint8_t used = t - head.load(std::memory_order_acquire);
+        if (used > highWater)
+            highWater = used;
+    }
+
+    /// Consumer: the oldest frame, or nullptr if there is none
+    const RxFrame *peek() const
+    {
+        const uint8_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &frames[h % RX_FRAME_RING_SIZE];
+    }
+
+    /// Consumer: done with the frame from peek(), its slot may be reused
+    void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    uint8_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+    /// Frames dropped because the ring was full
+    uint32_t getOverflows() const { return overflows; }
+    /// Frames ever handed to the consumer
+    uint32_t getWritten() const { return written; }
+    /// Most frames ever waiting at once
+    uint8_t getHighWater() const { return highWater; }
+
+  private:
+    RxFrame frames[RX_FRAME_RING_SIZE];
+
+    // Free running, the difference is the number of frames waiting. Only the consumer moves head, only the producer tail.
+    std::atomic<uint8_t> head{0};
+    std::atomic<uint8_t> tail{0};
+
+    // Only touched by the producer
+    uint32_t overflows = 0;
+    uint32_t written = 0;
+    uint8_t highWater = 0;
+};
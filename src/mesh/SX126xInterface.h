@@ -68,9 +68,9 @@ template <class T> class SX126xInterface : public RadioLibInterface
     virtual void configHardwareForSend() override;
 
     /**
-     * Add SNR data to received messages
+     * Add SNR data to received frames
      */
-    virtual void addReceiveMetadata(meshtastic_MeshPacket *mp) override;
+    virtual void addReceiveMetadata(RxFrame *frame) override;
 
     virtual void setStandby() override;
 
@@ -199,13 +199,13 @@ template <typename T> void SX128xInterface<T>::setStandby()
 }
 
 /**
- * Add SNR data to received messages
+ * Add SNR data to received frames
  */
-template <typename T> void SX128xInterface<T>::addReceiveMetadata(meshtastic_MeshPacket *mp)
+template <typename T> void SX128xInterface<T>::addReceiveMetadata(RxFrame *frame)
 {
     // LOG_DEBUG("PacketStatus %x", lora.getPacketStatus());
-    mp->rx_snr = lora.getSNR();
-    mp->rx_rssi = lround(lora.getRSSI());
+    frame->snr = lora.getSNR();
+    frame->rssi = lround(lora.getRSSI());
     LOG_DEBUG("Corrected frequency offset: %f", lora.getFrequencyError());
 }
 
@@ -62,9 +62,9 @@ template <class T> class SX128xInterface : public RadioLibInterface
     virtual void configHardwareForSend() override;
 
     /**
-     * Add SNR data to received messages
+     * Add SNR data to received frames
      */
-    virtual void addReceiveMetadata(meshtastic_MeshPacket *mp) override;
+    virtual void addReceiveMetadata(RxFrame *frame) override;
 
     virtual void setStandby() override;
 
@@ -15,7 +15,10 @@ class SinglePortModule : public MeshModule
     /** Constructor
      * name is for debugging output
      */
-    SinglePortModule(const char *_name, meshtastic_PortNum _ourPortNum) : MeshModule(_name), ourPortNum(_ourPortNum) {}
+    SinglePortModule(const char *_name, meshtastic_PortNum _ourPortNum) : MeshModule(_name), ourPortNum(_ourPortNum)
+    {
+        wantPortnum(ourPortNum);
+    }
 
   protected:
     /**
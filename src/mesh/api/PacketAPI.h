@@ -23,6 +23,7 @@ class PacketAPI : public PhoneAPI, public concurrency::OSThread
 
     void onNowHasData(uint32_t fromRadioNum) override {}
     void onConnectionChanged(bool connected) override {}
+    bool needsFromRadioScratch() override { return true; }
 
   private:
     bool receivePacket(void);
@@ -9,6 +9,10 @@ template <typename T>
 ServerAPI<T>::ServerAPI(T &_client) : StreamAPI(&client), concurrency::OSThread("ServerAPI"), client(_client)
 {
     LOG_INFO("Incoming API connection");
+    // A reconnecting client usually comes back from the same address
+    IPAddress ip = client.remoteIP();
+    const uint8_t addr[] = {ip[0], ip[1], ip[2], ip[3]};
+    setClientAddress(addr, sizeof(addr));
 }
 
 template <typename T> ServerAPI<T>::~ServerAPI()
@@ -55,9 +59,10 @@ template <class T, class U> void APIServerPort<T, U>::init()
 
 template <class T, class U> int32_t APIServerPort<T, U>::runOnce()
 {
-    // Clean up previous connection if its client already disconnected
-    if (openAPI && !openAPI->checkIsConnected()) {
-        openAPI.reset();
+    // Clean up previous connections if their client already disconnected
+    for (auto &openAPI : openAPIs) {
+        if (openAPI && !openAPI->checkIsConnected())
+            openAPI.reset();
     }
 
 #ifdef ARCH_ESP32
@@ -72,8 +77,15 @@ template <class T, class U> int32_t APIServerPort<T, U>::runOnce()
     auto client = U::available();
 #endif
     if (client) {
-        // Close any previous connection (see FIXME in header file)
-        if (openAPI) {
+        std::unique_ptr<T> *slot = nullptr;
+        for (auto &openAPI : openAPIs) {
+            if (!openAPI) {
+                slot = &openAPI;
+                break;
+            }
+        }
+
+        if (!slot) {
 #if RAK_4631
             // RAK13800 Ethernet requests periodically take more time
             // This backoff addresses most cases keeping max wait < 1s
@@ -84,11 +96,18 @@ template <class T, class U> int32_t APIServerPort<T, U>::runOnce()
                 return waitTime;
             }
 #endif
-            LOG_INFO("Force close previous TCP connection");
-            openAPI.reset();
+            // All slots are busy, the client we haven't heard from in the longest time is the most likely to be gone
+            uint32_t now = millis();
+            slot = &openAPIs[0];
+            for (auto &openAPI : openAPIs) {
+                if (now - openAPI->getLastContactMsec() > now - (*slot)->getLastContactMsec())
+                    slot = &openAPI;
+            }
+            LOG_INFO("All %d TCP connections in use, force close the least recently active one", MAX_API_SERVER_CLIENTS);
+            slot->reset();
         }
 
-        openAPI.reset(new T(client));
+        slot->reset(new T(client));
     }
 
 #if RAK_4631
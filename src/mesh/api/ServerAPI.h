@@ -5,6 +5,17 @@
 
 #define SERVER_API_DEFAULT_PORT 4403
 
+/// How many TCP API clients can be connected at the same time, each one costs a PhoneAPI state machine and its buffers
+#ifndef MAX_API_SERVER_CLIENTS
+#if defined(ARCH_PORTDUINO)
+#define MAX_API_SERVER_CLIENTS 4
+#elif defined(ARCH_ESP32)
+#define MAX_API_SERVER_CLIENTS 2
+#else
+#define MAX_API_SERVER_CLIENTS 1
+#endif
+#endif
+
 /**
  * Provides both debug printing and, if the client starts sending protobufs to us, switches to send/receive protobufs
  * (and starts dropping debug printing - FIXME, eventually those prints should be encapsulated in protobufs).
@@ -25,6 +36,9 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override;
 
+    /// @return the last msec we heard from the client
+    uint32_t getLastContactMsec() const { return lastContactMsec; }
+
   protected:
     /// We override this method to prevent publishing EVENT_SERIAL_CONNECTED/DISCONNECTED for wifi links (we want the board to
     /// stay in the POWERED state to prevent disabling wifi)
@@ -38,12 +52,11 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
  */
 template <class T, class U> class APIServerPort : public U, private concurrency::OSThread
 {
-    /** The currently open port
+    /** The currently open connections, each one runs as its own thread with its own PhoneAPI state.
      *
-     * FIXME: We currently only allow one open TCP connection at a time, because we depend on the loop() call in this class to
-     * delegate to the worker.  Once coroutines are implemented we can relax this restriction.
+     * When all slots are in use, a new client replaces the one we haven't heard from the longest.
      */
-    std::unique_ptr<T> openAPI;
+    std::unique_ptr<T> openAPIs[MAX_API_SERVER_CLIENTS];
 #if defined(RAK_4631) || defined(RAK11310)
     // Track wait time for RAK13800 Ethernet requests
     int32_t waitTime = 100;
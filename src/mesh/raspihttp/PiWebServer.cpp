@@ -40,6 +40,7 @@ mail:   marchammermann@googlemail.com
 #include "NodeDB.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
+#include "Profiler.h"
 #include "RadioLibInterface.h"
 #include "airtime.h"
 #include "graphics/Screen.h"
@@ -56,8 +57,11 @@ mail:   marchammermann@googlemail.com
 #include <ulfius.h>
 #include <yder.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include "PortduinoFS.h"
 #include "platform/portduino/PortduinoGlue.h"
@@ -253,15 +257,100 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
     return U_CALLBACK_COMPLETE;
 }
 
+/*
+ * Batched and streamed FromRadio packets use the StreamAPI framing: 0x94 0xc3, then the length as a big endian 16 bit number,
+ * then the protobuf.
+ */
+#define FRAME_START1 0x94
+#define FRAME_START2 0xc3
+#define FRAME_HEADER_LEN 4
+
+static std::atomic<bool> fromRadioStreamOpen(false);
+static std::atomic<bool> fromRadioStreamsStopped(false);
+
+/**
+ * Put the next FromRadio packet with its framing into buf, which has room for MAX_STREAM_BUF_SIZE bytes
+ * @return the number of bytes, 0 if there is no packet
+ */
+static size_t frameFromRadio(HttpAPI *api, uint8_t *buf)
+{
+    size_t len = api->getFromRadio(buf + FRAME_HEADER_LEN);
+    if (!len)
+        return 0;
+    buf[0] = FRAME_START1;
+    buf[1] = FRAME_START2;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+    return len + FRAME_HEADER_LEN;
+}
+
+/// A client reading /api/v1/fromradio?stream=true, possibly part way through a frame
+struct FromRadioStream {
+    HttpAPI *api;
+    uint8_t frame[MAX_STREAM_BUF_SIZE];
+    size_t frameLen = 0;
+    size_t frameSent = 0;
+};
+
+/**
+ * Stream callback: whatever packets are waiting, else block until there are some. A frame of length 0 is sent when there were
+ * none for a while, so a client that went away is noticed.
+ */
+static ssize_t callback_fromradio_stream(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)(pos);
+    FromRadioStream *stream = (FromRadioStream *)cls;
+    uint32_t idleMs = 0;
+
+    while (!fromRadioStreamsStopped) {
+        size_t written = 0;
+        while (written < max) {
+            if (stream->frameSent == stream->frameLen) {
+                stream->frameLen = stream->api->available() ? frameFromRadio(stream->api, stream->frame) : 0;
+                stream->frameSent = 0;
+                if (!stream->frameLen)
+                    break;
+            }
+            size_t n = std::min(max - written, stream->frameLen - stream->frameSent);
+            memcpy(buf + written, stream->frame + stream->frameSent, n);
+            stream->frameSent += n;
+            written += n;
+        }
+        if (written)
+            return written;
+
+        if (idleMs >= FROMRADIO_STREAM_KEEPALIVE_MS && max >= FRAME_HEADER_LEN) {
+            const uint8_t keepalive[FRAME_HEADER_LEN] = {FRAME_START1, FRAME_START2, 0, 0};
+            memcpy(buf, keepalive, sizeof(keepalive));
+            return sizeof(keepalive);
+        }
+        delay(FROMRADIO_STREAM_POLL_MS);
+        idleMs += FROMRADIO_STREAM_POLL_MS;
+    }
+    return U_STREAM_END;
+}
+
+static void callback_fromradio_stream_free(void *cls)
+{
+    delete (FromRadioStream *)cls;
+    fromRadioStreamOpen = false;
+}
+
 /*
  * Adapt the radioapi to the Webservice handleAPIv1FromRadio
  * Trigger : WebGui(POLL)->handleAPIv1FromRadio->phoneapi->Meshtastic(Radio) events
+ *
+ * Without parameters a single FromRadio protobuf is returned. With all=true every packet waiting (up to
+ * FROMRADIO_BATCH_MAX_BYTES) is returned in one response, and with stream=true the response stays open and packets are sent
+ * as they come. Both use the framing above.
  */
 int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res, void *user_data)
 {
 
     // LOG_DEBUG("handleAPIv1FromRadio radio -> web");
-    std::string valueAll;
+    HttpAPI *api = static_cast<HttpAPI *>(user_data);
+    const char *valueAll = u_map_get(req->map_url, "all");
+    const char *valueStream = u_map_get(req->map_url, "stream");
 
     // Status code is 200 OK by default.
     ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
@@ -275,22 +364,36 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
         return U_CALLBACK_COMPLETE;
     }
 
-    uint8_t txBuf[MAX_STREAM_BUF_SIZE];
-    uint32_t len = 1;
-
-    if (valueAll == "true") {
-        while (len) {
-            len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
-            ulfius_set_response_properties(res, U_OPT_STATUS, 200, U_OPT_BINARY_BODY, txBuf, len);
-            const char *tmpa = (const char *)txBuf;
-            ulfius_set_string_body_response(res, 200, tmpa);
-            // LOG_DEBUG("\n----webAPI response all:----");
-            // LOG_DEBUG(tmpa);
-            // LOG_DEBUG("");
+    if (valueStream && strcmp(valueStream, "true") == 0) {
+        // There is only the one HttpAPI, two streams would each get half of the packets
+        bool wasOpen = false;
+        if (!fromRadioStreamOpen.compare_exchange_strong(wasOpen, true)) {
+            ulfius_set_string_body_response(res, 409, "A fromradio stream is already open");
+            return U_CALLBACK_COMPLETE;
+        }
+        FromRadioStream *stream = new FromRadioStream();
+        stream->api = api;
+        ulfius_add_header_to_response(res, "Cache-Control", "no-cache");
+        if (ulfius_set_stream_response(res, 200, callback_fromradio_stream, callback_fromradio_stream_free, MHD_SIZE_UNKNOWN,
+                                       FROMRADIO_STREAM_CHUNK, stream) != U_OK) {
+            LOG_ERROR("handleAPIv1FromRadio - Error ulfius_set_stream_response");
+            callback_fromradio_stream_free(stream);
+            return U_CALLBACK_ERROR;
         }
+        return U_CALLBACK_COMPLETE;
+    }
+
+    if (valueAll && strcmp(valueAll, "true") == 0) {
+        // Leave room for a whole frame, so no packet taken from the api is dropped
+        std::vector<uint8_t> body(FROMRADIO_BATCH_MAX_BYTES + MAX_STREAM_BUF_SIZE);
+        size_t used = 0, len;
+        while (used < FROMRADIO_BATCH_MAX_BYTES && (len = frameFromRadio(api, body.data() + used)) != 0)
+            used += len;
+        ulfius_set_binary_body_response(res, 200, (const char *)body.data(), used);
         // Otherwise, just return one protobuf
     } else {
-        len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
+        uint8_t txBuf[MAX_STREAM_BUF_SIZE];
+        uint32_t len = api->getFromRadio(txBuf);
         const char *tmpa = (const char *)txBuf;
         ulfius_set_binary_body_response(res, 200, tmpa, len);
         // LOG_DEBUG("\n----webAPI response:");
@@ -302,6 +405,25 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
     return U_CALLBACK_COMPLETE;
 }
 
+#if !MESHTASTIC_EXCLUDE_PROFILER
+/*
+ * The run time histograms of the profiler as JSON
+ */
+int handleJsonProfile(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    std::vector<char> json(4096);
+    size_t len = profiler.toJson(json.data(), json.size());
+    if (len >= json.size()) {
+        json.resize(len + 1);
+        profiler.toJson(json.data(), json.size());
+    }
+
+    ulfius_add_header_to_response(res, "Content-Type", "application/json");
+    ulfius_set_string_body_response(res, 200, json.data());
+    return U_CALLBACK_COMPLETE;
+}
+#endif
+
 /*
 OpenSSL RSA Key Gen
 */
@@ -503,6 +625,9 @@ PiWebServerThread::PiWebServerThread()
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/fromradio/*", 1, &handleAPIv1FromRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "PUT", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
+#if !MESHTASTIC_EXCLUDE_PROFILER
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/json/profile", 1, &handleJsonProfile, NULL);
+#endif
 
         // Add callback function to all endpoints for the Web Server
         ulfius_add_endpoint_by_val(&instanceWeb, "GET", NULL, "/*", 2, &callback_static_file, &configWeb);
@@ -526,6 +651,9 @@ PiWebServerThread::~PiWebServerThread()
 {
     u_map_clean(&configWeb.mime_types);
 
+    // Open fromradio streams would block stopping the framework
+    fromRadioStreamsStopped = true;
+
     ulfius_stop_framework(&instanceWeb);
     ulfius_clean_instance(&instanceWeb);
     free(configWeb.rootPath);
@@ -9,6 +9,14 @@
 
 #define STATIC_FILE_CHUNK 256
 
+// /api/v1/fromradio?all=true stops adding packets once the response is this big
+#define FROMRADIO_BATCH_MAX_BYTES (64 * 1024)
+// /api/v1/fromradio?stream=true sends up to a chunk at a time, checks for packets every FROMRADIO_STREAM_POLL_MS while there
+// are none, and sends a keepalive when there were none for FROMRADIO_STREAM_KEEPALIVE_MS
+#define FROMRADIO_STREAM_CHUNK 4096
+#define FROMRADIO_STREAM_POLL_MS 20
+#define FROMRADIO_STREAM_KEEPALIVE_MS 10000
+
 void initWebServer();
 void createSSLCert();
 int callback_static_file(const struct _u_request *request, struct _u_response *response, void *user_data);
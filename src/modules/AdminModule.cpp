@@ -113,6 +113,7 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
                 } else {
                     LOG_INFO("PKC admin valid. Auto-favoriting node %x", mp.from);
                     remoteNode->is_favorite = true;
+                    nodeDB->updateNodeOrder(remoteNode);
                 }
             }
         } else {
@@ -367,7 +368,8 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
         meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->set_favorite_node);
         if (node != NULL) {
             node->is_favorite = true;
-            saveChanges(SEGMENT_NODEDATABASE, false);
+            nodeDB->updateNodeOrder(node);
+            saveNodeChange(*node);
             if (screen)
                 screen->setFrames(graphics::Screen::FOCUS_PRESERVE); // <-- Rebuild screens
         }
@@ -378,7 +380,8 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
         meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->remove_favorite_node);
         if (node != NULL) {
             node->is_favorite = false;
-            saveChanges(SEGMENT_NODEDATABASE, false);
+            nodeDB->updateNodeOrder(node);
+            saveNodeChange(*node);
             if (screen)
                 screen->setFrames(graphics::Screen::FOCUS_PRESERVE); // <-- Rebuild screens
         }
@@ -393,7 +396,7 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
             node->has_position = false;
             node->user.public_key.size = 0;
             memset(node->user.public_key.bytes, 0, sizeof(node->user.public_key.bytes));
-            saveChanges(SEGMENT_NODEDATABASE, false);
+            saveNodeChange(*node);
         }
         break;
     }
@@ -402,7 +405,7 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
         meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->remove_ignored_node);
         if (node != NULL) {
             node->is_ignored = false;
-            saveChanges(SEGMENT_NODEDATABASE, false);
+            saveNodeChange(*node);
         }
         break;
     }
@@ -411,7 +414,7 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
         meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->toggle_muted_node);
         if (node != NULL) {
             node->bitfield ^= (1 << NODEINFO_BITFIELD_IS_MUTED_SHIFT);
-            saveChanges(SEGMENT_NODEDATABASE, false);
+            saveNodeChange(*node);
         }
         break;
     }
@@ -1374,6 +1377,15 @@ void AdminModule::saveChanges(int saveWhat, bool shouldReboot)
     }
 }
 
+void AdminModule::saveNodeChange(const meshtastic_NodeInfoLite &node)
+{
+    if (!hasOpenEditTransaction) {
+        nodeDB->saveNodeToDisk(node);
+    } else {
+        LOG_INFO("Delay save of changes to disk until the open transaction is committed"); // The commit saves the node DB
+    }
+}
+
 void AdminModule::handleStoreDeviceUIConfig(const meshtastic_DeviceUIConfig &uicfg)
 {
     nodeDB->saveProto("/prefs/uiconfig.proto", meshtastic_DeviceUIConfig_size, &meshtastic_DeviceUIConfig_msg, &uicfg);
@@ -43,6 +43,9 @@ class AdminModule : public ProtobufModule<meshtastic_AdminMessage>, public Obser
 
     void saveChanges(int saveWhat, bool shouldReboot = true);
 
+    /// Persist a node changed in place, without the config reload of saveChanges()
+    void saveNodeChange(const meshtastic_NodeInfoLite &node);
+
     /**
      * Getters
      */
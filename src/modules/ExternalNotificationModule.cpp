@@ -277,6 +277,11 @@ ExternalNotificationModule::ExternalNotificationModule()
     : SinglePortModule("ExternalNotificationModule", meshtastic_PortNum_TEXT_MESSAGE_APP),
       concurrency::OSThread("ExternalNotification")
 {
+    // The other portnums MeshService::isTextPayload() accepts
+    wantPortnum(meshtastic_PortNum_DETECTION_SENSOR_APP);
+    wantPortnum(meshtastic_PortNum_ALERT_APP);
+    wantPortnum(meshtastic_PortNum_RANGE_TEST_APP);
+
     /*
         Uncomment the preferences below if you want to use the module
         without having to configure it from the PythonAPI or WebUI.
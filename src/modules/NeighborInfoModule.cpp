@@ -3,6 +3,7 @@
 #include "MeshService.h"
 #include "NodeDB.h"
 #include "RTC.h"
+#include "RoutingTable.h"
 #include <Throttle.h>
 
 NeighborInfoModule *neighborInfoModule;
@@ -45,6 +46,7 @@ NeighborInfoModule::NeighborInfoModule()
 
     if (moduleConfig.neighbor_info.enabled) {
         isPromiscuous = true; // Update neighbors from all packets
+        wantAllPortnums();
         setIntervalFromNow(Default::getConfiguredOrDefaultMs(moduleConfig.neighbor_info.update_interval,
                                                              default_telemetry_broadcast_interval_secs));
     } else {
@@ -167,6 +169,16 @@ bool NeighborInfoModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp,
         if (np->neighbors_count != 1 || np->neighbors[0].node_id != 0 || np->neighbors[0].snr != 0.0f) {
             LOG_DEBUG("  Updating neighbours");
             updateNeighbors(mp, np);
+            // Heard straight from a neighbor, so its neighbors can be reached through it
+            bool viaLora = mp.transport_mechanism == meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA;
+            if (getHopsAway(mp) == 0 && mp.from && viaLora) {
+                for (pb_size_t i = 0; i < np->neighbors_count; i++) {
+                    NodeNum neighbor = np->neighbors[i].node_id;
+                    if (neighbor != nodeDB->getNodeNum() && neighbor != mp.from)
+                        routingTable.learn(neighbor, nodeDB->getLastByteOfNodeNum(mp.from), RouteSource::NEIGHBOR_INFO,
+                                           millis());
+                }
+            }
         } else {
             LOG_DEBUG("  Ignoring dummy neighbor info packet (single neighbor with nodeId 0, snr 0)");
         }
@@ -86,6 +86,7 @@ meshtastic_MeshPacket *RoutingModule::allocAckNak(meshtastic_Routing_Error err,
 RoutingModule::RoutingModule() : ProtobufModule("routing", meshtastic_PortNum_ROUTING_APP, &meshtastic_Routing_msg)
 {
     isPromiscuous = true;
+    wantAllPortnums(); // See wantPacket()
 
     // moved the RebroadcastMode logic into handleReceivedProtobuf
     // LocalOnly requires either the from or to to be a known node
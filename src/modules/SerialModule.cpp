@@ -123,6 +123,7 @@ SerialModuleRadio::SerialModuleRadio() : MeshModule("SerialModuleRadio")
         boundChannel = Channels::serialChannel;
         break;
     }
+    wantPortnum(ourPortNum);
 }
 
 /**
@@ -0,0 +1,317 @@
+#include "StoreForwardHistory.h"
+#include <string.h>
+
+#ifdef ARCH_PORTDUINO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// At the start of the memory-mapped file, a file written by another build or for another capacity is started over
+struct HistoryFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slotSize;
+    uint32_t capacity;
+    uint32_t reserved;
+};
+#define HISTORY_FILE_MAGIC 0x48465353 // "SSFH"
+#define HISTORY_FILE_VERSION 1
+#elif defined(FSCom)
+#include "SPILock.h"
+#include <ErriezCRC32.h>
+#include <power/PowerHAL.h>
+#endif
+
+StoreForwardHistory::~StoreForwardHistory()
+{
+#ifdef ARCH_PORTDUINO
+    if (mappedBytes) {
+        munmap((uint8_t *)slots - sizeof(HistoryFileHeader), mappedBytes);
+        return;
+    }
+#endif
+    free(slots);
+}
+
+bool StoreForwardHistory::begin(uint32_t capacity, const char *path)
+{
+    if (!capacity)
+        return false;
+    this->capacity = capacity;
+
+#ifdef ARCH_PORTDUINO
+    if (path) {
+        if (mapFile(path)) {
+            relink();
+            LOG_INFO("S&F - %u records restored from %s", size(), path);
+            return true;
+        }
+        LOG_WARN("S&F - Can't map %s, history won't survive a restart", path);
+    }
+#endif
+
+#if defined(ARCH_ESP32)
+    slots = static_cast<Slot *>(ps_calloc(capacity, sizeof(Slot)));
+#else
+    slots = static_cast<Slot *>(calloc(capacity, sizeof(Slot)));
+#endif
+    if (!slots) {
+        this->capacity = 0;
+        return false;
+    }
+
+#if !defined(ARCH_PORTDUINO) && defined(FSCom)
+    if (path) {
+        journalPath = path;
+        uint32_t oldRecords = 0;
+        replayJournal(journalPath + ".old", oldRecords);
+        // Records after a torn one would never be replayed, so start a new file with the next one
+        if (!replayJournal(journalPath, journalRecords))
+            journalRecords = STOREFORWARD_FLASH_RECORDS / 2;
+        LOG_INFO("S&F - %u records restored from %s", size(), path);
+    }
+#endif
+    return true;
+}
+
+bool StoreForwardHistory::isPersistent() const
+{
+#ifdef ARCH_PORTDUINO
+    return mappedBytes != 0;
+#elif defined(FSCom)
+    return !journalPath.empty();
+#else
+    return false;
+#endif
+}
+
+const StoreForwardHistory::Slot *StoreForwardHistory::find(uint32_t seq) const
+{
+    if (seq < oldestSeq() || seq >= nextSeq)
+        return nullptr;
+    const Slot *slot = &slots[(seq - 1) % capacity];
+    return slot->seq == seq ? slot : nullptr;
+}
+
+void StoreForwardHistory::add(const PacketHistoryStruct &packet)
+{
+    if (!capacity)
+        return;
+    append(packet);
+#if !defined(ARCH_PORTDUINO) && defined(FSCom)
+    if (!journalPath.empty())
+        appendJournal(packet);
+#endif
+}
+
+void StoreForwardHistory::append(const PacketHistoryStruct &packet)
+{
+    uint32_t seq = nextSeq++;
+    Slot &slot = slots[(seq - 1) % capacity];
+
+    // The oldest packet makes room, if it was the only one left to its destination the list is gone
+    if (slot.seq) {
+        auto tail = tails.find(slot.packet.to);
+        if (tail != tails.end() && tail->second == slot.seq)
+            tails.erase(tail);
+    }
+
+    if (packet.time > maxTime)
+        maxTime = packet.time;
+    slot.seq = seq;
+    slot.nextSeq = 0;
+    slot.maxTime = maxTime;
+    slot.packet = packet;
+    auto tail = tails.find(packet.to);
+    Slot *prev = tail != tails.end() ? find(tail->second) : nullptr;
+    slot.prevSeq = prev ? prev->seq : 0;
+    if (prev)
+        prev->nextSeq = seq;
+    tails[packet.to] = seq;
+}
+
+uint32_t StoreForwardHistory::firstAfter(NodeNum key, uint32_t afterSeq, uint32_t sinceTime) const
+{
+    // The RTC may not have been set yet after a reboot, so the packet times alone don't tell when to stop
+    auto tail = tails.find(key);
+    uint32_t first = 0;
+    for (const Slot *slot = tail != tails.end() ? find(tail->second) : nullptr;
+         slot && slot->seq > afterSeq && slot->maxTime > sinceTime; slot = find(slot->prevSeq))
+        first = slot->seq;
+    return first;
+}
+
+uint32_t StoreForwardHistory::getNumAvailable(NodeNum dest, uint32_t sinceTime) const
+{
+    auto cursor = cursors.find(dest);
+    uint32_t afterSeq = cursor != cursors.end() ? cursor->second.lastSeq : 0;
+
+    const NodeNum keys[] = {NODENUM_BROADCAST, dest};
+    uint32_t count = 0;
+    for (size_t i = 0; i < (dest == NODENUM_BROADCAST ? 1 : 2); i++) {
+        for (const Slot *slot = find(firstAfter(keys[i], afterSeq, sinceTime)); slot; slot = find(slot->nextSeq))
+            if (isFor(slot->packet, dest, sinceTime))
+                count++;
+    }
+    return count;
+}
+
+const PacketHistoryStruct *StoreForwardHistory::next(NodeNum dest, uint32_t sinceTime)
+{
+    if (!capacity)
+        return nullptr;
+
+    Cursor &cursor = cursors[dest];
+    if (cursor.sinceTime != sinceTime) {
+        cursor.nextBroadcast = cursor.nextDirect = 0;
+        cursor.sinceTime = sinceTime;
+    }
+
+    while (true) {
+        // Carry on in each list where we left it, unless that packet has made room for a new one since
+        const Slot *broadcast = find(cursor.nextBroadcast);
+        if (!broadcast)
+            broadcast = find(firstAfter(NODENUM_BROADCAST, cursor.lastSeq, sinceTime));
+        const Slot *direct = nullptr;
+        if (dest != NODENUM_BROADCAST) {
+            direct = find(cursor.nextDirect);
+            if (!direct)
+                direct = find(firstAfter(dest, cursor.lastSeq, sinceTime));
+        }
+
+        // Oldest first, from either list
+        const Slot *slot = (!direct || (broadcast && broadcast->seq < direct->seq)) ? broadcast : direct;
+        if (!slot)
+            return nullptr;
+        cursor.nextBroadcast = slot == broadcast ? slot->nextSeq : (broadcast ? broadcast->seq : 0);
+        cursor.nextDirect = slot == direct ? slot->nextSeq : (direct ? direct->seq : 0);
+        cursor.lastSeq = slot->seq;
+
+        if (isFor(slot->packet, dest, sinceTime))
+            return &slot->packet;
+    }
+}
+
+uint32_t StoreForwardHistory::getLastRequest(NodeNum dest) const
+{
+    auto cursor = cursors.find(dest);
+    return cursor != cursors.end() ? cursor->second.lastSeq : 0;
+}
+
+void StoreForwardHistory::relink()
+{
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < capacity; i++)
+        if (slots[i].seq > newest)
+            newest = slots[i].seq;
+    nextSeq = newest + 1;
+
+    tails.clear();
+    cursors.clear();
+    maxTime = 0;
+    for (uint32_t seq = oldestSeq(); seq < nextSeq; seq++) {
+        Slot *slot = find(seq);
+        if (!slot)
+            continue;
+        if (slot->packet.time > maxTime)
+            maxTime = slot->packet.time;
+        slot->maxTime = maxTime;
+        auto tail = tails.find(slot->packet.to);
+        Slot *prev = tail != tails.end() ? find(tail->second) : nullptr;
+        slot->prevSeq = prev ? prev->seq : 0;
+        slot->nextSeq = 0;
+        if (prev)
+            prev->nextSeq = seq;
+        tails[slot->packet.to] = seq;
+    }
+}
+
+#ifdef ARCH_PORTDUINO
+bool StoreForwardHistory::mapFile(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    const HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, sizeof(Slot), capacity, 0};
+    HistoryFileHeader existing = {};
+    size_t bytes = sizeof(header) + (size_t)capacity * sizeof(Slot);
+    bool okay = true;
+    if (pread(fd, &existing, sizeof(existing), 0) != sizeof(existing) || memcmp(&existing, &header, sizeof(header)) != 0) {
+        if (existing.magic == HISTORY_FILE_MAGIC)
+            LOG_WARN("S&F - %s is from another version or capacity, start over", path);
+        okay = ftruncate(fd, 0) == 0 && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+    }
+    // Grows a new file with zeros, without writing them
+    okay = okay && ftruncate(fd, bytes) == 0;
+    void *map = okay ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    mappedBytes = bytes;
+    slots = reinterpret_cast<Slot *>(static_cast<uint8_t *>(map) + sizeof(HistoryFileHeader));
+    return true;
+}
+#elif defined(FSCom)
+/*
+ * Journal records: a crc32 over the packet, then the packet.
+ */
+bool StoreForwardHistory::replayJournal(const std::string &path, uint32_t &count)
+{
+    count = 0;
+    concurrency::LockGuard g(spiLock);
+    auto f = FSCom.open(path.c_str(), FILE_O_READ);
+    if (!f)
+        return true;
+
+    PacketHistoryStruct packet;
+    uint32_t crc;
+    bool clean = true;
+    while (f.available()) {
+        if (f.read((uint8_t *)&crc, sizeof(crc)) != sizeof(crc) || f.read((uint8_t *)&packet, sizeof(packet)) != sizeof(packet) ||
+            crc32Buffer(&packet, sizeof(packet)) != crc) {
+            clean = false;
+            break;
+        }
+        append(packet);
+        count++;
+    }
+    f.close();
+    return clean;
+}
+
+void StoreForwardHistory::appendJournal(const PacketHistoryStruct &packet)
+{
+    // Flash may be write protected, the device should be going to sleep anyway
+    if (!powerHAL_isPowerLevelSafe())
+        return;
+
+    if (journalRecords >= STOREFORWARD_FLASH_RECORDS / 2) {
+        std::string oldPath = journalPath + ".old";
+        spiLock->lock();
+        FSCom.remove(oldPath.c_str());
+        spiLock->unlock();
+        renameFile(journalPath.c_str(), oldPath.c_str());
+        journalRecords = 0;
+    }
+
+    uint32_t crc = crc32Buffer(&packet, sizeof(packet));
+    bool okay = false;
+    spiLock->lock();
+    auto f = FSCom.open(journalPath.c_str(), FILE_O_APPEND);
+    if (f) {
+        okay = f.write((const uint8_t *)&crc, sizeof(crc)) == sizeof(crc) &&
+               f.write((const uint8_t *)&packet, sizeof(packet)) == sizeof(packet);
+        f.close();
+    }
+    spiLock->unlock();
+
+    if (okay) {
+        journalRecords++;
+    } else {
+        LOG_ERROR("S&F - Can't append to %s", journalPath.c_str());
+        journalRecords = STOREFORWARD_FLASH_RECORDS / 2; // Start a new file rather than write after a torn record
+    }
+}
+#endif
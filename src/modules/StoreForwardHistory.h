@@ -0,0 +1,138 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "configuration.h"
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#ifndef ARCH_PORTDUINO
+#include "FSCommon.h"
+#endif
+
+/// Most recent records the flash journal keeps, when the history is persisted without a memory-mapped file
+#ifndef STOREFORWARD_FLASH_RECORDS
+#define STOREFORWARD_FLASH_RECORDS 1024
+#endif
+
+struct PacketHistoryStruct {
+    uint32_t time;
+    uint32_t to;
+    uint32_t from;
+    uint32_t id;
+    uint8_t channel;
+    uint32_t reply_id;
+    bool emoji;
+    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    pb_size_t payload_size;
+    int32_t rx_rssi;
+    float rx_snr;
+    uint8_t hop_start;
+    uint8_t hop_limit;
+    bool via_mqtt;
+    uint8_t transport_mechanism;
+};
+
+/**
+ * @brief The Store & Forward server's message history
+ *
+ * A circular log: once full, each new packet replaces the oldest one. Packets are numbered in the order they were added, and
+ * the packets to each destination (broadcast being one) are linked into a list, so finding what a client hasn't got yet only
+ * touches the broadcasts and the packets to that client.
+ *
+ * The log lives in RAM (PSRAM on ESP32), or with a path, it survives reboots: on Linux the log is a memory-mapped file, elsewhere
+ * the newest STOREFORWARD_FLASH_RECORDS packets are also appended to a journal in flash and replayed at boot.
+ */
+class StoreForwardHistory
+{
+  public:
+    ~StoreForwardHistory();
+
+    /**
+     * Make room for capacity packets
+     * @param path where to keep the history across reboots, or nullptr to keep it in RAM only
+     * @return false if there isn't memory for it
+     */
+    bool begin(uint32_t capacity, const char *path = nullptr);
+
+    void add(const PacketHistoryStruct &packet);
+
+    /// Packets newer than sinceTime that dest hasn't been sent yet: broadcasts and packets to dest, but not its own
+    uint32_t getNumAvailable(NodeNum dest, uint32_t sinceTime) const;
+
+    /**
+     * The next packet for dest, as counted by getNumAvailable(), and remember dest got it
+     * @return the packet, valid until the next add(), or nullptr if there is none
+     */
+    const PacketHistoryStruct *next(NodeNum dest, uint32_t sinceTime);
+
+    /// Number of the last packet dest was sent, 0 if none
+    uint32_t getLastRequest(NodeNum dest) const;
+
+    /// Memory used per packet of capacity
+    static size_t getRecordSize() { return sizeof(Slot); }
+
+    uint32_t size() const { return nextSeq - oldestSeq(); }
+    uint32_t getCapacity() const { return capacity; }
+    bool isPersistent() const;
+
+  private:
+    struct Slot {
+        uint32_t seq;     // Numbered from 1 in the order added, 0 while the slot is unused
+        uint32_t prevSeq; // The previous packet to the same destination, 0 if none
+        uint32_t nextSeq; // The next packet to the same destination, 0 if none yet
+        uint32_t maxTime; // The newest time of this and all packets before it, as the clock may have gone backwards
+        PacketHistoryStruct packet;
+    };
+
+    /// Where a client is in the history, and where it is in the two lists it reads. 0 means find out again.
+    struct Cursor {
+        uint32_t lastSeq;
+        uint32_t nextBroadcast;
+        uint32_t nextDirect;
+        uint32_t sinceTime; // What the two above were found for
+    };
+
+    Slot *slots = nullptr;
+    uint32_t capacity = 0;
+    uint32_t nextSeq = 1;
+    uint32_t maxTime = 0; // Of the packets added so far
+
+    /// The newest packet to each destination
+    std::unordered_map<NodeNum, uint32_t> tails;
+    std::unordered_map<NodeNum, Cursor> cursors;
+
+    uint32_t oldestSeq() const { return nextSeq > capacity ? nextSeq - capacity : 1; }
+    const Slot *find(uint32_t seq) const;
+    Slot *find(uint32_t seq) { return const_cast<Slot *>(static_cast<const StoreForwardHistory *>(this)->find(seq)); }
+
+    /// Put a packet into the log and the list for its destination
+    void append(const PacketHistoryStruct &packet);
+
+    /**
+     * The oldest packet to key newer than afterSeq that may be newer than sinceTime, walking back from the newest. Packets
+     * before it are all too old, but it and the ones after it still need to be checked with isFor().
+     */
+    uint32_t firstAfter(NodeNum key, uint32_t afterSeq, uint32_t sinceTime) const;
+
+    /// Whether dest wants this packet
+    static bool isFor(const PacketHistoryStruct &packet, NodeNum dest, uint32_t sinceTime)
+    {
+        return packet.time > sinceTime && packet.from != dest;
+    }
+
+    /// Link the packets already in slots, after loading them from a file
+    void relink();
+
+#ifdef ARCH_PORTDUINO
+    size_t mappedBytes = 0;
+    bool mapFile(const char *path);
+#elif defined(FSCom)
+    // Two files of up to half of STOREFORWARD_FLASH_RECORDS each: once the current one is full it replaces the old one
+    std::string journalPath;
+    uint32_t journalRecords = 0; // In the current file
+    /// @return false if the file ends in a torn record
+    bool replayJournal(const std::string &path, uint32_t &count);
+    void appendJournal(const PacketHistoryStruct &packet);
+#endif
+};
@@ -13,6 +13,7 @@
  * @date [Insert Date]
  */
 #include "StoreForwardModule.h"
+#include "FSCommon.h"
 #include "MeshService.h"
 #include "NodeDB.h"
 #include "RTC.h"
@@ -77,14 +78,18 @@ void StoreForwardModule::populatePSRAM()
         Note: This needs to be done after every thing that would use PSRAM
     */
     uint32_t numberOfPackets =
-        (this->records ? this->records : (((memGet.getFreePsram() / 4) * 3) / sizeof(PacketHistoryStruct)));
+        (this->records ? this->records : (((memGet.getFreePsram() / 4) * 3) / StoreForwardHistory::getRecordSize()));
     this->records = numberOfPackets;
-#if defined(ARCH_ESP32)
-    this->packetHistory = static_cast<PacketHistoryStruct *>(ps_calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
-#elif defined(ARCH_PORTDUINO)
-    this->packetHistory = static_cast<PacketHistoryStruct *>(calloc(numberOfPackets, sizeof(PacketHistoryStruct)));
-
+#if defined(ARCH_PORTDUINO)
+    std::string path = std::string(portduinoVFS->mountpoint()) + "/storeforward.bin";
+    bool allocated = this->history.begin(numberOfPackets, path.c_str());
+#elif STOREFORWARD_PERSIST_FLASH
+    bool allocated = this->history.begin(numberOfPackets, "/prefs/storeforward");
+#else
+    bool allocated = this->history.begin(numberOfPackets);
 #endif
+    if (!allocated)
+        LOG_ERROR("S&F - Can't allocate history for %u records", numberOfPackets);
 
     LOG_DEBUG("After PSRAM init: heap %d/%d PSRAM %d/%d", memGet.getFreeHeap(), memGet.getHeapSize(), memGet.getFreePsram(),
               memGet.getPsramSize());
@@ -116,7 +121,7 @@ void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
     sf.which_variant = meshtastic_StoreAndForward_history_tag;
     sf.variant.history.history_messages = queueSize;
     sf.variant.history.window = secAgo * 1000;
-    sf.variant.history.last_request = lastRequest[to];
+    sf.variant.history.last_request = history.getLastRequest(to);
     storeForwardModule->sendMessage(to, sf);
     setIntervalFromNow(this->packetTimeMax); // Delay start of sending payloads
 }
@@ -130,18 +135,7 @@ void StoreForwardModule::historySend(uint32_t secAgo, uint32_t to)
  */
 uint32_t StoreForwardModule::getNumAvailablePackets(NodeNum dest, uint32_t last_time)
 {
-    uint32_t count = 0;
-    lastRequest.emplace(dest, 0);
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            // Client is only interested in packets not from itself and only in broadcast packets or packets towards it.
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-                count++;
-            }
-        }
-    }
-    return count;
+    return history.getNumAvailable(dest, last_time);
 }
 
 /**
@@ -184,31 +178,27 @@ void StoreForwardModule::historyAdd(const meshtastic_MeshPacket &mp)
 {
     const auto &p = mp.decoded;
 
-    if (this->packetHistoryTotalCount == this->records) {
-        LOG_WARN("S&F - PSRAM Full. Starting overwrite");
-        this->packetHistoryTotalCount = 0;
-        for (auto &i : lastRequest) {
-            i.second = 0; // Clear the last request index for each client device
-        }
-    }
-
-    this->packetHistory[this->packetHistoryTotalCount].time = getTime();
-    this->packetHistory[this->packetHistoryTotalCount].to = mp.to;
-    this->packetHistory[this->packetHistoryTotalCount].channel = mp.channel;
-    this->packetHistory[this->packetHistoryTotalCount].from = getFrom(&mp);
-    this->packetHistory[this->packetHistoryTotalCount].id = mp.id;
-    this->packetHistory[this->packetHistoryTotalCount].reply_id = p.reply_id;
-    this->packetHistory[this->packetHistoryTotalCount].emoji = (bool)p.emoji;
-    this->packetHistory[this->packetHistoryTotalCount].payload_size = p.payload.size;
-    this->packetHistory[this->packetHistoryTotalCount].rx_rssi = mp.rx_rssi;
-    this->packetHistory[this->packetHistoryTotalCount].rx_snr = mp.rx_snr;
-    this->packetHistory[this->packetHistoryTotalCount].hop_start = mp.hop_start;
-    this->packetHistory[this->packetHistoryTotalCount].hop_limit = mp.hop_limit;
-    this->packetHistory[this->packetHistoryTotalCount].via_mqtt = mp.via_mqtt;
-    this->packetHistory[this->packetHistoryTotalCount].transport_mechanism = mp.transport_mechanism;
-    memcpy(this->packetHistory[this->packetHistoryTotalCount].payload, p.payload.bytes, meshtastic_Constants_DATA_PAYLOAD_LEN);
-
-    this->packetHistoryTotalCount++;
+    if (history.size() == history.getCapacity())
+        LOG_DEBUG("S&F - History full, replace the oldest record");
+
+    PacketHistoryStruct packet = {};
+    packet.time = getTime();
+    packet.to = mp.to;
+    packet.channel = mp.channel;
+    packet.from = getFrom(&mp);
+    packet.id = mp.id;
+    packet.reply_id = p.reply_id;
+    packet.emoji = (bool)p.emoji;
+    packet.payload_size = p.payload.size;
+    packet.rx_rssi = mp.rx_rssi;
+    packet.rx_snr = mp.rx_snr;
+    packet.hop_start = mp.hop_start;
+    packet.hop_limit = mp.hop_limit;
+    packet.via_mqtt = mp.via_mqtt;
+    packet.transport_mechanism = mp.transport_mechanism;
+    memcpy(packet.payload, p.payload.bytes, meshtastic_Constants_DATA_PAYLOAD_LEN);
+
+    history.add(packet);
 }
 
 /**
@@ -239,60 +229,52 @@ bool StoreForwardModule::sendPayload(NodeNum dest, uint32_t last_time)
  */
 meshtastic_MeshPacket *StoreForwardModule::preparePayload(NodeNum dest, uint32_t last_time, bool local)
 {
-    for (uint32_t i = lastRequest[dest]; i < this->packetHistoryTotalCount; i++) {
-        if (this->packetHistory[i].time && (this->packetHistory[i].time > last_time)) {
-            /*  Copy the messages that were received by the server in the last msAgo
-                to the packetHistoryTXQueue structure.
-                Client not interested in packets from itself and only in broadcast packets or packets towards it. */
-            if (this->packetHistory[i].from != dest &&
-                (this->packetHistory[i].to == NODENUM_BROADCAST || this->packetHistory[i].to == dest)) {
-
-                meshtastic_MeshPacket *p = allocDataPacket();
-
-                p->to = local ? this->packetHistory[i].to : dest; // PhoneAPI can handle original `to`
-                p->from = this->packetHistory[i].from;
-                p->id = this->packetHistory[i].id;
-                p->channel = this->packetHistory[i].channel;
-                p->decoded.reply_id = this->packetHistory[i].reply_id;
-                p->rx_time = this->packetHistory[i].time;
-                p->decoded.emoji = (uint32_t)this->packetHistory[i].emoji;
-                p->rx_rssi = this->packetHistory[i].rx_rssi;
-                p->rx_snr = this->packetHistory[i].rx_snr;
-                p->hop_start = this->packetHistory[i].hop_start;
-                p->hop_limit = this->packetHistory[i].hop_limit;
-                p->via_mqtt = this->packetHistory[i].via_mqtt;
-                p->transport_mechanism = (meshtastic_MeshPacket_TransportMechanism)this->packetHistory[i].transport_mechanism;
-
-                // Let's assume that if the server received the S&F request that the client is in range.
-                //   TODO: Make this configurable.
-                p->want_ack = false;
-
-                if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
-                    p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-                    memcpy(p->decoded.payload.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    p->decoded.payload.size = this->packetHistory[i].payload_size;
-                } else {
-                    meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
-                    sf.which_variant = meshtastic_StoreAndForward_text_tag;
-                    sf.variant.text.size = this->packetHistory[i].payload_size;
-                    memcpy(sf.variant.text.bytes, this->packetHistory[i].payload, this->packetHistory[i].payload_size);
-                    if (this->packetHistory[i].to == NODENUM_BROADCAST) {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
-                    } else {
-                        sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
-                    }
-
-                    p->decoded.payload.size = pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes),
-                                                                 &meshtastic_StoreAndForward_msg, &sf);
-                }
+    /*  Copy the next message received by the server since last_time.
+        Client not interested in packets from itself and only in broadcast packets or packets towards it. */
+    const PacketHistoryStruct *packet = history.next(dest, last_time);
+    if (!packet)
+        return nullptr;
+
+    meshtastic_MeshPacket *p = allocDataPacket();
+
+    p->to = local ? packet->to : dest; // PhoneAPI can handle original `to`
+    p->from = packet->from;
+    p->id = packet->id;
+    p->channel = packet->channel;
+    p->decoded.reply_id = packet->reply_id;
+    p->rx_time = packet->time;
+    p->decoded.emoji = (uint32_t)packet->emoji;
+    p->rx_rssi = packet->rx_rssi;
+    p->rx_snr = packet->rx_snr;
+    p->hop_start = packet->hop_start;
+    p->hop_limit = packet->hop_limit;
+    p->via_mqtt = packet->via_mqtt;
+    p->transport_mechanism = (meshtastic_MeshPacket_TransportMechanism)packet->transport_mechanism;
 
-                lastRequest[dest] = i + 1; // Update the last request index for the client device
+    // Let's assume that if the server received the S&F request that the client is in range.
+    //   TODO: Make this configurable.
+    p->want_ack = false;
 
-                return p;
-            }
+    if (local) { // PhoneAPI gets normal TEXT_MESSAGE_APP
+        p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+        memcpy(p->decoded.payload.bytes, packet->payload, packet->payload_size);
+        p->decoded.payload.size = packet->payload_size;
+    } else {
+        meshtastic_StoreAndForward sf = meshtastic_StoreAndForward_init_zero;
+        sf.which_variant = meshtastic_StoreAndForward_text_tag;
+        sf.variant.text.size = packet->payload_size;
+        memcpy(sf.variant.text.bytes, packet->payload, packet->payload_size);
+        if (packet->to == NODENUM_BROADCAST) {
+            sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_BROADCAST;
+        } else {
+            sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_TEXT_DIRECT;
         }
+
+        p->decoded.payload.size =
+            pb_encode_to_bytes(p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes), &meshtastic_StoreAndForward_msg, &sf);
     }
-    return nullptr;
+
+    return p;
 }
 
 /**
@@ -372,7 +354,7 @@ void StoreForwardModule::statsSend(uint32_t to)
     sf.rr = meshtastic_StoreAndForward_RequestResponse_ROUTER_STATS;
     sf.which_variant = meshtastic_StoreAndForward_stats_tag;
     sf.variant.stats.messages_total = this->records;
-    sf.variant.stats.messages_saved = this->packetHistoryTotalCount;
+    sf.variant.stats.messages_saved = history.size();
     sf.variant.stats.messages_max = this->records;
     sf.variant.stats.up_time = millis() / 1000;
     sf.variant.stats.requests = this->requests;
@@ -409,7 +391,7 @@ ProcessMessage StoreForwardModule::handleReceived(const meshtastic_MeshPacket &m
                 }
             } else {
                 storeForwardModule->historyAdd(mp);
-                LOG_INFO("S&F stored. Message history contains %u records now", this->packetHistoryTotalCount);
+                LOG_INFO("S&F stored. Message history contains %u records now", history.size());
             }
         } else if (!isFromUs(&mp) && mp.decoded.portnum == meshtastic_PortNum_STORE_FORWARD_APP) {
             auto &p = mp.decoded;
@@ -571,6 +553,7 @@ StoreForwardModule::StoreForwardModule()
     : concurrency::OSThread("StoreForward"),
       ProtobufModule("StoreForward", meshtastic_PortNum_STORE_FORWARD_APP, &meshtastic_StoreAndForward_msg)
 {
+    wantPortnum(meshtastic_PortNum_TEXT_MESSAGE_APP); // Text messages get stored for clients that were away
 
 #if defined(ARCH_ESP32) || defined(ARCH_PORTDUINO)
 
@@ -1,31 +1,19 @@
 #pragma once
 
 #include "ProtobufModule.h"
+#include "StoreForwardHistory.h"
 #include "concurrency/OSThread.h"
 #include "mesh/generated/meshtastic/storeforward.pb.h"
 
 #include "configuration.h"
 #include <Arduino.h>
 #include <functional>
-#include <unordered_map>
-
-struct PacketHistoryStruct {
-    uint32_t time;
-    uint32_t to;
-    uint32_t from;
-    uint32_t id;
-    uint8_t channel;
-    uint32_t reply_id;
-    bool emoji;
-    uint8_t payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
-    pb_size_t payload_size;
-    int32_t rx_rssi;
-    float rx_snr;
-    uint8_t hop_start;
-    uint8_t hop_limit;
-    bool via_mqtt;
-    uint8_t transport_mechanism;
-};
+
+/// Also keep the history in flash (the newest STOREFORWARD_FLASH_RECORDS of it), so it survives a reboot. Linux always keeps it
+/// in a memory-mapped file.
+#ifndef STOREFORWARD_PERSIST_FLASH
+#define STOREFORWARD_PERSIST_FLASH 0
+#endif
 
 class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<meshtastic_StoreAndForward>
 {
@@ -33,8 +21,7 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     uint32_t busyTo = 0;
     char routerMessage[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
 
-    PacketHistoryStruct *packetHistory = 0;
-    uint32_t packetHistoryTotalCount = 0;
+    StoreForwardHistory history;
     uint32_t last_time = 0;
     uint32_t requestCount = 0;
 
@@ -43,9 +30,6 @@ class StoreForwardModule : private concurrency::OSThread, public ProtobufModule<
     bool is_client = false;
     bool is_server = false;
 
-    // Unordered_map stores the last request for each nodeNum (`to` field)
-    std::unordered_map<NodeNum, uint32_t> lastRequest;
-
   public:
     StoreForwardModule();
 
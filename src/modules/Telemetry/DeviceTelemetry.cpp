@@ -155,6 +155,9 @@ meshtastic_Telemetry DeviceTelemetryModule::getLocalStatsTelemetry()
 
     LOG_INFO("num_packets_tx=%i, num_packets_rx=%i, num_packets_rx_bad=%i", telemetry.variant.local_stats.num_packets_tx,
              telemetry.variant.local_stats.num_packets_rx, telemetry.variant.local_stats.num_packets_rx_bad);
+    if (router)
+        LOG_INFO("num_rx_relay_fast_path=%u, num_decrypt_packets=%u, num_decrypt_attempts=%u", router->rxRelayFastPath,
+                 decodeStats.packets, decodeStats.attempts);
 
     return telemetry;
 }
@@ -18,7 +18,13 @@ class TextMessageModule : public SinglePortModule, public Observable<const mesht
     /** Constructor
      * name is for debugging output
      */
-    TextMessageModule() : SinglePortModule("text", meshtastic_PortNum_TEXT_MESSAGE_APP) {}
+    TextMessageModule() : SinglePortModule("text", meshtastic_PortNum_TEXT_MESSAGE_APP)
+    {
+        // The other portnums MeshService::isTextPayload() accepts
+        wantPortnum(meshtastic_PortNum_DETECTION_SENSOR_APP);
+        wantPortnum(meshtastic_PortNum_ALERT_APP);
+        wantPortnum(meshtastic_PortNum_RANGE_TEST_APP);
+    }
 
     bool recentlySeen(uint32_t id);
 
@@ -1,6 +1,7 @@
 #include "TraceRouteModule.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "RoutingTable.h"
 #include "graphics/Screen.h"
 #include "graphics/ScreenFonts.h"
 #include "graphics/SharedUIDisplay.h"
@@ -318,6 +319,8 @@ void TraceRouteModule::maybeSetNextHop(NodeNum target, uint8_t nextHopByte)
     if (target == NODENUM_BROADCAST)
         return;
 
+    routingTable.learn(target, nextHopByte, RouteSource::TRACEROUTE, millis());
+
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(target);
     if (node && node->next_hop != nextHopByte) {
         LOG_INFO("Updating next-hop for 0x%08x to 0x%02x based on traceroute", target, nextHopByte);
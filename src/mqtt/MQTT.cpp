@@ -2,6 +2,7 @@
 #include "MeshService.h"
 #include "NodeDB.h"
 #include "PowerFSM.h"
+#include "Profiler.h"
 #include "ServiceEnvelope.h"
 #include "configuration.h"
 #include "main.h"
@@ -29,6 +30,7 @@
 #include "serialization/MeshPacketSerializer.h"
 #endif
 #include <Throttle.h>
+#include <algorithm>
 #include <assert.h>
 #include <utility>
 
@@ -48,7 +50,7 @@ namespace
 constexpr int reconnectMax = 5;
 
 // FIXME - this size calculation is super sloppy, but it will go away once we dynamically alloc meshpackets
-static uint8_t bytes[meshtastic_MqttClientProxyMessage_size + 30]; // 12 for channel name and 16 for nodeid
+static uint8_t bytes[MQTT_ENVELOPE_MAX_BYTES];
 
 static bool isMqttServerAddressPrivate = false;
 static bool isConnected = false;
@@ -413,9 +415,9 @@ void mqttInit()
 #if HAS_NETWORKING
 MQTT::MQTT() : MQTT(std::unique_ptr<MQTTClient>(new MQTTClient())) {}
 MQTT::MQTT(std::unique_ptr<MQTTClient> _mqttClient)
-    : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE), mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
+    : concurrency::OSThread("mqtt"), mqttClient(std::move(_mqttClient)), pubSub(*mqttClient)
 #else
-MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
+MQTT::MQTT() : concurrency::OSThread("mqtt")
 #endif
 {
     if (moduleConfig.mqtt.enabled) {
@@ -423,6 +425,7 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
 
         assert(!mqtt);
         mqtt = this;
+        mqttQueue.reset(new QueueEntry[MAX_MQTT_QUEUE]);
 
         if (*moduleConfig.mqtt.root) {
             cryptTopic = moduleConfig.mqtt.root + cryptTopic;
@@ -456,7 +459,7 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
 
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT configured to use client proxy");
-            enabled = true;
+            enable();
             runASAP = true;
             reconnectCount = 0;
 #if !IS_RUNNING_TESTS
@@ -501,6 +504,7 @@ bool MQTT::publish(const char *topic, const char *payload, bool retained)
 
 bool MQTT::publish(const char *topic, const uint8_t *payload, size_t length, bool retained)
 {
+    PROFILE_SCOPE("mqtt", "publish");
     if (moduleConfig.mqtt.proxy_to_client_enabled) {
         meshtastic_MqttClientProxyMessage *msg = mqttClientProxyMessagePool.allocZeroed();
         msg->which_payload_variant = meshtastic_MqttClientProxyMessage_data_tag;
@@ -528,7 +532,7 @@ void MQTT::reconnect()
     if (wantsLink()) {
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT connect via client proxy instead");
-            enabled = true;
+            enable();
             runASAP = true;
             reconnectCount = 0;
 
@@ -548,7 +552,7 @@ void MQTT::reconnect()
         }
 #endif
         if (connectPubSub(ps_config, pubSub, *clientConnection)) {
-            enabled = true; // Start running background process again
+            enable(); // Start running background process again
             runASAP = true;
             reconnectCount = 0;
             isMqttServerAddressPrivate = isPrivateIpAddress(clientConnection->remoteIP());
@@ -634,6 +638,9 @@ int32_t MQTT::runOnce()
         if (!wantConnection) {
             LOG_INFO("MQTT link not needed, drop");
             pubSub.disconnect();
+        } else {
+            // Keep draining whatever queued up while we were disconnected
+            publishQueuedMessages();
         }
 
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
@@ -716,44 +723,81 @@ void MQTT::publishNodeInfo()
 {
     // TODO: NodeInfo broadcast over MQTT only (NODENUM_BROADCAST_NO_LORA)
 }
+const char *MQTT::channelTopic(ChannelTopic *topics, uint8_t topicIndex, const std::string &prefix, const char *channelId)
+{
+    ChannelTopic &cached = topics[topicIndex];
+    const size_t channelIdLength = strlen(channelId);
+    if (cached.nodeNum != myNodeInfo.my_node_num || cached.channelIdLength != channelIdLength ||
+        strncmp(cached.topic + prefix.length(), channelId, channelIdLength) != 0) {
+        // Same as prefix + channelId + "/" + nodeDB->getNodeId()
+        snprintf(cached.topic, sizeof(cached.topic), "%s%s/!%08x", prefix.c_str(), channelId, myNodeInfo.my_node_num);
+        cached.channelIdLength = channelIdLength;
+        cached.nodeNum = myNodeInfo.my_node_num;
+    }
+    return cached.topic;
+}
+
+MQTT::QueueEntry &MQTT::reserveQueueEntry()
+{
+    if (queueStats.depth == MAX_MQTT_QUEUE) {
+        LOG_WARN("MQTT queue is full, discard oldest");
+        queueHead = (queueHead + 1) % MAX_MQTT_QUEUE;
+        queueStats.depth--;
+        queueStats.dropped++;
+    }
+    return mqttQueue[(queueHead + queueStats.depth) % MAX_MQTT_QUEUE];
+}
+
 void MQTT::publishQueuedMessages()
 {
-    if (mqttQueue.isEmpty())
+    if (queueStats.depth == 0)
         return;
 
     if (!moduleConfig.mqtt.proxy_to_client_enabled && !isConnected)
         return;
 
-    LOG_DEBUG("Publish enqueued MQTT message");
-    const std::unique_ptr<QueueEntry> entry(mqttQueue.dequeuePtr(0));
-    LOG_INFO("publish %s, %u bytes from queue", entry->topic.c_str(), entry->envBytes.size());
-    publish(entry->topic.c_str(), entry->envBytes.data(), entry->envBytes.size(), false);
+    const uint32_t now = millis();
+    uint8_t published = 0;
+    while (published < MQTT_PUBLISH_BATCH && queueStats.depth > 0) {
+        const QueueEntry &entry = mqttQueue[queueHead];
+        LOG_INFO("publish %s, %u bytes from queue", entry.topic, entry.envLength);
+        if (!publish(entry.topic, entry.envBytes, entry.envLength, false))
+            break; // Keep it for when we are connected again
+
+        queueStats.maxWaitMs = std::max(queueStats.maxWaitMs, now - entry.queuedAtMs);
+        published++;
 
 #if !defined(ARCH_NRF52) ||                                                                                                      \
     defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-    if (!moduleConfig.mqtt.json_enabled)
-        return;
+        if (moduleConfig.mqtt.json_enabled) {
+            const DecodedServiceEnvelope env(entry.envBytes, entry.envLength);
+            if (env.validDecode && env.packet != NULL && env.channel_id != NULL)
+                publishJson(env.packet, entry.topicIndex, env.channel_id);
+        }
+#endif // ARCH_NRF52 NRF52_USE_JSON
 
-    // handle json topic
-    const DecodedServiceEnvelope env(entry->envBytes.data(), entry->envBytes.size());
-    if (!env.validDecode || env.packet == NULL || env.channel_id == NULL)
+        queueHead = (queueHead + 1) % MAX_MQTT_QUEUE;
+        queueStats.depth--;
+    }
+    LOG_DEBUG("Published %u queued MQTT messages, %u left, %u dropped, waited up to %u ms", published, queueStats.depth,
+              queueStats.dropped, queueStats.maxWaitMs);
+}
+
+void MQTT::publishJson(const meshtastic_MeshPacket *p, uint8_t topicIndex, const char *channelId)
+{
+#if !defined(ARCH_NRF52) ||                                                                                                      \
+    defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
+    if (!moduleConfig.mqtt.json_enabled)
         return;
 
-    auto jsonString = MeshPacketSerializer::JsonSerialize(env.packet);
+    std::string &jsonString = jsonScratch;
+    MeshPacketSerializer::JsonSerialize(p, jsonString);
     if (jsonString.length() == 0)
         return;
 
-    // Generate node ID from nodenum for topic
-    std::string nodeId = nodeDB->getNodeId();
-
-    std::string topicJson;
-    if (env.packet->pki_encrypted) {
-        topicJson = jsonTopic + "PKI/" + nodeId;
-    } else {
-        topicJson = jsonTopic + env.channel_id + "/" + nodeId;
-    }
-    LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-    publish(topicJson.c_str(), jsonString.c_str(), false);
+    const char *topicJson = channelTopic(jsonTopics, topicIndex, jsonTopic, channelId);
+    LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson, jsonString.length(), jsonString.c_str());
+    publish(topicJson, jsonString.c_str(), false);
 #endif // ARCH_NRF52 NRF52_USE_JSON
 }
 
@@ -806,48 +850,35 @@ void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_Me
         return; // Don't upload a still-encrypted PKI packet if not encryption_enabled
     }
 
-    // Generate node ID from nodenum for service envelope
-    std::string nodeId = nodeDB->getNodeId();
+    const uint8_t topicIndex = isPKIEncrypted ? MAX_NUM_CHANNELS : chIndex;
+    const char *topic = channelTopic(cryptTopics, topicIndex, cryptTopic, channelId);
+    // The topic ends in our node id, which is also the gateway id
+    const char *nodeId = topic + cryptTopic.length() + strlen(channelId) + 1;
 
     const meshtastic_ServiceEnvelope env = {.packet = const_cast<meshtastic_MeshPacket *>(p),
                                             .channel_id = const_cast<char *>(channelId),
-                                            .gateway_id = const_cast<char *>(nodeId.c_str())};
-    size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, &env);
-    std::string topic = cryptTopic + channelId + "/" + nodeId;
+                                            .gateway_id = const_cast<char *>(nodeId)};
 
     if (moduleConfig.mqtt.proxy_to_client_enabled || this->isConnectedDirectly()) {
-        LOG_DEBUG("MQTT Publish %s, %u bytes", topic.c_str(), numBytes);
-        publish(topic.c_str(), bytes, numBytes, false);
-
-#if !defined(ARCH_NRF52) ||                                                                                                      \
-    defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-        if (!moduleConfig.mqtt.json_enabled)
-            return;
-        // handle json topic
-        auto jsonString = MeshPacketSerializer::JsonSerialize(&mp_decoded);
-        if (jsonString.length() == 0)
-            return;
-        // Generate node ID from nodenum for JSON topic
-        std::string nodeIdForJson = nodeDB->getNodeId();
-        std::string topicJson = jsonTopic + channelId + "/" + nodeIdForJson;
-        LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-        publish(topicJson.c_str(), jsonString.c_str(), false);
-#endif // ARCH_NRF52 NRF52_USE_JSON
-    } else {
+        size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, &env);
+        LOG_DEBUG("MQTT Publish %s, %u bytes", topic, numBytes);
+        publish(topic, bytes, numBytes, false);
+        publishJson(&mp_decoded, topicIndex, channelId);
+    } else if (mqttQueue) {
         LOG_INFO("MQTT not connected, queue packet");
-        QueueEntry *entry;
-        if (mqttQueue.numFree() == 0) {
-            LOG_WARN("MQTT queue is full, discard oldest");
-            entry = mqttQueue.dequeuePtr(0);
-        } else {
-            entry = new QueueEntry;
-        }
-        entry->topic = std::move(topic);
-        entry->envBytes.assign(bytes, numBytes);
-        if (mqttQueue.enqueue(entry, 0) == false) {
-            LOG_CRIT("Failed to add a message to mqttQueue!");
-            abort();
+        // Encode straight into the queue, then publish from there once connected
+        QueueEntry &entry = reserveQueueEntry();
+        entry.envLength = pb_encode_to_bytes(entry.envBytes, sizeof(entry.envBytes), &meshtastic_ServiceEnvelope_msg, &env);
+        if (entry.envLength == 0) {
+            LOG_ERROR("Failed to encode MQTT service envelope");
+            return;
         }
+        strcpy(entry.topic, topic);
+        entry.topicIndex = topicIndex;
+        entry.queuedAtMs = millis();
+        queueStats.queued++;
+        queueStats.depth++;
+        queueStats.highWater = std::max(queueStats.highWater, queueStats.depth);
     }
 }
 
@@ -21,11 +21,22 @@
 
 #if HAS_NETWORKING
 #include <PubSubClient.h>
-#include <memory>
 #endif
+#include <memory>
 
 #define MAX_MQTT_QUEUE 16
 
+/// Room for one encoded ServiceEnvelope, same as the buffer messages are encoded into before publishing directly
+#define MQTT_ENVELOPE_MAX_BYTES (meshtastic_MqttClientProxyMessage_size + 30) // 12 for channel name and 16 for nodeid
+
+/// Room for a topic: a root of up to 31 characters, "/2/json/", the channel id and "/!12345678"
+#define MQTT_TOPIC_MAX_LEN 80
+
+/// How many queued messages are published per run of the thread once connected
+#ifndef MQTT_PUBLISH_BATCH
+#define MQTT_PUBLISH_BATCH 4
+#endif
+
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
  * the two components that use it: MQTTPlugin and MQTTSimInterface.
@@ -61,15 +72,42 @@ class MQTT : private concurrency::OSThread
     bool isUsingDefaultServer() { return isConfiguredForDefaultServer; }
     bool isUsingDefaultRootTopic() { return isConfiguredForDefaultRootTopic; }
 
+    /// How the queue of messages waiting for a connection is doing
+    struct QueueStats {
+        uint8_t depth;      // messages waiting now
+        uint8_t highWater;  // most messages ever waiting at once
+        uint32_t queued;    // messages ever queued
+        uint32_t dropped;   // oldest messages discarded because the queue was full
+        uint32_t maxWaitMs; // longest time a published message waited in the queue
+    };
+    const QueueStats &getQueueStats() const { return queueStats; }
+
     /// Validate the meshtastic_ModuleConfig_MQTTConfig.
     static bool isValidConfig(const meshtastic_ModuleConfig_MQTTConfig &config) { return isValidConfig(config, nullptr); }
 
   protected:
+    /// A message waiting for a connection, the envelope encoded straight into it
     struct QueueEntry {
-        std::string topic;
-        std::basic_string<uint8_t> envBytes; // binary/pb_encode_to_bytes ServiceEnvelope
+        uint32_t queuedAtMs;
+        uint16_t envLength;
+        uint8_t topicIndex; // channel index the message was sent on, or MAX_NUM_CHANNELS for PKI
+        char topic[MQTT_TOPIC_MAX_LEN];
+        uint8_t envBytes[MQTT_ENVELOPE_MAX_BYTES]; // binary/pb_encode_to_bytes ServiceEnvelope
+    };
+
+    /// Ring of MAX_MQTT_QUEUE entries, allocated once when MQTT is enabled
+    std::unique_ptr<QueueEntry[]> mqttQueue;
+    uint8_t queueHead = 0;
+    QueueStats queueStats = {};
+
+    /// A topic for each channel and one for PKI, rebuilt only when the channel id or our node number changes
+    struct ChannelTopic {
+        char topic[MQTT_TOPIC_MAX_LEN];
+        uint8_t channelIdLength = UINT8_MAX;
+        NodeNum nodeNum = 0;
     };
-    PointerQueue<QueueEntry> mqttQueue;
+    ChannelTopic cryptTopics[MAX_NUM_CHANNELS + 1];
+    ChannelTopic jsonTopics[MAX_NUM_CHANNELS + 1];
 
     int reconnectCount = 0;
     bool isConfiguredForDefaultServer = true;
@@ -104,6 +142,7 @@ class MQTT : private concurrency::OSThread
     std::string cryptTopic = "/2/e/";   // msh/2/e/CHANNELID/NODEID
     std::string jsonTopic = "/2/json/"; // msh/2/json/CHANNELID/NODEID
     std::string mapTopic = "/2/map/";   // For protobuf-encoded MapReport messages
+    std::string jsonScratch;            // JSON of the packet being published, kept so its memory is reused
 
     // For map reporting (only applies when enabled)
     const uint32_t default_map_position_precision = 14; // defaults to max. offset of ~1459m
@@ -127,8 +166,18 @@ class MQTT : private concurrency::OSThread
     /// Called when a new publish arrives from the MQTT server
     void onReceive(char *topic, byte *payload, size_t length);
 
+    /// Publish up to MQTT_PUBLISH_BATCH queued messages, oldest first
     void publishQueuedMessages();
 
+    /// Publish the JSON version of a message, if JSON is enabled
+    void publishJson(const meshtastic_MeshPacket *p, uint8_t topicIndex, const char *channelId);
+
+    /// prefix + channelId + "/" + our node id, from the cache slot for topicIndex
+    static const char *channelTopic(ChannelTopic *topics, uint8_t topicIndex, const std::string &prefix, const char *channelId);
+
+    /// The entry to encode the next message into, discarding the oldest one if the queue is full
+    QueueEntry &reserveQueueEntry();
+
     void publishNodeInfo();
 
     // Check if we should report unencrypted information about our node for consumption by a map
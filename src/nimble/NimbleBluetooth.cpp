@@ -658,6 +658,8 @@ class NimbleBluetoothServerCallback : public NimBLEServerCallbacks
     virtual void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo)
     {
         LOG_INFO("BLE incoming connection %s", connInfo.getAddress().toString().c_str());
+        if (bluetoothPhoneAPI)
+            bluetoothPhoneAPI->setClientAddress(connInfo.getIdAddress().getVal(), 6);
 
         const uint16_t connHandle = connInfo.getConnHandle();
 #if NIMBLE_ENABLE_2M_PHY && (defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32C6))
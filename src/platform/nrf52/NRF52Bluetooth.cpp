@@ -65,6 +65,10 @@ void onConnect(uint16_t conn_handle)
     char central_name[32] = {0};
     connection->getPeerName(central_name, sizeof(central_name));
     LOG_INFO("BLE Connected to %s", central_name);
+    if (bluetoothPhoneAPI) {
+        ble_gap_addr_t peer = connection->getPeerAddr();
+        bluetoothPhoneAPI->setClientAddress(peer.addr, sizeof(peer.addr));
+    }
 
     // Notify UI (or any other interested firmware components)
     meshtastic::BluetoothStatus newStatus(meshtastic::BluetoothStatus::ConnectionState::CONNECTED);
@@ -0,0 +1,214 @@
+#include "configuration.h"
+
+#if HAS_OPENSSL_CRYPTO_ENGINE
+#include "CryptoEngine.h"
+
+#include <openssl/evp.h>
+#if !(MESHTASTIC_EXCLUDE_PKI)
+#include <Curve25519.h>
+#endif
+
+/**
+ * CryptoEngine on top of the system OpenSSL, which uses AES-NI / ARMv8 crypto extensions and optimized X25519 and SHA256 where
+ * the CPU has them. Output is bit-identical to the generic engine: anything OpenSSL might handle differently is left to it, and
+ * create() only picks this engine if a self-test against the generic one passes.
+ */
+class OpenSSLCryptoEngine : public CryptoEngine
+{
+  public:
+    ~OpenSSLCryptoEngine()
+    {
+        for (auto &slot : ctr)
+            EVP_CIPHER_CTX_free(slot.ctx);
+#if !(MESHTASTIC_EXCLUDE_PKI)
+        EVP_CIPHER_CTX_free(ecb);
+        EVP_PKEY_free(privateKey);
+#endif
+    }
+
+    /** This engine if OpenSSL works and agrees with the generic engine, else the generic engine */
+    static CryptoEngine *create()
+    {
+        OpenSSLCryptoEngine *engine = new OpenSSLCryptoEngine();
+        if (engine->matchesReference())
+            return engine;
+        delete engine;
+        return new CryptoEngine();
+    }
+
+    virtual const char *getName() const override { return "OpenSSL"; }
+
+    virtual void encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes) override
+    {
+        // OpenSSL carries into the whole 128 bit counter, the generic engine only into its last 4 bytes. That only matters for
+        // nonces just below the wrap.
+        uint32_t counter = ((uint32_t)_nonce[12] << 24) | ((uint32_t)_nonce[13] << 16) | ((uint32_t)_nonce[14] << 8) | _nonce[15];
+        uint32_t blocks = (numBytes + 15) / 16;
+        if ((_key.length != 16 && _key.length != 32) || (blocks && counter > UINT32_MAX - (blocks - 1))) {
+            CryptoEngine::encryptAESCtr(_key, _nonce, numBytes, bytes);
+            return;
+        }
+
+        // One context per key size, only expanding the key schedule again when the key changes
+        CtrContext &slot = ctr[_key.length == 16 ? 0 : 1];
+        bool rekey = slot.key.length != _key.length || memcmp(slot.key.bytes, _key.bytes, _key.length) != 0;
+        const EVP_CIPHER *cipher = _key.length == 16 ? EVP_aes_128_ctr() : EVP_aes_256_ctr();
+        int outLen;
+        if (!slot.ctx || !EVP_EncryptInit_ex(slot.ctx, rekey ? cipher : nullptr, nullptr, rekey ? _key.bytes : nullptr, _nonce) ||
+            !EVP_EncryptUpdate(slot.ctx, bytes, &outLen, bytes, numBytes)) {
+            LOG_ERROR("OpenSSL AES-CTR failed!");
+            slot.key.length = 0;
+            return;
+        }
+        if (rekey)
+            slot.key = _key;
+    }
+
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    virtual bool setDHPublicKey(uint8_t *pubKey) override
+    {
+        // Low order points and encodings that are not reduced are left to Curve25519::dh2(), so they fail (or don't) the same
+        if (!isReducedPoint(pubKey) || Curve25519::isWeakPoint(pubKey))
+            return CryptoEngine::setDHPublicKey(pubKey);
+
+        EVP_PKEY *peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, pubKey, 32);
+        EVP_PKEY *priv = getPrivateKey();
+        EVP_PKEY_CTX *ctx = (peer && priv) ? EVP_PKEY_CTX_new(priv, nullptr) : nullptr;
+        size_t len = sizeof(shared_key);
+        bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_derive_set_peer(ctx, peer) > 0 &&
+                  EVP_PKEY_derive(ctx, shared_key, &len) > 0 && len == sizeof(shared_key);
+        EVP_PKEY_CTX_free(ctx);
+        EVP_PKEY_free(peer);
+        if (!ok)
+            return CryptoEngine::setDHPublicKey(pubKey);
+        return true;
+    }
+
+    virtual void hash(uint8_t *bytes, size_t numBytes) override
+    {
+        // The generic engine only ever hashes the first 255 bytes
+        unsigned int len;
+        if (!EVP_Digest(bytes, (uint8_t)numBytes, bytes, &len, EVP_sha256(), nullptr))
+            CryptoEngine::hash(bytes, numBytes);
+    }
+
+    // AES-CCM (aes-ccm.cpp) encrypts block by block through these, so only the block cipher changes
+    virtual void aesSetKey(const uint8_t *key_bytes, size_t key_len) override
+    {
+        ecbKeyed = key_len == 32 && ecb && EVP_EncryptInit_ex(ecb, EVP_aes_256_ecb(), nullptr, key_bytes, nullptr) &&
+                   EVP_CIPHER_CTX_set_padding(ecb, 0);
+        if (!ecbKeyed)
+            CryptoEngine::aesSetKey(key_bytes, key_len);
+    }
+
+    virtual void aesEncrypt(uint8_t *in, uint8_t *out) override
+    {
+        int outLen;
+        if (!ecbKeyed || !EVP_EncryptUpdate(ecb, out, &outLen, in, 16))
+            CryptoEngine::aesEncrypt(in, out);
+    }
+#endif
+
+  private:
+    struct CtrContext {
+        EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+        CryptoKey key = {}; // What ctx is keyed with, length 0 if nothing yet
+    };
+    CtrContext ctr[2]; // AES128, AES256
+
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    EVP_CIPHER_CTX *ecb = EVP_CIPHER_CTX_new();
+    bool ecbKeyed = false;
+
+    EVP_PKEY *privateKey = nullptr;
+    uint8_t privateKeyBytes[32] = {0}; // What privateKey was made from
+
+    /// Less than 2^255 - 19, with the top bit clear
+    static bool isReducedPoint(const uint8_t *x)
+    {
+        if (x[31] != 0x7f)
+            return x[31] < 0x7f;
+        for (int i = 30; i >= 1; i--)
+            if (x[i] != 0xff)
+                return true;
+        return x[0] < 0xed;
+    }
+
+    /// Our private key as an OpenSSL key, made again only when it changed
+    EVP_PKEY *getPrivateKey()
+    {
+        if (privateKey && memcmp(privateKeyBytes, private_key, sizeof(private_key)) == 0)
+            return privateKey;
+        EVP_PKEY_free(privateKey);
+        privateKey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, private_key, sizeof(private_key));
+        memcpy(privateKeyBytes, private_key, sizeof(private_key));
+        return privateKey;
+    }
+
+    /// The generic engine, with the derived key visible for comparing
+    class ReferenceEngine : public CryptoEngine
+    {
+      public:
+        using CryptoEngine::shared_key;
+    };
+#else
+    using ReferenceEngine = CryptoEngine;
+#endif
+
+    /** Run every primitive on fixed inputs through both engines. Runs before logging is up, so nothing here may log. */
+    bool matchesReference()
+    {
+        std::unique_ptr<ReferenceEngine> reference(new ReferenceEngine());
+
+        for (int8_t keyLength = 16; keyLength <= 32; keyLength += 16) {
+            CryptoKey k = {};
+            k.length = keyLength;
+            uint8_t expected[MAX_BLOCKSIZE], actual[MAX_BLOCKSIZE], nonce[16];
+            for (int i = 0; i < MAX_BLOCKSIZE; i++) {
+                expected[i] = actual[i] = i * 13 + 7;
+                if (i < keyLength)
+                    k.bytes[i] = i * 29 + keyLength;
+                if (i < 16)
+                    nonce[i] = i * 41 + 3;
+            }
+            nonce[12] = nonce[13] = nonce[14] = nonce[15] = 0;
+            reference->encryptAESCtr(k, nonce, 203, expected);
+            encryptAESCtr(k, nonce, 203, actual);
+            if (memcmp(expected, actual, sizeof(actual)) != 0)
+                return false;
+        }
+
+#if !(MESHTASTIC_EXCLUDE_PKI)
+        uint8_t privKey[32], pubKey[32] = {9}; // The base point
+        for (int i = 0; i < 32; i++)
+            privKey[i] = i * 7 + 1;
+        reference->setDHPrivateKey(privKey);
+        setDHPrivateKey(privKey);
+        if (!reference->setDHPublicKey(pubKey) || !setDHPublicKey(pubKey))
+            return false;
+        reference->hash(reference->shared_key, 32);
+        hash(shared_key, 32);
+        if (memcmp(reference->shared_key, shared_key, sizeof(shared_key)) != 0)
+            return false;
+
+        uint8_t expected[16], actual[16];
+        reference->aesSetKey(shared_key, 32);
+        reference->aesEncrypt(privKey, expected);
+        aesSetKey(shared_key, 32);
+        if (!ecbKeyed)
+            return false;
+        aesEncrypt(privKey, actual);
+        if (memcmp(expected, actual, sizeof(actual)) != 0)
+            return false;
+
+        // Start out like a fresh engine
+        memset(private_key, 0, sizeof(private_key));
+        memset(shared_key, 0, sizeof(shared_key));
+        clearSharedKeyCache();
+#endif
+        return ctr[0].ctx && ctr[1].ctx;
+    }
+};
+
+CryptoEngine *crypto = OpenSSLCryptoEngine::create();
+#endif
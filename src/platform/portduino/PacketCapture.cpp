@@ -0,0 +1,202 @@
+#include "PacketCapture.h"
+#include "configuration.h"
+#include "serialization/MeshPacketSerializer.h"
+#include <chrono>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+PacketCapture *packetCapture;
+
+struct __attribute__((packed)) PcapFileHeader {
+    uint32_t magic;
+    uint16_t versionMajor, versionMinor;
+    int32_t thiszone;
+    uint32_t sigfigs, snaplen, linktype;
+};
+
+struct __attribute__((packed)) PcapRecordHeader {
+    uint32_t tsSec, tsUsec, inclLen, origLen;
+};
+
+struct __attribute__((packed)) CaptureMetadata {
+    uint8_t version;
+    uint8_t result;
+    int16_t rssi;
+    float snr;
+};
+
+static uint64_t steadyMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void PacketCapture::begin(const Options &options)
+{
+    end();
+    this->options = options;
+    running = true;
+    writer = std::thread(&PacketCapture::writerLoop, this);
+}
+
+void PacketCapture::end()
+{
+    if (!running)
+        return;
+    running = false;
+    writer.join();
+}
+
+void PacketCapture::beginFrame(const RxFrame &frame)
+{
+    if (!wantsFrames())
+        return;
+    pendingFrame = frames.beginWrite();
+    if (!pendingFrame)
+        return;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    pendingFrame->timeUs = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    pendingFrame->rssi = frame.rssi;
+    pendingFrame->snr = frame.snr;
+    pendingFrame->length = frame.length;
+    pendingFrame->result = CaptureResult::NOT_HANDLED;
+    memcpy(&pendingFrame->buffer, &frame.buffer, frame.length);
+}
+
+void PacketCapture::setFrameResult(CaptureResult result)
+{
+    // Only the first, a packet sent in reply while handling the frame isn't what became of it
+    if (pendingFrame && pendingFrame->result == CaptureResult::NOT_HANDLED)
+        pendingFrame->result = result;
+}
+
+void PacketCapture::endFrame()
+{
+    if (!pendingFrame)
+        return;
+    pendingFrame = nullptr;
+    frames.commitWrite();
+}
+
+void PacketCapture::captureJson(const meshtastic_MeshPacket *p)
+{
+    if (options.jsonPath.empty())
+        return;
+    if (options.jsonFilter != meshtastic_PortNum_UNKNOWN_APP && options.jsonFilter != p->decoded.portnum)
+        return;
+    CapturedJson *line = json.beginWrite();
+    if (!line)
+        return;
+    size_t length = MeshPacketSerializer::JsonSerialize(p, line->text, sizeof(line->text), false);
+    if (length >= sizeof(line->text)) {
+        jsonTooLong++;
+        return;
+    }
+    line->length = length;
+    json.commitWrite();
+}
+
+void PacketCapture::writerLoop()
+{
+    Output pcap, jsonOut;
+    pcap.basePath = options.pcapPath;
+    pcap.isPcap = true;
+    jsonOut.basePath = options.jsonPath;
+
+    while (running) {
+        if (!drain(pcap, jsonOut))
+            std::this_thread::sleep_for(std::chrono::milliseconds(PACKET_CAPTURE_IDLE_MS));
+    }
+    // The producers are done by now, don't lose what they left
+    drain(pcap, jsonOut);
+}
+
+bool PacketCapture::drain(Output &pcap, Output &jsonOut)
+{
+    bool wrote = false;
+
+    for (const CapturedFrame *frame; (frame = frames.peek()) != nullptr; frames.pop()) {
+        if (!prepare(pcap))
+            continue;
+        const PcapRecordHeader record = {(uint32_t)(frame->timeUs / 1000000), (uint32_t)(frame->timeUs % 1000000),
+                                         (uint32_t)(sizeof(CaptureMetadata) + frame->length),
+                                         (uint32_t)(sizeof(CaptureMetadata) + frame->length)};
+        const CaptureMetadata metadata = {1, (uint8_t)frame->result, (int16_t)frame->rssi, frame->snr};
+        pcap.file.write((const char *)&record, sizeof(record));
+        pcap.file.write((const char *)&metadata, sizeof(metadata));
+        pcap.file.write((const char *)&frame->buffer, frame->length);
+        pcap.bytes += sizeof(record) + sizeof(metadata) + frame->length;
+        wrote = true;
+    }
+
+    for (const CapturedJson *line; (line = json.peek()) != nullptr; json.pop()) {
+        if (!prepare(jsonOut))
+            continue;
+        jsonOut.file.write(line->text, line->length);
+        jsonOut.file.put('\n');
+        jsonOut.bytes += line->length + 1;
+        wrote = true;
+    }
+
+    // Once per batch rather than per line
+    if (wrote) {
+        if (pcap.file.is_open())
+            pcap.file.flush();
+        if (jsonOut.file.is_open())
+            jsonOut.file.flush();
+    }
+    return wrote;
+}
+
+bool PacketCapture::prepare(Output &out)
+{
+    const uint64_t now = steadyMs();
+    if (!out.file.is_open()) {
+        // Only try again once in a while if it couldn't be opened
+        if (out.failed && now - out.openedAtMs < PACKET_CAPTURE_RETRY_MS)
+            return false;
+    } else {
+        // Several files within a second would all get the same name
+        bool due = now - out.openedAtMs >= 1000 &&
+                   ((options.rotateMinutes && now - out.openedAtMs >= options.rotateMinutes * 60 * 1000ULL) ||
+                    (options.rotateBytes && out.bytes >= options.rotateBytes));
+        if (!due)
+            return true;
+        out.file.close();
+    }
+
+    std::string path = out.basePath;
+    if (options.rotateMinutes || options.rotateBytes) {
+        time_t timestamp = time(NULL);
+        struct tm timeinfo;
+        char buffer[80];
+        localtime_r(&timestamp, &timeinfo);
+        strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &timeinfo);
+        path += "_" + std::string(buffer);
+    }
+
+    out.file.clear();
+    out.file.open(path, std::ios::out | std::ios::app | std::ios::ate | std::ios::binary);
+    out.openedAtMs = now;
+    if (!out.file.is_open()) {
+        if (!out.failed)
+            LOG_ERROR("Can't open capture file %s", path.c_str());
+        out.failed = true;
+        return false;
+    }
+    out.failed = false;
+    out.bytes = out.file.tellp();
+    filesOpened++;
+
+    // Appending to a capture file that already has its header
+    if (out.isPcap && out.bytes == 0) {
+        const PcapFileHeader header = {0xa1b2c3d4, 2, 4, 0, 0, sizeof(CapturedFrame::buffer) + sizeof(CaptureMetadata),
+                                       PACKET_CAPTURE_LINKTYPE};
+        out.file.write((const char *)&header, sizeof(header));
+        out.bytes = sizeof(header);
+    }
+    return true;
+}
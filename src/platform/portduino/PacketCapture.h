@@ -0,0 +1,179 @@
+#pragma once
+
+#include "RxFrameRing.h"
+#include "mesh/generated/meshtastic/mesh.pb.h"
+#include <atomic>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+/// Captured frames and JSON lines the writer may fall behind by, each must be a power of two
+#ifndef PACKET_CAPTURE_FRAMES
+#define PACKET_CAPTURE_FRAMES 256
+#endif
+#ifndef PACKET_CAPTURE_JSON_LINES
+#define PACKET_CAPTURE_JSON_LINES 64
+#endif
+/// Longest JSON line kept, longer ones are dropped and counted
+#define PACKET_CAPTURE_JSON_SIZE 2048
+/// How long the writer sleeps once it has caught up
+#define PACKET_CAPTURE_IDLE_MS 50
+/// How long the writer waits before trying to open a file again that it couldn't open
+#define PACKET_CAPTURE_RETRY_MS 10000
+
+/// pcap link type of the capture file: one of the LINKTYPE_USERn types, which are free for private use
+#define PACKET_CAPTURE_LINKTYPE 147
+
+/// What became of a captured frame, the second byte of each pcap record
+enum class CaptureResult : uint8_t {
+    NOT_HANDLED = 0, // Dropped before decoding: a duplicate, from an ignored node, or filtered
+    DECODED = 1,
+    UNDECODABLE = 2, // No channel or key we have could decrypt it
+    FATAL = 3,       // Malformed
+    RELAYED = 4,     // Nobody here can read it, relayed without trying to decode it
+};
+
+/**
+ * A LoRa frame as received, with what became of it. In the pcap file each record is this 8 byte little endian header, then
+ * the frame itself (PacketHeader, then the encrypted payload):
+ *
+ *   uint8_t version (1), uint8_t result (CaptureResult), int16_t rssi, float snr
+ */
+struct CapturedFrame {
+    uint64_t timeUs; // Wall clock, since the epoch
+    int32_t rssi;
+    float snr;
+    uint16_t length;
+    CaptureResult result;
+    RadioBuffer buffer;
+};
+
+struct CapturedJson {
+    uint16_t length;
+    char text[PACKET_CAPTURE_JSON_SIZE];
+};
+
+/**
+ * Single producer, single consumer ring of fixed size slots. The producer fills the slot from beginWrite() in place and hands it
+ * over with commitWrite(), if the ring is full it drops the new item rather than wait.
+ */
+template <typename T, uint32_t SIZE> class CaptureRing
+{
+    static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "The size of a CaptureRing must be a power of two");
+
+  public:
+    /// Producer: the slot for the next item, or nullptr (counted as an overflow) if the ring is full
+    T *beginWrite()
+    {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == SIZE) {
+            overflows++;
+            return nullptr;
+        }
+        return &items[t % SIZE];
+    }
+
+    /// Producer: hand the item filled in since beginWrite() to the consumer
+    void commitWrite() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /// Consumer: the oldest item, or nullptr if there is none
+    const T *peek() const
+    {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &items[h % SIZE];
+    }
+
+    /// Consumer: done with the item from peek(), its slot may be reused
+    void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /// Items dropped because the ring was full
+    uint32_t getOverflows() const { return overflows; }
+
+  private:
+    T items[SIZE];
+
+    // Free running, the difference is the number of items waiting. Only the consumer moves head, only the producer tail.
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+
+    std::atomic<uint32_t> overflows{0};
+};
+
+/**
+ * @brief Received frames and packet JSON written to files in the background
+ *
+ * The Router only copies into memory: raw LoRa frames with their RSSI, SNR, arrival time and what became of them go into one
+ * ring, the JSON of decoded packets into another. A thread of its own drains both into a pcap file and a JSON lines file,
+ * flushing once per batch, and starts new files after a while or once they get big. If the disk can't keep up, captures are
+ * dropped and counted, the Router never waits for it.
+ *
+ * Frames come only from the Router thread. JSON lines come from perhapsDecode(), which holds cryptLock, so there is only ever
+ * one producer for each ring.
+ */
+class PacketCapture
+{
+  public:
+    /// Where and how to write, an empty path leaves that file out
+    struct Options {
+        std::string pcapPath;
+        std::string jsonPath;
+        meshtastic_PortNum jsonFilter = meshtastic_PortNum_UNKNOWN_APP; // Only packets of this portnum, UNKNOWN_APP for all
+        uint32_t rotateMinutes = 0; // Start a new file this often, named with the time it was started. 0 to keep one file
+        uint64_t rotateBytes = 0;   // Start a new file once one is this big, named the same way. 0 for no limit
+    };
+
+    ~PacketCapture() { end(); }
+
+    /// Start the writer thread. The files are opened by it, failures are logged there.
+    void begin(const Options &options);
+    /// Write out what is still waiting and stop the writer
+    void end();
+
+    /// Router thread: capture frame, committed by endFrame() once the frame was handled
+    void beginFrame(const RxFrame &frame);
+    /// What became of the frame from beginFrame(), while it is being handled
+    void setFrameResult(CaptureResult result);
+    void endFrame();
+
+    /// Capture the JSON of a packet perhapsDecode() just decoded
+    void captureJson(const meshtastic_MeshPacket *p);
+
+    bool wantsFrames() const { return !options.pcapPath.empty(); }
+
+    uint32_t getDroppedFrames() const { return frames.getOverflows(); }
+    uint32_t getDroppedJson() const { return json.getOverflows() + jsonTooLong; }
+    uint32_t getFilesOpened() const { return filesOpened; }
+
+  private:
+    /// One of the output files, only touched by the writer thread
+    struct Output {
+        std::string basePath;
+        std::ofstream file;
+        uint64_t bytes = 0;
+        uint64_t openedAtMs = 0; // Or when opening it last failed
+        bool failed = false;
+        bool isPcap = false;
+    };
+
+    Options options;
+    CaptureRing<CapturedFrame, PACKET_CAPTURE_FRAMES> frames;
+    CaptureRing<CapturedJson, PACKET_CAPTURE_JSON_LINES> json;
+    CapturedFrame *pendingFrame = nullptr;
+    std::atomic<uint32_t> jsonTooLong{0};
+    std::atomic<uint32_t> filesOpened{0};
+
+    std::thread writer;
+    std::atomic<bool> running{false};
+
+    void writerLoop();
+    /// Write out everything waiting, @return whether there was anything
+    bool drain(Output &pcap, Output &jsonOut);
+    /// Open the file to write to next, if there is none yet or it is due for rotation
+    bool prepare(Output &out);
+};
+
+/// nullptr unless a capture file is configured
+extern PacketCapture *packetCapture;
@@ -6,6 +6,7 @@
 #include "sleep.h"
 #include "target_specific.h"
 
+#include "PacketCapture.h"
 #include "PortduinoGlue.h"
 #include "SHA256.h"
 #include "api/ServerAPI.h"
@@ -38,7 +39,6 @@
 portduino_config_struct portduino_config;
 portduino_status_struct portduino_status;
 std::ofstream traceFile;
-std::ofstream JSONFile;
 Ch341Hal *ch341Hal = nullptr;
 char *configPath = nullptr;
 char *optionMac = nullptr;
@@ -239,6 +239,8 @@ void portduinoSetup()
         exit(EXIT_SUCCESS);
     }
 
+    std::cout << "Using " << crypto->getName() << " crypto engine" << std::endl;
+
     if (portduino_config.force_simradio) {
         std::cout << "Running in simulated mode." << std::endl;
         portduino_config.MaxNodes = 200; // Default to 200 nodes
@@ -649,19 +651,17 @@ void portduinoSetup()
             std::cout << "*** traceFile open failure" << std::endl;
             exit(EXIT_FAILURE);
         }
-    } else if (portduino_config.JSONFilename != "") {
-        try {
-            if (portduino_config.JSONFileRotate == 0) {
-                JSONFile.open(portduino_config.JSONFilename, std::ios::out | std::ios::app);
-            }
-        } catch (std::ofstream::failure &e) {
-            std::cout << "*** JSONFile Exception " << e.what() << std::endl;
-            exit(EXIT_FAILURE);
-        }
-        if (!JSONFile.is_open()) {
-            std::cout << "*** JSONFile open failure" << std::endl;
-            exit(EXIT_FAILURE);
-        }
+    }
+    // The JSON file is left out while packets are traced instead
+    PacketCapture::Options capture;
+    capture.pcapPath = portduino_config.pcapFilename;
+    capture.jsonPath = portduino_config.traceFilename == "" ? portduino_config.JSONFilename : "";
+    capture.jsonFilter = portduino_config.JSONFilter;
+    capture.rotateMinutes = portduino_config.JSONFileRotate;
+    capture.rotateBytes = (uint64_t)portduino_config.captureFileMaxSize * 1024 * 1024;
+    if (capture.pcapPath != "" || capture.jsonPath != "") {
+        packetCapture = new PacketCapture();
+        packetCapture->begin(capture);
     }
     if (verboseEnabled && portduino_config.logoutputlevel != level_trace) {
         portduino_config.logoutputlevel = level_debug;
@@ -734,6 +734,8 @@ bool loadConfig(const char *configPath)
                 portduino_config.JSONFilter = meshtastic_PortNum_PAXCOUNTER_APP;
             else if (yamlConfig["Logging"]["JSONFilter"].as<std::string>("") == "remotehardware")
                 portduino_config.JSONFilter = meshtastic_PortNum_REMOTE_HARDWARE_APP;
+            portduino_config.pcapFilename = yamlConfig["Logging"]["PcapFile"].as<std::string>("");
+            portduino_config.captureFileMaxSize = yamlConfig["Logging"]["CaptureFileMaxSize"].as<int>(0);
 
             if (yamlConfig["Logging"]["AsciiLogs"]) {
                 // Default is !isatty(1) but can be set explicitly in config.yaml
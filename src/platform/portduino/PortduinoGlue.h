@@ -56,7 +56,6 @@ struct pinMapping {
 };
 
 extern std::ofstream traceFile;
-extern std::ofstream JSONFile;
 
 extern Ch341Hal *ch341Hal;
 int initGPIOPin(int pinNum, const std::string &gpioChipname, int line);
@@ -167,6 +166,8 @@ extern struct portduino_config_struct {
     std::string JSONFilename;
     int JSONFileRotate = 0;
     meshtastic_PortNum JSONFilter = (_meshtastic_PortNum)0;
+    std::string pcapFilename;
+    int captureFileMaxSize = 0; // MB
 
     // Webserver
     std::string webserver_root_path = "";
@@ -497,6 +498,10 @@ extern struct portduino_config_struct {
             else if (JSONFilter == meshtastic_PortNum_REMOTE_HARDWARE_APP)
                 out << YAML::Key << "JSONFilter" << YAML::Value << "remotehardware";
         }
+        if (pcapFilename != "")
+            out << YAML::Key << "PcapFile" << YAML::Value << pcapFilename;
+        if (captureFileMaxSize != 0)
+            out << YAML::Key << "CaptureFileMaxSize" << YAML::Value << captureFileMaxSize;
         if (ascii_logs_explicit) {
             out << YAML::Key << "AsciiLogs" << YAML::Value << ascii_logs;
         }
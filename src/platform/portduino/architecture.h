@@ -30,4 +30,9 @@
 #define TB_LEFT (uint8_t) portduino_config.tbLeftPin.pin
 #define TB_RIGHT (uint8_t) portduino_config.tbRightPin.pin
 #define TB_PRESS (uint8_t) portduino_config.tbPressPin.pin
-#endif
\ No newline at end of file
+#endif
+// Use OpenSSL's AES (AES-NI / ARMv8 crypto extensions), X25519 and SHA256 when its headers are installed
+#if !defined(HAS_CUSTOM_CRYPTO_ENGINE) && !MESHTASTIC_EXCLUDE_OPENSSL_CRYPTO && __has_include(<openssl/evp.h>)
+#define HAS_CUSTOM_CRYPTO_ENGINE 1
+#define HAS_OPENSSL_CRYPTO_ENGINE 1
+#endif
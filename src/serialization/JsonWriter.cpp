@@ -0,0 +1,167 @@
+#include "JsonWriter.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+JsonWriter::JsonWriter(char *buf, size_t size) : buf(buf), size(size)
+{
+    if (size > 0)
+        buf[0] = 0;
+}
+
+void JsonWriter::put(const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        put(s[i]);
+}
+
+void JsonWriter::separate()
+{
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (hasMembers & (1u << depth))
+        put(',');
+    hasMembers |= 1u << depth;
+}
+
+void JsonWriter::beginObject()
+{
+    separate();
+    put('{');
+    assert(depth < MAX_DEPTH);
+    depth++;
+    hasMembers &= ~(1u << depth);
+}
+
+void JsonWriter::endObject()
+{
+    depth--;
+    put('}');
+}
+
+void JsonWriter::beginArray()
+{
+    separate();
+    put('[');
+    assert(depth < MAX_DEPTH);
+    depth++;
+    hasMembers &= ~(1u << depth);
+}
+
+void JsonWriter::endArray()
+{
+    depth--;
+    put(']');
+}
+
+JsonWriter &JsonWriter::key(const char *name)
+{
+    string(name);
+    put(':');
+    afterKey = true;
+    return *this;
+}
+
+// Same escaping as JSONValue::StringifyString(), including what it does with bytes >= 0x80 where char is signed
+void JsonWriter::string(const char *s, size_t maxLen)
+{
+    separate();
+    put('"');
+
+    size_t n = 0;
+    while (n < maxLen && s[n])
+        n++;
+
+    for (size_t i = 0; i < n; i++) {
+        char chr = s[i];
+
+        if (chr == '"' || chr == '\\' || chr == '/') {
+            put('\\');
+            put(chr);
+        } else if (chr == '\b') {
+            put("\\b", 2);
+        } else if (chr == '\f') {
+            put("\\f", 2);
+        } else if (chr == '\n') {
+            put("\\n", 2);
+        } else if (chr == '\r') {
+            put("\\r", 2);
+        } else if (chr == '\t') {
+            put("\\t", 2);
+        } else if (chr < 0x20 || chr == 0x7F) {
+            char escaped[7];
+            int escapedLen = snprintf(escaped, sizeof(escaped), "\\u%04x", chr);
+            put(escaped, escapedLen < (int)sizeof(escaped) ? escapedLen : sizeof(escaped) - 1);
+        } else if (chr < 0x80) {
+            put(chr);
+        } else {
+            put(chr);
+            size_t remain = n - i - 1;
+            if ((chr & 0xE0) == 0xC0 && remain >= 1) {
+                put(s[++i]);
+            } else if ((chr & 0xF0) == 0xE0 && remain >= 2) {
+                put(s[++i]);
+                put(s[++i]);
+            } else if ((chr & 0xF8) == 0xF0 && remain >= 3) {
+                put(s[++i]);
+                put(s[++i]);
+                put(s[++i]);
+            }
+        }
+    }
+
+    put('"');
+}
+
+void JsonWriter::number(double value)
+{
+    separate();
+    if (isinf(value) || isnan(value)) {
+        put("null", 4);
+        return;
+    }
+    // What a std::stringstream with precision(15) makes of it
+    char formatted[32];
+    int n = snprintf(formatted, sizeof(formatted), "%.15g", value);
+    put(formatted, n);
+}
+
+void JsonWriter::number(int value)
+{
+    separate();
+    char formatted[12];
+    int n = snprintf(formatted, sizeof(formatted), "%d", value);
+    put(formatted, n);
+}
+
+void JsonWriter::number(unsigned int value)
+{
+    separate();
+    char formatted[12];
+    int n = snprintf(formatted, sizeof(formatted), "%u", value);
+    put(formatted, n);
+}
+
+void JsonWriter::boolean(bool value)
+{
+    separate();
+    if (value)
+        put("true", 4);
+    else
+        put("false", 5);
+}
+
+void JsonWriter::raw(const char *json, size_t len)
+{
+    separate();
+    put(json, len);
+}
+
+size_t JsonWriter::finish()
+{
+    if (size > 0)
+        buf[len < size ? len : size - 1] = 0;
+    return len;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Writes JSON straight into a caller provided buffer, without building a tree of values first
+ *
+ * Values come out in the order they are written, so callers that want the output of JSONValue::Stringify() write object
+ * members sorted by name, the way its std::map keeps them. Strings and numbers are formatted exactly like JSONValue does.
+ *
+ * Like snprintf, output that doesn't fit is cut off, and length() tells how big the buffer should have been.
+ */
+class JsonWriter
+{
+  public:
+    JsonWriter(char *buf, size_t size);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /// Start a member of the current object, the next call writes its value
+    JsonWriter &key(const char *name);
+
+    /// Write a string, up to its terminating NUL or maxLen chars, whichever comes first
+    void string(const char *s, size_t maxLen = SIZE_MAX);
+    void number(double value);
+    void number(int value);
+    void number(unsigned int value);
+    void boolean(bool value);
+    /// Write an already encoded JSON value
+    void raw(const char *json, size_t len);
+
+    /// NUL terminate the output
+    /// @return the length of the complete output, it didn't fit if >= the buffer size
+    size_t finish();
+
+    size_t length() const { return len; }
+
+  private:
+    static constexpr uint8_t MAX_DEPTH = 31;
+
+    char *buf;
+    size_t size;
+    size_t len = 0;
+    uint32_t hasMembers = 0; // Bit n set once the container at depth n has a member, so the next one needs a comma
+    uint8_t depth = 0;
+    bool afterKey = false; // The next value belongs to the key just written, no comma
+
+    void put(char c)
+    {
+        if (len + 1 < size)
+            buf[len] = c;
+        len++;
+    }
+    void put(const char *s, size_t n);
+
+    /// Write the comma that goes before every value but the first one of a container
+    void separate();
+};
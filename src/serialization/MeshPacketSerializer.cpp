@@ -1,6 +1,7 @@
 #ifndef NRF52_USE_JSON
 #include "MeshPacketSerializer.h"
 #include "JSON.h"
+#include "JsonWriter.h"
 #include "NodeDB.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mesh/generated/meshtastic/telemetry.pb.h"
@@ -11,466 +12,484 @@
 #include "../mesh/generated/meshtastic/paxcount.pb.h"
 #endif
 #include "mesh/generated/meshtastic/remote_hardware.pb.h"
+#include <algorithm>
 #include <sys/types.h>
 
 static const char *errStr = "Error decoding proto for %s message!";
 
-std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog)
+// Object members are written sorted by name, the order JSONObject kept them in before we streamed the JSON out directly.
+
+/// @return true if JSON::Parse() might accept this text, anything else can't be a JSON value
+static bool mayBeJson(const char *text, size_t len)
+{
+    size_t i = 0;
+    while (i < len && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || text[i] == '\n'))
+        i++;
+    return i < len && strchr("\"{[-0123456789tTfFnN", text[i]);
+}
+
+static void writeTelemetry(JsonWriter &json, const meshtastic_Telemetry *decoded)
+{
+    json.beginObject();
+    if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
+        const meshtastic_DeviceMetrics &m = decoded->variant.device_metrics;
+        json.key("air_util_tx").number(m.air_util_tx);
+        // If battery is present, encode the battery level value
+        // TODO - Add a condition to send a code for a non-present value
+        if (m.has_battery_level)
+            json.key("battery_level").number((int)m.battery_level);
+        json.key("channel_utilization").number(m.channel_utilization);
+        json.key("uptime_seconds").number((unsigned int)m.uptime_seconds);
+        json.key("voltage").number(m.voltage);
+    } else if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
+        // Avoid sending 0s for sensors that could be 0
+        const meshtastic_EnvironmentMetrics &m = decoded->variant.environment_metrics;
+        if (m.has_barometric_pressure)
+            json.key("barometric_pressure").number(m.barometric_pressure);
+        if (m.has_current)
+            json.key("current").number(m.current);
+        if (m.has_distance)
+            json.key("distance").number(m.distance);
+        if (m.has_gas_resistance)
+            json.key("gas_resistance").number(m.gas_resistance);
+        if (m.has_iaq)
+            json.key("iaq").number((uint)m.iaq);
+        if (m.has_ir_lux)
+            json.key("ir_lux").number(m.ir_lux);
+        if (m.has_lux)
+            json.key("lux").number(m.lux);
+        if (m.has_radiation)
+            json.key("radiation").number(m.radiation);
+        if (m.has_rainfall_1h)
+            json.key("rainfall_1h").number(m.rainfall_1h);
+        if (m.has_rainfall_24h)
+            json.key("rainfall_24h").number(m.rainfall_24h);
+        if (m.has_relative_humidity)
+            json.key("relative_humidity").number(m.relative_humidity);
+        if (m.has_soil_moisture)
+            json.key("soil_moisture").number((uint)m.soil_moisture);
+        if (m.has_soil_temperature)
+            json.key("soil_temperature").number(m.soil_temperature);
+        if (m.has_temperature)
+            json.key("temperature").number(m.temperature);
+        if (m.has_uv_lux)
+            json.key("uv_lux").number(m.uv_lux);
+        if (m.has_voltage)
+            json.key("voltage").number(m.voltage);
+        if (m.has_weight)
+            json.key("weight").number(m.weight);
+        if (m.has_white_lux)
+            json.key("white_lux").number(m.white_lux);
+        if (m.has_wind_direction)
+            json.key("wind_direction").number((uint)m.wind_direction);
+        if (m.has_wind_gust)
+            json.key("wind_gust").number(m.wind_gust);
+        if (m.has_wind_lull)
+            json.key("wind_lull").number(m.wind_lull);
+        if (m.has_wind_speed)
+            json.key("wind_speed").number(m.wind_speed);
+    } else if (decoded->which_variant == meshtastic_Telemetry_air_quality_metrics_tag) {
+        const meshtastic_AirQualityMetrics &m = decoded->variant.air_quality_metrics;
+        if (m.has_co2)
+            json.key("co2").number((unsigned int)m.co2);
+        if (m.has_co2_humidity)
+            json.key("co2_humidity").number(m.co2_humidity);
+        if (m.has_co2_temperature)
+            json.key("co2_temperature").number(m.co2_temperature);
+        if (m.has_form_formaldehyde)
+            json.key("form_formaldehyde").number(m.form_formaldehyde);
+        if (m.has_form_humidity)
+            json.key("form_humidity").number(m.form_humidity);
+        if (m.has_form_temperature)
+            json.key("form_temperature").number(m.form_temperature);
+        if (m.has_pm10_standard)
+            json.key("pm10").number((unsigned int)m.pm10_standard);
+        if (m.has_pm100_standard)
+            json.key("pm100").number((unsigned int)m.pm100_standard);
+        if (m.has_pm25_standard)
+            json.key("pm25").number((unsigned int)m.pm25_standard);
+    } else if (decoded->which_variant == meshtastic_Telemetry_power_metrics_tag) {
+        const meshtastic_PowerMetrics &m = decoded->variant.power_metrics;
+        if (m.has_ch1_current)
+            json.key("current_ch1").number(m.ch1_current);
+        if (m.has_ch2_current)
+            json.key("current_ch2").number(m.ch2_current);
+        if (m.has_ch3_current)
+            json.key("current_ch3").number(m.ch3_current);
+        if (m.has_ch1_voltage)
+            json.key("voltage_ch1").number(m.ch1_voltage);
+        if (m.has_ch2_voltage)
+            json.key("voltage_ch2").number(m.ch2_voltage);
+        if (m.has_ch3_voltage)
+            json.key("voltage_ch3").number(m.ch3_voltage);
+    }
+    json.endObject();
+}
+
+static void writePosition(JsonWriter &json, const meshtastic_Position *decoded)
+{
+    json.beginObject();
+    if ((int)decoded->HDOP)
+        json.key("HDOP").number((int)decoded->HDOP);
+    if ((int)decoded->PDOP)
+        json.key("PDOP").number((int)decoded->PDOP);
+    if ((int)decoded->VDOP)
+        json.key("VDOP").number((int)decoded->VDOP);
+    if ((int)decoded->altitude)
+        json.key("altitude").number((int)decoded->altitude);
+    if ((int)decoded->ground_speed)
+        json.key("ground_speed").number((unsigned int)decoded->ground_speed);
+    if (int(decoded->ground_track))
+        json.key("ground_track").number((unsigned int)decoded->ground_track);
+    json.key("latitude_i").number((int)decoded->latitude_i);
+    json.key("longitude_i").number((int)decoded->longitude_i);
+    if ((int)decoded->precision_bits)
+        json.key("precision_bits").number((int)decoded->precision_bits);
+    if (int(decoded->sats_in_view))
+        json.key("sats_in_view").number((unsigned int)decoded->sats_in_view);
+    if ((int)decoded->time)
+        json.key("time").number((unsigned int)decoded->time);
+    if ((int)decoded->timestamp)
+        json.key("timestamp").number((unsigned int)decoded->timestamp);
+    json.endObject();
+}
+
+/// Add the long name of a node to a traceroute
+static void writeRouteHop(JsonWriter &json, NodeNum num)
 {
-    // the created jsonObj is immutable after creation, so
-    // we need to do the heavy lifting before assembling it.
-    std::string msgType;
-    JSONObject jsonObj;
+    const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
+    if (node && node->has_user)
+        json.string(node->user.long_name, sizeof(node->user.long_name));
+    else
+        json.string("Unknown");
+}
+
+static void writeTraceroute(JsonWriter &json, const meshtastic_MeshPacket *mp, const meshtastic_RouteDiscovery *decoded)
+{
+    json.beginObject();
+
+    // Route this message took
+    json.key("route").beginArray();
+    writeRouteHop(json, mp->to); // Started at the original transmitter (destination of response)
+    for (uint8_t i = 0; i < decoded->route_count; i++)
+        writeRouteHop(json, decoded->route[i]);
+    writeRouteHop(json, mp->from); // Ended at the original destination (source of response)
+    json.endArray();
+
+    // Route this message took back
+    json.key("route_back").beginArray();
+    writeRouteHop(json, mp->from); // Started at the original destination (source of response)
+    for (uint8_t i = 0; i < decoded->route_back_count; i++)
+        writeRouteHop(json, decoded->route_back[i]);
+    writeRouteHop(json, mp->to); // Ended at the original transmitter (destination of response)
+    json.endArray();
+
+    // Snr for reverse route
+    json.key("snr_back").beginArray();
+    for (uint8_t i = 0; i < decoded->snr_back_count; i++)
+        json.number((float)decoded->snr_back[i] / 4);
+    json.endArray();
 
-    if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-        JSONObject msgPayload;
-        switch (mp->decoded.portnum) {
-        case meshtastic_PortNum_TEXT_MESSAGE_APP: {
-            msgType = "text";
-            // convert bytes to string
-            if (shouldLog)
-                LOG_DEBUG("got text message of size %u", mp->decoded.payload.size);
+    // Snr for forward route
+    json.key("snr_towards").beginArray();
+    for (uint8_t i = 0; i < decoded->snr_towards_count; i++)
+        json.number((float)decoded->snr_towards[i] / 4);
+    json.endArray();
 
-            char payloadStr[(mp->decoded.payload.size) + 1];
-            memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
-            payloadStr[mp->decoded.payload.size] = 0; // null terminated string
-            // check if this is a JSON payload
+    json.endObject();
+}
+
+/**
+ * Write the "payload" member for a decoded packet, if we know how to show its port
+ * @return the type of message, "" if we don't know it
+ */
+static const char *writePayload(JsonWriter &json, const meshtastic_MeshPacket *mp, bool shouldLog)
+{
+    const char *msgType = "";
+    switch (mp->decoded.portnum) {
+    case meshtastic_PortNum_TEXT_MESSAGE_APP: {
+        msgType = "text";
+        if (shouldLog)
+            LOG_DEBUG("got text message of size %u", mp->decoded.payload.size);
+
+        // The text ends at the first NUL, if any
+        const char *text = (const char *)mp->decoded.payload.bytes;
+        size_t textLen = strnlen(text, mp->decoded.payload.size);
+        // check if this is a JSON payload, only parsing the ones that might be
+        if (mayBeJson(text, textLen)) {
+            char payloadStr[textLen + 1];
+            memcpy(payloadStr, text, textLen);
+            payloadStr[textLen] = 0; // null terminated string
             JSONValue *json_value = JSON::Parse(payloadStr);
             if (json_value != NULL) {
                 if (shouldLog)
                     LOG_INFO("text message payload is of type json");
 
-                // if it is, then we can just use the json object
-                jsonObj["payload"] = json_value;
-            } else {
-                // if it isn't, then we need to create a json object
-                // with the string as the value
-                if (shouldLog)
-                    LOG_INFO("text message payload is of type plaintext");
-
-                msgPayload["text"] = new JSONValue(payloadStr);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                // if it is, then we can just use the json value
+                std::string jsonStr = json_value->Stringify();
+                delete json_value;
+                json.key("payload").raw(jsonStr.c_str(), jsonStr.length());
+                break;
             }
-            break;
         }
-        case meshtastic_PortNum_TELEMETRY_APP: {
-            msgType = "telemetry";
-            meshtastic_Telemetry scratch;
-            meshtastic_Telemetry *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
-                decoded = &scratch;
-                if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
-                    // If battery is present, encode the battery level value
-                    // TODO - Add a condition to send a code for a non-present value
-                    if (decoded->variant.device_metrics.has_battery_level) {
-                        msgPayload["battery_level"] = new JSONValue((int)decoded->variant.device_metrics.battery_level);
-                    }
-                    msgPayload["voltage"] = new JSONValue(decoded->variant.device_metrics.voltage);
-                    msgPayload["channel_utilization"] = new JSONValue(decoded->variant.device_metrics.channel_utilization);
-                    msgPayload["air_util_tx"] = new JSONValue(decoded->variant.device_metrics.air_util_tx);
-                    msgPayload["uptime_seconds"] = new JSONValue((unsigned int)decoded->variant.device_metrics.uptime_seconds);
-                } else if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
-                    // Avoid sending 0s for sensors that could be 0
-                    if (decoded->variant.environment_metrics.has_temperature) {
-                        msgPayload["temperature"] = new JSONValue(decoded->variant.environment_metrics.temperature);
-                    }
-                    if (decoded->variant.environment_metrics.has_relative_humidity) {
-                        msgPayload["relative_humidity"] = new JSONValue(decoded->variant.environment_metrics.relative_humidity);
-                    }
-                    if (decoded->variant.environment_metrics.has_barometric_pressure) {
-                        msgPayload["barometric_pressure"] =
-                            new JSONValue(decoded->variant.environment_metrics.barometric_pressure);
-                    }
-                    if (decoded->variant.environment_metrics.has_gas_resistance) {
-                        msgPayload["gas_resistance"] = new JSONValue(decoded->variant.environment_metrics.gas_resistance);
-                    }
-                    if (decoded->variant.environment_metrics.has_voltage) {
-                        msgPayload["voltage"] = new JSONValue(decoded->variant.environment_metrics.voltage);
-                    }
-                    if (decoded->variant.environment_metrics.has_current) {
-                        msgPayload["current"] = new JSONValue(decoded->variant.environment_metrics.current);
-                    }
-                    if (decoded->variant.environment_metrics.has_lux) {
-                        msgPayload["lux"] = new JSONValue(decoded->variant.environment_metrics.lux);
-                    }
-                    if (decoded->variant.environment_metrics.has_white_lux) {
-                        msgPayload["white_lux"] = new JSONValue(decoded->variant.environment_metrics.white_lux);
-                    }
-                    if (decoded->variant.environment_metrics.has_iaq) {
-                        msgPayload["iaq"] = new JSONValue((uint)decoded->variant.environment_metrics.iaq);
-                    }
-                    if (decoded->variant.environment_metrics.has_distance) {
-                        msgPayload["distance"] = new JSONValue(decoded->variant.environment_metrics.distance);
-                    }
-                    if (decoded->variant.environment_metrics.has_wind_speed) {
-                        msgPayload["wind_speed"] = new JSONValue(decoded->variant.environment_metrics.wind_speed);
-                    }
-                    if (decoded->variant.environment_metrics.has_wind_direction) {
-                        msgPayload["wind_direction"] = new JSONValue((uint)decoded->variant.environment_metrics.wind_direction);
-                    }
-                    if (decoded->variant.environment_metrics.has_wind_gust) {
-                        msgPayload["wind_gust"] = new JSONValue(decoded->variant.environment_metrics.wind_gust);
-                    }
-                    if (decoded->variant.environment_metrics.has_wind_lull) {
-                        msgPayload["wind_lull"] = new JSONValue(decoded->variant.environment_metrics.wind_lull);
-                    }
-                    if (decoded->variant.environment_metrics.has_radiation) {
-                        msgPayload["radiation"] = new JSONValue(decoded->variant.environment_metrics.radiation);
-                    }
-                    if (decoded->variant.environment_metrics.has_ir_lux) {
-                        msgPayload["ir_lux"] = new JSONValue(decoded->variant.environment_metrics.ir_lux);
-                    }
-                    if (decoded->variant.environment_metrics.has_uv_lux) {
-                        msgPayload["uv_lux"] = new JSONValue(decoded->variant.environment_metrics.uv_lux);
-                    }
-                    if (decoded->variant.environment_metrics.has_weight) {
-                        msgPayload["weight"] = new JSONValue(decoded->variant.environment_metrics.weight);
-                    }
-                    if (decoded->variant.environment_metrics.has_rainfall_1h) {
-                        msgPayload["rainfall_1h"] = new JSONValue(decoded->variant.environment_metrics.rainfall_1h);
-                    }
-                    if (decoded->variant.environment_metrics.has_rainfall_24h) {
-                        msgPayload["rainfall_24h"] = new JSONValue(decoded->variant.environment_metrics.rainfall_24h);
-                    }
-                    if (decoded->variant.environment_metrics.has_soil_moisture) {
-                        msgPayload["soil_moisture"] = new JSONValue((uint)decoded->variant.environment_metrics.soil_moisture);
-                    }
-                    if (decoded->variant.environment_metrics.has_soil_temperature) {
-                        msgPayload["soil_temperature"] = new JSONValue(decoded->variant.environment_metrics.soil_temperature);
-                    }
-                } else if (decoded->which_variant == meshtastic_Telemetry_air_quality_metrics_tag) {
-                    if (decoded->variant.air_quality_metrics.has_pm10_standard) {
-                        msgPayload["pm10"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm10_standard);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_pm25_standard) {
-                        msgPayload["pm25"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm25_standard);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_pm100_standard) {
-                        msgPayload["pm100"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.pm100_standard);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_co2) {
-                        msgPayload["co2"] = new JSONValue((unsigned int)decoded->variant.air_quality_metrics.co2);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_co2_temperature) {
-                        msgPayload["co2_temperature"] = new JSONValue(decoded->variant.air_quality_metrics.co2_temperature);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_co2_humidity) {
-                        msgPayload["co2_humidity"] = new JSONValue(decoded->variant.air_quality_metrics.co2_humidity);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_form_formaldehyde) {
-                        msgPayload["form_formaldehyde"] = new JSONValue(decoded->variant.air_quality_metrics.form_formaldehyde);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_form_temperature) {
-                        msgPayload["form_temperature"] = new JSONValue(decoded->variant.air_quality_metrics.form_temperature);
-                    }
-                    if (decoded->variant.air_quality_metrics.has_form_humidity) {
-                        msgPayload["form_humidity"] = new JSONValue(decoded->variant.air_quality_metrics.form_humidity);
-                    }
-                } else if (decoded->which_variant == meshtastic_Telemetry_power_metrics_tag) {
-                    if (decoded->variant.power_metrics.has_ch1_voltage) {
-                        msgPayload["voltage_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_voltage);
-                    }
-                    if (decoded->variant.power_metrics.has_ch1_current) {
-                        msgPayload["current_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_current);
-                    }
-                    if (decoded->variant.power_metrics.has_ch2_voltage) {
-                        msgPayload["voltage_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_voltage);
-                    }
-                    if (decoded->variant.power_metrics.has_ch2_current) {
-                        msgPayload["current_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_current);
-                    }
-                    if (decoded->variant.power_metrics.has_ch3_voltage) {
-                        msgPayload["voltage_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_voltage);
-                    }
-                    if (decoded->variant.power_metrics.has_ch3_current) {
-                        msgPayload["current_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_current);
-                    }
-                }
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+        // if it isn't, then we need to create a json object with the string as the value
+        if (shouldLog)
+            LOG_INFO("text message payload is of type plaintext");
+        json.key("payload").beginObject();
+        json.key("text").string(text, textLen);
+        json.endObject();
+        break;
+    }
+    case meshtastic_PortNum_TELEMETRY_APP: {
+        msgType = "telemetry";
+        meshtastic_Telemetry scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
+            json.key("payload");
+            writeTelemetry(json, &scratch);
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_NODEINFO_APP: {
-            msgType = "nodeinfo";
-            meshtastic_User scratch;
-            meshtastic_User *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["id"] = new JSONValue(decoded->id);
-                msgPayload["longname"] = new JSONValue(decoded->long_name);
-                msgPayload["shortname"] = new JSONValue(decoded->short_name);
-                msgPayload["hardware"] = new JSONValue(decoded->hw_model);
-                msgPayload["role"] = new JSONValue((int)decoded->role);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+        break;
+    }
+    case meshtastic_PortNum_NODEINFO_APP: {
+        msgType = "nodeinfo";
+        meshtastic_User scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
+            json.key("payload").beginObject();
+            json.key("hardware").number((int)scratch.hw_model);
+            json.key("id").string(scratch.id);
+            json.key("longname").string(scratch.long_name);
+            json.key("role").number((int)scratch.role);
+            json.key("shortname").string(scratch.short_name);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_POSITION_APP: {
-            msgType = "position";
-            meshtastic_Position scratch;
-            meshtastic_Position *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
-                decoded = &scratch;
-                if ((int)decoded->time) {
-                    msgPayload["time"] = new JSONValue((unsigned int)decoded->time);
-                }
-                if ((int)decoded->timestamp) {
-                    msgPayload["timestamp"] = new JSONValue((unsigned int)decoded->timestamp);
-                }
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
-                if ((int)decoded->altitude) {
-                    msgPayload["altitude"] = new JSONValue((int)decoded->altitude);
-                }
-                if ((int)decoded->ground_speed) {
-                    msgPayload["ground_speed"] = new JSONValue((unsigned int)decoded->ground_speed);
-                }
-                if (int(decoded->ground_track)) {
-                    msgPayload["ground_track"] = new JSONValue((unsigned int)decoded->ground_track);
-                }
-                if (int(decoded->sats_in_view)) {
-                    msgPayload["sats_in_view"] = new JSONValue((unsigned int)decoded->sats_in_view);
-                }
-                if ((int)decoded->PDOP) {
-                    msgPayload["PDOP"] = new JSONValue((int)decoded->PDOP);
-                }
-                if ((int)decoded->HDOP) {
-                    msgPayload["HDOP"] = new JSONValue((int)decoded->HDOP);
-                }
-                if ((int)decoded->VDOP) {
-                    msgPayload["VDOP"] = new JSONValue((int)decoded->VDOP);
-                }
-                if ((int)decoded->precision_bits) {
-                    msgPayload["precision_bits"] = new JSONValue((int)decoded->precision_bits);
-                }
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+        break;
+    }
+    case meshtastic_PortNum_POSITION_APP: {
+        msgType = "position";
+        meshtastic_Position scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
+            json.key("payload");
+            writePosition(json, &scratch);
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_WAYPOINT_APP: {
-            msgType = "waypoint";
-            meshtastic_Waypoint scratch;
-            meshtastic_Waypoint *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["id"] = new JSONValue((unsigned int)decoded->id);
-                msgPayload["name"] = new JSONValue(decoded->name);
-                msgPayload["description"] = new JSONValue(decoded->description);
-                msgPayload["expire"] = new JSONValue((unsigned int)decoded->expire);
-                msgPayload["locked_to"] = new JSONValue((unsigned int)decoded->locked_to);
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
+        break;
+    }
+    case meshtastic_PortNum_WAYPOINT_APP: {
+        msgType = "waypoint";
+        meshtastic_Waypoint scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
+            json.key("payload").beginObject();
+            json.key("description").string(scratch.description);
+            json.key("expire").number((unsigned int)scratch.expire);
+            json.key("id").number((unsigned int)scratch.id);
+            json.key("latitude_i").number((int)scratch.latitude_i);
+            json.key("locked_to").number((unsigned int)scratch.locked_to);
+            json.key("longitude_i").number((int)scratch.longitude_i);
+            json.key("name").string(scratch.name);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
+        }
+        break;
+    }
+    case meshtastic_PortNum_NEIGHBORINFO_APP: {
+        msgType = "neighborinfo";
+        meshtastic_NeighborInfo scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg,
+                                 &scratch)) {
+            json.key("payload").beginObject();
+            json.key("last_sent_by_id").number((unsigned int)scratch.last_sent_by_id);
+            json.key("neighbors").beginArray();
+            for (uint8_t i = 0; i < scratch.neighbors_count; i++) {
+                json.beginObject();
+                json.key("node_id").number((unsigned int)scratch.neighbors[i].node_id);
+                json.key("snr").number((int)scratch.neighbors[i].snr);
+                json.endObject();
             }
-            break;
+            json.endArray();
+            json.key("neighbors_count").number((int)scratch.neighbors_count);
+            json.key("node_broadcast_interval_secs").number((unsigned int)scratch.node_broadcast_interval_secs);
+            json.key("node_id").number((unsigned int)scratch.node_id);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
-        case meshtastic_PortNum_NEIGHBORINFO_APP: {
-            msgType = "neighborinfo";
-            meshtastic_NeighborInfo scratch;
-            meshtastic_NeighborInfo *decoded = NULL;
+        break;
+    }
+    case meshtastic_PortNum_TRACEROUTE_APP: {
+        if (mp->decoded.request_id) { // Only report the traceroute response
+            msgType = "traceroute";
+            meshtastic_RouteDiscovery scratch;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg,
+            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
                                      &scratch)) {
-                decoded = &scratch;
-                msgPayload["node_id"] = new JSONValue((unsigned int)decoded->node_id);
-                msgPayload["node_broadcast_interval_secs"] = new JSONValue((unsigned int)decoded->node_broadcast_interval_secs);
-                msgPayload["last_sent_by_id"] = new JSONValue((unsigned int)decoded->last_sent_by_id);
-                msgPayload["neighbors_count"] = new JSONValue(decoded->neighbors_count);
-                JSONArray neighbors;
-                for (uint8_t i = 0; i < decoded->neighbors_count; i++) {
-                    JSONObject neighborObj;
-                    neighborObj["node_id"] = new JSONValue((unsigned int)decoded->neighbors[i].node_id);
-                    neighborObj["snr"] = new JSONValue((int)decoded->neighbors[i].snr);
-                    neighbors.push_back(new JSONValue(neighborObj));
-                }
-                msgPayload["neighbors"] = new JSONValue(neighbors);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                json.key("payload");
+                writeTraceroute(json, mp, &scratch);
             } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
-        }
-        case meshtastic_PortNum_TRACEROUTE_APP: {
-            if (mp->decoded.request_id) { // Only report the traceroute response
-                msgType = "traceroute";
-                meshtastic_RouteDiscovery scratch;
-                meshtastic_RouteDiscovery *decoded = NULL;
-                memset(&scratch, 0, sizeof(scratch));
-                if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
-                                         &scratch)) {
-                    decoded = &scratch;
-                    JSONArray route;      // Route this message took
-                    JSONArray routeBack;  // Route this message took back
-                    JSONArray snrTowards; // Snr for forward route
-                    JSONArray snrBack;    // Snr for reverse route
-
-                    // Lambda function for adding a long name to the route
-                    auto addToRoute = [](JSONArray *route, NodeNum num) {
-                        char long_name[40] = "Unknown";
-                        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
-                        bool name_known = node ? node->has_user : false;
-                        if (name_known)
-                            memcpy(long_name, node->user.long_name, sizeof(long_name));
-                        route->push_back(new JSONValue(long_name));
-                    };
-                    addToRoute(&route, mp->to); // Started at the original transmitter (destination of response)
-                    for (uint8_t i = 0; i < decoded->route_count; i++) {
-                        addToRoute(&route, decoded->route[i]);
-                    }
-                    addToRoute(&route, mp->from); // Ended at the original destination (source of response)
-
-                    addToRoute(&routeBack, mp->from); // Started at the original destination (source of response)
-                    for (uint8_t i = 0; i < decoded->route_back_count; i++) {
-                        addToRoute(&routeBack, decoded->route_back[i]);
-                    }
-                    addToRoute(&routeBack, mp->to); // Ended at the original transmitter (destination of response)
-
-                    for (uint8_t i = 0; i < decoded->snr_back_count; i++) {
-                        snrBack.push_back(new JSONValue((float)decoded->snr_back[i] / 4));
-                    }
-
-                    for (uint8_t i = 0; i < decoded->snr_towards_count; i++) {
-                        snrTowards.push_back(new JSONValue((float)decoded->snr_towards[i] / 4));
-                    }
-
-                    msgPayload["route"] = new JSONValue(route);
-                    msgPayload["route_back"] = new JSONValue(routeBack);
-                    msgPayload["snr_back"] = new JSONValue(snrBack);
-                    msgPayload["snr_towards"] = new JSONValue(snrTowards);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                } else if (shouldLog) {
-                    LOG_ERROR(errStr, msgType.c_str());
-                }
+                LOG_ERROR(errStr, msgType);
             }
-            break;
-        }
-        case meshtastic_PortNum_DETECTION_SENSOR_APP: {
-            msgType = "detection";
-            char payloadStr[(mp->decoded.payload.size) + 1];
-            memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
-            payloadStr[mp->decoded.payload.size] = 0; // null terminated string
-            msgPayload["text"] = new JSONValue(payloadStr);
-            jsonObj["payload"] = new JSONValue(msgPayload);
-            break;
         }
+        break;
+    }
+    case meshtastic_PortNum_DETECTION_SENSOR_APP: {
+        msgType = "detection";
+        json.key("payload").beginObject();
+        json.key("text").string((const char *)mp->decoded.payload.bytes, mp->decoded.payload.size);
+        json.endObject();
+        break;
+    }
 #ifdef ARCH_ESP32
-        case meshtastic_PortNum_PAXCOUNTER_APP: {
-            msgType = "paxcounter";
-            meshtastic_Paxcount scratch;
-            meshtastic_Paxcount *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
-                decoded = &scratch;
-                msgPayload["wifi_count"] = new JSONValue((unsigned int)decoded->wifi);
-                msgPayload["ble_count"] = new JSONValue((unsigned int)decoded->ble);
-                msgPayload["uptime"] = new JSONValue((unsigned int)decoded->uptime);
-                jsonObj["payload"] = new JSONValue(msgPayload);
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, msgType.c_str());
-            }
-            break;
+    case meshtastic_PortNum_PAXCOUNTER_APP: {
+        msgType = "paxcounter";
+        meshtastic_Paxcount scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
+            json.key("payload").beginObject();
+            json.key("ble_count").number((unsigned int)scratch.ble);
+            json.key("uptime").number((unsigned int)scratch.uptime);
+            json.key("wifi_count").number((unsigned int)scratch.wifi);
+            json.endObject();
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, msgType);
         }
+        break;
+    }
 #endif
-        case meshtastic_PortNum_REMOTE_HARDWARE_APP: {
-            meshtastic_HardwareMessage scratch;
-            meshtastic_HardwareMessage *decoded = NULL;
-            memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
-                                     &scratch)) {
-                decoded = &scratch;
-                if (decoded->type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
-                    msgType = "gpios_changed";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                } else if (decoded->type == meshtastic_HardwareMessage_Type_READ_GPIOS_REPLY) {
-                    msgType = "gpios_read_reply";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    msgPayload["gpio_mask"] = new JSONValue((unsigned int)decoded->gpio_mask);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
-                }
-            } else if (shouldLog) {
-                LOG_ERROR(errStr, "RemoteHardware");
+    case meshtastic_PortNum_REMOTE_HARDWARE_APP: {
+        meshtastic_HardwareMessage scratch;
+        memset(&scratch, 0, sizeof(scratch));
+        if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
+                                 &scratch)) {
+            if (scratch.type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
+                msgType = "gpios_changed";
+                json.key("payload").beginObject();
+                json.key("gpio_value").number((unsigned int)scratch.gpio_value);
+                json.endObject();
+            } else if (scratch.type == meshtastic_HardwareMessage_Type_READ_GPIOS_REPLY) {
+                msgType = "gpios_read_reply";
+                json.key("payload").beginObject();
+                json.key("gpio_mask").number((unsigned int)scratch.gpio_mask);
+                json.key("gpio_value").number((unsigned int)scratch.gpio_value);
+                json.endObject();
             }
-            break;
+        } else if (shouldLog) {
+            LOG_ERROR(errStr, "RemoteHardware");
         }
-        // add more packet types here if needed
-        default:
-            break;
-        }
-    } else if (shouldLog) {
-        LOG_WARN("Couldn't convert encrypted payload of MeshPacket to JSON");
+        break;
+    }
+    // add more packet types here if needed
+    default:
+        break;
     }
+    return msgType;
+}
 
-    jsonObj["id"] = new JSONValue((unsigned int)mp->id);
-    jsonObj["timestamp"] = new JSONValue((unsigned int)mp->rx_time);
-    jsonObj["to"] = new JSONValue((unsigned int)mp->to);
-    jsonObj["from"] = new JSONValue((unsigned int)mp->from);
-    jsonObj["channel"] = new JSONValue((unsigned int)mp->channel);
-    jsonObj["type"] = new JSONValue(msgType.c_str());
-    jsonObj["sender"] = new JSONValue(nodeDB->getNodeId().c_str());
-    if (mp->rx_rssi != 0)
-        jsonObj["rssi"] = new JSONValue((int)mp->rx_rssi);
-    if (mp->rx_snr != 0)
-        jsonObj["snr"] = new JSONValue((float)mp->rx_snr);
+size_t MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize, bool shouldLog)
+{
+    JsonWriter json(buf, bufSize);
+    json.beginObject();
+
+    json.key("channel").number((unsigned int)mp->channel);
+    json.key("from").number((unsigned int)mp->from);
     const int8_t hopsAway = getHopsAway(*mp);
     if (hopsAway >= 0) {
-        jsonObj["hops_away"] = new JSONValue((unsigned int)(hopsAway));
-        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp->hop_start));
+        json.key("hop_start").number((unsigned int)(mp->hop_start));
+        json.key("hops_away").number((unsigned int)(hopsAway));
     }
+    json.key("id").number((unsigned int)mp->id);
 
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObj);
-    std::string jsonStr = value->Stringify();
+    const char *msgType = "";
+    if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag)
+        msgType = writePayload(json, mp, shouldLog);
+    else if (shouldLog)
+        LOG_WARN("Couldn't convert encrypted payload of MeshPacket to JSON");
 
-    if (shouldLog)
-        LOG_INFO("serialized json message: %s", jsonStr.c_str());
+    if (mp->rx_rssi != 0)
+        json.key("rssi").number((int)mp->rx_rssi);
+    json.key("sender").string(nodeDB->getNodeId().c_str());
+    if (mp->rx_snr != 0)
+        json.key("snr").number((float)mp->rx_snr);
+    json.key("timestamp").number((unsigned int)mp->rx_time);
+    json.key("to").number((unsigned int)mp->to);
+    json.key("type").string(msgType);
 
-    delete value;
-    return jsonStr;
+    json.endObject();
+    size_t len = json.finish();
+    if (shouldLog && len < bufSize)
+        LOG_INFO("serialized json message: %s", buf);
+    return len;
 }
 
-std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
+size_t MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize)
 {
-    JSONObject jsonObj;
-
-    jsonObj["id"] = new JSONValue((unsigned int)mp->id);
-    jsonObj["time_ms"] = new JSONValue((double)millis());
-    jsonObj["timestamp"] = new JSONValue((unsigned int)mp->rx_time);
-    jsonObj["to"] = new JSONValue((unsigned int)mp->to);
-    jsonObj["from"] = new JSONValue((unsigned int)mp->from);
-    jsonObj["channel"] = new JSONValue((unsigned int)mp->channel);
-    jsonObj["want_ack"] = new JSONValue(mp->want_ack);
+    JsonWriter json(buf, bufSize);
+    json.beginObject();
 
-    if (mp->rx_rssi != 0)
-        jsonObj["rssi"] = new JSONValue((int)mp->rx_rssi);
-    if (mp->rx_snr != 0)
-        jsonObj["snr"] = new JSONValue((float)mp->rx_snr);
+    char hex[sizeof(mp->encrypted.bytes) * 2];
+    for (pb_size_t i = 0; i < mp->encrypted.size; i++) {
+        hex[i * 2] = hexChars[(mp->encrypted.bytes[i] & 0xF0) >> 4];
+        hex[i * 2 + 1] = hexChars[mp->encrypted.bytes[i] & 0x0F];
+    }
+    json.key("bytes").string(hex, mp->encrypted.size * 2);
+    json.key("channel").number((unsigned int)mp->channel);
+    json.key("from").number((unsigned int)mp->from);
     const int8_t hopsAway = getHopsAway(*mp);
     if (hopsAway >= 0) {
-        jsonObj["hops_away"] = new JSONValue((unsigned int)(hopsAway));
-        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp->hop_start));
+        json.key("hop_start").number((unsigned int)(mp->hop_start));
+        json.key("hops_away").number((unsigned int)(hopsAway));
     }
-    jsonObj["size"] = new JSONValue((unsigned int)mp->encrypted.size);
-    auto encryptedStr = bytesToHex(mp->encrypted.bytes, mp->encrypted.size);
-    jsonObj["bytes"] = new JSONValue(encryptedStr.c_str());
+    json.key("id").number((unsigned int)mp->id);
+    if (mp->rx_rssi != 0)
+        json.key("rssi").number((int)mp->rx_rssi);
+    json.key("size").number((unsigned int)mp->encrypted.size);
+    if (mp->rx_snr != 0)
+        json.key("snr").number((float)mp->rx_snr);
+    json.key("time_ms").number((double)millis());
+    json.key("timestamp").number((unsigned int)mp->rx_time);
+    json.key("to").number((unsigned int)mp->to);
+    json.key("want_ack").boolean(mp->want_ack);
+
+    json.endObject();
+    return json.finish();
+}
 
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObj);
-    std::string jsonStr = value->Stringify();
+/// Serialize with one of the functions above into a std::string, growing it if the JSON turns out bigger than it
+template <typename Serialize> static void serializeToString(std::string &out, Serialize serialize)
+{
+    out.resize(std::max(out.capacity(), (size_t)MESHPACKET_JSON_SIZE));
+    size_t len = serialize(&out[0], out.size());
+    if (len >= out.size()) {
+        out.resize(len + 1);
+        serialize(&out[0], out.size());
+    }
+    out.resize(len);
+}
 
-    delete value;
+void MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, std::string &out, bool shouldLog)
+{
+    serializeToString(out, [&](char *buf, size_t bufSize) { return JsonSerialize(mp, buf, bufSize, shouldLog); });
+}
+
+std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog)
+{
+    std::string jsonStr;
+    JsonSerialize(mp, jsonStr, shouldLog);
     return jsonStr;
 }
-#endif
\ No newline at end of file
+
+std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
+{
+    std::string jsonStr;
+    serializeToString(jsonStr, [&](char *buf, size_t bufSize) { return JsonSerializeEncrypted(mp, buf, bufSize); });
+    return jsonStr;
+}
+#endif
@@ -1,6 +1,9 @@
 #include <meshtastic/mesh.pb.h>
 #include <string>
 
+/// Buffer size that fits the JSON of most packets
+#define MESHPACKET_JSON_SIZE 1024
+
 static const char hexChars[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
 
 class MeshPacketSerializer
@@ -9,6 +12,15 @@ class MeshPacketSerializer
     static std::string JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog = true);
     static std::string JsonSerializeEncrypted(const meshtastic_MeshPacket *mp);
 
+    /// Serialize into out, reusing the memory it already has, so callers that keep it around don't allocate for each packet
+    static void JsonSerialize(const meshtastic_MeshPacket *mp, std::string &out, bool shouldLog = true);
+
+    /// Write the JSON into buf, allocating nothing unless a text message is JSON itself. Like snprintf, the output is cut off
+    /// if it doesn't fit.
+    /// @return the length of the complete JSON, it didn't fit if >= bufSize
+    static size_t JsonSerialize(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize, bool shouldLog = true);
+    static size_t JsonSerializeEncrypted(const meshtastic_MeshPacket *mp, char *buf, size_t bufSize);
+
   private:
     static std::string bytesToHex(const uint8_t *bytes, int len)
     {
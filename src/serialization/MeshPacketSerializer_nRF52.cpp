@@ -388,6 +388,11 @@ std::string MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp,
     return jsonStr;
 }
 
+void MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, std::string &out, bool shouldLog)
+{
+    out = JsonSerialize(mp, shouldLog);
+}
+
 std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp)
 {
     jsonObj.clear();
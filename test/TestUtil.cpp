@@ -31,4 +31,27 @@ void testDelay(unsigned long ms)
 #else
     std::this_thread::sleep_for(std::chrono::milliseconds(ms));
 #endif
-}
\ No newline at end of file
+}
+
+#ifdef TEST_VIRTUAL_MILLIS
+static bool virtualMillisActive = false;
+static uint32_t virtualMillis = 0;
+
+// The test build links with -Wl,--wrap=millis (bin/platformio-pre.py), so every millis() call outside the framework lands here
+extern "C" unsigned long __real_millis(void);
+extern "C" unsigned long __wrap_millis(void)
+{
+    return virtualMillisActive ? virtualMillis : __real_millis();
+}
+
+void testSetMillis(uint32_t ms)
+{
+    virtualMillis = ms;
+    virtualMillisActive = true;
+}
+
+void testUseRealMillis()
+{
+    virtualMillisActive = false;
+}
+#endif
@@ -4,4 +4,14 @@
 void initializeTestEnvironment();
 
 // Portable delay for tests (Arduino or host).
-void testDelay(unsigned long ms);
\ No newline at end of file
+void testDelay(unsigned long ms);
+
+#ifdef TEST_VIRTUAL_MILLIS
+#include <stdint.h>
+
+// Make millis() return ms from now on, for simulations that run the firmware's timers on their own clock.
+void testSetMillis(uint32_t ms);
+
+// Go back to the wall clock.
+void testUseRealMillis();
+#endif
@@ -2,8 +2,20 @@
 #include "CryptoEngine.h"
 
 #include "TestUtil.h"
+#include <memory>
+#include <random>
 #include <unity.h>
 
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
 void HexToBytes(uint8_t *result, const std::string hex, size_t len = 0)
 {
     if (len) {
@@ -152,6 +164,45 @@ void test_PKC(void)
     TEST_ASSERT_EQUAL_MEMORY(expected_decrypted, decrypted, 10);
 }
 
+void test_PKC_shared_key_cache(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t expected_shared[32];
+    uint8_t radioBytes[128] __attribute__((__aligned__));
+    uint8_t decrypted[128] __attribute__((__aligned__));
+
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(expected_shared, "777b1545c9d6f9a2");
+    HexToBytes(radioBytes, "8c646d7a2909000062d6b2136b00000040df24abfcc30a17a3d9046726099e796a1c036a792b");
+    crypto->setDHPrivateKey(private_key);
+    crypto->clearSharedKeyCache();
+
+    uint32_t hits = crypto->getSharedKeyCacheHits();
+    uint32_t misses = crypto->getSharedKeyCacheMisses();
+    TEST_ASSERT(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, crypto->getSharedKeyCacheMisses());
+
+    // Same peer again: served from the cache, and the key must be identical
+    memset(crypto->shared_key, 0, sizeof(crypto->shared_key));
+    TEST_ASSERT(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, crypto->getSharedKeyCacheHits());
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+
+    // Replacing the peer's key drops the entry
+    crypto->invalidateSharedKey(public_key.bytes);
+    TEST_ASSERT(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(misses + 2, crypto->getSharedKeyCacheMisses());
+
+    // A new private key drops everything
+    private_key[0] ^= 0x40;
+    crypto->setDHPrivateKey(private_key);
+    TEST_ASSERT_FALSE(crypto->decryptCurve25519(0x0929, public_key, 0x13b2d662, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(misses + 3, crypto->getSharedKeyCacheMisses());
+}
+
 void test_AES_CTR(void)
 {
     uint8_t expected[32];
@@ -178,6 +229,137 @@ void test_AES_CTR(void)
     TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
 }
 
+// aes-ccm.cpp always goes through the global engine, so PKI on any other engine needs it swapped in
+static CryptoEngine *useEngine(CryptoEngine *engine)
+{
+    CryptoEngine *previous = crypto;
+    crypto = engine;
+    return previous;
+}
+
+// Whichever engine the platform picked must give exactly what the generic one gives
+void test_engine_matches_reference(void)
+{
+    std::unique_ptr<CryptoEngine> reference(new CryptoEngine());
+    std::mt19937 rng(42);
+    TEST_MESSAGE(crypto->getName());
+
+    // Channel AES-CTR: every length, both key sizes, a third of them with the block counter about to wrap
+    uint8_t expected[MAX_BLOCKSIZE], actual[MAX_BLOCKSIZE], nonce[16];
+    for (size_t len = 1; len <= MAX_BLOCKSIZE; len++) {
+        CryptoKey k;
+        k.length = (len % 2) ? 16 : 32;
+        for (auto &b : k.bytes)
+            b = rng();
+        for (auto &b : nonce)
+            b = rng();
+        if (len % 3 == 0)
+            memset(nonce + 12, 0xff, 3);
+        for (size_t i = 0; i < len; i++)
+            expected[i] = actual[i] = rng();
+        reference->encryptAESCtr(k, nonce, len, expected);
+        crypto->encryptAESCtr(k, nonce, len, actual);
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, len);
+    }
+
+    // X25519 with random peers, plus a low order one and one that is not reduced
+    uint8_t private_key[32];
+    for (auto &b : private_key)
+        b = rng();
+    reference->setDHPrivateKey(private_key);
+    crypto->setDHPrivateKey(private_key);
+    for (int i = 0; i < 32; i++) {
+        uint8_t public_key[32], reference_public_key[32];
+        for (auto &b : public_key)
+            b = rng();
+        if (i == 0)
+            HexToBytes(public_key, "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f");
+        if (i == 1)
+            HexToBytes(public_key, "efffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f");
+        memcpy(reference_public_key, public_key, 32);
+        bool ok = reference->setDHPublicKey(reference_public_key);
+        TEST_ASSERT_EQUAL(ok, crypto->setDHPublicKey(public_key));
+        if (ok)
+            TEST_ASSERT_EQUAL_MEMORY(reference->shared_key, crypto->shared_key, 32);
+    }
+
+    // PKI round trip, with the same random extra nonce on both sides
+    meshtastic_UserLite_public_key_t remote;
+    HexToBytes(remote.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    remote.size = 32;
+    uint8_t plain[200], encrypted[MAX_BLOCKSIZE] __attribute__((__aligned__)), decrypted[MAX_BLOCKSIZE];
+    for (auto &b : plain)
+        b = rng();
+    for (size_t len : {1, 10, 100, 200}) {
+        srandom(len);
+        CryptoEngine *previous = useEngine(reference.get());
+        TEST_ASSERT(reference->encryptCurve25519(0, 0x0929, remote, 0x13b2d662 + len, len, plain, expected));
+        useEngine(previous);
+        srandom(len);
+        TEST_ASSERT(crypto->encryptCurve25519(0, 0x0929, remote, 0x13b2d662 + len, len, plain, encrypted));
+        TEST_ASSERT_EQUAL_MEMORY(expected, encrypted, len + 12);
+        TEST_ASSERT(crypto->decryptCurve25519(0x0929, remote, 0x13b2d662 + len, len + 12, encrypted, decrypted));
+        TEST_ASSERT_EQUAL_MEMORY(plain, decrypted, len);
+    }
+}
+
+/**
+ * Packets per second through one engine: channel AES-CTR on full size packets, and PKI encrypt and decrypt with the shared key
+ * cache cleared each time, so every packet pays for the X25519 key agreement as it does for a new DM partner.
+ */
+static void benchmarkEngine(CryptoEngine *engine)
+{
+    const uint32_t numChannelPackets = 5000;
+    const uint32_t numPkiPackets = 100;
+    CryptoEngine *previous = useEngine(engine);
+
+    CryptoKey k;
+    k.length = 32;
+    HexToBytes(k.bytes, "776BEFF2851DB06F4C8A0542C8696F6C6A81AF1EEC96B4D37FC1D689E6C1C104");
+    engine->setKey(k);
+    uint8_t bytes[MAX_BLOCKSIZE] = {0};
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numChannelPackets; i++)
+        engine->encryptPacket(0x0929, i, sizeof(bytes), bytes);
+    uint32_t channelElapsed = micros() - start;
+
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t remote;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(remote.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    remote.size = 32;
+    engine->setDHPrivateKey(private_key);
+    uint8_t encrypted[MAX_BLOCKSIZE] __attribute__((__aligned__)), decrypted[MAX_BLOCKSIZE];
+    start = micros();
+    for (uint32_t i = 0; i < numPkiPackets; i++) {
+        engine->clearSharedKeyCache();
+        TEST_ASSERT(engine->encryptCurve25519(0, 0x0929, remote, i, 200, bytes, encrypted));
+    }
+    uint32_t encryptElapsed = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < numPkiPackets; i++) {
+        engine->clearSharedKeyCache();
+        TEST_ASSERT(engine->decryptCurve25519(0x0929, remote, numPkiPackets - 1, 212, encrypted, decrypted));
+    }
+    uint32_t decryptElapsed = micros() - start;
+    useEngine(previous);
+
+    auto perSecond = [](uint32_t packets, uint32_t elapsedUs) { return packets * 1e6 / (elapsedUs ? elapsedUs : 1); };
+    TEST_MSG_FMT("%s: channel AES-CTR %.0f packets/s, PKI encrypt %.0f packets/s, PKI decrypt %.0f packets/s", engine->getName(),
+                 perSecond(numChannelPackets, channelElapsed), perSecond(numPkiPackets, encryptElapsed),
+                 perSecond(numPkiPackets, decryptElapsed));
+}
+
+// Benchmark: the generic engine against the one the platform picked
+void test_benchmark_engines(void)
+{
+    std::unique_ptr<CryptoEngine> reference(new CryptoEngine());
+    benchmarkEngine(reference.get());
+    if (strcmp(crypto->getName(), reference->getName()) != 0)
+        benchmarkEngine(crypto);
+}
+
 void setup()
 {
     // NOTE!!! Wait for >2 secs
@@ -192,6 +374,9 @@ void setup()
     RUN_TEST(test_DH25519);
     RUN_TEST(test_AES_CTR);
     RUN_TEST(test_PKC);
+    RUN_TEST(test_PKC_shared_key_cache);
+    RUN_TEST(test_engine_matches_reference);
+    RUN_TEST(test_benchmark_engines);
     exit(UNITY_END()); // stop unit testing
 }
 
@@ -1,6 +1,9 @@
+#include "Channels.h"
 #include "MeshModule.h"
 #include "MeshTypes.h"
+#include "NodeDB.h"
 #include "TestUtil.h"
+#include <string>
 #include <unity.h>
 
 // Minimal concrete subclass for testing the base class helper
@@ -13,6 +16,33 @@ class TestModule : public MeshModule
     using MeshModule::isMultiHopBroadcastRequest;
 };
 
+static std::string handledBy; // Names of the modules that handled packets, in the order they did
+
+// Module that declares its portnums, for testing how callModules() dispatches packets
+class PortModule : public MeshModule
+{
+  public:
+    uint32_t asked = 0;
+    ProcessMessage result = ProcessMessage::CONTINUE;
+
+    explicit PortModule(const char *name) : MeshModule(name) {}
+    using MeshModule::boundChannel;
+    using MeshModule::encryptedOk;
+    using MeshModule::wantPortnum;
+
+    virtual bool wantPacket(const meshtastic_MeshPacket *p) override
+    {
+        asked++;
+        return true;
+    }
+
+    virtual ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override
+    {
+        handledBy += name;
+        return result;
+    }
+};
+
 static TestModule *testModule;
 static meshtastic_MeshPacket testPacket;
 
@@ -98,9 +128,98 @@ static void test_singleHopRelayedBroadcast_isBlocked()
     TEST_ASSERT_TRUE(testModule->isMultiHopBroadcastRequest());
 }
 
+static meshtastic_MeshPacket textPacket(ChannelIndex channel = 0)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x12345678;
+    p.to = NODENUM_BROADCAST;
+    p.id = 1;
+    p.channel = channel;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    return p;
+}
+
+// Only modules that declared the portnum, or no portnum at all, are asked about a packet, in the order they registered
+static void test_dispatch_asks_modules_for_the_portnum()
+{
+    PortModule text("T"), position("P"), any("A");
+    text.wantPortnum(meshtastic_PortNum_TEXT_MESSAGE_APP);
+    position.wantPortnum(meshtastic_PortNum_POSITION_APP);
+    PortModule later("L");
+    later.wantPortnum(meshtastic_PortNum_TEXT_MESSAGE_APP);
+
+    handledBy.clear();
+    meshtastic_MeshPacket p = textPacket();
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("TAL", handledBy.c_str());
+    TEST_ASSERT_EQUAL(0, position.asked);
+
+    // Nobody declared this one
+    handledBy.clear();
+    p.decoded.portnum = meshtastic_PortNum_PRIVATE_APP;
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("A", handledBy.c_str());
+
+    // A module that stops processing keeps the packet from the modules after it
+    handledBy.clear();
+    text.result = ProcessMessage::STOP;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("T", handledBy.c_str());
+}
+
+// Packets we couldn't decode only go to modules that take encrypted packets
+static void test_dispatch_encrypted_packets()
+{
+    PortModule plain("P"), encrypted("E");
+    encrypted.encryptedOk = true;
+    encrypted.wantPortnum(meshtastic_PortNum_ROUTING_APP);
+
+    handledBy.clear();
+    meshtastic_MeshPacket p = textPacket();
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("E", handledBy.c_str());
+    TEST_ASSERT_EQUAL(0, plain.asked);
+}
+
+// A module bound to a channel name only handles packets on the channels with that name, looked up again when they change
+static void test_dispatch_bound_channel()
+{
+    PortModule bound("B");
+    bound.boundChannel = Channels::gpioChannel;
+
+    meshtastic_Channel ch = channels.getByIndex(1);
+    ch.index = 1;
+    ch.role = meshtastic_Channel_Role_SECONDARY;
+    ch.has_settings = true;
+    strcpy(ch.settings.name, "GPIO");
+    channels.setChannel(ch);
+    channels.onConfigChanged();
+
+    handledBy.clear();
+    meshtastic_MeshPacket p = textPacket(1);
+    MeshModule::callModules(p);
+    p = textPacket(0);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("B", handledBy.c_str());
+
+    strcpy(ch.settings.name, "other");
+    channels.setChannel(ch);
+    channels.onConfigChanged();
+    handledBy.clear();
+    p = textPacket(1);
+    MeshModule::callModules(p);
+    TEST_ASSERT_EQUAL_STRING("", handledBy.c_str());
+}
+
 void setup()
 {
     initializeTestEnvironment();
+    nodeDB = new NodeDB();
+    channels.initDefaults();
+    channels.onConfigChanged();
 
     UNITY_BEGIN();
     RUN_TEST(test_zeroHopBroadcast_isAllowed);
@@ -110,6 +229,9 @@ void setup()
     RUN_TEST(test_noCurrentRequest_isAllowed);
     RUN_TEST(test_legacyPacket_zeroHopStart_isAllowed);
     RUN_TEST(test_singleHopRelayedBroadcast_isBlocked);
+    RUN_TEST(test_dispatch_asks_modules_for_the_portnum);
+    RUN_TEST(test_dispatch_encrypted_packets);
+    RUN_TEST(test_dispatch_bound_channel);
     exit(UNITY_END());
 }
 
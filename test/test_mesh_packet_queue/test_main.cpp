@@ -0,0 +1,276 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "mesh/MeshPacketQueue.h"
+#include "mesh/NodeDB.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_MeshPacket *p2);
+
+static const NodeNum OUR_NODE = 0x11223344;
+static const uint8_t QUEUE_LEN = 16;
+
+static NodeDB *testNodeDB = nullptr;
+
+static meshtastic_MeshPacket *makePacket(NodeNum from, PacketId id, meshtastic_MeshPacket_Priority priority,
+                                         uint32_t txAfter = 0, uint8_t hopLimit = 3)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = from;
+    p->id = id;
+    p->priority = priority;
+    p->tx_after = txAfter;
+    p->hop_limit = hopLimit;
+    return p;
+}
+
+static void drain(MeshPacketQueue &q)
+{
+    while (!q.empty())
+        packetPool.release(q.dequeue());
+}
+
+// --- Ordering invariants ---
+
+static void test_higher_priority_goes_first()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_BACKGROUND));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_ACK));
+    q.enqueue(makePacket(0x100, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    TEST_ASSERT_EQUAL_UINT32(2, q.getFront()->id);
+    meshtastic_MeshPacket *p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(2, p->id);
+    packetPool.release(p);
+    p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(3, p->id);
+    packetPool.release(p);
+    p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(1, p->id);
+    packetPool.release(p);
+    TEST_ASSERT_TRUE(q.empty());
+    TEST_ASSERT_NULL(q.dequeue());
+}
+
+static void test_equal_packets_stay_fifo()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    for (PacketId id = 1; id <= 10; id++)
+        q.enqueue(makePacket(0x100, id, meshtastic_MeshPacket_Priority_DEFAULT));
+    // Interleave some other priorities, they must not disturb the FIFO order of the equal ones
+    q.enqueue(makePacket(0x100, 100, meshtastic_MeshPacket_Priority_HIGH));
+    q.enqueue(makePacket(0x100, 101, meshtastic_MeshPacket_Priority_BACKGROUND));
+
+    meshtastic_MeshPacket *p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(100, p->id);
+    packetPool.release(p);
+    for (PacketId id = 1; id <= 10; id++) {
+        p = q.dequeue();
+        TEST_ASSERT_EQUAL_UINT32(id, p->id);
+        packetPool.release(p);
+    }
+    drain(q);
+}
+
+static void test_late_window_goes_last()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_ACK, millis() + 1000));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_BACKGROUND));
+
+    meshtastic_MeshPacket *p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(2, p->id);
+    packetPool.release(p);
+    drain(q);
+}
+
+static void test_relayed_before_own_at_equal_priority()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0, 1, meshtastic_MeshPacket_Priority_DEFAULT)); // Generated locally
+    q.enqueue(makePacket(OUR_NODE, 2, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x100, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    meshtastic_MeshPacket *p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(3, p->id);
+    packetPool.release(p);
+    p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(1, p->id);
+    packetPool.release(p);
+    drain(q);
+}
+
+// Random mix of packets must come out in the order a stable sort by CompareMeshPacketFunc gives
+static void test_random_mix_matches_stable_sort()
+{
+    const meshtastic_MeshPacket_Priority priorities[] = {
+        meshtastic_MeshPacket_Priority_BACKGROUND, meshtastic_MeshPacket_Priority_DEFAULT, meshtastic_MeshPacket_Priority_RELIABLE,
+        meshtastic_MeshPacket_Priority_RESPONSE,   meshtastic_MeshPacket_Priority_HIGH,    meshtastic_MeshPacket_Priority_ACK};
+    std::mt19937 rng(42);
+
+    for (int round = 0; round < 50; round++) {
+        MeshPacketQueue q(QUEUE_LEN);
+        std::vector<meshtastic_MeshPacket *> expected;
+        for (PacketId id = 1; id <= QUEUE_LEN; id++) {
+            meshtastic_MeshPacket *p = makePacket((rng() % 4) ? 0x100 + rng() % 3 : 0, id, priorities[rng() % 6],
+                                                  (rng() % 3) ? 0 : millis() + 1000);
+            expected.push_back(p);
+            TEST_ASSERT_TRUE(q.enqueue(p));
+        }
+        std::stable_sort(expected.begin(), expected.end(), CompareMeshPacketFunc);
+
+        for (meshtastic_MeshPacket *e : expected) {
+            meshtastic_MeshPacket *p = q.dequeue();
+            TEST_ASSERT_EQUAL_PTR(e, p);
+            packetPool.release(p);
+        }
+        TEST_ASSERT_TRUE(q.empty());
+    }
+}
+
+// --- Index lookups ---
+
+static void test_find_and_remove_by_from_and_id()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    for (PacketId id = 1; id <= 8; id++)
+        q.enqueue(makePacket(0x100 + id % 2, id, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    TEST_ASSERT_TRUE(q.find(0x101, 3));
+    TEST_ASSERT_FALSE(q.find(0x100, 3));
+    TEST_ASSERT_NOT_NULL(q.getPacketFromQueue(0x100, 4));
+
+    meshtastic_MeshPacket *p = q.remove(0x101, 3);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(3, p->id);
+    packetPool.release(p);
+    TEST_ASSERT_FALSE(q.find(0x101, 3));
+    TEST_ASSERT_NULL(q.remove(0x101, 3));
+    TEST_ASSERT_EQUAL(QUEUE_LEN - 7, q.getFree());
+
+    // The rest keeps its order
+    for (PacketId id : {1, 2, 4, 5, 6, 7, 8}) {
+        p = q.dequeue();
+        TEST_ASSERT_EQUAL_UINT32(id, p->id);
+        packetPool.release(p);
+    }
+}
+
+static void test_locally_generated_is_found_by_our_node_num()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0, 7, meshtastic_MeshPacket_Priority_DEFAULT));
+    TEST_ASSERT_TRUE(q.find(OUR_NODE, 7));
+    drain(q);
+}
+
+static void test_remove_honours_late_and_hop_limit_filters()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_DEFAULT, millis() + 1000, 3));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_DEFAULT, 0, 5));
+
+    TEST_ASSERT_NULL(q.remove(0x100, 1, true, false));   // Late, but only normal requested
+    TEST_ASSERT_NULL(q.remove(0x100, 2, false, true));   // Normal, but only late requested
+    TEST_ASSERT_NULL(q.remove(0x100, 2, true, true, 5)); // Hop limit not lower than 5
+
+    meshtastic_MeshPacket *p = q.remove(0x100, 2, true, true, 6);
+    TEST_ASSERT_NOT_NULL(p);
+    packetPool.release(p);
+    p = q.remove(0x100, 1, false, true);
+    TEST_ASSERT_NOT_NULL(p);
+    packetPool.release(p);
+    TEST_ASSERT_TRUE(q.empty());
+}
+
+// Moving a packet into the late window is remove + re-enqueue, like RadioLibInterface::clampToLateRebroadcastWindow
+static void test_requeue_into_late_window()
+{
+    MeshPacketQueue q(QUEUE_LEN);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_HIGH));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_BACKGROUND));
+
+    meshtastic_MeshPacket *p = q.remove(0x100, 1, true, false);
+    p->tx_after = millis() + 1000;
+    TEST_ASSERT_TRUE(q.enqueue(p));
+    TEST_ASSERT_NULL(q.remove(0x100, 1, true, false)); // Not in the normal window anymore
+
+    p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(2, p->id);
+    packetPool.release(p);
+    p = q.dequeue();
+    TEST_ASSERT_EQUAL_UINT32(1, p->id);
+    packetPool.release(p);
+}
+
+// --- Full queue ---
+
+static void test_full_queue_evicts_lowest_priority()
+{
+    MeshPacketQueue q(4);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_BACKGROUND));
+    q.enqueue(makePacket(0x100, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x100, 4, meshtastic_MeshPacket_Priority_HIGH));
+    TEST_ASSERT_EQUAL(0, q.getFree());
+
+    bool dropped = false;
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x100, 5, meshtastic_MeshPacket_Priority_RELIABLE), &dropped));
+    TEST_ASSERT_TRUE(dropped);
+    TEST_ASSERT_FALSE(q.find(0x100, 2));
+    TEST_ASSERT_TRUE(q.find(0x100, 5));
+
+    // Nothing of lower priority than BACKGROUND left to evict
+    meshtastic_MeshPacket *p = makePacket(0x100, 6, meshtastic_MeshPacket_Priority_BACKGROUND);
+    TEST_ASSERT_FALSE(q.enqueue(p, &dropped));
+    TEST_ASSERT_TRUE(dropped);
+    packetPool.release(p);
+    drain(q);
+}
+
+static void test_full_queue_evicts_non_late_before_late()
+{
+    MeshPacketQueue q(2);
+    q.enqueue(makePacket(0x100, 1, meshtastic_MeshPacket_Priority_BACKGROUND));
+    q.enqueue(makePacket(0x100, 2, meshtastic_MeshPacket_Priority_DEFAULT, millis() + 1000));
+
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x100, 3, meshtastic_MeshPacket_Priority_HIGH)));
+    TEST_ASSERT_FALSE(q.find(0x100, 1));
+    TEST_ASSERT_TRUE(q.find(0x100, 2));
+    drain(q);
+}
+
+// --- Unity lifecycle ---
+
+void setUp(void)
+{
+    myNodeInfo.my_node_num = OUR_NODE;
+    nodeDB = testNodeDB;
+}
+
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    testNodeDB = new NodeDB();
+    UNITY_BEGIN();
+    RUN_TEST(test_higher_priority_goes_first);
+    RUN_TEST(test_equal_packets_stay_fifo);
+    RUN_TEST(test_late_window_goes_last);
+    RUN_TEST(test_relayed_before_own_at_equal_priority);
+    RUN_TEST(test_random_mix_matches_stable_sort);
+    RUN_TEST(test_find_and_remove_by_from_and_id);
+    RUN_TEST(test_locally_generated_is_found_by_our_node_num);
+    RUN_TEST(test_remove_honours_late_and_hop_limit_filters);
+    RUN_TEST(test_requeue_into_late_window);
+    RUN_TEST(test_full_queue_evicts_lowest_priority);
+    RUN_TEST(test_full_queue_evicts_non_late_before_late);
+    exit(UNITY_END());
+}
+
+void loop() {}
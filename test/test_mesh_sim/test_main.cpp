@@ -0,0 +1,865 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+// The firmware's timers only run on simulated time with the virtual millis() from TestUtil, which the native test build has on
+// Linux
+#if defined(ARCH_PORTDUINO) && defined(TEST_VIRTUAL_MILLIS)
+
+#include "FSCommon.h"
+#include "airtime.h"
+#include "gps/RTC.h"
+#include "mesh/Channels.h"
+#include "mesh/CryptoEngine.h"
+#include "mesh/MeshPacketQueue.h"
+#include "mesh/MeshRadio.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "mesh/RadioInterface.h"
+#include "mesh/ReliableRouter.h"
+#include "meshUtils.h"
+#include "modules/RoutingModule.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+/*
+ * Deterministic discrete-event mesh simulator
+ *
+ * Every simulated node runs its own NodeDB, ReliableRouter (with its PacketHistory) and a SimNodeRadio, the same stack
+ * meshtasticd runs. The firmware reaches them through globals (nodeDB, router, config, myNodeInfo, owner), so the simulator
+ * swaps those to the node an event belongs to before handing it a packet. Radios only talk to the simulator: airtime comes
+ * from RadioInterface::getPacketTime(), transmit delays from the same contention window logic as SimRadio, and the channel is
+ * modelled with a per-link SNR, carrier sense, half duplex and collisions with capture.
+ *
+ * All time is virtual: millis() returns the simulation clock, so PacketHistory expiry and the retransmission deadlines of
+ * NextHopRouter and ReliableRouter follow it. Each router runs after every packet it gets and again at the deadline its
+ * runOnce() returns, which is how retransmissions, next hop fallback and the floods they end in get on the air. A run over
+ * hundreds of nodes takes seconds and the same seed gives the same result.
+ *
+ * Run results are printed as CSV and JSON lines. Set MESH_SIM_OUT=<path prefix> to also append them to <prefix>.csv and
+ * <prefix>.jsonl, so routing changes can be compared run by run.
+ */
+
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 400
+
+// --- Simulation model ---
+
+enum SimTopology { TOPOLOGY_LINE, TOPOLOGY_GRID, TOPOLOGY_RANDOM };
+
+struct SimConfig {
+    const char *label = "mesh";
+    SimTopology topology = TOPOLOGY_RANDOM;
+    uint32_t numNodes = 50;
+    float spacingKm = 4;     // LINE and GRID: distance between neighbouring nodes
+    float avgNeighbors = 8;  // RANDOM: the area is sized so a node has this many others in range on average
+    uint32_t seed = 1;       // Seeds the topology, the traffic, the link losses and the firmware's random()
+    uint32_t numPackets = 20;
+    uint32_t packetIntervalMsec = 60 * 1000; // Mean time between originated packets
+    int32_t source = -1;                     // Node that originates every packet, -1 for a random node each time
+    uint8_t payloadLen = 32;
+    uint8_t hopLimit = 3;
+    float dmFraction = 0;     // Share of packets sent to one random node instead of broadcast
+    bool dmWantAck = true;    // DMs ask for an ACK like the apps do, so the sender retransmits until it gets one
+    float routerFraction = 0; // Share of nodes with the ROUTER role, the others are CLIENT
+
+    // Link model: log-distance path loss with static per-link shadowing, LongFast demodulation floor
+    float snrAt1Km = 10;
+    float pathLossExponent = 3;
+    float shadowingDb = 4;
+    float demodFloorSnr = -17.5;
+    float captureDb = 6; // An overlapping reception survives if it is at least this much stronger than the other
+
+    // The first this many transmissions of the run reach nobody, to exercise retransmission
+    uint32_t lostTransmissions = 0;
+};
+
+struct SimMetrics {
+    uint32_t nodes = 0, links = 0, packets = 0;
+    uint32_t expected = 0, delivered = 0; // Receptions by intended recipients, the first copy only
+    uint32_t transmissions = 0, relays = 0;
+    uint32_t retransmissions = 0; // Packets a node put on the air again after already sending them
+    uint32_t rxDupe = 0, txRelayCanceled = 0, txDropped = 0;
+    uint32_t collisions = 0, linkLosses = 0;
+    uint32_t latencyMeanMsec = 0, latencyP95Msec = 0, latencyMaxMsec = 0;
+    float channelUtilization = 0; // Percentage of the run the channel was busy, averaged over nodes
+    uint32_t simulatedMsec = 0, wallMsec = 0;
+};
+
+class MeshSim;
+
+/// What millis() returns when a run starts, clear of 0, which some firmware timestamps take as "never"
+static const uint32_t SIM_START_MSEC = 1000 * 1000;
+
+/// Set the RTC to the wall clock as of the current millis(), so getTime() stays sane when millis() changes clocks
+static void setClock()
+{
+    struct timeval tv = {time(NULL), 0};
+    perhapsSetRTC(RTCQualityNTP, &tv, true);
+}
+
+/** The radio of one simulated node, transmit timing follows SimRadio and RadioLibInterface */
+class SimNodeRadio : public RadioInterface
+{
+  public:
+    SimNodeRadio(MeshSim &_sim, uint32_t _node) : sim(_sim), node(_node)
+    {
+        // LongFast
+        bw = 250;
+        sf = 11;
+        cr = 5;
+        slotTimeMsec = computeSlotTimeMsec();
+        preambleTimeMsec = preambleLength * (pow_of_2(sf) / bw);
+    }
+
+    ~SimNodeRadio() override
+    {
+        meshtastic_MeshPacket *p;
+        while ((p = txQueue.dequeue()) != NULL)
+            packetPool.release(p);
+    }
+
+    using RadioInterface::getPacketTime;
+
+    ErrorCode send(meshtastic_MeshPacket *p) override;
+
+    bool cancelSending(NodeNum from, PacketId id) override
+    {
+        meshtastic_MeshPacket *p = txQueue.remove(from, id);
+        if (p)
+            packetPool.release(p);
+        return p != NULL;
+    }
+
+    bool findInTxQueue(NodeNum from, PacketId id) override { return txQueue.find(from, id); }
+
+    bool removePendingTXPacket(NodeNum from, PacketId id, uint32_t hop_limit_lt) override
+    {
+        meshtastic_MeshPacket *p = txQueue.remove(from, id, true, true, hop_limit_lt);
+        if (p)
+            packetPool.release(p);
+        return p != NULL;
+    }
+
+    /// Same LoRa time-on-air formula as SimRadio
+    uint32_t getPacketTime(uint32_t pl, bool received = false) override
+    {
+        float bandwidthHz = bw * 1000.0f;
+        float tSym = (1 << sf) / bandwidthHz;
+        bool lowDataOptEn = tSym > 16e-3;
+        float tPreamble = (preambleLength + 4.25f) * tSym;
+        float numPayloadSym = 8 + std::max(ceilf(((8.0f * pl - 4 * sf + 28 + 16) / (4 * (sf - 2 * lowDataOptEn))) * cr), 0.0f);
+        return (tPreamble + numPayloadSym * tSym) * 1000;
+    }
+
+    /// getTxDelayMsec() for an idle channel, the simulated nodes have no AirTime of their own
+    uint32_t getBackoffMsec() { return random(0, pow_of_2(CWmin)) * slotTimeMsec; }
+
+    MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
+    uint32_t txDrop = 0;
+
+  private:
+    MeshSim &sim;
+    uint32_t node;
+};
+
+/** The router meshtasticd runs, driven by the simulator on its virtual clock rather than by the thread scheduler */
+class SimRouter : public ReliableRouter
+{
+  public:
+    SimRouter() { concurrency::mainController.remove(this); } // The simulation runs each router on its own clock
+};
+
+class MeshSim
+{
+    enum EventType { EV_ORIGINATE, EV_TX_TIMER, EV_TX_DONE, EV_RX_DONE, EV_ROUTER };
+
+    struct Event {
+        uint64_t at;
+        uint64_t seq; // Orders events at the same time, keeps runs deterministic
+        EventType type;
+        uint32_t node;
+        uint32_t arg;
+        bool operator>(const Event &o) const { return at != o.at ? at > o.at : seq > o.seq; }
+    };
+
+    struct Link {
+        uint32_t to;
+        float snr;
+    };
+
+    struct Reception {
+        uint32_t tx;
+        float snr;
+        bool corrupted;
+        bool lost;
+    };
+
+    struct Transmission {
+        meshtastic_MeshPacket packet;
+    };
+
+    struct Node {
+        NodeNum num = 0;
+        float x = 0, y = 0;
+        NodeDB *db = nullptr;
+        SimRouter *router = nullptr;
+        SimNodeRadio *radio = nullptr; // Owned by router
+        meshtastic_LocalConfig config = meshtastic_LocalConfig_init_zero;
+        meshtastic_MyNodeInfo info = meshtastic_MyNodeInfo_init_zero;
+        meshtastic_User user = meshtastic_User_init_zero;
+        std::vector<Link> links;
+
+        // Radio state
+        bool transmitting = false;
+        bool timerPending = false;
+        uint32_t timerGen = 0;
+        std::vector<uint32_t> receiving; // Indexes into receptions
+        uint32_t busyCount = 0;          // Own transmission plus receptions in progress
+        uint64_t busySince = 0, busyMsec = 0;
+
+        // Router state
+        uint32_t routerGen = 0;         // Only the latest EV_ROUTER wakeup counts
+        std::set<uint64_t> sentPackets; // flowKey() of every packet this node transmitted
+    };
+
+    struct Flow {
+        uint64_t start;
+        NodeNum to;
+        std::vector<bool> reached;
+    };
+
+    const SimConfig cfg;
+    std::mt19937 rng;
+    std::vector<Node> nodes;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t nextSeq = 0;
+    std::vector<Transmission> transmissions;
+    std::vector<Reception> receptions;
+    std::vector<Flow> flows;
+    std::map<uint64_t, uint32_t> flowByKey; // (from, id) -> index into flows
+    std::vector<uint32_t> latencies;
+    SimMetrics m;
+
+    static uint64_t flowKey(NodeNum from, PacketId id) { return ((uint64_t)from << 32) | id; }
+
+    float uniform() { return std::uniform_real_distribution<float>(0, 1)(rng); }
+
+    void schedule(uint64_t at, EventType type, uint32_t node, uint32_t arg = 0)
+    {
+        events.push(Event{at, nextSeq++, type, node, arg});
+    }
+
+    /// Move the simulation clock, which is also what the firmware's millis() returns
+    void advanceTo(uint64_t at)
+    {
+        now = at;
+        testSetMillis(SIM_START_MSEC + now);
+    }
+
+    /// Point the firmware globals at this node's stack
+    void activate(Node &n)
+    {
+        nodeDB = n.db;
+        router = n.router;
+        config = n.config;
+        myNodeInfo = n.info;
+        owner = n.user;
+    }
+
+    void busyStart(Node &n)
+    {
+        if (n.busyCount++ == 0)
+            n.busySince = now;
+    }
+
+    void busyEnd(Node &n)
+    {
+        if (--n.busyCount == 0)
+            n.busyMsec += now - n.busySince;
+    }
+
+    void placeNodes()
+    {
+        float rangeKm = powf(10, (cfg.snrAt1Km - cfg.demodFloorSnr) / (10 * cfg.pathLossExponent));
+        uint32_t cols = ceilf(sqrtf(cfg.numNodes));
+        float side = rangeKm * sqrtf(M_PI * cfg.numNodes / std::max(cfg.avgNeighbors, 1.0f));
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            Node &n = nodes[i];
+            switch (cfg.topology) {
+            case TOPOLOGY_LINE:
+                n.x = i * cfg.spacingKm;
+                break;
+            case TOPOLOGY_GRID:
+                n.x = (i % cols) * cfg.spacingKm;
+                n.y = (i / cols) * cfg.spacingKm;
+                break;
+            case TOPOLOGY_RANDOM:
+                n.x = uniform() * side;
+                n.y = uniform() * side;
+                break;
+            }
+        }
+    }
+
+    void connectNodes()
+    {
+        std::normal_distribution<float> shadowing(0, cfg.shadowingDb);
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            for (uint32_t j = i + 1; j < nodes.size(); j++) {
+                float d = std::max(hypotf(nodes[i].x - nodes[j].x, nodes[i].y - nodes[j].y), 0.01f);
+                float snr = cfg.snrAt1Km - 10 * cfg.pathLossExponent * log10f(d);
+                if (cfg.topology == TOPOLOGY_RANDOM && cfg.shadowingDb > 0)
+                    snr += shadowing(rng);
+                if (snr < cfg.demodFloorSnr - 3) // Below the floor even carrier sense stops working
+                    continue;
+                nodes[i].links.push_back(Link{j, snr});
+                nodes[j].links.push_back(Link{i, snr});
+                m.links++;
+            }
+        }
+    }
+
+    void createNode(uint32_t i)
+    {
+        Node &n = nodes[i];
+        do {
+            n.num = 0x01000000 | (rng() & 0x00FFFFFF);
+        } while (std::any_of(nodes.begin(), nodes.begin() + i, [&](const Node &o) { return o.num == n.num; }));
+
+        // NodeDB keeps the node number in myNodeInfo unless it loads another one, don't let it see what the previous node saved
+#ifdef FSCom
+        FSCom.remove(deviceStateFileName);
+        FSCom.remove(nodeDatabaseFileName);
+        FSCom.remove(nodeJournalFileName);
+#endif
+        myNodeInfo = meshtastic_MyNodeInfo_init_zero;
+        myNodeInfo.my_node_num = n.num;
+        n.db = nodeDB = new NodeDB();
+        n.info = myNodeInfo;
+        n.user = owner;
+
+        n.config = config;
+        n.config.device.role = uniform() < cfg.routerFraction ? meshtastic_Config_DeviceConfig_Role_ROUTER
+                                                              : meshtastic_Config_DeviceConfig_Role_CLIENT;
+        n.config.device.rebroadcast_mode = meshtastic_Config_DeviceConfig_RebroadcastMode_ALL;
+        n.config.lora.region = meshtastic_Config_LoRaConfig_RegionCode_US;
+        n.config.lora.use_preset = true;
+        n.config.lora.modem_preset = meshtastic_Config_LoRaConfig_ModemPreset_LONG_FAST;
+        n.config.lora.hop_limit = cfg.hopLimit;
+        n.config.lora.override_duty_cycle = true;
+        n.config.lora.ignore_incoming_count = 0;
+        n.user.role = n.config.device.role;
+        activate(n);
+        initRegion();
+
+        // Every Router creates the crypt lock, they all share the first one
+        concurrency::Lock *sharedLock = cryptLock;
+        cryptLock = nullptr;
+        n.router = new SimRouter();
+        if (sharedLock) {
+            delete cryptLock;
+            cryptLock = sharedLock;
+        }
+        n.radio = new SimNodeRadio(*this, i);
+        n.router->addInterface(std::unique_ptr<RadioInterface>(n.radio));
+    }
+
+    void originate(uint32_t src, uint32_t dst)
+    {
+        Node &n = nodes[src];
+        activate(n);
+        meshtastic_MeshPacket *p = router->allocForSending();
+        p->to = dst < nodes.size() ? nodes[dst].num : NODENUM_BROADCAST;
+        p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+        p->decoded.payload.size = cfg.payloadLen;
+        memset(p->decoded.payload.bytes, 'x', cfg.payloadLen);
+
+        Flow f = {now, p->to, std::vector<bool>(nodes.size(), false)};
+        f.reached[src] = true;
+        flowByKey[flowKey(p->from, p->id)] = flows.size();
+        flows.push_back(f);
+        m.packets++;
+        m.expected += isBroadcast(p->to) ? nodes.size() - 1 : 1;
+
+        if (!isBroadcast(p->to))
+            p->want_ack = cfg.dmWantAck;
+
+        router->sendLocal(p, RX_SRC_USER);
+        runRouter(src);
+    }
+
+    void startTransmit(uint32_t i)
+    {
+        Node &n = nodes[i];
+        meshtastic_MeshPacket *p = n.radio->txQueue.dequeue();
+        activate(n);
+        uint32_t airtime = n.radio->getPacketTime(p);
+
+        uint32_t tx = transmissions.size();
+        transmissions.push_back(Transmission{*p});
+        m.transmissions++;
+        if (p->from != n.num)
+            m.relays++;
+        if (!n.sentPackets.insert(flowKey(p->from, p->id)).second)
+            m.retransmissions++;
+        bool lost = m.transmissions <= cfg.lostTransmissions;
+        packetPool.release(p);
+
+        n.transmitting = true;
+        busyStart(n);
+        schedule(now + airtime, EV_TX_DONE, i);
+
+        for (const Link &l : n.links) {
+            Node &rx = nodes[l.to];
+            uint32_t r = receptions.size();
+            receptions.push_back(Reception{tx, l.snr, rx.transmitting, lost}); // Half duplex
+            for (uint32_t other : rx.receiving) {
+                Reception &o = receptions[other];
+                if (l.snr < o.snr + cfg.captureDb)
+                    receptions[r].corrupted = true;
+                if (o.snr < l.snr + cfg.captureDb)
+                    o.corrupted = true;
+            }
+            rx.receiving.push_back(r);
+            busyStart(rx);
+            schedule(now + airtime, EV_RX_DONE, l.to, r);
+        }
+    }
+
+    void finishReceive(uint32_t i, uint32_t r)
+    {
+        Node &n = nodes[i];
+        n.receiving.erase(std::find(n.receiving.begin(), n.receiving.end(), r));
+        busyEnd(n);
+
+        const Reception &rec = receptions[r];
+        if (rec.corrupted) {
+            m.collisions++;
+            return;
+        }
+        // Logistic packet success curve around the demodulation floor
+        if (uniform() > 1 / (1 + expf(-1.5f * (rec.snr - cfg.demodFloorSnr))) || rec.lost) {
+            m.linkLosses++;
+            return;
+        }
+
+        // Rebuild the packet from what went over the air, like the radio driver does
+        const meshtastic_MeshPacket &sent = transmissions[rec.tx].packet;
+        meshtastic_MeshPacket *p = packetPool.allocZeroed();
+        p->from = sent.from;
+        p->to = sent.to;
+        p->id = sent.id;
+        p->channel = sent.channel;
+        p->hop_limit = sent.hop_limit;
+        p->hop_start = sent.hop_start;
+        p->want_ack = sent.want_ack;
+        p->via_mqtt = sent.via_mqtt;
+        p->next_hop = sent.next_hop;
+        p->relay_node = sent.relay_node;
+        p->which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+        p->encrypted = sent.encrypted;
+        p->rx_snr = rec.snr;
+        p->rx_rssi = (int32_t)(rec.snr - 120);
+        p->transport_mechanism = meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA;
+
+        auto it = flowByKey.find(flowKey(p->from, p->id));
+        if (it != flowByKey.end()) {
+            Flow &f = flows[it->second];
+            if (!f.reached[i] && (isBroadcast(f.to) || f.to == n.num)) {
+                f.reached[i] = true;
+                m.delivered++;
+                latencies.push_back(now - f.start);
+            }
+        }
+
+        activate(n);
+        router->enqueueReceivedMessage(p);
+        runRouter(i);
+    }
+
+    /// Let a router handle what it was given and do its due retransmissions, then wake it again at its next deadline
+    void runRouter(uint32_t i)
+    {
+        Node &n = nodes[i];
+        activate(n);
+        int32_t delay = n.router->runOnce();
+        drainPhoneQueue();
+        if (delay != INT32_MAX)
+            schedule(now + std::max<int32_t>(delay, 1), EV_ROUTER, i, ++n.routerGen);
+    }
+
+    void drainPhoneQueue()
+    {
+        meshtastic_MeshPacket *p;
+        while ((p = service->getForPhone()) != NULL)
+            service->releaseToPool(p);
+    }
+
+    void finishMetrics()
+    {
+        m.nodes = nodes.size();
+        m.simulatedMsec = now;
+        for (Node &n : nodes) {
+            m.rxDupe += n.router->rxDupe;
+            m.txRelayCanceled += n.router->txRelayCanceled;
+            m.txDropped += n.radio->txDrop;
+            m.channelUtilization += now ? 100.0f * n.busyMsec / now : 0;
+        }
+        m.channelUtilization /= std::max<size_t>(nodes.size(), 1);
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            uint64_t sum = 0;
+            for (uint32_t l : latencies)
+                sum += l;
+            m.latencyMeanMsec = sum / latencies.size();
+            m.latencyP95Msec = latencies[(latencies.size() - 1) * 95 / 100];
+            m.latencyMaxMsec = latencies.back();
+        }
+    }
+
+  public:
+    uint64_t now = 0;
+
+    explicit MeshSim(const SimConfig &_cfg) : cfg(_cfg), rng(_cfg.seed), nodes(_cfg.numNodes) {}
+
+    ~MeshSim()
+    {
+        for (Node &n : nodes) {
+            delete n.router;
+            delete n.db;
+        }
+        nodeDB = nullptr;
+        router = nullptr;
+        testUseRealMillis();
+        setClock();
+    }
+
+    /** A radio asked to send, start its transmit timer unless one is running */
+    void onRadioSend(uint32_t i, meshtastic_MeshPacket *p)
+    {
+        Node &n = nodes[i];
+        if (n.transmitting || n.timerPending)
+            return;
+        // SimRadio: packets without an SNR are our own and get a random delay, relays are delayed by their SNR
+        uint32_t delay = (p->rx_snr == 0 && p->rx_rssi == 0) ? n.radio->getBackoffMsec() : n.radio->getTxDelayMsecWeighted(p);
+        n.timerPending = true;
+        schedule(now + delay, EV_TX_TIMER, i, ++n.timerGen);
+    }
+
+    SimMetrics run()
+    {
+        auto wallStart = std::chrono::steady_clock::now();
+
+        // Nodes are created on the simulation clock already, so everything they time stamp is on it
+        advanceTo(0);
+        setClock();
+        placeNodes();
+        connectNodes();
+        for (uint32_t i = 0; i < nodes.size(); i++)
+            createNode(i);
+        channels.initDefaults(); // Every NodeDB loaded the channels from disk, make sure all nodes share the default one
+        channels.onConfigChanged();
+
+        // The first packet id draws one extra random number, get that out of the way so every run sees the same sequence
+        generatePacketId();
+        randomSeed(cfg.seed);
+
+        std::exponential_distribution<float> interval(1.0f / cfg.packetIntervalMsec);
+        uint64_t at = 0;
+        for (uint32_t k = 0; k < cfg.numPackets; k++) {
+            at += (uint64_t)interval(rng) + 1;
+            uint32_t src = cfg.source >= 0 ? cfg.source : rng() % nodes.size();
+            uint32_t dst = UINT32_MAX;
+            if (nodes.size() > 1 && uniform() < cfg.dmFraction)
+                dst = (src + 1 + rng() % (nodes.size() - 1)) % nodes.size();
+            schedule(at, EV_ORIGINATE, src, dst);
+        }
+
+        while (!events.empty()) {
+            Event e = events.top();
+            events.pop();
+            advanceTo(e.at);
+            Node &n = nodes[e.node];
+            switch (e.type) {
+            case EV_ORIGINATE:
+                originate(e.node, e.arg);
+                break;
+            case EV_TX_TIMER:
+                if (e.arg != n.timerGen)
+                    break;
+                n.timerPending = false;
+                if (n.transmitting || n.radio->txQueue.empty())
+                    break;
+                if (n.busyCount > 0) { // Channel active, back off like RadioLibInterface does
+                    n.timerPending = true;
+                    schedule(now + n.radio->getBackoffMsec(), EV_TX_TIMER, e.node, ++n.timerGen);
+                } else {
+                    startTransmit(e.node);
+                }
+                break;
+            case EV_TX_DONE:
+                n.transmitting = false;
+                busyEnd(n);
+                if (!n.radio->txQueue.empty() && !n.timerPending) {
+                    n.timerPending = true;
+                    schedule(now + n.radio->getBackoffMsec(), EV_TX_TIMER, e.node, ++n.timerGen);
+                }
+                break;
+            case EV_RX_DONE:
+                finishReceive(e.node, e.arg);
+                break;
+            case EV_ROUTER:
+                if (e.arg == n.routerGen)
+                    runRouter(e.node);
+                break;
+            }
+        }
+
+        finishMetrics();
+        m.wallMsec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wallStart).count();
+        return m;
+    }
+};
+
+ErrorCode SimNodeRadio::send(meshtastic_MeshPacket *p)
+{
+    bool dropped = false;
+    if (!txQueue.enqueue(p, &dropped)) {
+        txDrop++;
+        packetPool.release(p);
+        return ERRNO_UNKNOWN;
+    }
+    if (dropped)
+        txDrop++;
+    sim.onRadioSend(node, p);
+    return ERRNO_OK;
+}
+
+// --- Metrics output ---
+
+static const char *CSV_HEADER = "label,seed,nodes,links,packets,expected,delivered,reach,transmissions,relays,retransmissions,"
+                                "tx_per_packet,rx_dupe,tx_relay_canceled,tx_dropped,collisions,link_losses,latency_mean_ms,"
+                                "latency_p95_ms,latency_max_ms,channel_util,simulated_ms,wall_ms";
+
+static float reachOf(const SimMetrics &m)
+{
+    return m.expected ? (float)m.delivered / m.expected : 0;
+}
+
+static void formatCsv(char *buf, size_t len, const SimConfig &cfg, const SimMetrics &m)
+{
+    snprintf(buf, len, "%s,%u,%u,%u,%u,%u,%u,%.4f,%u,%u,%u,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%u,%u", cfg.label, cfg.seed,
+             m.nodes, m.links, m.packets, m.expected, m.delivered, reachOf(m), m.transmissions, m.relays, m.retransmissions,
+             m.packets ? (float)m.transmissions / m.packets : 0, m.rxDupe, m.txRelayCanceled, m.txDropped, m.collisions,
+             m.linkLosses, m.latencyMeanMsec, m.latencyP95Msec, m.latencyMaxMsec, m.channelUtilization, m.simulatedMsec,
+             m.wallMsec);
+}
+
+static void formatJson(char *buf, size_t len, const SimConfig &cfg, const SimMetrics &m)
+{
+    snprintf(buf, len,
+             "{\"label\":\"%s\",\"seed\":%u,\"nodes\":%u,\"links\":%u,\"packets\":%u,\"expected\":%u,\"delivered\":%u,"
+             "\"reach\":%.4f,\"transmissions\":%u,\"relays\":%u,\"retransmissions\":%u,\"rx_dupe\":%u,"
+             "\"tx_relay_canceled\":%u,\"tx_dropped\":%u,\"collisions\":%u,\"link_losses\":%u,\"latency_mean_ms\":%u,"
+             "\"latency_p95_ms\":%u,\"latency_max_ms\":%u,\"channel_util\":%.3f,\"simulated_ms\":%u,\"wall_ms\":%u}",
+             cfg.label, cfg.seed, m.nodes, m.links, m.packets, m.expected, m.delivered, reachOf(m), m.transmissions, m.relays,
+             m.retransmissions, m.rxDupe, m.txRelayCanceled, m.txDropped, m.collisions, m.linkLosses, m.latencyMeanMsec,
+             m.latencyP95Msec, m.latencyMaxMsec, m.channelUtilization, m.simulatedMsec, m.wallMsec);
+}
+
+static void appendLine(const char *path, const char *header, const char *line)
+{
+    FILE *f = fopen(path, "a");
+    if (!f)
+        return;
+    fseek(f, 0, SEEK_END);
+    if (header && ftell(f) == 0)
+        fprintf(f, "%s\n", header);
+    fprintf(f, "%s\n", line);
+    fclose(f);
+}
+
+static SimMetrics runAndReport(const SimConfig &cfg)
+{
+    SimMetrics m = MeshSim(cfg).run();
+
+    char csv[MSG_BUF_LEN], json[2 * MSG_BUF_LEN];
+    formatCsv(csv, sizeof(csv), cfg, m);
+    formatJson(json, sizeof(json), cfg, m);
+    TEST_MESSAGE(csv);
+    TEST_MESSAGE(json);
+
+    const char *out = getenv("MESH_SIM_OUT");
+    if (out && *out) {
+        std::string prefix(out);
+        appendLine((prefix + ".csv").c_str(), CSV_HEADER, csv);
+        appendLine((prefix + ".jsonl").c_str(), nullptr, json);
+    }
+    return m;
+}
+
+// --- Tests ---
+
+/// Nodes 1km apart in a line, neighbours hear each other at 10dB and nodes two hops apart not at all
+static SimConfig lineConfig(const char *label, uint32_t numNodes, uint8_t hopLimit)
+{
+    SimConfig cfg;
+    cfg.label = label;
+    cfg.topology = TOPOLOGY_LINE;
+    cfg.numNodes = numNodes;
+    cfg.spacingKm = 1;
+    cfg.pathLossExponent = 30;
+    cfg.hopLimit = hopLimit;
+    cfg.numPackets = 1;
+    cfg.source = 0;
+    return cfg;
+}
+
+// 0 - 1 - 2 - 3: every node relays the flood once, and hears the next relay as a duplicate
+static void test_line_flood_reaches_every_node()
+{
+    SimMetrics m = runAndReport(lineConfig("line4", 4, 3));
+    TEST_ASSERT_EQUAL_UINT32(3, m.links);
+    TEST_ASSERT_EQUAL_UINT32(0, m.collisions);
+    TEST_ASSERT_EQUAL_UINT32(0, m.linkLosses);
+    TEST_ASSERT_EQUAL_UINT32(3, m.expected);
+    TEST_ASSERT_EQUAL_UINT32(3, m.delivered);
+    TEST_ASSERT_EQUAL_UINT32(4, m.transmissions);
+    TEST_ASSERT_EQUAL_UINT32(3, m.relays);
+    TEST_ASSERT_EQUAL_UINT32(3, m.rxDupe);
+    TEST_ASSERT_EQUAL_UINT32(0, m.txRelayCanceled);
+}
+
+// With a hop limit of 2 the flood stops three nodes down the line, the last one doesn't relay
+static void test_hop_limit_bounds_flood()
+{
+    SimMetrics m = runAndReport(lineConfig("line6_hop2", 6, 2));
+    TEST_ASSERT_EQUAL_UINT32(5, m.links);
+    TEST_ASSERT_EQUAL_UINT32(3, m.delivered);
+    TEST_ASSERT_EQUAL_UINT32(3, m.transmissions);
+    TEST_ASSERT_EQUAL_UINT32(2, m.relays);
+}
+
+// 0 - 1: the first copy of a DM is lost, so the sender retransmits it when its ACK doesn't come in time
+static void test_lost_dm_is_retransmitted()
+{
+    SimConfig cfg = lineConfig("line2_lost_dm", 2, 3);
+    cfg.dmFraction = 1;
+    cfg.lostTransmissions = 1;
+
+    SimMetrics m = runAndReport(cfg);
+    TEST_ASSERT_EQUAL_UINT32(1, m.expected);
+    TEST_ASSERT_EQUAL_UINT32(1, m.linkLosses);
+    // The only way the DM got there
+    TEST_ASSERT_EQUAL_UINT32(1, m.delivered);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, m.retransmissions);
+
+    // It only went out again once the sender gave up waiting for the ACK
+    cfg.label = "line2_dm";
+    cfg.lostTransmissions = 0;
+    SimMetrics direct = runAndReport(cfg);
+    TEST_ASSERT_EQUAL_UINT32(1, direct.delivered);
+    TEST_ASSERT_GREATER_THAN_UINT32(direct.latencyMaxMsec, m.latencyMaxMsec);
+}
+
+static void test_same_seed_same_result()
+{
+    SimConfig cfg;
+    cfg.label = "determinism";
+    cfg.numNodes = 30;
+    cfg.numPackets = 10;
+    cfg.seed = 7;
+
+    SimMetrics a = runAndReport(cfg);
+    SimMetrics b = runAndReport(cfg);
+    TEST_ASSERT_GREATER_THAN(0, a.delivered);
+    TEST_ASSERT_EQUAL_UINT32(a.links, b.links);
+    TEST_ASSERT_EQUAL_UINT32(a.delivered, b.delivered);
+    TEST_ASSERT_EQUAL_UINT32(a.transmissions, b.transmissions);
+    TEST_ASSERT_EQUAL_UINT32(a.retransmissions, b.retransmissions);
+    TEST_ASSERT_EQUAL_UINT32(a.rxDupe, b.rxDupe);
+    TEST_ASSERT_EQUAL_UINT32(a.txRelayCanceled, b.txRelayCanceled);
+    TEST_ASSERT_EQUAL_UINT32(a.collisions, b.collisions);
+    TEST_ASSERT_EQUAL_UINT32(a.latencyP95Msec, b.latencyP95Msec);
+}
+
+// Benchmark: flood efficiency, duplicate suppression and latency from 50 to 500 nodes, with and without routers
+static void test_benchmark_mesh_sizes()
+{
+    const uint32_t sizes[] = {50, 200, 500};
+    const char *labels[] = {"random50", "random200", "random500", "random50_routers", "random200_routers", "random500_routers"};
+
+    for (int withRouters = 0; withRouters < 2; withRouters++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            SimConfig cfg;
+            cfg.label = labels[withRouters * 3 + s];
+            cfg.numNodes = sizes[s];
+            cfg.numPackets = 20;
+            cfg.routerFraction = withRouters ? 0.1 : 0;
+            cfg.dmFraction = 0.2;
+
+            SimMetrics m = runAndReport(cfg);
+            TEST_ASSERT_GREATER_THAN(0, m.delivered);
+            TEST_ASSERT_GREATER_OR_EQUAL(m.packets, m.transmissions);
+        }
+    }
+}
+
+// --- Unity lifecycle ---
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    portduino_config.logoutputlevel = level_warn; // Hundreds of nodes logging every packet would drown the results
+    if (!service)
+        service = new MeshService();
+    if (!routingModule)
+        routingModule = new RoutingModule();
+    // Retransmission timing asks for the channel utilization. Nothing logs to this one, so every node sees an idle channel.
+    if (!airTime)
+        airTime = new AirTime();
+    UNITY_BEGIN();
+    RUN_TEST(test_line_flood_reaches_every_node);
+    RUN_TEST(test_hop_limit_bounds_flood);
+    RUN_TEST(test_lost_dm_is_retransmitted);
+    RUN_TEST(test_same_seed_same_result);
+    RUN_TEST(test_benchmark_mesh_sizes);
+    exit(UNITY_END());
+}
+
+void loop() {}
+
+#else // !ARCH_PORTDUINO || !TEST_VIRTUAL_MILLIS
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    exit(UNITY_END());
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,152 @@
+#include "../test_helpers.h"
+#include "NodeDB.h"
+#include "mesh-pb-constants.h"
+#include <new>
+#include <stdlib.h>
+
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
+// Count heap allocations, to see how much churn serializing a packet causes
+static uint32_t numAllocs;
+
+void *operator new(size_t size)
+{
+    numAllocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+/// The JSON the JSONValue based serializer made of a packet from create_test_packet(), with its payload and type
+static std::string expectedJson(const char *payload, const char *type)
+{
+    char json[512];
+    snprintf(json, sizeof(json),
+             "{\"channel\":0,\"from\":287454020,\"hop_start\":3,\"hops_away\":0,\"id\":39321,\"payload\":%s,\"rssi\":-85,"
+             "\"sender\":\"%s\",\"snr\":10.5,\"timestamp\":1609459200,\"to\":1432778632,\"type\":\"%s\"}",
+             payload, nodeDB->getNodeId().c_str(), type);
+    return json;
+}
+
+static meshtastic_MeshPacket create_text_packet(const char *text)
+{
+    return create_test_packet(meshtastic_PortNum_TEXT_MESSAGE_APP, reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+// The streamed JSON has to match what the DOM based serializer produced, byte for byte
+void test_streaming_matches_dom_output()
+{
+    meshtastic_MeshPacket packet = create_text_packet("Hello \"mesh\"/\t\x01!");
+    TEST_ASSERT_EQUAL_STRING(expectedJson("{\"text\":\"Hello \\\"mesh\\\"\\/\\t\\u0001!\"}", "text").c_str(),
+                             MeshPacketSerializer::JsonSerialize(&packet, false).c_str());
+
+    // JSON text is passed on as JSON, members sorted like JSONObject keeps them
+    packet = create_text_packet(" {\"b\":2,\"a\":[1,2.5,\"x\"]}");
+    TEST_ASSERT_EQUAL_STRING(expectedJson("{\"a\":[1,2.5,\"x\"],\"b\":2}", "text").c_str(),
+                             MeshPacketSerializer::JsonSerialize(&packet, false).c_str());
+
+    uint8_t buffer[256];
+    meshtastic_Position position = meshtastic_Position_init_zero;
+    position.has_latitude_i = true;
+    position.latitude_i = 374208000;
+    position.has_longitude_i = true;
+    position.longitude_i = -1221981000;
+    position.has_altitude = true;
+    position.altitude = 35;
+    position.time = 1609459100;
+    position.sats_in_view = 7;
+    size_t size = pb_encode_to_bytes(buffer, sizeof(buffer), &meshtastic_Position_msg, &position);
+    packet = create_test_packet(meshtastic_PortNum_POSITION_APP, buffer, size);
+    TEST_ASSERT_EQUAL_STRING(expectedJson("{\"altitude\":35,\"latitude_i\":374208000,\"longitude_i\":-1221981000,"
+                                          "\"sats_in_view\":7,\"time\":1609459100}",
+                                          "position")
+                                 .c_str(),
+                             MeshPacketSerializer::JsonSerialize(&packet, false).c_str());
+
+    // Floats show all the digits of their double value
+    meshtastic_Telemetry telemetry = meshtastic_Telemetry_init_zero;
+    telemetry.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    meshtastic_DeviceMetrics &metrics = telemetry.variant.device_metrics;
+    metrics.has_battery_level = true;
+    metrics.battery_level = 80;
+    metrics.has_voltage = true;
+    metrics.voltage = 3.7f;
+    metrics.has_channel_utilization = true;
+    metrics.channel_utilization = 12.5f;
+    metrics.has_air_util_tx = true;
+    metrics.air_util_tx = 0.1f;
+    metrics.has_uptime_seconds = true;
+    metrics.uptime_seconds = 3600;
+    size = pb_encode_to_bytes(buffer, sizeof(buffer), &meshtastic_Telemetry_msg, &telemetry);
+    packet = create_test_packet(meshtastic_PortNum_TELEMETRY_APP, buffer, size);
+    TEST_ASSERT_EQUAL_STRING(expectedJson("{\"air_util_tx\":0.100000001490116,\"battery_level\":80,\"channel_utilization\":12.5,"
+                                          "\"uptime_seconds\":3600,\"voltage\":3.70000004768372}",
+                                          "telemetry")
+                                 .c_str(),
+                             MeshPacketSerializer::JsonSerialize(&packet, false).c_str());
+}
+
+// A buffer that is too small gets a cut off, terminated string, and the length it should have had
+void test_streaming_small_buffer()
+{
+    meshtastic_MeshPacket packet = create_text_packet("Hello Meshtastic!");
+    std::string json = MeshPacketSerializer::JsonSerialize(&packet, false);
+
+    char buf[32];
+    memset(buf, 'x', sizeof(buf));
+    TEST_ASSERT_EQUAL(json.length(), MeshPacketSerializer::JsonSerialize(&packet, buf, sizeof(buf), false));
+    TEST_ASSERT_EQUAL_STRING(json.substr(0, sizeof(buf) - 1).c_str(), buf);
+
+    // Text that doesn't fit the default buffer still comes out whole as a std::string
+    std::string escaped(200, '\x01');
+    packet = create_text_packet(escaped.c_str());
+    json = MeshPacketSerializer::JsonSerialize(&packet, false);
+    TEST_ASSERT_GREATER_THAN(MESHPACKET_JSON_SIZE, json.length());
+    TEST_ASSERT_EQUAL('}', json.back());
+}
+
+// Benchmark: packets per second and heap allocations per packet, std::string API against a reused buffer
+void test_benchmark_streaming_serializer()
+{
+    const uint32_t numPackets = 20000;
+    meshtastic_MeshPacket packet = create_text_packet("Meet at the trailhead at 9, bring water");
+    char buf[MESHPACKET_JSON_SIZE];
+
+    uint32_t allocs = numAllocs;
+    uint32_t start = millis();
+    size_t total = 0;
+    for (uint32_t i = 0; i < numPackets; i++)
+        total += MeshPacketSerializer::JsonSerialize(&packet, false).length();
+    uint32_t stringElapsed = millis() - start;
+    uint32_t stringAllocs = numAllocs - allocs;
+
+    allocs = numAllocs;
+    start = millis();
+    for (uint32_t i = 0; i < numPackets; i++)
+        total -= MeshPacketSerializer::JsonSerialize(&packet, buf, sizeof(buf), false);
+    uint32_t bufElapsed = millis() - start;
+    uint32_t bufAllocs = numAllocs - allocs;
+
+    TEST_ASSERT_EQUAL(0, total);
+    TEST_MSG_FMT("packets=%u string=%ums (%u allocs/packet) buffer=%ums (%u allocs/packet)", numPackets, stringElapsed,
+                 stringAllocs / numPackets, bufElapsed, bufAllocs / numPackets);
+    TEST_ASSERT_EQUAL(0, bufAllocs);
+}
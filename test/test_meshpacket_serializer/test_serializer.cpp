@@ -19,6 +19,9 @@ void test_telemetry_environment_metrics_complete_coverage();
 void test_telemetry_environment_metrics_unset_fields();
 void test_encrypted_packet_serialization();
 void test_empty_encrypted_packet();
+void test_streaming_matches_dom_output();
+void test_streaming_small_buffer();
+void test_benchmark_streaming_serializer();
 
 void setup()
 {
@@ -52,6 +55,11 @@ void setup()
     RUN_TEST(test_encrypted_packet_serialization);
     RUN_TEST(test_empty_encrypted_packet);
 
+    // Streaming serializer tests
+    RUN_TEST(test_streaming_matches_dom_output);
+    RUN_TEST(test_streaming_small_buffer);
+    RUN_TEST(test_benchmark_streaming_serializer);
+
     UNITY_END();
 }
 
@@ -261,7 +261,7 @@ class MQTTUnitTest : public MQTT
     }
     using MQTT::isValidConfig;
     using MQTT::reconnect;
-    int queueSize() { return mqttQueue.numUsed(); }
+    int queueSize() { return getQueueStats().depth; }
     void reportToMap(std::optional<uint32_t> precision = std::nullopt)
     {
         if (precision.has_value())
@@ -513,6 +513,37 @@ void test_sendQueued(void)
     TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
 }
 
+// Test that the oldest queued MeshPackets are dropped when the queue is full, and the rest are published in order.
+void test_sendQueuedDropsOldest(void)
+{
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+
+    for (uint32_t i = 0; i < MAX_MQTT_QUEUE + 2; i++) {
+        meshtastic_MeshPacket p = decoded;
+        p.id = 100 + i;
+        mqtt->onSend(encrypted, p, 0);
+    }
+    const auto &stats = unitTest->getQueueStats();
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE, stats.depth);
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE, stats.highWater);
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE + 2, stats.queued);
+    TEST_ASSERT_EQUAL(2, stats.dropped);
+
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return pubsub->published_.size() == MAX_MQTT_QUEUE; }));
+    TEST_ASSERT_EQUAL(0, unitTest->queueSize());
+
+    uint32_t id = 102;
+    for (const auto &[topic, payload] : pubsub->published_) {
+        const DecodedServiceEnvelope &env = std::get<DecodedServiceEnvelope>(payload);
+        TEST_ASSERT_EQUAL_STRING("msh/2/e/test/!12345678", topic.c_str());
+        TEST_ASSERT_TRUE(env.validDecode);
+        TEST_ASSERT_EQUAL(id++, env.packet->id);
+    }
+}
+
 // Verify reconnecting with the proxy enabled does not reconnect to a MQTT server.
 void test_reconnectProxyDoesNotReconnectMqtt(void)
 {
@@ -888,6 +919,7 @@ void setup()
     RUN_TEST(test_noRangeTestAppOnDefaultServer);
     RUN_TEST(test_noDetectionSensorAppOnDefaultServer);
     RUN_TEST(test_sendQueued);
+    RUN_TEST(test_sendQueuedDropsOldest);
     RUN_TEST(test_reconnectProxyDoesNotReconnectMqtt);
     RUN_TEST(test_receiveEmptyMeshPacket);
     RUN_TEST(test_receiveDecodedProto);
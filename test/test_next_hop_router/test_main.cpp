@@ -0,0 +1,205 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+// Retransmission deadlines only come around quickly with the virtual millis() from TestUtil, which the native test build has on
+// Linux
+#if defined(ARCH_PORTDUINO) && defined(TEST_VIRTUAL_MILLIS)
+
+#include "FSCommon.h"
+#include "airtime.h"
+#include "gps/RTC.h"
+#include "mesh/Channels.h"
+#include "mesh/NextHopRouter.h"
+#include "mesh/NodeDB.h"
+#include "mesh/RadioInterface.h"
+#include "mesh/RoutingTable.h"
+#include <sys/time.h>
+#include <vector>
+
+static const NodeNum OUR_NODE = 0x01000044;
+static const NodeNum SENDER = 0x01000011;
+static const NodeNum DEST = 0x010000dd;
+static const uint8_t RELAY_A = 0xa1, RELAY_B = 0xb2, RELAY_C = 0xc3;
+
+/// What millis() returns when a test starts, clear of 0, which some firmware timestamps take as "never"
+static const uint32_t START_MSEC = 1000 * 1000;
+
+/** Stands in for the LoRa radio, it sends nothing and remembers the next hop of every packet it was given */
+class NextHopRecordingRadio : public RadioInterface
+{
+  public:
+    NextHopRecordingRadio()
+    {
+        // LongFast, so retransmissions wait as long as they do on the air
+        bw = 250;
+        sf = 11;
+        cr = 5;
+        slotTimeMsec = computeSlotTimeMsec();
+        preambleTimeMsec = preambleLength * (pow_of_2(sf) / bw);
+    }
+
+    ErrorCode send(meshtastic_MeshPacket *p) override
+    {
+        nextHops.push_back(p->next_hop);
+        packetPool.release(p);
+        return ERRNO_OK;
+    }
+
+    uint32_t getPacketTime(uint32_t totalPacketLen, bool received = false) override { return 1000; }
+
+    std::vector<uint8_t> nextHops;
+};
+
+/** The router a node runs, driven by the test on the virtual clock rather than by the thread scheduler */
+class TestRouter : public NextHopRouter
+{
+  public:
+    TestRouter() { concurrency::mainController.remove(this); }
+};
+
+static TestRouter *testRouter;
+static NextHopRecordingRadio *radio;
+
+/// Set the RTC to the wall clock as of the current millis(), so getTime() stays sane when millis() changes clocks
+static void setClock()
+{
+    struct timeval tv = {time(NULL), 0};
+    perhapsSetRTC(RTCQualityNTP, &tv, true);
+}
+
+/// A DM from another node that we relay, like the ones perhapsRebroadcast() hands to send()
+static meshtastic_MeshPacket *relayedPacket(PacketId id)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = SENDER;
+    p->to = DEST;
+    p->id = id;
+    p->hop_start = 3;
+    p->hop_limit = 2;
+    p->which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    p->encrypted.size = 16;
+    p->transport_mechanism = meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA;
+    return p;
+}
+
+/// Nobody relays what we send, so run the router at each retransmission deadline until it gives up
+static void runUntilRetransmissionsEnd()
+{
+    for (int i = 0; i < 10; i++) {
+        int32_t delay = testRouter->runOnce();
+        if (delay == INT32_MAX)
+            return;
+        testSetMillis(millis() + delay);
+    }
+    TEST_FAIL_MESSAGE("Retransmissions didn't end");
+}
+
+// Each retry goes through a candidate not tried yet, and only then does the packet fall back to flooding
+static void test_failover_then_flood()
+{
+    routingTable.learn(DEST, RELAY_A, RouteSource::ACK, millis());
+    routingTable.learn(DEST, RELAY_B, RouteSource::TRACEROUTE, millis());
+
+    testRouter->send(relayedPacket(1));
+    runUntilRetransmissionsEnd();
+
+    // After failing over to B, A (which already failed once) still ranks above flooding but must not be tried again
+    const uint8_t expected[] = {RELAY_A, RELAY_B, NO_NEXT_HOP_PREFERENCE};
+    TEST_ASSERT_EQUAL(sizeof(expected), radio->nextHops.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, radio->nextHops.data(), sizeof(expected));
+}
+
+static void test_failover_tries_every_candidate_once()
+{
+    routingTable.learn(DEST, RELAY_A, RouteSource::ACK, millis());
+    routingTable.learn(DEST, RELAY_B, RouteSource::TRACEROUTE, millis());
+    routingTable.learn(DEST, RELAY_C, RouteSource::NEIGHBOR_INFO, millis());
+
+    testRouter->send(relayedPacket(2));
+    runUntilRetransmissionsEnd();
+
+    const uint8_t expected[] = {RELAY_A, RELAY_B, RELAY_C, NO_NEXT_HOP_PREFERENCE};
+    TEST_ASSERT_EQUAL(sizeof(expected), radio->nextHops.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, radio->nextHops.data(), sizeof(expected));
+}
+
+static void test_single_candidate_floods_next()
+{
+    routingTable.learn(DEST, RELAY_A, RouteSource::ACK, millis());
+
+    testRouter->send(relayedPacket(3));
+    runUntilRetransmissionsEnd();
+
+    const uint8_t expected[] = {RELAY_A, NO_NEXT_HOP_PREFERENCE};
+    TEST_ASSERT_EQUAL(sizeof(expected), radio->nextHops.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, radio->nextHops.data(), sizeof(expected));
+}
+
+void setUp(void)
+{
+    testSetMillis(START_MSEC);
+    setClock();
+    routingTable.clear();
+    radio->nextHops.clear();
+}
+
+void tearDown(void)
+{
+    routingTable.clear();
+    testUseRealMillis();
+    setClock();
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    // Retransmission timing asks for the channel utilization. Nothing logs to this one, so the channel is idle.
+    if (!airTime)
+        airTime = new AirTime();
+
+    // NodeDB keeps the node number in myNodeInfo unless it loads another one
+#ifdef FSCom
+    FSCom.remove(deviceStateFileName);
+    FSCom.remove(nodeDatabaseFileName);
+    FSCom.remove(nodeJournalFileName);
+#endif
+    myNodeInfo.my_node_num = OUR_NODE;
+    nodeDB = new NodeDB();
+    config.lora.region = meshtastic_Config_LoRaConfig_RegionCode_US;
+    config.lora.use_preset = true;
+    config.lora.modem_preset = meshtastic_Config_LoRaConfig_ModemPreset_LONG_FAST;
+    config.lora.override_duty_cycle = true;
+    initRegion();
+    channels.initDefaults();
+    channels.onConfigChanged();
+
+    testRouter = new TestRouter();
+    radio = new NextHopRecordingRadio();
+    testRouter->addInterface(std::unique_ptr<RadioInterface>(radio));
+    router = testRouter;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_failover_then_flood);
+    RUN_TEST(test_failover_tries_every_candidate_once);
+    RUN_TEST(test_single_candidate_floods_next);
+    exit(UNITY_END());
+}
+
+void loop() {}
+
+#else // !ARCH_PORTDUINO || !TEST_VIRTUAL_MILLIS
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    exit(UNITY_END());
+}
+
+void loop() {}
+
+#endif
@@ -0,0 +1,504 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "FSCommon.h"
+#include "MeshService.h"
+#include "SPILock.h"
+#include "gps/RTC.h"
+#include "mesh/NodeDB.h"
+#include "mesh/NodeInfoCache.h"
+#include "mesh/PhoneAPI.h"
+#include "mesh/TypeConversions.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
+static const NodeNum FIRST_NODE = 0x10000;
+
+static NodeDB *testNodeDB = nullptr;
+
+static void heardFrom(NodeNum from, uint32_t rxTime)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = from;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.rx_time = rxTime;
+    nodeDB->updateFrom(p);
+}
+
+/// A node like the ones NodeInfo fills in, so it survives cleanupMeshDB() and has a realistic size on disk
+static meshtastic_NodeInfoLite *addUserNode(NodeNum num, uint32_t rxTime)
+{
+    heardFrom(num, rxTime);
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
+    node->has_user = true;
+    snprintf(node->user.long_name, sizeof(node->user.long_name), "Meshtastic node %08x", num);
+    snprintf(node->user.short_name, sizeof(node->user.short_name), "%04x", num & 0xffff);
+    node->user.hw_model = meshtastic_HardwareModel_HELTEC_V3;
+    node->user.public_key.size = 32;
+    memset(node->user.public_key.bytes, num & 0xff, 32);
+    node->has_position = true;
+    node->position.latitude_i = 520000000 + num;
+    node->position.longitude_i = 50000000 + num;
+    node->snr = 5.25f;
+    return node;
+}
+
+static size_t fileSize(const char *filename)
+{
+    size_t size = 0;
+#ifdef FSCom
+    auto f = FSCom.open(filename, FILE_O_READ);
+    if (f) {
+        size = f.size();
+        f.close();
+    }
+#endif
+    return size;
+}
+
+/// Check the sorted node list: us first, then favorites, then the most recently heard
+static void assertSorted()
+{
+    size_t n = nodeDB->getNumMeshNodes();
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_EQUAL_UINT32(nodeDB->getNodeNum(), nodeDB->getMeshNodeByIndex(0)->num);
+    for (size_t i = 2; i < n; i++) {
+        const meshtastic_NodeInfoLite *prev = nodeDB->getMeshNodeByIndex(i - 1);
+        const meshtastic_NodeInfoLite *cur = nodeDB->getMeshNodeByIndex(i);
+        TEST_ASSERT_FALSE(cur->is_favorite && !prev->is_favorite);
+        if (cur->is_favorite == prev->is_favorite)
+            TEST_ASSERT_TRUE(prev->last_heard >= cur->last_heard);
+    }
+}
+
+/// A TCP client, which gets a new PhoneAPI for each connection
+class TestPhoneAPI : public PhoneAPI
+{
+  public:
+    explicit TestPhoneAPI(uint8_t host)
+    {
+        api_type = TYPE_WIFI;
+        const uint8_t addr[] = {192, 168, 1, host};
+        setClientAddress(addr, sizeof(addr));
+    }
+
+    /// Ask for the nodes that changed since our last download, and read them all like a client would
+    std::vector<NodeNum> downloadChangedNodes()
+    {
+        meshtastic_ToRadio toRadio = meshtastic_ToRadio_init_zero;
+        toRadio.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+        toRadio.want_config_id = SPECIAL_NONCE_ONLY_CHANGED_NODES;
+        uint8_t buf[meshtastic_FromRadio_size];
+        handleToRadio(buf, pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &toRadio));
+
+        std::vector<NodeNum> nodes;
+        size_t len;
+        while ((len = getFromRadio(buf)) > 0) {
+            meshtastic_FromRadio fromRadio = meshtastic_FromRadio_init_zero;
+            TEST_ASSERT_TRUE(pb_decode_from_bytes(buf, len, &meshtastic_FromRadio_msg, &fromRadio));
+            if (fromRadio.which_payload_variant == meshtastic_FromRadio_config_complete_id_tag)
+                break;
+            // Our own node is always sent
+            if (fromRadio.which_payload_variant == meshtastic_FromRadio_node_info_tag &&
+                fromRadio.node_info.num != myNodeInfo.my_node_num)
+                nodes.push_back(fromRadio.node_info.num);
+        }
+        return nodes;
+    }
+
+  protected:
+    bool checkIsConnected() override { return true; }
+};
+
+// --- Tests ---
+
+static void test_lookup_finds_every_node()
+{
+    for (NodeNum i = 0; i < 1000; i++)
+        heardFrom(FIRST_NODE + i * 7919, 1000 + i);
+
+    TEST_ASSERT_EQUAL(1001, nodeDB->getNumMeshNodes());
+    for (NodeNum i = 0; i < 1000; i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE + i * 7919);
+        TEST_ASSERT_NOT_NULL(node);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, node->last_heard);
+    }
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 1));
+    TEST_ASSERT_NOT_NULL(nodeDB->getMeshNode(nodeDB->getNodeNum()));
+}
+
+static void test_order_follows_last_heard_and_favorites()
+{
+    for (NodeNum i = 0; i < 10; i++)
+        heardFrom(FIRST_NODE + i, 1000 + i);
+    assertSorted();
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 9, nodeDB->getMeshNodeByIndex(1)->num);
+
+    heardFrom(FIRST_NODE + 3, 2000); // Moves up
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 3, nodeDB->getMeshNodeByIndex(1)->num);
+    assertSorted();
+
+    nodeDB->set_favorite(true, FIRST_NODE + 0); // Oldest, but favorites go first
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 0, nodeDB->getMeshNodeByIndex(1)->num);
+    assertSorted();
+
+    nodeDB->set_favorite(false, FIRST_NODE + 0); // Moves down again
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 0, nodeDB->getMeshNodeByIndex(nodeDB->getNumMeshNodes() - 1)->num);
+    assertSorted();
+}
+
+static void test_paused_sort_catches_up()
+{
+    for (NodeNum i = 0; i < 10; i++)
+        heardFrom(FIRST_NODE + i, 1000 + i);
+
+    nodeDB->pause_sort(true);
+    heardFrom(FIRST_NODE + 2, 2000);
+    heardFrom(FIRST_NODE + 20, 3000); // New node while paused
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 9, nodeDB->getMeshNodeByIndex(1)->num);
+    TEST_ASSERT_NOT_NULL(nodeDB->getMeshNode(FIRST_NODE + 20));
+
+    nodeDB->pause_sort(false);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 20, nodeDB->getMeshNodeByIndex(1)->num);
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 2, nodeDB->getMeshNodeByIndex(2)->num);
+    assertSorted();
+}
+
+static void test_full_db_evicts_oldest()
+{
+    size_t maxNodes = MAX_NUM_NODES;
+    for (NodeNum i = 1; i < maxNodes; i++)
+        heardFrom(FIRST_NODE + i, 1000 + i);
+    TEST_ASSERT_EQUAL(maxNodes, nodeDB->getNumMeshNodes());
+
+    heardFrom(FIRST_NODE + maxNodes, 1000 + maxNodes);
+    TEST_ASSERT_EQUAL(maxNodes, nodeDB->getNumMeshNodes());
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 1));
+    for (NodeNum i = 2; i <= maxNodes; i++)
+        TEST_ASSERT_NOT_NULL(nodeDB->getMeshNode(FIRST_NODE + i));
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + maxNodes, nodeDB->getMeshNodeByIndex(1)->num);
+    assertSorted();
+}
+
+// Tests like the MockNodeDB pattern point meshNodes at their own array. Lookups, which may run in an ISR, scan it until the
+// next change or sorted read rebuilds the index.
+static void test_replaced_node_array_is_reindexed()
+{
+    std::vector<meshtastic_NodeInfoLite> *saved = nodeDB->meshNodes;
+    pb_size_t savedCount = nodeDB->numMeshNodes;
+
+    std::vector<meshtastic_NodeInfoLite> nodes(3, meshtastic_NodeInfoLite_init_zero);
+    nodes[0].num = FIRST_NODE + 1;
+    nodes[0].last_heard = 10;
+    nodes[1].num = nodeDB->getNodeNum();
+    nodes[2].num = FIRST_NODE + 2;
+    nodes[2].last_heard = 20;
+    nodeDB->meshNodes = &nodes;
+    nodeDB->numMeshNodes = nodes.size();
+
+    TEST_ASSERT_EQUAL_PTR(&nodes[2], nodeDB->getMeshNode(FIRST_NODE + 2));
+    TEST_ASSERT_EQUAL_PTR(&nodes[1], nodeDB->getMeshNodeByIndex(0));
+    TEST_ASSERT_EQUAL_PTR(&nodes[2], nodeDB->getMeshNodeByIndex(1));
+    TEST_ASSERT_EQUAL_PTR(&nodes[0], nodeDB->getMeshNodeByIndex(2));
+
+    // Changes go through the rebuilt index
+    heardFrom(FIRST_NODE + 1, 30);
+    TEST_ASSERT_EQUAL_PTR(&nodes[0], nodeDB->getMeshNodeByIndex(1));
+    TEST_ASSERT_EQUAL_PTR(&nodes[0], nodeDB->getMeshNode(FIRST_NODE + 1));
+
+    nodeDB->meshNodes = saved;
+    nodeDB->numMeshNodes = savedCount;
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 2));
+}
+
+// A reboot replays the journal on top of the snapshot, stopping at a record torn by a power loss
+static void test_journal_replays_after_reboot()
+{
+    for (NodeNum i = 0; i < 10; i++)
+        addUserNode(FIRST_NODE + i, 1000 + i);
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+    TEST_ASSERT_EQUAL(0, fileSize(nodeJournalFileName));
+
+    nodeDB->set_favorite(true, FIRST_NODE + 3);
+    nodeDB->removeNodeByNum(FIRST_NODE + 5);
+    meshtastic_NodeInfoLite *renamed = nodeDB->getMeshNode(FIRST_NODE + 7);
+    strcpy(renamed->user.long_name, "Renamed");
+    TEST_ASSERT_TRUE(nodeDB->saveNodeToDisk(*renamed));
+    nodeDB->set_favorite(true, FIRST_NODE + 8);
+    size_t journalBytes = fileSize(nodeJournalFileName);
+    TEST_ASSERT_GREATER_THAN(0, journalBytes);
+
+#ifdef FSCom
+    // Cut the last record in half
+    std::vector<uint8_t> journal(journalBytes);
+    auto in = FSCom.open(nodeJournalFileName, FILE_O_READ);
+    in.read(journal.data(), journalBytes);
+    in.close();
+    auto out = FSCom.open(nodeJournalFileName, FILE_O_WRITE);
+    out.write(journal.data(), journalBytes - 20);
+    out.close();
+#endif
+
+    nodeDB = new NodeDB();
+    TEST_ASSERT_EQUAL(10, nodeDB->getNumMeshNodes());
+    TEST_ASSERT_TRUE(nodeDB->isFavorite(FIRST_NODE + 3));
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 5));
+    TEST_ASSERT_EQUAL_STRING("Renamed", nodeDB->getMeshNode(FIRST_NODE + 7)->user.long_name);
+    TEST_ASSERT_FALSE(nodeDB->isFavorite(FIRST_NODE + 8)); // Torn record
+    TEST_ASSERT_EQUAL(0, fileSize(nodeJournalFileName));   // Folded into the snapshot, so we can append again
+    assertSorted();
+
+    // Both instances share the global nodeDatabase
+    testNodeDB->numMeshNodes = nodeDB->numMeshNodes;
+    delete nodeDB;
+    nodeDB = testNodeDB;
+}
+
+// NodeInfo is rebroadcast every few hours, only a real change may cost a journal record. A contact added to a full DB must
+// still be there after a reboot, although it evicted a node the snapshot has.
+static void test_user_changes_are_journaled()
+{
+    size_t maxNodes = MAX_NUM_NODES;
+    for (NodeNum i = 1; i < maxNodes; i++)
+        addUserNode(FIRST_NODE + i, 1000 + i);
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+
+    meshtastic_User user = meshtastic_User_init_zero;
+    strcpy(user.long_name, "Contact");
+    strcpy(user.short_name, "CT");
+    user.hw_model = meshtastic_HardwareModel_RAK4631;
+    meshtastic_SharedContact contact = meshtastic_SharedContact_init_zero;
+    contact.node_num = FIRST_NODE + maxNodes;
+    contact.has_user = true;
+    contact.user = user;
+    nodeDB->addFromContact(contact);
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 1));
+    size_t journalBytes = fileSize(nodeJournalFileName);
+    TEST_ASSERT_GREATER_THAN(0, journalBytes);
+
+    TEST_ASSERT_FALSE(nodeDB->updateUser(FIRST_NODE + maxNodes, user));
+    TEST_ASSERT_EQUAL(journalBytes, fileSize(nodeJournalFileName));
+    strcpy(user.long_name, "Renamed contact");
+    TEST_ASSERT_TRUE(nodeDB->updateUser(FIRST_NODE + maxNodes, user));
+    TEST_ASSERT_GREATER_THAN(journalBytes, fileSize(nodeJournalFileName));
+
+    nodeDB = new NodeDB();
+    TEST_ASSERT_EQUAL(maxNodes, nodeDB->getNumMeshNodes());
+    meshtastic_NodeInfoLite *added = nodeDB->getMeshNode(FIRST_NODE + maxNodes);
+    TEST_ASSERT_NOT_NULL(added);
+    TEST_ASSERT_EQUAL_STRING("Renamed contact", added->user.long_name);
+    TEST_ASSERT_TRUE(added->is_favorite);
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 1));
+    assertSorted();
+
+    testNodeDB->numMeshNodes = nodeDB->numMeshNodes;
+    delete nodeDB;
+    nodeDB = testNodeDB;
+}
+
+// Benchmark: persist single node changes on a 1000 node DB, rewriting nodes.proto vs appending to the journal
+static void test_benchmark_node_save()
+{
+    const uint32_t numNodes = 1000;
+    const uint32_t numSaves = 50;
+    for (NodeNum i = 0; i < numNodes; i++)
+        addUserNode(FIRST_NODE + i, 1000 + i);
+
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < numSaves; i++) {
+        nodeDB->getMeshNode(FIRST_NODE + i)->is_favorite = true;
+        TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+    }
+    uint32_t snapshotElapsed = millis() - start;
+    size_t snapshotBytes = fileSize(nodeDatabaseFileName);
+
+    start = millis();
+    for (uint32_t i = 0; i < numSaves; i++)
+        nodeDB->set_favorite(false, FIRST_NODE + i);
+    uint32_t journalElapsed = millis() - start;
+    size_t journalBytes = fileSize(nodeJournalFileName);
+
+    TEST_MSG_FMT("nodes=%u snapshot: %u bytes/save, %ums for %u saves", nodeDB->getNumMeshNodes(), snapshotBytes,
+                 snapshotElapsed, numSaves);
+    TEST_MSG_FMT("nodes=%u journal: %u bytes/save, %ums for %u saves", nodeDB->getNumMeshNodes(), journalBytes / numSaves,
+                 journalElapsed, numSaves);
+    TEST_ASSERT_GREATER_THAN(0, journalBytes); // No compaction got in the way
+    TEST_ASSERT_LESS_THAN(300, journalBytes / numSaves);
+}
+
+// Benchmark: updateFrom() on a full 5k node DB, most traffic coming from recently heard nodes
+static void test_benchmark_update_from()
+{
+    const uint32_t numNodes = MAX_NUM_NODES - 1;
+    const uint32_t numPackets = 100000;
+    std::mt19937 rng(42);
+
+    uint32_t start = millis();
+    for (NodeNum i = 0; i < numNodes; i++)
+        heardFrom(FIRST_NODE + i, 1000 + i);
+    uint32_t fillElapsed = millis() - start;
+
+    uint32_t rxTime = 1000 + numNodes;
+    start = millis();
+    for (uint32_t i = 0; i < numPackets; i++) {
+        uint32_t node = (rng() % 4 == 0) ? rng() % numNodes : numNodes - 1 - rng() % 100;
+        heardFrom(FIRST_NODE + node, rxTime++);
+    }
+    uint32_t elapsed = millis() - start;
+
+    TEST_MSG_FMT("nodes=%u fill=%ums packets=%u updateFrom=%ums", nodeDB->getNumMeshNodes(), fillElapsed, numPackets, elapsed);
+    assertSorted();
+}
+
+// A cached encoding is only served while the node stays as it was encoded
+static void test_nodeinfo_cache_follows_node_changes()
+{
+    const uint8_t encoded[] = {1, 2, 3};
+    uint8_t buf[meshtastic_FromRadio_size];
+    meshtastic_NodeInfoLite *node = addUserNode(FIRST_NODE, 1000);
+    uint32_t fingerprint = NodeInfoCache::fingerprint(*node);
+    TEST_ASSERT_EQUAL(0, nodeInfoCache.get(FIRST_NODE, fingerprint, buf));
+
+    nodeInfoCache.put(FIRST_NODE, fingerprint, encoded, sizeof(encoded));
+    TEST_ASSERT_EQUAL(sizeof(encoded), nodeInfoCache.get(FIRST_NODE, fingerprint, buf));
+    TEST_ASSERT_EQUAL_MEMORY(encoded, buf, sizeof(encoded));
+
+    heardFrom(FIRST_NODE, 1001);
+    node = nodeDB->getMeshNode(FIRST_NODE);
+    TEST_ASSERT_NOT_EQUAL(fingerprint, NodeInfoCache::fingerprint(*node));
+    TEST_ASSERT_EQUAL(0, nodeInfoCache.get(FIRST_NODE, NodeInfoCache::fingerprint(*node), buf));
+
+    nodeInfoCache.put(FIRST_NODE, fingerprint, encoded, sizeof(encoded));
+    nodeDB->removeNodeByNum(FIRST_NODE);
+    TEST_ASSERT_EQUAL(0, nodeInfoCache.get(FIRST_NODE, fingerprint, buf));
+}
+
+// A client that reconnects and asks for the changed nodes only gets the ones heard since its last download, others get all
+static void test_reconnect_downloads_changed_nodes()
+{
+    uint32_t now = getTime();
+    for (NodeNum i = 0; i < 10; i++)
+        addUserNode(FIRST_NODE + i, now - 1000 + i);
+
+    TEST_ASSERT_EQUAL(10, TestPhoneAPI(1).downloadChangedNodes().size());
+
+    heardFrom(FIRST_NODE + 3, getTime());
+    std::vector<NodeNum> nodes = TestPhoneAPI(1).downloadChangedNodes();
+    TEST_ASSERT_EQUAL(1, nodes.size());
+    TEST_ASSERT_EQUAL_UINT32(FIRST_NODE + 3, nodes[0]);
+
+    TEST_ASSERT_EQUAL(10, TestPhoneAPI(2).downloadChangedNodes().size());
+
+    // It can't tell the client a node is gone, so the next download is complete again
+    nodeDB->removeNodeByNum(FIRST_NODE + 5);
+    TEST_ASSERT_EQUAL(9, TestPhoneAPI(1).downloadChangedNodes().size());
+}
+
+static void test_evicted_node_resets_downloads()
+{
+    size_t maxNodes = MAX_NUM_NODES;
+    uint32_t now = getTime();
+    for (NodeNum i = 1; i < maxNodes; i++)
+        addUserNode(FIRST_NODE + i, now - 1000 + i);
+    TEST_ASSERT_EQUAL(maxNodes - 1, TestPhoneAPI(1).downloadChangedNodes().size());
+
+    // Making room for a new node drops the oldest one, which the client only learns about from a complete download
+    heardFrom(FIRST_NODE + maxNodes, getTime());
+    TEST_ASSERT_NULL(nodeDB->getMeshNode(FIRST_NODE + 1));
+    std::vector<NodeNum> nodes = TestPhoneAPI(1).downloadChangedNodes();
+    TEST_ASSERT_EQUAL(maxNodes - 1, nodes.size());
+    TEST_ASSERT_TRUE(std::find(nodes.begin(), nodes.end(), FIRST_NODE + 1) == nodes.end());
+}
+
+// Benchmark: node download of a 2000 node DB, converting and encoding every node vs copying cached encodings
+static void test_benchmark_nodeinfo_download()
+{
+    const uint32_t numNodes = 2000;
+    for (NodeNum i = 0; i < numNodes; i++)
+        addUserNode(FIRST_NODE + i, 1000 + i);
+    nodeInfoCache.clear();
+
+    uint8_t buf[meshtastic_FromRadio_size];
+    meshtastic_FromRadio fromRadio = meshtastic_FromRadio_init_zero;
+    size_t encodedBytes = 0, cachedBytes = 0;
+    uint32_t start = millis();
+    for (size_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+        fromRadio.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+        fromRadio.node_info = TypeConversions::ConvertToNodeInfo(node);
+        size_t len = pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_FromRadio_msg, &fromRadio);
+        nodeInfoCache.put(node->num, NodeInfoCache::fingerprint(*node), buf, len);
+        encodedBytes += len;
+    }
+    uint32_t encodeElapsed = millis() - start;
+
+    start = millis();
+    for (size_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+        cachedBytes += nodeInfoCache.get(node->num, NodeInfoCache::fingerprint(*node), buf);
+    }
+    uint32_t cachedElapsed = millis() - start;
+
+    TEST_MSG_FMT("nodes=%u encode=%ums cached=%ums bytes=%u", nodeDB->getNumMeshNodes(), encodeElapsed, cachedElapsed,
+                 encodedBytes);
+    TEST_ASSERT_EQUAL(encodedBytes, cachedBytes);
+}
+
+// --- Unity lifecycle ---
+
+void setUp(void)
+{
+    nodeDB = testNodeDB;
+    nodeDB->pause_sort(false);
+    nodeDB->resetNodes();
+}
+
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+#ifdef ARCH_PORTDUINO
+    portduino_config.MaxNodes = 5000; // Like a big meshtasticd install
+#endif
+    testNodeDB = new NodeDB();
+    if (!spiLock)
+        initSPI();
+    if (!service)
+        service = new MeshService();
+    UNITY_BEGIN();
+    RUN_TEST(test_lookup_finds_every_node);
+    RUN_TEST(test_order_follows_last_heard_and_favorites);
+    RUN_TEST(test_paused_sort_catches_up);
+    RUN_TEST(test_full_db_evicts_oldest);
+    RUN_TEST(test_replaced_node_array_is_reindexed);
+    RUN_TEST(test_journal_replays_after_reboot);
+    RUN_TEST(test_user_changes_are_journaled);
+    RUN_TEST(test_benchmark_node_save);
+    RUN_TEST(test_benchmark_update_from);
+    RUN_TEST(test_nodeinfo_cache_follows_node_changes);
+    RUN_TEST(test_reconnect_downloads_changed_nodes);
+    RUN_TEST(test_evicted_node_resets_downloads);
+    RUN_TEST(test_benchmark_nodeinfo_download);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,260 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "platform/portduino/PacketCapture.h"
+#include "serialization/MeshPacketSerializer.h"
+#include <dirent.h>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
+static const size_t PCAP_FILE_HEADER_LEN = 24, PCAP_RECORD_HEADER_LEN = 16, METADATA_LEN = 8;
+
+static PacketCapture *capture;
+static std::string dir;
+
+static RxFrame makeFrame(uint32_t id, uint8_t payloadLen)
+{
+    RxFrame frame = {};
+    frame.buffer.header.from = 0x11223344;
+    frame.buffer.header.to = NODENUM_BROADCAST;
+    frame.buffer.header.id = id;
+    frame.buffer.header.flags = 3;
+    for (uint8_t i = 0; i < payloadLen; i++)
+        frame.buffer.payload[i] = id + i;
+    frame.length = sizeof(PacketHeader) + payloadLen;
+    frame.rssi = -100 - (int32_t)id;
+    frame.snr = 5.25f;
+    return frame;
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+/// Paths of the files in dir starting with prefix
+static std::vector<std::string> filesStartingWith(const std::string &prefix)
+{
+    std::vector<std::string> files;
+    DIR *d = opendir(dir.c_str());
+    while (struct dirent *entry = readdir(d)) {
+        if (entry->d_name[0] != '.' && strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0)
+            files.push_back(dir + "/" + entry->d_name);
+    }
+    closedir(d);
+    return files;
+}
+
+template <typename T> static T readAt(const std::string &data, size_t offset)
+{
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(value));
+    return value;
+}
+
+void setUp(void)
+{
+    char path[] = "/tmp/capturetestXXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(path));
+    dir = path;
+    capture = new PacketCapture();
+}
+
+void tearDown(void)
+{
+    delete capture;
+    for (const std::string &file : filesStartingWith(""))
+        unlink(file.c_str());
+    rmdir(dir.c_str());
+}
+
+// Items come out in order, also after the indexes wrapped around many times, and the ring drops rather than overwrites
+static void test_ring_order_and_overflow()
+{
+    CaptureRing<uint32_t, 4> ring;
+    uint32_t next = 0, expected = 0;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 3; i++) {
+            *ring.beginWrite() = next++;
+            ring.commitWrite();
+        }
+        for (const uint32_t *item; (item = ring.peek()) != nullptr; ring.pop())
+            TEST_ASSERT_EQUAL(expected++, *item);
+    }
+    TEST_ASSERT_EQUAL(next, expected);
+
+    for (int i = 0; i < 4; i++) {
+        *ring.beginWrite() = i;
+        ring.commitWrite();
+    }
+    TEST_ASSERT_NULL(ring.beginWrite());
+    TEST_ASSERT_EQUAL(1, ring.getOverflows());
+    TEST_ASSERT_EQUAL(0, *ring.peek());
+}
+
+// Frames end up in a pcap file, with their metadata and what became of them
+static void test_pcap_records()
+{
+    PacketCapture::Options options;
+    options.pcapPath = dir + "/rx.pcap";
+    capture->begin(options);
+
+    const CaptureResult results[] = {CaptureResult::DECODED, CaptureResult::RELAYED, CaptureResult::NOT_HANDLED};
+    for (uint32_t i = 0; i < 3; i++) {
+        capture->beginFrame(makeFrame(i + 1, 10 * (i + 1)));
+        if (results[i] != CaptureResult::NOT_HANDLED) {
+            capture->setFrameResult(results[i]);
+            // Replies sent while handling the frame don't change what became of it
+            capture->setFrameResult(CaptureResult::FATAL);
+        }
+        capture->endFrame();
+    }
+    capture->end();
+
+    std::string data = readFile(options.pcapPath);
+    TEST_ASSERT_EQUAL(0xa1b2c3d4, readAt<uint32_t>(data, 0));
+    TEST_ASSERT_EQUAL(PACKET_CAPTURE_LINKTYPE, readAt<uint32_t>(data, 20));
+
+    size_t offset = PCAP_FILE_HEADER_LEN;
+    for (uint32_t i = 0; i < 3; i++) {
+        RxFrame frame = makeFrame(i + 1, 10 * (i + 1));
+        TEST_ASSERT_EQUAL(METADATA_LEN + frame.length, readAt<uint32_t>(data, offset + 8));
+        offset += PCAP_RECORD_HEADER_LEN;
+        TEST_ASSERT_EQUAL(1, (uint8_t)data[offset]);
+        TEST_ASSERT_EQUAL((uint8_t)results[i], (uint8_t)data[offset + 1]);
+        TEST_ASSERT_EQUAL(frame.rssi, readAt<int16_t>(data, offset + 2));
+        TEST_ASSERT_EQUAL_FLOAT(frame.snr, readAt<float>(data, offset + 4));
+        offset += METADATA_LEN;
+        TEST_ASSERT_EQUAL_MEMORY(&frame.buffer, data.data() + offset, frame.length);
+        offset += frame.length;
+    }
+    TEST_ASSERT_EQUAL(data.size(), offset);
+}
+
+// Decoded packets are written as JSON lines, as perhapsDecode() used to write them itself
+static void test_json_lines()
+{
+    PacketCapture::Options options;
+    options.jsonPath = dir + "/packets.json";
+    options.jsonFilter = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    capture->begin(options);
+
+    meshtastic_MeshPacket packet = meshtastic_MeshPacket_init_zero;
+    packet.id = 0x1234;
+    packet.from = 0x11223344;
+    packet.to = NODENUM_BROADCAST;
+    packet.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    packet.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    packet.decoded.payload.size = 5;
+    memcpy(packet.decoded.payload.bytes, "hello", 5);
+    capture->captureJson(&packet);
+
+    meshtastic_MeshPacket filtered = packet;
+    filtered.decoded.portnum = meshtastic_PortNum_POSITION_APP;
+    capture->captureJson(&filtered);
+    capture->end();
+
+    std::string expected = MeshPacketSerializer::JsonSerialize(&packet, false) + "\n";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), readFile(options.jsonPath).c_str());
+    TEST_ASSERT_EQUAL(0, capture->getDroppedJson());
+}
+
+// Once a file gets too big the next one is started, each with its own pcap header
+static void test_rotates_by_size()
+{
+    PacketCapture::Options options;
+    options.pcapPath = dir + "/rx.pcap";
+    options.rotateBytes = 100;
+    capture->begin(options);
+
+    for (int file = 0; file < 2; file++) {
+        for (uint32_t i = 0; i < 5; i++) {
+            capture->beginFrame(makeFrame(i, 50));
+            capture->endFrame();
+        }
+        // Rotated file names only go down to the second
+        testDelay(PACKET_CAPTURE_IDLE_MS * 2 + 1000);
+    }
+    capture->end();
+
+    std::vector<std::string> files = filesStartingWith("rx.pcap_");
+    TEST_ASSERT_EQUAL(2, files.size());
+    TEST_ASSERT_EQUAL(2, capture->getFilesOpened());
+    for (const std::string &file : files) {
+        std::string data = readFile(file);
+        TEST_ASSERT_EQUAL(0xa1b2c3d4, readAt<uint32_t>(data, 0));
+        TEST_ASSERT_EQUAL(PCAP_FILE_HEADER_LEN + 5 * (PCAP_RECORD_HEADER_LEN + METADATA_LEN + sizeof(PacketHeader) + 50),
+                          data.size());
+    }
+}
+
+// Benchmark: what capturing costs the Router per frame, compared to writing each one out itself
+static void test_benchmark_capture()
+{
+    const uint32_t numBursts = 20, burstFrames = PACKET_CAPTURE_FRAMES / 2;
+    RxFrame frame = makeFrame(1, 200);
+
+    PacketCapture::Options options;
+    options.pcapPath = dir + "/rx.pcap";
+    capture->begin(options);
+    uint32_t captureElapsed = 0;
+    for (uint32_t burst = 0; burst < numBursts; burst++) {
+        uint32_t start = micros();
+        for (uint32_t i = 0; i < burstFrames; i++) {
+            capture->beginFrame(frame);
+            capture->setFrameResult(CaptureResult::DECODED);
+            capture->endFrame();
+        }
+        captureElapsed += micros() - start;
+        // Give the writer time to catch up, as it would between bursts on air
+        testDelay(PACKET_CAPTURE_IDLE_MS * 2);
+    }
+    capture->end();
+
+    std::ofstream direct(dir + "/direct.bin", std::ios::out | std::ios::binary);
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < numBursts * burstFrames; i++) {
+        direct.write((const char *)&frame.buffer, frame.length);
+        direct << std::endl;
+    }
+    uint32_t directElapsed = micros() - start;
+
+    TEST_MSG_FMT("frames=%u captured=%uus dropped=%u written with a flush each=%uus", numBursts * burstFrames, captureElapsed,
+                 capture->getDroppedFrames(), directElapsed);
+    TEST_ASSERT_EQUAL(0, capture->getDroppedFrames());
+    TEST_ASSERT_EQUAL(PCAP_FILE_HEADER_LEN + numBursts * burstFrames * (PCAP_RECORD_HEADER_LEN + METADATA_LEN + frame.length),
+                      readFile(options.pcapPath).size());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ring_order_and_overflow);
+    RUN_TEST(test_pcap_records);
+    RUN_TEST(test_json_lines);
+    RUN_TEST(test_rotates_by_size);
+    RUN_TEST(test_benchmark_capture);
+    exit(UNITY_END());
+}
+
+void loop() {}
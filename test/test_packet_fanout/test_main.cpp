@@ -0,0 +1,194 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "mesh/PacketFanout.h"
+
+static const size_t RING_LEN = 4;
+
+static meshtastic_MeshPacket *makePacket(PacketId id)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->id = id;
+    return p;
+}
+
+/// Read and release the next packet, return its id or 0 if there was none
+static PacketId readNext(PacketFanout &ring, PacketFanout::Reader &r)
+{
+    const meshtastic_MeshPacket *p = ring.peek(&r);
+    if (!p)
+        return 0;
+    PacketId id = p->id;
+    ring.release(&r);
+    return id;
+}
+
+static uint32_t poolInUse()
+{
+    return packetPool.getStats().inUse;
+}
+
+// --- Sharing ---
+
+static void test_readers_share_one_buffer()
+{
+    uint32_t before = poolInUse();
+    {
+        PacketFanout ring(RING_LEN, packetPool);
+        PacketFanout::Reader a, b;
+        ring.addReader(&a);
+        ring.addReader(&b);
+        ring.push(makePacket(1), false);
+
+        const meshtastic_MeshPacket *pa = ring.peek(&a);
+        const meshtastic_MeshPacket *pb = ring.peek(&b);
+        TEST_ASSERT_NOT_NULL(pa);
+        TEST_ASSERT_EQUAL_PTR(pa, pb);
+        TEST_ASSERT_EQUAL_UINT32(before + 1, poolInUse());
+
+        ring.release(&a);
+        TEST_ASSERT_EQUAL_UINT32(before + 1, poolInUse());
+        ring.release(&b);
+        TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+        TEST_ASSERT_NULL(ring.peek(&a));
+        TEST_ASSERT_FALSE(ring.hasUnread());
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+}
+
+static void test_unread_packets_wait_for_next_reader()
+{
+    uint32_t before = poolInUse();
+    {
+        PacketFanout ring(RING_LEN, packetPool);
+        ring.push(makePacket(1), false);
+        ring.push(makePacket(2), false);
+        TEST_ASSERT_TRUE(ring.hasUnread());
+
+        PacketFanout::Reader a;
+        ring.addReader(&a);
+        TEST_ASSERT_EQUAL_UINT32(1, readNext(ring, a));
+        TEST_ASSERT_EQUAL_UINT32(2, readNext(ring, a));
+        TEST_ASSERT_EQUAL_UINT32(0, readNext(ring, a));
+        TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+
+        // A reader joining later doesn't get the packets someone already read
+        ring.push(makePacket(3), false);
+        PacketFanout::Reader b;
+        ring.addReader(&b);
+        TEST_ASSERT_EQUAL_UINT32(3, readNext(ring, b));
+        TEST_ASSERT_EQUAL_UINT32(3, readNext(ring, a));
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+}
+
+static void test_removed_reader_releases_its_backlog()
+{
+    uint32_t before = poolInUse();
+    PacketFanout ring(RING_LEN, packetPool);
+    PacketFanout::Reader a, b;
+    ring.addReader(&a);
+    ring.addReader(&b);
+    ring.push(makePacket(1), false);
+    ring.push(makePacket(2), false);
+
+    TEST_ASSERT_EQUAL_UINT32(1, readNext(ring, a));
+    TEST_ASSERT_EQUAL_UINT32(2, readNext(ring, a));
+    TEST_ASSERT_EQUAL_UINT32(before + 2, poolInUse());
+
+    ring.removeReader(&b);
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.numQueued());
+}
+
+// --- Overflow ---
+
+static void test_slow_reader_counts_dropped_packets()
+{
+    uint32_t before = poolInUse();
+    {
+        PacketFanout ring(RING_LEN, packetPool);
+        PacketFanout::Reader fast, slow;
+        ring.addReader(&fast);
+        ring.addReader(&slow);
+
+        for (PacketId id = 1; id <= RING_LEN + 2; id++) {
+            TEST_ASSERT_TRUE(ring.push(makePacket(id), false));
+            TEST_ASSERT_EQUAL_UINT32(id, readNext(ring, fast));
+        }
+        TEST_ASSERT_EQUAL_UINT32(before + RING_LEN, poolInUse());
+
+        TEST_ASSERT_EQUAL_UINT32(3, readNext(ring, slow));
+        TEST_ASSERT_EQUAL_UINT32(2, slow.dropped);
+        TEST_ASSERT_EQUAL_UINT32(0, fast.dropped);
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+}
+
+static void test_full_ring_of_unread_packets()
+{
+    uint32_t before = poolInUse();
+    {
+        PacketFanout ring(RING_LEN, packetPool);
+        for (PacketId id = 1; id <= RING_LEN; id++)
+            ring.push(makePacket(id), false);
+
+        // Nobody read anything yet, only important packets push out the oldest
+        TEST_ASSERT_FALSE(ring.push(makePacket(10), false));
+        TEST_ASSERT_EQUAL_UINT32(before + RING_LEN, poolInUse());
+        TEST_ASSERT_TRUE(ring.push(makePacket(11), true));
+        TEST_ASSERT_EQUAL_UINT32(before + RING_LEN, poolInUse());
+
+        PacketFanout::Reader a;
+        ring.addReader(&a);
+        TEST_ASSERT_EQUAL_UINT32(2, readNext(ring, a));
+        TEST_ASSERT_EQUAL_UINT32(0, a.dropped);
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+}
+
+static void test_held_packet_survives_overflow()
+{
+    uint32_t before = poolInUse();
+    {
+        PacketFanout ring(RING_LEN, packetPool);
+        PacketFanout::Reader a, b;
+        ring.addReader(&a);
+        ring.addReader(&b);
+        for (PacketId id = 1; id <= RING_LEN; id++)
+            ring.push(makePacket(id), false);
+        TEST_ASSERT_EQUAL_UINT32(1, readNext(ring, a));
+
+        const meshtastic_MeshPacket *held = ring.peek(&b);
+        TEST_ASSERT_FALSE(ring.push(makePacket(10), true));
+        TEST_ASSERT_EQUAL_UINT32(1, held->id);
+
+        ring.release(&b);
+        TEST_ASSERT_TRUE(ring.push(makePacket(11), false));
+        TEST_ASSERT_NOT_NULL(ring.findById(11));
+        TEST_ASSERT_NULL(ring.findById(10));
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, poolInUse());
+}
+
+// --- Unity lifecycle ---
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    UNITY_BEGIN();
+    RUN_TEST(test_readers_share_one_buffer);
+    RUN_TEST(test_unread_packets_wait_for_next_reader);
+    RUN_TEST(test_removed_reader_releases_its_backlog);
+    RUN_TEST(test_slow_reader_counts_dropped_packets);
+    RUN_TEST(test_full_ring_of_unread_packets);
+    RUN_TEST(test_held_packet_survives_overflow);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,187 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "mesh/NodeDB.h"
+#include "mesh/PacketHistory.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
+static const NodeNum OUR_NODE = 0x11223344;
+
+static NodeDB *testNodeDB = nullptr;
+
+static meshtastic_MeshPacket makePacket(NodeNum from, PacketId id, uint8_t hopLimit = 3)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = from;
+    p.id = id;
+    p.hop_limit = hopLimit;
+    p.relay_node = 0x55;
+    return p;
+}
+
+static bool seen(PacketHistory &h, NodeNum from, PacketId id)
+{
+    meshtastic_MeshPacket p = makePacket(from, id);
+    return h.wasSeenRecently(&p);
+}
+
+static bool peek(PacketHistory &h, NodeNum from, PacketId id)
+{
+    meshtastic_MeshPacket p = makePacket(from, id);
+    return h.wasSeenRecently(&p, false);
+}
+
+// --- Tests ---
+
+static void test_duplicate_is_detected()
+{
+    PacketHistory h(16);
+    TEST_ASSERT_TRUE(h.initOk());
+    TEST_ASSERT_FALSE(seen(h, 0x100, 1));
+    TEST_ASSERT_TRUE(seen(h, 0x100, 1));
+    TEST_ASSERT_FALSE(seen(h, 0x101, 1)); // Same id, other sender
+    TEST_ASSERT_FALSE(seen(h, 0x100, 2)); // Same sender, other id
+}
+
+static void test_without_update_nothing_is_stored()
+{
+    PacketHistory h(16);
+    TEST_ASSERT_FALSE(peek(h, 0x100, 1));
+    TEST_ASSERT_FALSE(peek(h, 0x100, 1));
+}
+
+static void test_oldest_is_evicted_when_full()
+{
+    PacketHistory h(4);
+    for (PacketId id = 1; id <= 4; id++)
+        TEST_ASSERT_FALSE(seen(h, 0x100, id));
+
+    TEST_ASSERT_FALSE(seen(h, 0x100, 5)); // Evicts id 1
+    TEST_ASSERT_FALSE(peek(h, 0x100, 1));
+    for (PacketId id = 2; id <= 5; id++)
+        TEST_ASSERT_TRUE(peek(h, 0x100, id));
+}
+
+static void test_seen_again_refreshes_age()
+{
+    PacketHistory h(4);
+    for (PacketId id = 1; id <= 4; id++)
+        seen(h, 0x100, id);
+
+    TEST_ASSERT_TRUE(seen(h, 0x100, 1)); // id 1 is now the newest, id 2 the oldest
+    seen(h, 0x100, 5);
+    TEST_ASSERT_TRUE(peek(h, 0x100, 1));
+    TEST_ASSERT_FALSE(peek(h, 0x100, 2));
+}
+
+static void test_relayer_tracking_survives_index()
+{
+    PacketHistory h(8);
+    meshtastic_MeshPacket p = makePacket(0x100, 42);
+    h.wasSeenRecently(&p);
+
+    TEST_ASSERT_FALSE(h.wasRelayer(0x55, 42, 0x100));
+    p.relay_node = nodeDB->getLastByteOfNodeNum(OUR_NODE);
+    h.wasSeenRecently(&p);
+    bool wasSole = false;
+    TEST_ASSERT_TRUE(h.wasRelayer(p.relay_node, 42, 0x100, &wasSole));
+    TEST_ASSERT_TRUE(wasSole);
+
+    h.removeRelayer(p.relay_node, 42, 0x100);
+    TEST_ASSERT_FALSE(h.wasRelayer(p.relay_node, 42, 0x100));
+}
+
+// Replays a random trace against a reference model, exercising index deletion through many evictions
+static void test_matches_reference_model()
+{
+    const uint32_t cap = 64;
+    PacketHistory h(cap);
+    std::vector<std::pair<NodeNum, PacketId>> ref; // Oldest first
+    std::mt19937 rng(1234);
+
+    for (int i = 0; i < 20000; i++) {
+        NodeNum from = 1 + rng() % 32;
+        PacketId id = 1 + rng() % 256;
+        auto key = std::make_pair(from, id);
+        auto it = std::find(ref.begin(), ref.end(), key);
+        bool expected = (it != ref.end());
+        TEST_ASSERT_EQUAL(expected, seen(h, from, id));
+        if (expected)
+            ref.erase(it);
+        ref.push_back(key);
+        if (ref.size() > cap)
+            ref.erase(ref.begin());
+    }
+}
+
+// Benchmark: replay a 100k packet trace (~30% duplicates) at several capacities
+static void test_benchmark_trace_replay()
+{
+    const uint32_t numPackets = 100000;
+    const uint32_t capacities[] = {100, 1000, 4000, 10000};
+#ifdef ARCH_PORTDUINO
+    portduino_config.MaxNodes = 5000; // PacketHistory caps its size at 2 * MaxNodes, like a big meshtasticd relay
+#endif
+
+    for (uint32_t cap : capacities) {
+        PacketHistory h(cap);
+        std::mt19937 rng(cap);
+        uint32_t dups = 0;
+
+        uint32_t start = millis();
+        for (uint32_t i = 0; i < numPackets; i++) {
+            PacketId id = (rng() % 10 < 3 && i > 0) ? 1 + (i - 1 - rng() % (i < cap ? i : cap)) : 1 + i;
+            if (seen(h, 0x1000 + id % 97, id))
+                dups++;
+        }
+        uint32_t elapsed = millis() - start;
+        TEST_MSG_FMT("capacity=%u packets=%u dups=%u elapsed=%ums", cap, numPackets, dups, elapsed);
+        TEST_ASSERT_GREATER_THAN(0, dups);
+    }
+}
+
+// --- Unity lifecycle ---
+
+void setUp(void)
+{
+    myNodeInfo.my_node_num = OUR_NODE;
+    nodeDB = testNodeDB;
+}
+
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+    testNodeDB = new NodeDB();
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicate_is_detected);
+    RUN_TEST(test_without_update_nothing_is_stored);
+    RUN_TEST(test_oldest_is_evicted_when_full);
+    RUN_TEST(test_seen_again_refreshes_age);
+    RUN_TEST(test_relayer_tracking_survives_index);
+    RUN_TEST(test_matches_reference_model);
+    RUN_TEST(test_benchmark_trace_replay);
+    exit(UNITY_END());
+}
+
+void loop() {}
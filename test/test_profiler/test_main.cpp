@@ -0,0 +1,191 @@
+#include "Profiler.h"
+#include "TestUtil.h"
+#include "concurrency/OSThread.h"
+#include <memory>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+// Runs land in power of two buckets, and percentiles report the upper end of their bucket
+void test_histogram_percentiles()
+{
+    LatencyHistogram histogram = {};
+    for (int i = 0; i < 98; i++)
+        histogram.record(10); // [8, 16)
+    histogram.record(3000);   // [2048, 4096)
+    histogram.record(5000);   // [4096, 8192)
+
+    TEST_ASSERT_EQUAL(100, histogram.count);
+    TEST_ASSERT_EQUAL(98, histogram.buckets[1]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[9]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[10]);
+    TEST_ASSERT_EQUAL(5000, histogram.maxUs);
+    TEST_ASSERT_EQUAL(98 * 10 + 3000 + 5000, histogram.totalUs);
+
+    TEST_ASSERT_EQUAL(16, histogram.percentileUs(50));
+    TEST_ASSERT_EQUAL(4096, histogram.percentileUs(99));
+    // Never more than the longest run
+    TEST_ASSERT_EQUAL(5000, histogram.percentileUs(100));
+
+    // Runs too long for the histogram still count
+    histogram.record(10 * 1000 * 1000);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[PROFILER_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL(10 * 1000 * 1000, histogram.percentileUs(100));
+
+    LatencyHistogram empty = {};
+    TEST_ASSERT_EQUAL(0, empty.percentileUs(50));
+}
+
+// Points are found by name, and there are only so many of them
+void test_points()
+{
+    Profiler *p = new Profiler();
+    TEST_ASSERT_EQUAL(PROFILER_FIXED_POINTS, p->size());
+    int16_t decode = p->pointFor("router", "decode");
+    TEST_ASSERT_GREATER_OR_EQUAL(0, decode);
+    TEST_ASSERT_EQUAL(decode, p->pointFor("router", "decode"));
+    TEST_ASSERT_EQUAL_STRING("router/decode", p->name(decode));
+    TEST_ASSERT_EQUAL(PROFILER_FIXED_POINTS, p->pointFor("module", "routing"));
+
+    int16_t cached = PROFILER_UNKNOWN_POINT;
+    TEST_ASSERT_EQUAL(decode, p->pointFor("router", "decode", cached));
+    TEST_ASSERT_EQUAL(decode, cached);
+
+    char name[12];
+    for (int i = p->size(); i < PROFILER_MAX_POINTS; i++) {
+        snprintf(name, sizeof(name), "%d", i);
+        TEST_ASSERT_EQUAL(i, p->pointFor("module", name));
+    }
+    TEST_ASSERT_EQUAL(PROFILER_NO_POINT, p->pointFor("module", "one too many"));
+    // The router stages are still there once the modules took the rest
+    TEST_ASSERT_EQUAL(decode, p->pointFor("router", "decode"));
+    p->record(PROFILER_NO_POINT, 100);
+
+    p->record(decode, 100);
+    TEST_ASSERT_EQUAL(1, p->histogram(decode).count);
+    p->reset();
+    TEST_ASSERT_EQUAL(0, p->histogram(decode).count);
+    TEST_ASSERT_EQUAL(PROFILER_MAX_POINTS, p->size());
+    delete p;
+}
+
+// Threads fill a block of points of their own, with the modules' points taken they still get theirs and the other way round
+void test_thread_points()
+{
+    Profiler *p = new Profiler();
+    char name[12];
+    for (int i = p->size(); i < PROFILER_MAX_POINTS; i++) {
+        snprintf(name, sizeof(name), "%d", i);
+        p->pointFor("module", name);
+    }
+
+    int16_t router = PROFILER_UNKNOWN_POINT;
+    TEST_ASSERT_EQUAL(PROFILER_MAX_POINTS, p->threadPointFor("Router", router));
+    TEST_ASSERT_EQUAL(PROFILER_MAX_POINTS, router);
+    TEST_ASSERT_EQUAL_STRING("thread/Router", p->name(router));
+    for (int i = 1; i < PROFILER_MAX_THREAD_POINTS; i++) {
+        int16_t cached = PROFILER_UNKNOWN_POINT;
+        snprintf(name, sizeof(name), "%d", i);
+        TEST_ASSERT_EQUAL(PROFILER_MAX_POINTS + i, p->threadPointFor(name, cached));
+    }
+    int16_t tooMany = PROFILER_UNKNOWN_POINT;
+    TEST_ASSERT_EQUAL(PROFILER_NO_POINT, p->threadPointFor("one too many", tooMany));
+    TEST_ASSERT_EQUAL(PROFILER_NO_POINT, p->pointFor("module", "one too many"));
+    TEST_ASSERT_EQUAL(PROFILER_MAX_POINTS + PROFILER_MAX_THREAD_POINTS, p->size());
+
+    p->record(router, 30000);
+    TEST_ASSERT_EQUAL(30000, p->histogram(router).maxUs);
+    delete p;
+}
+
+// The text and JSON dumps list the points that took the most time first
+void test_dumps()
+{
+    Profiler *p = new Profiler();
+    int16_t decode = p->pointFor("router", "decode");
+    int16_t routing = p->pointFor("module", "routing");
+    int16_t thread = PROFILER_UNKNOWN_POINT;
+    p->threadPointFor("Router", thread);
+    p->pointFor("module", "idle");
+    p->record(decode, 100);
+    p->record(routing, 1000);
+    p->record(routing, 2000);
+    p->record(thread, 4000);
+
+    char text[200];
+    size_t len = p->describe(text, sizeof(text), 5);
+    TEST_ASSERT_EQUAL(strlen(text), len);
+    TEST_ASSERT_EQUAL_STRING("thread/Router n=1 p50=4000 p99=4000 max=4000us, "
+                             "module/routing n=2 p50=1024 p99=2000 max=2000us, router/decode n=1 p50=100 p99=100 max=100us",
+                             text);
+
+    char small[16];
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, p->describe(small, sizeof(small), 5));
+
+    char json[4096];
+    len = p->toJson(json, sizeof(json));
+    TEST_ASSERT_LESS_THAN(sizeof(json), len);
+    TEST_ASSERT_EQUAL(strlen(json), len);
+    TEST_ASSERT_NOT_NULL(strstr(json, "{\"name\":\"module\\/routing\",\"count\":2,\"total_us\":3000,\"p50_us\":1024,"
+                                      "\"p99_us\":2000,\"max_us\":2000,\"buckets\":[0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0]}"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"name\":\"module\\/idle\",\"count\":0"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "{\"name\":\"thread\\/Router\",\"count\":1,\"total_us\":4000,"));
+
+    // Too small a buffer tells how much would have been needed
+    TEST_ASSERT_EQUAL(len, p->toJson(json, 10));
+    delete p;
+}
+
+class BusyThread : public concurrency::OSThread
+{
+  public:
+    BusyThread(const char *name, concurrency::Scheduler *scheduler) : OSThread(name, 0, scheduler) {}
+
+  protected:
+    int32_t runOnce() override { return 1000; }
+};
+
+// A firmware runs some 40 threads before the first packet comes in. Each gets a histogram, up to the block for threads, and
+// that must not leave the router stages unprofiled.
+void test_threads_leave_room_for_router_stages()
+{
+    profiler.reset();
+    concurrency::Scheduler scheduler("test");
+    std::vector<std::unique_ptr<BusyThread>> threads;
+    for (int i = 0; i < PROFILER_MAX_POINTS + PROFILER_MAX_THREAD_POINTS; i++)
+        threads.emplace_back(new BusyThread(("Thread" + std::to_string(i)).c_str(), &scheduler));
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, threads.back()->getRunCount());
+
+    int profiled = 0;
+    for (auto &thread : threads) {
+        int16_t point = PROFILER_UNKNOWN_POINT;
+        if (profiler.threadPointFor(thread->ThreadName.c_str(), point) >= 0) {
+            TEST_ASSERT_EQUAL(1, profiler.histogram(point).count);
+            profiled++;
+        }
+    }
+    TEST_ASSERT_EQUAL(PROFILER_MAX_THREAD_POINTS, profiled);
+
+    {
+        PROFILE_SCOPE("router", "decode");
+    }
+    int16_t decode = profiler.pointFor("router", "decode");
+    TEST_ASSERT_GREATER_OR_EQUAL(0, decode);
+    TEST_ASSERT_EQUAL(1, profiler.histogram(decode).count);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_percentiles);
+    RUN_TEST(test_points);
+    RUN_TEST(test_thread_points);
+    RUN_TEST(test_dumps);
+    RUN_TEST(test_threads_leave_room_for_router_stages);
+    exit(UNITY_END());
+}
+
+void loop() {}
@@ -0,0 +1,234 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "mesh/RoutingTable.h"
+
+static const NodeNum DEST = 0x1000a0d0;
+static const uint8_t RELAY_A = 0xa1, RELAY_B = 0xb2, RELAY_C = 0xc3;
+static const uint32_t START_MS = 1000;
+
+static RoutingTable *table;
+
+// A repeatable stand-in for the radio losing packets
+static uint32_t lcgState;
+static float chance()
+{
+    lcgState = lcgState * 1664525 + 1013904223;
+    return (lcgState >> 8) / 16777216.0f;
+}
+
+void setUp(void)
+{
+    table = new RoutingTable();
+    lcgState = 12345;
+}
+
+void tearDown(void)
+{
+    delete table;
+}
+
+// Candidates are ranked by how they were learned, and any of them can be left out
+static void test_ranks_candidates()
+{
+    table->learn(DEST, RELAY_C, RouteSource::NEIGHBOR_INFO, START_MS);
+    table->learn(DEST, RELAY_B, RouteSource::TRACEROUTE, START_MS);
+    table->learn(DEST, RELAY_A, RouteSource::ACK, START_MS);
+
+    RoutingTable::Candidate candidates[ROUTING_MAX_CANDIDATES];
+    TEST_ASSERT_EQUAL(3, table->getCandidates(DEST, candidates, ROUTING_MAX_CANDIDATES, START_MS));
+    TEST_ASSERT_EQUAL(RELAY_A, candidates[0].relay);
+    TEST_ASSERT_EQUAL(RELAY_B, candidates[1].relay);
+    TEST_ASSERT_EQUAL(RELAY_C, candidates[2].relay);
+    TEST_ASSERT_EQUAL(1, table->getCandidates(DEST, candidates, 1, START_MS));
+
+    TEST_ASSERT_EQUAL(RELAY_A, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS));
+    TEST_ASSERT_EQUAL(RELAY_B, *table->getNextHop(DEST, RELAY_A, START_MS));
+    const uint8_t tried[] = {RELAY_A, RELAY_B};
+    TEST_ASSERT_EQUAL(RELAY_C, *table->getNextHop(DEST, tried, 2, START_MS));
+    const uint8_t all[] = {RELAY_C, RELAY_A, RELAY_B};
+    TEST_ASSERT_FALSE(table->getNextHop(DEST, all, 3, START_MS).has_value());
+    TEST_ASSERT_FALSE(table->getNextHop(0x2000, NO_NEXT_HOP_PREFERENCE, START_MS).has_value());
+
+    // A fourth candidate only gets in by beating the worst one
+    table->learn(DEST, 0xd4, RouteSource::NEIGHBOR_INFO, START_MS);
+    TEST_ASSERT_EQUAL(3, table->getCandidates(DEST, candidates, ROUTING_MAX_CANDIDATES, START_MS));
+    table->learn(DEST, 0xe5, RouteSource::OVERHEARD, START_MS);
+    table->getCandidates(DEST, candidates, ROUTING_MAX_CANDIDATES, START_MS);
+    TEST_ASSERT_EQUAL(0xe5, candidates[1].relay);
+    TEST_ASSERT_EQUAL(RELAY_B, candidates[2].relay);
+}
+
+// A failure demotes a candidate below the next one, successes bring it back
+static void test_failures_and_successes()
+{
+    table->learn(DEST, RELAY_A, RouteSource::ACK, START_MS);
+    table->learn(DEST, RELAY_B, RouteSource::TRACEROUTE, START_MS);
+
+    table->recordFailure(DEST, RELAY_A, START_MS);
+    TEST_ASSERT_EQUAL(RELAY_B, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS));
+
+    table->recordSuccess(DEST, RELAY_A, START_MS);
+    table->recordSuccess(DEST, RELAY_A, START_MS);
+    TEST_ASSERT_EQUAL(RELAY_A, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS));
+
+    // Once nothing is worth trying, flood
+    for (int i = 0; i < 10; i++) {
+        table->recordFailure(DEST, RELAY_A, START_MS);
+        table->recordFailure(DEST, RELAY_B, START_MS);
+    }
+    TEST_ASSERT_FALSE(table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS).has_value());
+}
+
+// Relays we hear better are preferred
+static void test_link_quality()
+{
+    table->learn(DEST, RELAY_A, RouteSource::TRACEROUTE, START_MS);
+    table->learn(DEST, RELAY_B, RouteSource::TRACEROUTE, START_MS);
+    table->recordLink(RELAY_A, -16, START_MS);
+    table->recordLink(RELAY_B, 4, START_MS);
+    TEST_ASSERT_EQUAL(RELAY_B, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS));
+
+    RoutingTable::Candidate candidates[ROUTING_MAX_CANDIDATES];
+    table->getCandidates(DEST, candidates, ROUTING_MAX_CANDIDATES, START_MS);
+    TEST_ASSERT_TRUE(table->etx(candidates[0], START_MS) < table->etx(candidates[1], START_MS));
+}
+
+// Estimates drift back to a coin flip, and candidates are dropped when they get too old
+static void test_aging()
+{
+    table->learn(DEST, RELAY_A, RouteSource::ACK, START_MS);
+    for (int i = 0; i < 6; i++)
+        table->recordFailure(DEST, RELAY_A, START_MS);
+    TEST_ASSERT_FALSE(table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS).has_value());
+
+    // An hour later it's worth another try
+    uint32_t later = START_MS + 60 * 60 * 1000;
+    TEST_ASSERT_EQUAL(RELAY_A, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, later));
+
+    TEST_ASSERT_FALSE(table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS + ROUTING_MAX_AGE_MS + 1).has_value());
+    table->learn(DEST, RELAY_B, RouteSource::TRACEROUTE, START_MS + ROUTING_MAX_AGE_MS + 1);
+    RoutingTable::Candidate candidates[ROUTING_MAX_CANDIDATES];
+    TEST_ASSERT_EQUAL(1, table->getCandidates(DEST, candidates, ROUTING_MAX_CANDIDATES, START_MS + ROUTING_MAX_AGE_MS + 1));
+}
+
+// The least recently used destination makes room for a new one
+static void test_capacity()
+{
+    for (NodeNum n = 1; n <= ROUTING_TABLE_SIZE; n++)
+        table->learn(n, RELAY_A, RouteSource::ACK, START_MS + n);
+    TEST_ASSERT_EQUAL(ROUTING_TABLE_SIZE, table->size());
+
+    table->recordSuccess(1, RELAY_A, START_MS + ROUTING_TABLE_SIZE + 1);
+    table->learn(DEST, RELAY_A, RouteSource::ACK, START_MS + ROUTING_TABLE_SIZE + 2);
+    TEST_ASSERT_EQUAL(ROUTING_TABLE_SIZE, table->size());
+    TEST_ASSERT_TRUE(table->getNextHop(1, NO_NEXT_HOP_PREFERENCE, START_MS + ROUTING_TABLE_SIZE + 2).has_value());
+    TEST_ASSERT_FALSE(table->getNextHop(2, NO_NEXT_HOP_PREFERENCE, START_MS + ROUTING_TABLE_SIZE + 2).has_value());
+    TEST_ASSERT_TRUE(table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, START_MS + ROUTING_TABLE_SIZE + 2).has_value());
+}
+
+/**
+ * Replay a synthetic topology: three relays towards DEST that really deliver with the given probabilities, sending one packet
+ * every 10 seconds, failing over once and then flooding like NextHopRouter does.
+ * @return how many packets got through without a flood
+ */
+static int replay(const float *delivery, int packets, uint32_t &now, int *picked)
+{
+    const uint8_t relays[] = {RELAY_A, RELAY_B, RELAY_C};
+    auto deliveryOf = [&](uint8_t relay) {
+        for (int i = 0; i < 3; i++)
+            if (relays[i] == relay)
+                return delivery[i];
+        return 0.0f;
+    };
+    auto pick = [&](uint8_t relay) {
+        for (int i = 0; i < 3; i++)
+            if (relays[i] == relay)
+                picked[i]++;
+    };
+
+    // Nothing left to try, flood. The ACK comes back through whichever relay got the packet there first.
+    auto flood = [&]() {
+        for (int i = 0; i < 3; i++) {
+            if (chance() < delivery[i]) {
+                table->learn(DEST, relays[i], RouteSource::ACK, now);
+                return;
+            }
+        }
+    };
+
+    int delivered = 0;
+    for (int i = 0; i < packets; i++, now += 10 * 1000) {
+        std::optional<uint8_t> hop = table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, now);
+        if (!hop) {
+            flood();
+            continue;
+        }
+        pick(*hop);
+        if (chance() < deliveryOf(*hop)) {
+            table->recordSuccess(DEST, *hop, now);
+            delivered++;
+            continue;
+        }
+        table->recordFailure(DEST, *hop, now);
+        std::optional<uint8_t> failover = table->getNextHop(DEST, *hop, now);
+        if (failover && chance() < deliveryOf(*failover)) {
+            table->recordSuccess(DEST, *failover, now);
+            delivered++;
+        } else {
+            if (failover)
+                table->recordFailure(DEST, *failover, now);
+            flood();
+        }
+    }
+    return delivered;
+}
+
+// The relay that really delivers wins, even when it was learned from the least trusted source, and the table moves on when it
+// goes away
+static void test_topology_replay()
+{
+    uint32_t now = START_MS;
+    table->learn(DEST, RELAY_A, RouteSource::NEIGHBOR_INFO, now);
+    table->learn(DEST, RELAY_B, RouteSource::TRACEROUTE, now);
+    table->learn(DEST, RELAY_C, RouteSource::ACK, now);
+    table->recordLink(RELAY_A, -2, now);
+    table->recordLink(RELAY_B, -6, now);
+    table->recordLink(RELAY_C, -3, now);
+
+    float delivery[] = {0.95f, 0.6f, 0.15f};
+    int picked[3] = {};
+    replay(delivery, 20, now, picked);
+    int settled[3] = {};
+    int delivered = replay(delivery, 200, now, settled);
+    TEST_ASSERT_GREATER_THAN(180, delivered);
+    TEST_ASSERT_GREATER_THAN(170, settled[0]);
+    TEST_ASSERT_LESS_THAN(10, settled[2]);
+
+    // A goes off the air, B takes over within a few packets
+    delivery[0] = 0;
+    int broken[3] = {};
+    replay(delivery, 5, now, broken);
+    TEST_ASSERT_EQUAL(RELAY_B, *table->getNextHop(DEST, NO_NEXT_HOP_PREFERENCE, now));
+    int afterBreak[3] = {};
+    delivered = replay(delivery, 100, now, afterBreak);
+    TEST_ASSERT_GREATER_THAN(80, afterBreak[1]);
+    TEST_ASSERT_GREATER_THAN(45, delivered);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ranks_candidates);
+    RUN_TEST(test_failures_and_successes);
+    RUN_TEST(test_link_quality);
+    RUN_TEST(test_aging);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_topology_replay);
+    exit(UNITY_END());
+}
+
+void loop() {}
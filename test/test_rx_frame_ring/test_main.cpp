@@ -0,0 +1,86 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "mesh/RxFrameRing.h"
+
+static void writeFrame(RxFrameRing &ring, PacketId id)
+{
+    RxFrame *frame = ring.beginWrite();
+    TEST_ASSERT_NOT_NULL(frame);
+    frame->buffer.header.id = id;
+    frame->length = sizeof(PacketHeader);
+    ring.commitWrite();
+}
+
+// Frames come out in the order they went in
+static void test_fifo()
+{
+    RxFrameRing ring;
+    TEST_ASSERT_NULL(ring.peek());
+
+    writeFrame(ring, 1);
+    writeFrame(ring, 2);
+    TEST_ASSERT_EQUAL(2, ring.size());
+
+    TEST_ASSERT_EQUAL(1, ring.peek()->buffer.header.id);
+    ring.pop();
+    TEST_ASSERT_EQUAL(2, ring.peek()->buffer.header.id);
+    ring.pop();
+    TEST_ASSERT_NULL(ring.peek());
+    TEST_ASSERT_EQUAL(2, ring.getWritten());
+}
+
+// A full ring refuses new frames and counts them, keeping the ones it has
+static void test_overflow()
+{
+    RxFrameRing ring;
+    for (PacketId id = 0; id < RX_FRAME_RING_SIZE; id++)
+        writeFrame(ring, id);
+
+    TEST_ASSERT_NULL(ring.beginWrite());
+    TEST_ASSERT_NULL(ring.beginWrite());
+    TEST_ASSERT_EQUAL(2, ring.getOverflows());
+    TEST_ASSERT_EQUAL(RX_FRAME_RING_SIZE, ring.getHighWater());
+
+    ring.pop();
+    writeFrame(ring, 100);
+    for (PacketId id = 1; id < RX_FRAME_RING_SIZE; id++) {
+        TEST_ASSERT_EQUAL(id, ring.peek()->buffer.header.id);
+        ring.pop();
+    }
+    TEST_ASSERT_EQUAL(100, ring.peek()->buffer.header.id);
+}
+
+// The free running indexes keep working when they wrap around
+static void test_wraparound()
+{
+    RxFrameRing ring;
+    for (PacketId id = 0; id < 1000; id++) {
+        writeFrame(ring, id);
+        if (id % 3 == 0)
+            writeFrame(ring, id + 100000);
+        while (ring.size() > 1) {
+            ring.pop();
+        }
+    }
+    TEST_ASSERT_EQUAL(0, ring.getOverflows());
+    TEST_ASSERT_EQUAL(1, ring.size());
+    TEST_ASSERT_EQUAL(999 + 100000, ring.peek()->buffer.header.id);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_wraparound);
+    exit(UNITY_END());
+}
+
+void loop() {}
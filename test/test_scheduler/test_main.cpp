@@ -0,0 +1,166 @@
+#include "TestUtil.h"
+#include "concurrency/OSThread.h"
+#include <string>
+#include <unity.h>
+
+using concurrency::OSThread;
+using concurrency::Scheduler;
+
+static std::string ran;
+
+class TestThread : public OSThread
+{
+  public:
+    const char letter;
+    int32_t nextDelay = RUN_SAME;
+    OSThread *victim = nullptr;
+
+    TestThread(const char *name, uint32_t period, Scheduler *scheduler) : OSThread(name, period, scheduler), letter(name[0]) {}
+
+  protected:
+    int32_t runOnce() override
+    {
+        ran += letter;
+        if (victim)
+            delete victim;
+        return nextDelay;
+    }
+};
+
+// Threads run when they are due, and runOrDelay() says how long until the next one is
+void test_runs_due_threads()
+{
+    Scheduler scheduler("test");
+    TestThread a("a", 0, &scheduler);
+    TestThread b("b", 60 * 1000, &scheduler);
+    TestThread c("c", 0, &scheduler);
+    a.nextDelay = 30 * 1000;
+
+    ran.clear();
+    long delay = scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(2, ran.size());
+    TEST_ASSERT_TRUE(ran.find('a') != std::string::npos && ran.find('c') != std::string::npos);
+    // c runs again right away
+    TEST_ASSERT_EQUAL(0, delay);
+
+    c.nextDelay = 45 * 1000;
+    ran.clear();
+    delay = scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_STRING("c", ran.c_str());
+    TEST_ASSERT_INT_WITHIN(100, 30 * 1000, delay);
+    TEST_ASSERT_EQUAL(3, scheduler.size());
+}
+
+// Moving a deadline earlier or later reorders the threads
+void test_reschedule()
+{
+    Scheduler scheduler("test");
+    TestThread a("a", 60 * 1000, &scheduler);
+    TestThread b("b", 30 * 1000, &scheduler);
+
+    TEST_ASSERT_INT_WITHIN(100, 30 * 1000, scheduler.runOrDelay());
+
+    a.setIntervalFromNow(10 * 1000);
+    TEST_ASSERT_INT_WITHIN(100, 10 * 1000, scheduler.runOrDelay());
+
+    a.setIntervalFromNow(90 * 1000);
+    TEST_ASSERT_INT_WITHIN(100, 30 * 1000, scheduler.runOrDelay());
+
+    ran.clear();
+    b.setIntervalFromNow(0);
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_STRING("b", ran.c_str());
+}
+
+// Disabled threads don't run, and run again once enable() or a setInterval() tells the scheduler
+void test_disabled_threads()
+{
+    Scheduler scheduler("test");
+    TestThread a("a", 0, &scheduler);
+    TestThread b("b", 0, &scheduler);
+    a.nextDelay = 0;
+    b.nextDelay = 0;
+    a.enabled = false;
+
+    ran.clear();
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_STRING("b", ran.c_str());
+
+    b.enabled = false;
+    a.enable();
+    ran.clear();
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_STRING("a", ran.c_str());
+
+    a.disable();
+    ran.clear();
+    TEST_ASSERT_EQUAL(INT32_MAX, scheduler.runOrDelay());
+    TEST_ASSERT_EQUAL_STRING("", ran.c_str());
+
+    // Parked threads aren't looked at on every pass
+    b.enabled = true;
+    TEST_ASSERT_EQUAL(INT32_MAX, scheduler.runOrDelay());
+    TEST_ASSERT_EQUAL_STRING("", ran.c_str());
+    b.setInterval(0);
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL_STRING("b", ran.c_str());
+}
+
+// A thread may delete a thread that is due in the same pass
+void test_remove_while_running()
+{
+    Scheduler scheduler("test");
+    TestThread *a = new TestThread("a", 0, &scheduler);
+    TestThread *b = new TestThread("b", 0, &scheduler);
+    a->victim = b;
+    b->victim = a;
+
+    ran.clear();
+    scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, ran.size());
+    TEST_ASSERT_EQUAL(1, scheduler.size());
+
+    delete scheduler.get(0);
+    TEST_ASSERT_EQUAL(0, scheduler.size());
+    TEST_ASSERT_EQUAL(INT32_MAX, scheduler.runOrDelay());
+}
+
+// Every run is counted, along with the time it took
+void test_accounting()
+{
+    Scheduler scheduler("test");
+    TestThread a("a", 0, &scheduler);
+    TestThread b("b", 0, &scheduler);
+    a.nextDelay = 0;
+    b.nextDelay = 60 * 1000;
+
+    for (int i = 0; i < 5; i++)
+        scheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(5, a.getRunCount());
+    TEST_ASSERT_EQUAL(1, b.getRunCount());
+
+    char stats[64];
+    size_t len = scheduler.describeBusiest(stats, sizeof(stats), 1);
+    TEST_ASSERT_EQUAL(strlen(stats), len);
+    TEST_ASSERT_TRUE(strstr(stats, " 5x ") != nullptr || strstr(stats, " 1x ") != nullptr);
+
+    char small[8];
+    len = scheduler.describeBusiest(small, sizeof(small), 2);
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, len);
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, strlen(small));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_runs_due_threads);
+    RUN_TEST(test_reschedule);
+    RUN_TEST(test_disabled_threads);
+    RUN_TEST(test_remove_while_running);
+    RUN_TEST(test_accounting);
+    exit(UNITY_END());
+}
+
+void loop() {}
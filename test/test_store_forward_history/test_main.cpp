@@ -0,0 +1,267 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#include "modules/StoreForwardHistory.h"
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+// --- Test output helpers ---
+// Unity swallows printf/stdout. Only TEST_MESSAGE() output appears in results.
+#define MSG_BUF_LEN 200
+#define TEST_MSG_FMT(fmt, ...)                                                                                                   \
+    do {                                                                                                                         \
+        char _buf[MSG_BUF_LEN];                                                                                                  \
+        snprintf(_buf, sizeof(_buf), fmt, __VA_ARGS__);                                                                          \
+        TEST_MESSAGE(_buf);                                                                                                      \
+    } while (0)
+
+static const NodeNum CLIENT_A = 0x1000000a, CLIENT_B = 0x1000000b, CLIENT_C = 0x1000000c;
+
+static StoreForwardHistory *history;
+static uint32_t nextId;
+
+static void add(NodeNum from, NodeNum to, uint32_t time)
+{
+    PacketHistoryStruct packet = {};
+    packet.time = time;
+    packet.from = from;
+    packet.to = to;
+    packet.id = nextId++;
+    packet.payload_size = snprintf((char *)packet.payload, sizeof(packet.payload), "packet %u", packet.id);
+    history->add(packet);
+}
+
+/// Ids of the packets next() returns, until it runs out
+static std::vector<uint32_t> drain(NodeNum dest, uint32_t sinceTime)
+{
+    std::vector<uint32_t> ids;
+    while (const PacketHistoryStruct *packet = history->next(dest, sinceTime))
+        ids.push_back(packet->id);
+    return ids;
+}
+
+void setUp(void)
+{
+    history = new StoreForwardHistory();
+    nextId = 1;
+}
+
+void tearDown(void)
+{
+    delete history;
+}
+
+// Once full, each packet replaces the oldest one
+static void test_keeps_newest()
+{
+    TEST_ASSERT_TRUE(history->begin(8));
+    for (uint32_t i = 1; i <= 20; i++)
+        add(CLIENT_A, NODENUM_BROADCAST, i);
+
+    TEST_ASSERT_EQUAL(8, history->size());
+    TEST_ASSERT_EQUAL(8, history->getNumAvailable(CLIENT_B, 0));
+    std::vector<uint32_t> ids = drain(CLIENT_B, 0);
+    TEST_ASSERT_EQUAL(8, ids.size());
+    for (uint32_t i = 0; i < ids.size(); i++)
+        TEST_ASSERT_EQUAL(13 + i, ids[i]);
+}
+
+// A client gets broadcasts and its own direct messages, oldest first, but not what it sent
+static void test_filters_by_destination()
+{
+    TEST_ASSERT_TRUE(history->begin(16));
+    add(CLIENT_A, NODENUM_BROADCAST, 1); // 1
+    add(CLIENT_A, CLIENT_B, 2);          // 2
+    add(CLIENT_A, CLIENT_C, 3);          // 3
+    add(CLIENT_B, NODENUM_BROADCAST, 4); // 4
+    add(CLIENT_C, CLIENT_B, 5);          // 5
+    add(CLIENT_C, NODENUM_BROADCAST, 6); // 6
+
+    TEST_ASSERT_EQUAL(4, history->getNumAvailable(CLIENT_B, 0));
+    std::vector<uint32_t> ids = drain(CLIENT_B, 0);
+    TEST_ASSERT_EQUAL(4, ids.size());
+    TEST_ASSERT_EQUAL(1, ids[0]);
+    TEST_ASSERT_EQUAL(2, ids[1]);
+    TEST_ASSERT_EQUAL(5, ids[2]);
+    TEST_ASSERT_EQUAL(6, ids[3]);
+
+    ids = drain(CLIENT_C, 0);
+    TEST_ASSERT_EQUAL(3, ids.size());
+    TEST_ASSERT_EQUAL(1, ids[0]);
+    TEST_ASSERT_EQUAL(3, ids[1]);
+    TEST_ASSERT_EQUAL(4, ids[2]);
+}
+
+// A client picks up where it left off, including packets added in between
+static void test_resumes_after_last_request()
+{
+    TEST_ASSERT_TRUE(history->begin(16));
+    for (uint32_t i = 1; i <= 5; i++)
+        add(CLIENT_A, NODENUM_BROADCAST, i);
+
+    TEST_ASSERT_EQUAL(0, history->getLastRequest(CLIENT_B));
+    TEST_ASSERT_EQUAL(1, history->next(CLIENT_B, 0)->id);
+    TEST_ASSERT_EQUAL(2, history->next(CLIENT_B, 0)->id);
+    TEST_ASSERT_EQUAL(2, history->getLastRequest(CLIENT_B));
+
+    add(CLIENT_A, CLIENT_B, 6);
+    add(CLIENT_A, NODENUM_BROADCAST, 7);
+    TEST_ASSERT_EQUAL(5, history->getNumAvailable(CLIENT_B, 0));
+    std::vector<uint32_t> ids = drain(CLIENT_B, 0);
+    TEST_ASSERT_EQUAL(5, ids.size());
+    for (uint32_t i = 0; i < ids.size(); i++)
+        TEST_ASSERT_EQUAL(3 + i, ids[i]);
+    TEST_ASSERT_EQUAL(0, history->getNumAvailable(CLIENT_B, 0));
+
+    // Other clients are on their own
+    TEST_ASSERT_EQUAL(6, history->getNumAvailable(CLIENT_C, 0));
+}
+
+// Only packets newer than the requested window are sent
+static void test_since_time()
+{
+    TEST_ASSERT_TRUE(history->begin(16));
+    for (uint32_t i = 1; i <= 10; i++)
+        add(CLIENT_A, i % 2 ? NODENUM_BROADCAST : CLIENT_B, i * 100);
+
+    TEST_ASSERT_EQUAL(3, history->getNumAvailable(CLIENT_B, 700));
+    std::vector<uint32_t> ids = drain(CLIENT_B, 700);
+    TEST_ASSERT_EQUAL(3, ids.size());
+    TEST_ASSERT_EQUAL(8, ids[0]);
+
+    // A wider window on the next request doesn't resend what was already sent
+    TEST_ASSERT_EQUAL(0, history->getNumAvailable(CLIENT_B, 0));
+    TEST_ASSERT_NULL(history->next(CLIENT_B, 0));
+}
+
+// After a reboot the RTC may not be set yet, so a kept history can have packets older than the ones before them
+static void test_since_time_with_clock_going_backwards()
+{
+    TEST_ASSERT_TRUE(history->begin(16));
+    add(CLIENT_A, NODENUM_BROADCAST, 1000); // 1
+    add(CLIENT_A, CLIENT_B, 1001);          // 2
+    add(CLIENT_A, NODENUM_BROADCAST, 1002); // 3
+    add(CLIENT_A, CLIENT_B, 1003);          // 4
+    add(CLIENT_A, NODENUM_BROADCAST, 5);    // 5, rebooted
+    add(CLIENT_A, CLIENT_B, 6);             // 6
+    add(CLIENT_A, NODENUM_BROADCAST, 1004); // 7, got the time again
+
+    TEST_ASSERT_EQUAL(3, history->getNumAvailable(CLIENT_B, 1001));
+    std::vector<uint32_t> ids = drain(CLIENT_B, 1001);
+    TEST_ASSERT_EQUAL(3, ids.size());
+    TEST_ASSERT_EQUAL(3, ids[0]);
+    TEST_ASSERT_EQUAL(4, ids[1]);
+    TEST_ASSERT_EQUAL(7, ids[2]);
+
+    TEST_ASSERT_EQUAL(4, history->getNumAvailable(CLIENT_C, 0));
+    TEST_ASSERT_EQUAL(1, history->getNumAvailable(CLIENT_C, 1003));
+}
+
+// Packets replaced while a client is part way through are skipped, not resent
+static void test_overwritten_while_reading()
+{
+    TEST_ASSERT_TRUE(history->begin(4));
+    for (uint32_t i = 1; i <= 4; i++)
+        add(CLIENT_A, i % 2 ? NODENUM_BROADCAST : CLIENT_B, i);
+    TEST_ASSERT_EQUAL(1, history->next(CLIENT_B, 0)->id);
+
+    for (uint32_t i = 5; i <= 7; i++)
+        add(CLIENT_A, i % 2 ? NODENUM_BROADCAST : CLIENT_B, i);
+    std::vector<uint32_t> ids = drain(CLIENT_B, 0);
+    TEST_ASSERT_EQUAL(4, ids.size());
+    for (uint32_t i = 0; i < ids.size(); i++)
+        TEST_ASSERT_EQUAL(4 + i, ids[i]);
+}
+
+#ifdef ARCH_PORTDUINO
+// On Linux the history is a memory-mapped file, which a restart picks up again
+static void test_persists_across_restart()
+{
+    char path[] = "/tmp/storeforwardXXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    TEST_ASSERT_TRUE(history->begin(8, path));
+    TEST_ASSERT_TRUE(history->isPersistent());
+    for (uint32_t i = 1; i <= 12; i++)
+        add(CLIENT_A, i % 3 ? NODENUM_BROADCAST : CLIENT_B, i);
+
+    delete history;
+    history = new StoreForwardHistory();
+    TEST_ASSERT_TRUE(history->begin(8, path));
+    TEST_ASSERT_EQUAL(8, history->size());
+    std::vector<uint32_t> ids = drain(CLIENT_B, 0);
+    TEST_ASSERT_EQUAL(8, ids.size());
+    for (uint32_t i = 0; i < ids.size(); i++)
+        TEST_ASSERT_EQUAL(5 + i, ids[i]);
+
+    // Adding goes on after the restored packets
+    add(CLIENT_A, CLIENT_B, 13);
+    TEST_ASSERT_EQUAL(1, history->getNumAvailable(CLIENT_B, 0));
+    TEST_ASSERT_EQUAL(13, history->next(CLIENT_B, 0)->id);
+
+    // A file for another capacity starts over
+    delete history;
+    history = new StoreForwardHistory();
+    TEST_ASSERT_TRUE(history->begin(16, path));
+    TEST_ASSERT_EQUAL(0, history->size());
+
+    unlink(path);
+}
+#endif
+
+// Benchmark: a busy server with a big history, answering history requests from many clients
+static void test_benchmark_history_requests()
+{
+    const uint32_t capacity = 200000, numClients = 500, numRequests = 2000;
+    std::mt19937 rng(42);
+
+    TEST_ASSERT_TRUE(history->begin(capacity));
+    uint32_t start = millis();
+    for (uint32_t i = 1; i <= capacity + capacity / 2; i++) {
+        NodeNum from = 0x20000000 + rng() % numClients;
+        NodeNum to = rng() % 4 ? NODENUM_BROADCAST : 0x20000000 + rng() % numClients;
+        add(from, to, i);
+    }
+    uint32_t fillElapsed = millis() - start;
+
+    uint32_t sent = 0;
+    start = millis();
+    for (uint32_t i = 0; i < numRequests; i++) {
+        NodeNum client = 0x20000000 + rng() % numClients;
+        uint32_t sinceTime = capacity + capacity / 2 - rng() % 10000;
+        uint32_t available = history->getNumAvailable(client, sinceTime);
+        for (uint32_t j = 0; j < available && j < 25 && history->next(client, sinceTime); j++)
+            sent++;
+    }
+    uint32_t elapsed = millis() - start;
+
+    TEST_MSG_FMT("records=%u clients=%u fill=%ums requests=%u sent=%u elapsed=%ums", capacity, numClients, fillElapsed,
+                 numRequests, sent, elapsed);
+    TEST_ASSERT_EQUAL(capacity, history->size());
+    TEST_ASSERT_GREATER_THAN(0, sent);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_keeps_newest);
+    RUN_TEST(test_filters_by_destination);
+    RUN_TEST(test_resumes_after_last_request);
+    RUN_TEST(test_since_time);
+    RUN_TEST(test_since_time_with_clock_going_backwards);
+    RUN_TEST(test_overwritten_while_reading);
+#ifdef ARCH_PORTDUINO
+    RUN_TEST(test_persists_across_restart);
+#endif
+    RUN_TEST(test_benchmark_history_requests);
+    exit(UNITY_END());
+}
+
+void loop() {}